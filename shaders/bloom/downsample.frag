@@ -0,0 +1,41 @@
+#version 450
+
+
+layout(set = 0, binding = 0) uniform sampler2D srcTexture; // Previous level (twice the size of this one)
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+
+void main() {
+    // 13 bilinear taps around the center, weighted as in Jimenez, "Next Generation Post Processing in Call of Duty: Advanced Warfare"
+    // Wider than a 2x2 box, so small bright spots don't flicker as they move between texels of the smaller level
+    vec2 texel = 1.0 / textureSize(srcTexture, 0);
+    float x = texel.x;
+    float y = texel.y;
+
+    vec3 a = texture(srcTexture, fragTexCoord + vec2(-2.0 * x,  2.0 * y)).rgb;
+    vec3 b = texture(srcTexture, fragTexCoord + vec2( 0.0,      2.0 * y)).rgb;
+    vec3 c = texture(srcTexture, fragTexCoord + vec2( 2.0 * x,  2.0 * y)).rgb;
+
+    vec3 d = texture(srcTexture, fragTexCoord + vec2(-2.0 * x,  0.0)).rgb;
+    vec3 e = texture(srcTexture, fragTexCoord).rgb;
+    vec3 f = texture(srcTexture, fragTexCoord + vec2( 2.0 * x,  0.0)).rgb;
+
+    vec3 g = texture(srcTexture, fragTexCoord + vec2(-2.0 * x, -2.0 * y)).rgb;
+    vec3 h = texture(srcTexture, fragTexCoord + vec2( 0.0,     -2.0 * y)).rgb;
+    vec3 i = texture(srcTexture, fragTexCoord + vec2( 2.0 * x, -2.0 * y)).rgb;
+
+    vec3 j = texture(srcTexture, fragTexCoord + vec2(-x,  y)).rgb;
+    vec3 k = texture(srcTexture, fragTexCoord + vec2( x,  y)).rgb;
+    vec3 l = texture(srcTexture, fragTexCoord + vec2(-x, -y)).rgb;
+    vec3 m = texture(srcTexture, fragTexCoord + vec2( x, -y)).rgb;
+
+    vec3 result = e * 0.125;
+    result += (a + c + g + i) * 0.03125;
+    result += (b + d + f + h) * 0.0625;
+    result += (j + k + l + m) * 0.125;
+
+    outColor = vec4(result, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 450
+
+
+layout(set = 0, binding = 0) uniform BlurSettings
+{
+	float filterRadius;
+	float blurStrength;
+	uint levelCount;
+} bs;
+
+layout(set = 0, binding = 1) uniform sampler2D lowerTexture;   // Accumulated bloom of the next (half size) level
+layout(set = 0, binding = 2) uniform sampler2D currentTexture; // This level after blurring
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+
+void main() {
+    // 3x3 tent filter while upsampling, so the bilinear blocks of the small level don't show
+    vec2 r = bs.filterRadius / textureSize(lowerTexture, 0);
+
+    vec3 upsampled = texture(lowerTexture, fragTexCoord).rgb * 4.0;
+    upsampled += texture(lowerTexture, fragTexCoord + vec2(-r.x, 0.0)).rgb * 2.0;
+    upsampled += texture(lowerTexture, fragTexCoord + vec2( r.x, 0.0)).rgb * 2.0;
+    upsampled += texture(lowerTexture, fragTexCoord + vec2(0.0, -r.y)).rgb * 2.0;
+    upsampled += texture(lowerTexture, fragTexCoord + vec2(0.0,  r.y)).rgb * 2.0;
+    upsampled += texture(lowerTexture, fragTexCoord + vec2(-r.x, -r.y)).rgb;
+    upsampled += texture(lowerTexture, fragTexCoord + vec2( r.x, -r.y)).rgb;
+    upsampled += texture(lowerTexture, fragTexCoord + vec2(-r.x,  r.y)).rgb;
+    upsampled += texture(lowerTexture, fragTexCoord + vec2( r.x,  r.y)).rgb;
+    upsampled /= 16.0;
+
+    // Halve the weight of every coarser level, the sum over the chain stays at the brightness of one level
+    vec3 current = texture(currentTexture, fragTexCoord).rgb;
+    outColor = vec4(mix(current, upsampled, 0.5), 1.0);
+}
@@ -3,8 +3,9 @@
 
 layout(set = 0, binding = 0) uniform BlurSettings
 {
-	float blurScale;
+	float filterRadius;
 	float blurStrength;
+	uint levelCount;
 } bs;
 
 layout(set = 0, binding = 1) uniform sampler2D samplerColor; // Input texture (from the previous pass)
@@ -19,7 +20,7 @@ layout(location = 0) out vec4 outColor;
 void main() {
     float weight[5] = float[] (0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
 
-    vec2 texOffset = 1.0 / textureSize(samplerColor, 0) * bs.blurScale;
+    vec2 texOffset = 1.0 / textureSize(samplerColor, 0) * bs.filterRadius;
     vec3 result = texture(samplerColor, fragTexCoord).rgb * weight[0]; // Current fragment's color
     for (int i = 1; i < 5; i++) {
         if (blurDirection == 1)
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 // Per-frame variables (set 0 is per-frame descriptor set)
 layout(set = 0, binding = 0) uniform SceneInfo {
@@ -13,13 +14,19 @@ layout(set = 0, binding = 0) uniform SceneInfo {
 // Per-model variabales that change a lot 
 layout(push_constant) uniform PushConstants {
     mat4 model;
+    uvec2 virtualTextures;  // Replace the base color and unlit textures unless VIRTUAL_TEXTURE_NONE
+    uint baseColor;         // Indices into the bindless textures
+    uint unlitColor;
+    uint normalMap;
+    uint specular;
+    uint overlayColor;
 } pc;
 
-layout(set = 1, binding = 0) uniform sampler2D baseColorTexture;
-layout(set = 1, binding = 1) uniform sampler2D unlitColorTexture;
-layout(set = 1, binding = 2) uniform sampler2D normalMapTexture;
-layout(set = 1, binding = 3) uniform sampler2D specularTexture;
-layout(set = 1, binding = 4) uniform sampler2D overlayColorTexture;
+#define BINDLESS_SET 1
+#include "../include/bindless.glsl"
+
+#define VIRTUAL_TEXTURE_SET 2
+#include "../include/virtualtexture.glsl"
 
 layout(location = 0) in vec4 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
@@ -30,6 +37,7 @@ layout(location = 5) in vec3 worldViewPosition;
 layout(location = 6) in vec3 normalView;
 
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outGlow;   // Black, the earth occludes the glow behind it
 
 void main() {
     vec3 N = normalize(worldNormal);
@@ -50,15 +58,21 @@ void main() {
 
     vec3 normalTBN = vec3(0.0, 0.0, 1.0);
     float normalDot = dot(normalTBN, lightDirTBN);
-    normalTBN = texture(normalMapTexture, fragTexCoord).rgb * 2.0 - 1.0;
+    // Only xy is stored (BC5 has two channels), z is rebuilt from the unit length
+    normalTBN.xy = texture(bindlessTextures[pc.normalMap], fragTexCoord).rg * 2.0 - 1.0;
+    normalTBN.z = sqrt(max(0.0, 1.0 - dot(normalTBN.xy, normalTBN.xy)));
     float diffuseDot = dot(normalTBN, lightDirTBN);
     
     float mixAmount = 1.0;
     vec3 color = fragColor.rgb;
-    vec4 baseColor = texture(baseColorTexture, fragTexCoord);
+    vec4 baseColor = pc.virtualTextures.x != VIRTUAL_TEXTURE_NONE
+        ? sampleVirtualTexture(pc.virtualTextures.x, fragTexCoord)
+        : texture(bindlessTextures[pc.baseColor], fragTexCoord);
     color = baseColor.rgb;
 
-    vec4 unlitColor = texture(unlitColorTexture, fragTexCoord);
+    vec4 unlitColor = pc.virtualTextures.y != VIRTUAL_TEXTURE_NONE
+        ? sampleVirtualTexture(pc.virtualTextures.y, fragTexCoord)
+        : texture(bindlessTextures[pc.unlitColor], fragTexCoord);
 
     mixAmount = 1. / (1. + exp(-20. * normalDot));
     mixAmount *= 1.0 + 5.0 * (diffuseDot - normalDot);
@@ -66,7 +80,7 @@ void main() {
     color = mix(unlitColor, baseColor, mixAmount).rgb;
    
     float reflectRatio = 0.12;
-    reflectRatio *= texture(specularTexture, fragTexCoord).r;
+    reflectRatio *= texture(bindlessTextures[pc.specular], fragTexCoord).r;
     reflectRatio += 0.03;
 
     vec3 viewDir = normalize(si.cameraPosition - worldPosition.xyz);
@@ -79,12 +93,12 @@ void main() {
     // Cloud shadow effect
     //vec3 originalNormal = vec3(0.0, 0.0, 1.0);
     vec3 shadowVec = 0.007 * TBN_to_world * (lightDirTBN - normalTBN) * normalDot;
-    vec4 cloudShadow = texture(overlayColorTexture, fragTexCoord - shadowVec.xy);
+    vec4 cloudShadow = texture(bindlessTextures[pc.overlayColor], fragTexCoord - shadowVec.xy);
     color *= (1.0 - cloudShadow.a * 0.5);
 
     // Cloud color effect
     float mixAmountHemisphere = clamp(1. / (1. + exp(-20. * normalDot)),0.0, 1.0);
-    vec4 cloudsColor = texture(overlayColorTexture, fragTexCoord);
+    vec4 cloudsColor = texture(bindlessTextures[pc.overlayColor], fragTexCoord);
     cloudsColor.r *= clamp(mixAmountHemisphere, 0.1, 1.);
     cloudsColor.g *= clamp(pow(mixAmountHemisphere, 1.5), 0.1, 1.);
     cloudsColor.b *= clamp(pow(mixAmountHemisphere, 2.0), 0.1, 1.); // Blue light is less scattered than red light
@@ -93,5 +107,6 @@ void main() {
     color = color * (1. - cloudsColor.a) + cloudsColor.rgb * cloudsColor.a;
 
     outColor = vec4(color, 1.0);
+    outGlow = vec4(0.0, 0.0, 0.0, 1.0);
 }
 
@@ -1,27 +0,0 @@
-#version 450
-
-// Per-frame variables (set 0 is per-frame descriptor set)
-layout(set = 0, binding = 0) uniform SceneInfo {
-    mat4 view;
-    mat4 proj;
-
-    float time;
-    vec3 cameraPosition;
-    vec3 lightColor;
-} si;
-
-// Per-model variabales that change a lot 
-layout(push_constant) uniform PushConstants {
-    mat4 model;
-    vec3 glowColor;
-} pc;
-
-
-layout(location = 0) in vec3 positionView;
-layout(location = 1) in vec3 normalView;
-
-layout(location = 0) out vec4 outColor;
-
-void main() {
-    outColor = vec4(pc.glowColor, 1.0f);
-}
\ No newline at end of file
@@ -10,18 +10,14 @@ layout(set = 0, binding = 0) uniform SceneInfo {
     vec3 lightColor;
 } si;
 
-// Per-model variabales that change a lot 
+// Per-model variables
 layout(push_constant) uniform PushConstants {
     mat4 model;
-} pc;
-
-// Per-model variables that don't change a lot (set 1 is per-model descriptor set)
-layout(set = 1, binding = 0) uniform atmosphereInfo {
     vec4 color;
     float coeffScatter;
     float powScatter;
     int isLightSource;
-} ai;
+} pc;
 
 layout(location = 0) in vec4 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
@@ -32,6 +28,7 @@ layout(location = 5) in vec3 positionView;
 layout(location = 6) in vec3 normalView;
 
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outGlow;   // Light sources only show up in the glow, atmospheres only in the scene
 
 void main() {
     vec3 center = pc.model[3].xyz;
@@ -43,13 +40,22 @@ void main() {
     float mixAmount = 1. / (1. + exp(-7. * (normalDot + 0.1))); // Calculate the mix amount based on the dot product
 
     //vec3 viewDir = normalize(si.cameraPosition - worldPosition.xyz);
-    float raw_intensity = ai.coeffScatter * max(dot(positionView, normalView), 0.);
-    float intensity = pow(raw_intensity, ai.powScatter); // Apply the power scatter effect
+    float raw_intensity = pc.coeffScatter * max(dot(positionView, normalView), 0.);
+    float intensity = pow(raw_intensity, pc.powScatter); // Apply the power scatter effect
 
-    if (ai.isLightSource == 1) {
+    if (pc.isLightSource == 1) {
         mixAmount = 1.0; // If it's a light source, set mixAmount to 1.0
     }
-    outColor = vec4(ai.color.rgb, ai.color.a * intensity) * mixAmount;
+    vec4 color = vec4(pc.color.rgb, pc.color.a * intensity) * mixAmount;
+
+    // Alpha 0 leaves the other attachment as it is
+    if (pc.isLightSource == 1) {
+        outColor = vec4(0.0);
+        outGlow = color;
+    } else {
+        outColor = color;
+        outGlow = vec4(0.0);
+    }
 }
 
 
@@ -0,0 +1,8 @@
+// Bindless texture table (see BindlessTextures). Define BINDLESS_SET before including.
+// Needs GL_GOOGLE_include_directive in the including shader.
+#extension GL_EXT_nonuniform_qualifier : require
+
+const uint BINDLESS_NONE = 0xFFFFFFFFu;
+
+layout(set = BINDLESS_SET, binding = 0) uniform sampler2D bindlessTextures[];
+layout(set = BINDLESS_SET, binding = 1) uniform samplerCube bindlessCubemaps[];
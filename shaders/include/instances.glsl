@@ -0,0 +1,29 @@
+// Per-body data of instanced draws (see InstancedBodies). Define INSTANCE_SET before including.
+// Needs GL_GOOGLE_include_directive in the including shader.
+
+struct InstanceData {
+    mat4 model;
+    uvec2 virtualTextures;  // x replaces the base color texture unless it is VIRTUAL_TEXTURE_NONE
+    uint baseColor;         // Index into the bindless textures
+    uint padding;
+    vec4 shading;           // Tint (rgb), specular strength
+};
+
+// The dynamic offset selects the batch of this frame
+layout(std430, set = INSTANCE_SET, binding = 0) readonly buffer Instances {
+    InstanceData instances[];
+};
+
+// Index of the instance drawn by gl_InstanceIndex. GPU culled draws (define INSTANCE_VISIBLE_SET, see GpuCulling)
+// read it from the batch's visible indices, which start at the pushed firstVisible (firstInstance is 0).
+#ifdef INSTANCE_VISIBLE_SET
+layout(std430, set = INSTANCE_VISIBLE_SET, binding = 1) readonly buffer VisibleInstances {
+    uint visibleInstances[];
+};
+layout(push_constant) uniform VisiblePushConstants {
+    uint firstVisible;
+} visiblePc;
+#define INSTANCE_INDEX visibleInstances[visiblePc.firstVisible + gl_InstanceIndex]
+#else
+#define INSTANCE_INDEX gl_InstanceIndex
+#endif
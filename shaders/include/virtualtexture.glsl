@@ -0,0 +1,100 @@
+// Sparse virtual textures (see VirtualTextureSystem). Define VIRTUAL_TEXTURE_SET before including, and
+// VIRTUAL_TEXTURE_FEEDBACK in the feedback pass (it writes a storage buffer, the others must not).
+// Needs GL_GOOGLE_include_directive in the including shader.
+
+const uint VIRTUAL_TEXTURE_NONE = 0xFFFFFFFFu;
+
+struct VirtualTextureInfo {
+    uvec4 info;         // mip count, width, height, -
+    uvec4 mips[16];     // width, height, tilesX | tilesY << 16, first entry
+};
+
+// Physical tiles, every tile has a border so bilinear filtering stays inside it
+layout(set = VIRTUAL_TEXTURE_SET, binding = 0) uniform sampler2D virtualAtlas;
+
+// Entry per tile: atlas slot x | slot y << 12 | mip << 24 of the tile or its closest resident ancestor
+layout(std430, set = VIRTUAL_TEXTURE_SET, binding = 1) readonly buffer VirtualPageTable {
+    uvec4 atlas;        // tiles per row, tile size, border, atlas size
+    VirtualTextureInfo textures[32];
+    uint entries[];
+} vtPageTable;
+
+// Tiles the frame wants, written by the feedback pass only
+#ifdef VIRTUAL_TEXTURE_FEEDBACK
+layout(std430, set = VIRTUAL_TEXTURE_SET, binding = 2) buffer VirtualFeedback {
+    uint requests[];
+} vtFeedback;
+#endif
+
+
+// Level of detail like the hardware would pick it for the full texture
+float virtualTextureLod(uint id, vec2 uv) {
+    vec2 texel = uv * vec2(vtPageTable.textures[id].info.yz);
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    return 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+}
+
+
+// Horizontally the maps wrap, vertically they end at the poles
+vec2 virtualTextureWrap(vec2 uv) {
+    return vec2(fract(uv.x), clamp(uv.y, 0.0, 1.0));
+}
+
+
+uvec2 virtualTextureTile(uvec4 level, vec2 texel) {
+    uvec2 tiles = uvec2(level.z & 0xFFFFu, level.z >> 16);
+    return min(uvec2(texel) / vtPageTable.atlas.y, tiles - 1u);
+}
+
+
+uint virtualTexturePage(uvec4 level, uvec2 tile) {
+    return level.w + tile.y * (level.z & 0xFFFFu) + tile.x;
+}
+
+
+vec4 sampleVirtualTextureMip(uint id, vec2 uv, uint mip) {
+    uvec4 level = vtPageTable.textures[id].mips[mip];
+    uint entry = vtPageTable.entries[virtualTexturePage(level, virtualTextureTile(level, uv * vec2(level.xy)))];
+    if (entry == VIRTUAL_TEXTURE_NONE) return vec4(0.5, 0.5, 0.5, 1.0); // Nothing resident yet
+
+    // The entry may be an ancestor, find the texel in its level
+    uint tileSize = vtPageTable.atlas.y;
+    uint border = vtPageTable.atlas.z;
+    uvec4 resident = vtPageTable.textures[id].mips[entry >> 24];
+    vec2 texel = uv * vec2(resident.xy);
+    vec2 inTile = clamp(texel - vec2(virtualTextureTile(resident, texel) * tileSize), vec2(0.0), vec2(tileSize));
+
+    vec2 slot = vec2(entry & 0xFFFu, (entry >> 12) & 0xFFFu);
+    vec2 atlasTexel = slot * float(tileSize + 2u * border) + float(border) + inTile;
+    return textureLod(virtualAtlas, atlasTexel / float(vtPageTable.atlas.w), 0.0);
+}
+
+
+// Trilinear: the atlas has no mips, the two levels are blended here
+vec4 sampleVirtualTexture(uint id, vec2 uv) {
+    uint mipCount = vtPageTable.textures[id].info.x;
+    float lod = clamp(virtualTextureLod(id, uv), 0.0, float(mipCount - 1u));
+    uv = virtualTextureWrap(uv);
+
+    uint mip = uint(lod);
+    float blend = lod - float(mip);
+    vec4 color = sampleVirtualTextureMip(id, uv, mip);
+    if (blend > 0.0 && mip + 1u < mipCount) {
+        color = mix(color, sampleVirtualTextureMip(id, uv, mip + 1u), blend);
+    }
+    return color;
+}
+
+
+#ifdef VIRTUAL_TEXTURE_FEEDBACK
+// Marks the tile sampleVirtualTexture would read. lodBias makes up for a lower resolution feedback pass.
+void requestVirtualTexture(uint id, vec2 uv, float lodBias) {
+    uint mipCount = vtPageTable.textures[id].info.x;
+    float lod = clamp(virtualTextureLod(id, uv) + lodBias, 0.0, float(mipCount - 1u));
+    uv = virtualTextureWrap(uv);
+
+    uvec4 level = vtPageTable.textures[id].mips[uint(lod)];
+    vtFeedback.requests[virtualTexturePage(level, virtualTextureTile(level, uv * vec2(level.xy)))] = 1u;
+}
+#endif
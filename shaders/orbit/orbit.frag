@@ -14,6 +14,7 @@ layout(location = 0) in vec4 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outGlow;   // Orbits leave the glow untouched (alpha 0)
 
 void main() {
     // draw a circle with smooth edges
@@ -34,5 +35,6 @@ void main() {
     float gradient = mix(0.01, 0.1, (angle / 3.1415) - 0.2); // Smooth transition from center to edge
 
     outColor = vec4(1.0, 1.0, 1.0, gradient); // Set the color to white
+    outGlow = vec4(0.0);
 }
 
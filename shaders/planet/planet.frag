@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 // Per-frame variables (set 0 is per-frame descriptor set)
 layout(set = 0, binding = 0) uniform SceneInfo {
@@ -10,12 +11,11 @@ layout(set = 0, binding = 0) uniform SceneInfo {
     vec3 lightColor;
 } si;
 
-// Per-model variabales that change a lot 
-layout(push_constant) uniform PushConstants {
-    mat4 model;
-} pc;
+#define BINDLESS_SET 1
+#include "../include/bindless.glsl"
 
-layout(set = 1, binding = 0) uniform sampler2D baseColorTexture;
+#define VIRTUAL_TEXTURE_SET 2
+#include "../include/virtualtexture.glsl"
 
 layout(location = 0) in vec4 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
@@ -24,11 +24,15 @@ layout(location = 3) in vec3 worldNormal;
 layout(location = 4) in vec3 worldTangent;
 layout(location = 5) in vec3 worldViewPosition;
 layout(location = 6) in vec3 normalView;
+layout(location = 7) flat in uvec3 fragTextures;   // x replaces the base color (z, bindless) unless it is VIRTUAL_TEXTURE_NONE
+layout(location = 8) flat in vec4 fragShading;     // Tint, specular strength
+layout(location = 9) flat in vec3 fragCenter;      // Per draw (planet.vert) or per instance (planet_instanced.vert)
 
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outGlow;   // Black, planets occlude the glow behind them
 
 void main() {
-    vec3 center = pc.model[3].xyz;
+    vec3 center = fragCenter;
     vec3 lightPosition = vec3(0.0, 0.0, 0.0);
     vec3 lightDir = normalize(lightPosition - center); // Vector from center to light position
     vec3 viewDir = normalize(si.cameraPosition - worldPosition.xyz); // Vector from fragment position to camera position
@@ -37,7 +41,10 @@ void main() {
     float NdotL = dot(worldNormal, lightDir); // Normal dot Light in TBN 
 
     vec3 unlitColor = vec3(0.0); // Unlit color, can be adjusted
-    vec3 litColor = texture(baseColorTexture, fragTexCoord).rgb;
+    vec3 litColor = fragTextures.x != VIRTUAL_TEXTURE_NONE
+        ? sampleVirtualTexture(fragTextures.x, fragTexCoord).rgb
+        : texture(bindlessTextures[nonuniformEXT(fragTextures.z)], fragTexCoord).rgb;
+    litColor *= fragShading.rgb;
 
     float mixAmount = 1. / (1. + exp(-20. * (NdotL - 0.15)));
     vec3 color = mix(unlitColor, litColor, mixAmount).rgb;
@@ -45,7 +52,7 @@ void main() {
 
     //Specular
     float specPower = dot(reflectDir, viewDir);
-    color += mixAmount * pow(specPower, 4.0) * 0.2;
+    color += mixAmount * pow(specPower, 4.0) * fragShading.a;
 
     // // Specular (Phong)
     // //vec3 halfVector = normalize(lightDirTBN + viewDirTBN);
@@ -65,6 +72,7 @@ void main() {
 
 
     outColor = vec4(color, 1.0);
+    outGlow = vec4(0.0, 0.0, 0.0, 1.0);
 
     // float mixAmount = 1.0;
     // mixAmount = 1. / (1. + exp(-20. * normalDot));
@@ -13,6 +13,8 @@ layout(set = 0, binding = 0) uniform SceneInfo {
 // Per-model variabales that change a lot 
 layout(push_constant) uniform PushConstants {
     mat4 model;
+    uvec2 virtualTextures;
+    uint baseColor;
 } pc;
 
 layout(location = 0) in vec3 inPosition; // Vertex position
@@ -29,6 +31,9 @@ layout(location = 3) out vec3 worldNormal;
 layout(location = 4) out vec3 worldTangent;
 layout(location = 5) out vec3 positionView;
 layout(location = 6) out vec3 normalView;
+layout(location = 7) flat out uvec3 fragTextures;  // Virtual textures, bindless base color
+layout(location = 8) flat out vec4 fragShading;    // Tint, specular strength
+layout(location = 9) flat out vec3 fragCenter;
 
 void main() {
     worldPosition = pc.model * vec4(inPosition, 1.0);
@@ -42,4 +47,8 @@ void main() {
     gl_Position = si.proj * si.view * worldPosition;
     fragColor = inColor;
     fragTexCoord = inTexCoord;
+
+    fragTextures = uvec3(pc.virtualTextures, pc.baseColor);
+    fragShading = vec4(1.0, 1.0, 1.0, 0.2);
+    fragCenter = pc.model[3].xyz;
 }
\ No newline at end of file
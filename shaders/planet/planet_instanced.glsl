@@ -0,0 +1,56 @@
+// Vertex shader of the instanced planets (planet_instanced.vert and planet_instanced_culled.vert), included after
+// #version and GL_GOOGLE_include_directive
+
+// Per-frame variables (set 0 is per-frame descriptor set)
+layout(set = 0, binding = 0) uniform SceneInfo {
+    mat4 view;
+    mat4 proj;
+
+    float time;
+    vec3 cameraPosition;
+    vec3 lightColor;
+} si;
+
+// Per-body variables, one entry per instance (sets 1 and 2 are the planet.frag textures)
+#define INSTANCE_SET 3
+#include "../include/instances.glsl"
+
+layout(location = 0) in vec3 inPosition; // Vertex position
+layout(location = 1) in vec4 inColor;    // Vertex color
+layout(location = 2) in vec2 inTexCoord; // Vertex texture coordinate
+layout(location = 3) in vec3 inNormal;   // Vertex normal
+layout(location = 4) in vec3 inTangent;  // Vertex tangent
+
+// Same outputs as planet.vert, planet.frag shades both
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec4 worldPosition;
+layout(location = 3) out vec3 worldNormal;
+layout(location = 4) out vec3 worldTangent;
+layout(location = 5) out vec3 positionView;
+layout(location = 6) out vec3 normalView;
+layout(location = 7) flat out uvec3 fragTextures;  // Virtual textures, bindless base color
+layout(location = 8) flat out vec4 fragShading;    // Tint, specular strength
+layout(location = 9) flat out vec3 fragCenter;
+
+void main() {
+    InstanceData instance = instances[INSTANCE_INDEX];
+
+    // Asteroids are scaled unevenly, so normals go through the normal matrix
+    mat3 normalMatrix = transpose(inverse(mat3(instance.model)));
+
+    worldPosition = instance.model * vec4(inPosition, 1.0);
+    worldNormal = normalize(normalMatrix * inNormal);
+    worldTangent = normalize(mat3(instance.model) * inTangent);
+
+    normalView = normalize(mat3(si.view) * worldNormal);
+    positionView = normalize((si.view * worldPosition).xyz);
+
+    gl_Position = si.proj * si.view * worldPosition;
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+
+    fragTextures = uvec3(instance.virtualTextures, instance.baseColor);
+    fragShading = instance.shading;
+    fragCenter = instance.model[3].xyz;
+}
@@ -0,0 +1,5 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// CPU submitted: gl_InstanceIndex is the instance
+#include "planet_instanced.glsl"
@@ -0,0 +1,6 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// GPU culled (see GpuCulling): the instances come through the visible indices of the culling set
+#define INSTANCE_VISIBLE_SET 4
+#include "planet_instanced.glsl"
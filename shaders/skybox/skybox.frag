@@ -1,12 +1,21 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
-layout (set = 1, binding = 0) uniform samplerCube samplerCubeMap;
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    uint cubemap;       // Index into the bindless cubemaps
+} pc;
+
+#define BINDLESS_SET 1
+#include "../include/bindless.glsl"
 
 layout (location = 0) in vec3 inUVW;
 
 layout (location = 0) out vec4 outFragColor;
+layout (location = 1) out vec4 outGlow;       // Nothing glows in the background
 
 void main() 
 {
-	outFragColor = texture(samplerCubeMap, inUVW);
+	outFragColor = texture(bindlessCubemaps[pc.cubemap], inUVW);
+	outGlow = vec4(0.0, 0.0, 0.0, 1.0);
 }
\ No newline at end of file
@@ -30,6 +30,7 @@ layout(location = 5) in vec3 worldViewPosition;
 layout(location = 6) in vec3 normalView;
 
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outGlow;   // The sun glows in its own color
 
 
 // 2D Random
@@ -121,4 +122,5 @@ void main() {
     color = mix(vec3(.9, 0.15, 0.), vec3(.9, .7, .0), n*n);
     color = mix(color, vec3(.9, 0., 0.), q);
     outColor = vec4(color, 1.);
+    outGlow = outColor;
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Virtual texture feedback: marks the tiles every visible pixel of a virtual textured model samples.
+// Depth only, so hidden surfaces request nothing.
+layout(early_fragment_tests) in;
+
+#define VIRTUAL_TEXTURE_SET 2
+#define VIRTUAL_TEXTURE_FEEDBACK
+#include "../include/virtualtexture.glsl"
+
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    uvec2 virtualTextures;
+} pc;
+
+// log2 of the pass resolution relative to the main pass
+layout(constant_id = 0) const float lodBias = -2.0;
+
+layout(location = 1) in vec2 fragTexCoord;
+
+void main() {
+    if (pc.virtualTextures.x != VIRTUAL_TEXTURE_NONE) requestVirtualTexture(pc.virtualTextures.x, fragTexCoord, lodBias);
+    if (pc.virtualTextures.y != VIRTUAL_TEXTURE_NONE) requestVirtualTexture(pc.virtualTextures.y, fragTexCoord, lodBias);
+}
@@ -0,0 +1,149 @@
+#include "BindlessTextures.h"
+
+
+BindlessTextures::BindlessTextures(VkPhysicalDevice physicalDevice, VkDevice device, DeletionQueue& deletionQueue)
+    : _device(device), _deletionQueue(deletionQueue)
+{
+    // Both arrays count against the per stage limit of update-after-bind samplers
+    VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+    vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &vulkan12Properties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    const uint32_t limit = std::min(vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                    vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+    _cubemaps = { 1, std::min(MaxCubemaps, limit / 2) };
+    _textures = { 0, std::min(MaxTextures, limit - _cubemaps.capacity) };
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    for (const Binding* binding : { &_textures, &_cubemaps }) {
+        VkDescriptorSetLayoutBinding& layoutBinding = bindings[binding->binding];
+        layoutBinding.binding = binding->binding;
+        layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        layoutBinding.descriptorCount = binding->capacity;
+        layoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    // Slots nobody registered are never written (partially bound), and writing a slot does not touch the
+    // frames in flight that sample other slots (update after bind, unused while pending)
+    const VkDescriptorBindingFlags bindingFlag = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+        | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    std::array<VkDescriptorBindingFlags, 2> bindingFlags = { bindingFlag, bindingFlag };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless descriptor set layout!");
+    }
+
+    // Its own pool, update-after-bind sets need a pool created for them
+    VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _textures.capacity + _cubemaps.capacity };
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bindless descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = _descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(_device, &allocInfo, &_descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate bindless descriptor set!");
+    }
+
+    spdlog::info("Bindless texture table created successfully ({} textures, {} cubemaps)", _textures.capacity, _cubemaps.capacity);
+}
+
+
+BindlessTextures::~BindlessTextures()
+{
+    vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(_device, _descriptorSetLayout, nullptr);
+}
+
+
+uint32_t BindlessTextures::addTexture(const VkDescriptorImageInfo& imageInfo)
+{
+    return add(_textures, imageInfo);
+}
+
+
+uint32_t BindlessTextures::addCubemap(const VkDescriptorImageInfo& imageInfo)
+{
+    return add(_cubemaps, imageInfo);
+}
+
+
+uint32_t BindlessTextures::replaceTexture(uint32_t index, const VkDescriptorImageInfo& imageInfo)
+{
+    removeTexture(index);
+    return add(_textures, imageInfo);
+}
+
+
+void BindlessTextures::removeTexture(uint32_t index)
+{
+    remove(_textures, index);
+}
+
+
+void BindlessTextures::removeCubemap(uint32_t index)
+{
+    remove(_cubemaps, index);
+}
+
+
+uint32_t BindlessTextures::add(Binding& binding, const VkDescriptorImageInfo& imageInfo)
+{
+    uint32_t index;
+    if (!binding.freeSlots.empty()) {
+        index = binding.freeSlots.back();
+        binding.freeSlots.pop_back();
+    } else if (binding.used < binding.capacity) {
+        index = binding.used++;
+    } else {
+        throw std::runtime_error("Bindless texture table is full!");
+    }
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = _descriptorSet;
+    write.dstBinding = binding.binding;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+
+    return index;
+}
+
+
+void BindlessTextures::remove(Binding& binding, uint32_t index)
+{
+    if (index == None) return;
+
+    // Frames in flight may still sample the slot
+    _deletionQueue.push([&binding, index]() { binding.freeSlots.push_back(index); });
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "stdafx.h"
+#include "DeletionQueue.h"
+
+
+// One descriptor set with every texture of the scene (descriptor indexing, core in Vulkan 1.2). A texture is
+// registered once and keeps its index, draws pass the indices in push constants and the set is bound as it is,
+// so models need no descriptor sets of their own.
+//
+// Shaders include shaders/include/bindless.glsl: bindlessTextures[] (binding 0) and bindlessCubemaps[] (binding 1).
+// Slots are written with update-after-bind, so textures can be added while frames using the set are in flight.
+// A removed slot is reused only once the frames submitted so far have completed.
+class BindlessTextures
+{
+public:
+    static constexpr uint32_t None = UINT32_MAX;
+    static constexpr uint32_t MaxTextures = 1024;
+    static constexpr uint32_t MaxCubemaps = 16;
+
+    BindlessTextures(VkPhysicalDevice physicalDevice, VkDevice device, DeletionQueue& deletionQueue);
+    ~BindlessTextures();
+
+    BindlessTextures(const BindlessTextures&) = delete;
+    BindlessTextures& operator=(const BindlessTextures&) = delete;
+
+    // Registers a texture (its getDescriptorInfo()), returns its index. The texture must outlive the index.
+    uint32_t addTexture(const VkDescriptorImageInfo& imageInfo);
+    uint32_t addCubemap(const VkDescriptorImageInfo& imageInfo);
+
+    // Registers the new texture and removes the old index (None adds only), returns the new index
+    uint32_t replaceTexture(uint32_t index, const VkDescriptorImageInfo& imageInfo);
+
+    // Frees the index once the frames submitted so far have completed (None is ignored)
+    void removeTexture(uint32_t index);
+    void removeCubemap(uint32_t index);
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return _descriptorSetLayout; }
+    VkDescriptorSet getDescriptorSet() const { return _descriptorSet; }
+
+private:
+    VkDevice _device;
+    DeletionQueue& _deletionQueue;
+
+    VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+
+    struct Binding {
+        uint32_t binding;
+        uint32_t capacity;
+        uint32_t used = 0;                  // Slots handed out at least once
+        std::vector<uint32_t> freeSlots;
+    };
+    Binding _textures;
+    Binding _cubemaps;
+
+    uint32_t add(Binding& binding, const VkDescriptorImageInfo& imageInfo);
+    void remove(Binding& binding, uint32_t index);
+};
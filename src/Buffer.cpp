@@ -15,28 +15,19 @@ Buffer::~Buffer()
 void Buffer::initialize(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
 {
     // Create the buffer and allocate memory for it
-    VulkanHelper::createBuffer(_ctx, size, usage, properties, _buffer, _bufferMemory);
+    VulkanHelper::createBuffer(_ctx, size, usage, properties, _buffer, _allocation);
 
-    // Map the memory to the buffer
-    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
-        vkMapMemory(_ctx->device, _bufferMemory, 0, size, 0, &_mappedMemory);
-    }
+    // Host visible memory is mapped by the allocator for its whole lifetime
+    _mappedMemory = _allocation.mapped;
 }
 
 void Buffer::destroy()
 {
-    // Unmap the memory if it was mapped
-    if (_mappedMemory) {
-        vkUnmapMemory(_ctx->device, _bufferMemory);
-        _mappedMemory = nullptr;
-    }
+    _mappedMemory = nullptr;
 
-    // Destroy the buffer and free the memory
+    // Destroy the buffer and release its memory
     if (_buffer) {
-        vkDestroyBuffer(_ctx->device, _buffer, nullptr);
-        vkFreeMemory(_ctx->device, _bufferMemory, nullptr);
-        _buffer = VK_NULL_HANDLE;
-        _bufferMemory = VK_NULL_HANDLE;
+        VulkanHelper::destroyBuffer(_ctx, _buffer, _allocation);
     }
 }
 
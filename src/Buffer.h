@@ -13,7 +13,8 @@ public:
     void destroy();
 
     VkBuffer getBuffer() const { return _buffer; }
-    VkDeviceMemory getMemory() const { return _bufferMemory; }
+    VkDeviceMemory getMemory() const { return _allocation.memory; }
+    VkDeviceSize getMemoryOffset() const { return _allocation.offset; }
     void* getMappedMemory() const { return _mappedMemory; }
 
     void copyData(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
@@ -23,6 +24,6 @@ private:
     std::shared_ptr<VulkanContext> _ctx;
 
     VkBuffer _buffer = VK_NULL_HANDLE;
-    VkDeviceMemory _bufferMemory = VK_NULL_HANDLE;
+    Allocation _allocation;
     void* _mappedMemory = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "CommandRecorder.h"
+#include "utilities/ThreadPool.h"
+#include "utilities/Tracer.h"
+
+
+CommandRecorder::CommandRecorder(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight)
+    : _ctx(std::move(ctx)), _ownerThread(std::this_thread::get_id())
+{
+    _threadCount = ThreadPool::getInstance()->getThreadCount();
+
+    QueueFamilyIndices queueFamilyIndices = VulkanHelper::findQueueFamilies(_ctx->physicalDevice, _ctx->surface);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // Reset as a whole, never per buffer
+
+    _pools.resize(framesInFlight);
+    for (auto& framePools : _pools) {
+        framePools.resize(_threadCount);
+        for (auto& pool : framePools) {
+            if (vkCreateCommandPool(_ctx->device, &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create per-thread command pool!");
+            }
+        }
+    }
+
+    spdlog::info("Command recorder created successfully ({} threads x {} frames)", _threadCount, framesInFlight);
+}
+
+
+CommandRecorder::~CommandRecorder()
+{
+    // Destroying a pool frees its command buffers
+    for (auto& framePools : _pools) {
+        for (auto& pool : framePools) {
+            vkDestroyCommandPool(_ctx->device, pool.commandPool, nullptr);
+        }
+    }
+}
+
+
+void CommandRecorder::beginFrame(uint32_t frameIndex)
+{
+    _currentFrame = frameIndex;
+    for (auto& pool : _pools[frameIndex]) {
+        if (pool.used == 0) continue;
+        vkResetCommandPool(_ctx->device, pool.commandPool, 0);
+        pool.used = 0;
+    }
+}
+
+
+uint32_t CommandRecorder::getChunkCount(uint32_t drawCount, uint32_t minDrawsPerChunk) const
+{
+    if (!_parallel || drawCount == 0) return 1;
+    uint32_t chunks = (drawCount + minDrawsPerChunk - 1) / minDrawsPerChunk;
+    return std::clamp(chunks, 1u, _threadCount);
+}
+
+
+VkCommandBuffer CommandRecorder::acquireCommandBuffer(uint32_t threadIndex)
+{
+    // Only the owning thread touches this pool during the frame
+    ThreadCommandPool& pool = _pools[_currentFrame][threadIndex];
+
+    if (pool.used == pool.commandBuffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(_ctx->device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate secondary command buffer!");
+        }
+        pool.commandBuffers.push_back(commandBuffer);
+    }
+
+    return pool.commandBuffers[pool.used++];
+}
+
+
+void CommandRecorder::recordOne(SecondaryRecording& recording)
+{
+    TRACE_SCOPE(recording.name);
+
+    VkCommandBuffer commandBuffer = acquireCommandBuffer(ThreadPool::getThreadIndex());
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = recording.renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = recording.framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording secondary command buffer!");
+    }
+
+    // Dynamic state is not inherited from the primary
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(recording.extent.width);
+    viewport.height = static_cast<float>(recording.extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = recording.extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    recording.record(commandBuffer);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record secondary command buffer!");
+    }
+    recording.commandBuffer = commandBuffer;
+}
+
+
+void CommandRecorder::record(std::vector<SecondaryRecording>& recordings)
+{
+    // Any other non-worker thread would record into the owner's pools of thread index 0 at the same time
+    if (ThreadPool::getThreadIndex() == 0 && std::this_thread::get_id() != _ownerThread) {
+        throw std::runtime_error("Secondary command buffers must be recorded on the render thread or a pool worker!");
+    }
+
+    if (_parallel) {
+        ThreadPool::getInstance()->parallelFor(static_cast<uint32_t>(recordings.size()), [&](uint32_t i) {
+            recordOne(recordings[i]);
+        });
+    } else {
+        for (auto& recording : recordings) {
+            recordOne(recording);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "stdafx.h"
+#include "VulkanContext.h"
+
+
+// One secondary command buffer to record inside a render pass instance
+struct SecondaryRecording
+{
+    const char* name = "Secondary";   // Shows up in the CPU trace
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkExtent2D extent = { 0, 0 };       // Full viewport and scissor are set before record is called
+    std::function<void(VkCommandBuffer)> record;
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE; // Filled in by CommandRecorder::record
+};
+
+
+// Records secondary command buffers on the thread pool.
+// Every (frame in flight, thread) pair owns a command pool, so threads never share a pool
+// and a whole frame worth of buffers is recycled with one vkResetCommandPool.
+// Outside of the pool only the thread that created the recorder may record (all of them are thread index 0).
+class CommandRecorder
+{
+public:
+    CommandRecorder(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight);
+    ~CommandRecorder();
+
+    // Call after the frame's fence has signaled, recycles all secondaries of that frame
+    void beginFrame(uint32_t frameIndex);
+
+    // Record all entries (in parallel unless disabled). On return every entry has its commandBuffer set.
+    void record(std::vector<SecondaryRecording>& recordings);
+
+    // How many chunks to split drawCount draws into, so each thread gets work without tiny secondaries
+    uint32_t getChunkCount(uint32_t drawCount, uint32_t minDrawsPerChunk = 32) const;
+
+    void setParallel(bool parallel) { _parallel = parallel; }
+    bool isParallel() const { return _parallel; }
+
+private:
+    std::shared_ptr<VulkanContext> _ctx;
+
+    struct ThreadCommandPool {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers; // Allocated once, reused every time the frame comes around
+        uint32_t used = 0;
+    };
+    std::vector<std::vector<ThreadCommandPool>> _pools; // [frame][thread]
+    uint32_t _currentFrame = 0;
+    uint32_t _threadCount = 1;
+    bool _parallel = true;
+    std::thread::id _ownerThread;       // The non-worker thread that uses the pools of thread index 0
+
+    VkCommandBuffer acquireCommandBuffer(uint32_t threadIndex);
+    void recordOne(SecondaryRecording& recording);
+};
@@ -0,0 +1,102 @@
+#include "ComputePipeline.h"
+#include "loader/AssetPack.h"
+#include "loader/AsyncFileReader.h"
+#include "utilities/Tracer.h"
+
+
+ComputePipeline::ComputePipeline(std::shared_ptr<VulkanContext> ctx, const std::string& compShaderPath, const ComputePipelineParams& params)
+    : _ctx(std::move(ctx)), _name(params.name)
+{
+    TRACE_SCOPE_CAT("ComputePipeline " + params.name, "asset");
+
+    createPipelineLayout(params);
+    createComputePipeline(compShaderPath, params);
+}
+
+
+ComputePipeline::~ComputePipeline()
+{
+    vkDestroyPipeline(_ctx->device, _pipeline, nullptr);
+    vkDestroyPipelineLayout(_ctx->device, _pipelineLayout, nullptr);
+}
+
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+}
+
+
+VkShaderModule ComputePipeline::createShaderModule(const std::vector<char>& code)
+{
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(_ctx->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shader module!");
+    }
+
+    return shaderModule;
+}
+
+
+void ComputePipeline::createPipelineLayout(const ComputePipelineParams& params)
+{
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(params.descriptorSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = params.descriptorSetLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(params.pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = params.pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(_ctx->device, &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+        spdlog::error("Failed to create compute pipeline layout!");
+        throw std::runtime_error("Failed to create compute pipeline layout!");
+    }
+}
+
+
+void ComputePipeline::createComputePipeline(const std::string& compShaderPath, const ComputePipelineParams& params)
+{
+    auto compShaderCode = readBinaryFile(compShaderPath);
+    VkShaderModule compShaderModule = createShaderModule(compShaderCode);
+
+    VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+    compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    compShaderStageInfo.module = compShaderModule;
+    compShaderStageInfo.pName = "main";
+    if (params.specializationInfo.has_value()) {
+        compShaderStageInfo.pSpecializationInfo = &params.specializationInfo.value();
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = compShaderStageInfo;
+    pipelineInfo.layout = _pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    if (vkCreateComputePipelines(_ctx->device, _ctx->pipelineCache, 1, &pipelineInfo, nullptr, &_pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute pipeline!");
+    } else {
+        spdlog::info("Compute pipeline created successfully {}", _name != "" ? fmt::format("({})", _name) : "");
+    }
+
+    vkDestroyShaderModule(_ctx->device, compShaderModule, nullptr);
+}
+
+
+std::vector<char> ComputePipeline::readBinaryFile(const std::string& filename) {
+    AssetView asset = AssetPack::getInstance()->find(filename);
+    if (asset) {
+        return std::vector<char>(asset.data, asset.data + asset.size);
+    }
+
+    // A failed read is logged by the reader and comes back empty
+    FileReadResult file = AsyncFileReader::getInstance()->read(filename).get();
+    return std::vector<char>(file.data.begin(), file.data.end());
+}
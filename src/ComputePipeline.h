@@ -0,0 +1,40 @@
+#pragma once
+#include "stdafx.h"
+#include "VulkanContext.h"
+
+struct ComputePipelineParams
+{
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+    std::vector<VkPushConstantRange> pushConstantRanges;
+
+    // Compute Shader Specialization Info
+    std::optional<VkSpecializationInfo> specializationInfo = std::nullopt;
+
+    // Pipeline Name (for debugging purposes)
+    std::string name = "";
+};
+
+class ComputePipeline
+{
+public:
+    ComputePipeline(std::shared_ptr<VulkanContext> ctx, const std::string& compShaderPath, const ComputePipelineParams& params);
+    ~ComputePipeline();
+
+    VkPipeline getPipeline() const { return _pipeline; }
+    VkPipelineLayout getPipelineLayout() const { return _pipelineLayout; }
+
+    void bind(VkCommandBuffer commandBuffer);
+
+private:
+    std::shared_ptr<VulkanContext> _ctx;
+
+    VkPipeline _pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+
+    void createPipelineLayout(const ComputePipelineParams& params);
+    void createComputePipeline(const std::string& compShaderPath, const ComputePipelineParams& params);
+    VkShaderModule createShaderModule(const std::vector<char>& code);
+    std::vector<char> readBinaryFile(const std::string& filename);
+
+    std::string _name;
+};
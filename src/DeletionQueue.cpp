@@ -0,0 +1,59 @@
+#include "DeletionQueue.h"
+
+
+DeletionQueue::~DeletionQueue()
+{
+    if (!_entries.empty()) {
+        spdlog::warn("Deletion queue destroyed with {} pending entries", _entries.size());
+    }
+    flush();
+}
+
+
+void DeletionQueue::push(std::function<void()> deleter)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.push_back({ _submittedFrames.load(), std::move(deleter) });
+}
+
+
+uint64_t DeletionQueue::onFrameSubmitted()
+{
+    return ++_submittedFrames;
+}
+
+
+void DeletionQueue::collect(uint64_t completedFrame)
+{
+    // Deleters run outside the lock, destroying an object may queue more work
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        while (!_entries.empty() && _entries.front().frame <= completedFrame) {
+            ready.push_back(std::move(_entries.front().deleter));
+            _entries.pop_front();
+        }
+    }
+
+    for (auto& deleter : ready) {
+        deleter();
+    }
+}
+
+
+void DeletionQueue::flush()
+{
+    // Deleters may push again, keep going until nothing is left
+    while (true) {
+        std::deque<Entry> entries;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            entries.swap(_entries);
+        }
+        if (entries.empty()) return;
+
+        for (auto& entry : entries) {
+            entry.deleter();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include "stdafx.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+
+// Destroys objects once every frame that may still use them has finished on the GPU, so resources
+// can be replaced (e.g. on resize) without idling the device. Frames are numbered by submission:
+// an object pushed after frame N was submitted is released once frame N has completed.
+class DeletionQueue
+{
+public:
+    DeletionQueue() = default;
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    // Runs deleter once the frames submitted so far have completed
+    void push(std::function<void()> deleter);
+
+    // Keeps object alive until the frames submitted so far have completed
+    template<typename T>
+    void pushObject(std::unique_ptr<T> object)
+    {
+        if (!object) return;
+        std::shared_ptr<T> shared = std::move(object);
+        push([shared]() mutable { shared.reset(); });
+    }
+
+    template<typename T>
+    void pushObject(std::shared_ptr<T> object)
+    {
+        if (!object) return;
+        push([object]() mutable { object.reset(); });
+    }
+
+    // Called by the renderer after every submit, returns the number of the submitted frame
+    uint64_t onFrameSubmitted();
+
+    // Called by the renderer once frames 1..completedFrame are known to be complete (their fences signaled)
+    void collect(uint64_t completedFrame);
+
+    // Runs every pending deleter, the device must be idle
+    void flush();
+
+    uint64_t getSubmittedFrameCount() const { return _submittedFrames; }
+
+private:
+    struct Entry {
+        uint64_t frame;
+        std::function<void()> deleter;
+    };
+
+    std::mutex _mutex;
+    std::deque<Entry> _entries; // Sorted by frame, entries are pushed with the current submit count
+    std::atomic<uint64_t> _submittedFrames = 0;
+};
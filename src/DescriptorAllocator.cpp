@@ -0,0 +1,110 @@
+#include "DescriptorAllocator.h"
+
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device, DescriptorAllocatorParams params)
+    : _device(device), _params(std::move(params))
+{
+    _nextPoolSets = std::max(1u, _params.initialSets);
+    _pools.push_back(createPool(_nextPoolSets));
+}
+
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+    for (VkDescriptorPool pool : _pools) {
+        vkDestroyDescriptorPool(_device, pool, nullptr);
+    }
+}
+
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount, const std::vector<VkDescriptorPoolSize>& descriptorCounts)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const auto& [type, ratio] : _params.typeRatios) {
+        poolSizes.push_back({ type, std::max(1u, static_cast<uint32_t>(ratio * setCount)) });
+    }
+
+    // At least one set of the given counts fits
+    for (const VkDescriptorPoolSize& count : descriptorCounts) {
+        auto it = std::find_if(poolSizes.begin(), poolSizes.end(), [&](const VkDescriptorPoolSize& size) { return size.type == count.type; });
+        if (it == poolSizes.end()) {
+            spdlog::warn("Descriptor type {} has no pool ratio, the new pool holds one set of it", static_cast<int>(count.type));
+            poolSizes.push_back(count);
+        } else it->descriptorCount = std::max(it->descriptorCount, count.descriptorCount);
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // DescriptorSet frees its set
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(_device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool!");
+    }
+
+    spdlog::info("Descriptor pool created successfully ({} sets)", setCount);
+    return pool;
+}
+
+
+bool DescriptorAllocator::tryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& set)
+{
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, &set);
+    if (result == VK_SUCCESS) return true;
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) return false;
+    throw std::runtime_error("Failed to allocate descriptor set!");
+}
+
+
+DescriptorAllocation DescriptorAllocator::allocate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& descriptorCounts)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // The pool of the last set first, then the others (freed sets leave room behind)
+    DescriptorAllocation allocation;
+    for (size_t i = 0; i < _pools.size(); i++) {
+        size_t index = (_currentPool + i) % _pools.size();
+        if (tryAllocate(_pools[index], layout, allocation.set)) {
+            _currentPool = index;
+            allocation.pool = _pools[index];
+            return allocation;
+        }
+    }
+
+    // Every pool is full (or none holds the set's descriptor types)
+    _nextPoolSets = std::min(_nextPoolSets * 2, std::max(_params.maxSetsPerPool, _params.initialSets));
+    VkDescriptorPool pool = createPool(_nextPoolSets, descriptorCounts);
+    bool allocated = false;
+    try {
+        allocated = tryAllocate(pool, layout, allocation.set);
+    } catch (...) {
+        vkDestroyDescriptorPool(_device, pool, nullptr);
+        throw;
+    }
+    if (!allocated) {
+        vkDestroyDescriptorPool(_device, pool, nullptr);
+        throw std::runtime_error("Failed to allocate descriptor set from a new pool!");
+    }
+    _pools.push_back(pool);
+    _currentPool = _pools.size() - 1;
+    allocation.pool = pool;
+    return allocation;
+}
+
+
+void DescriptorAllocator::free(const DescriptorAllocation& allocation)
+{
+    if (allocation.set == VK_NULL_HANDLE) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    vkFreeDescriptorSets(_device, allocation.pool, 1, &allocation.set);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "stdafx.h"
+#include <mutex>
+
+
+struct DescriptorAllocatorParams
+{
+    // Sets of the first pool, every new pool is twice as big up to maxSetsPerPool
+    uint32_t initialSets = 256;
+    uint32_t maxSetsPerPool = 4096;
+
+    // Descriptors of each type per set a pool is sized for
+    std::vector<std::pair<VkDescriptorType, float>> typeRatios = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0.25f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0.25f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.25f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f }
+    };
+};
+
+
+// A set and the pool it came from, which is where it has to be freed
+struct DescriptorAllocation
+{
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+};
+
+
+// Hands out descriptor sets from a chain of pools. When no pool has room for a set (out of pool memory or
+// fragmented), a new pool twice the size of the last one is added, so the number of sets is only bounded by
+// memory. Sets are freed individually and their pool takes new sets again. New pools always have room for the
+// descriptors of the set they are created for, also of types typeRatios does not list.
+class DescriptorAllocator
+{
+public:
+    DescriptorAllocator(VkDevice device, DescriptorAllocatorParams params = {});
+    ~DescriptorAllocator();
+
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    // descriptorCounts are the descriptors of the set by type
+    DescriptorAllocation allocate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& descriptorCounts);
+    void free(const DescriptorAllocation& allocation);
+
+    uint32_t getPoolCount() const { return static_cast<uint32_t>(_pools.size()); }
+
+private:
+    VkDevice _device;
+    DescriptorAllocatorParams _params;
+
+    std::mutex _mutex;
+    std::vector<VkDescriptorPool> _pools;
+    size_t _currentPool = 0;                // Took the last set, tried first
+    uint32_t _nextPoolSets = 0;
+
+    VkDescriptorPool createPool(uint32_t setCount, const std::vector<VkDescriptorPoolSize>& descriptorCounts = {});
+    bool tryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& set);
+};
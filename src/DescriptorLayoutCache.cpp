@@ -0,0 +1,94 @@
+#include "DescriptorLayoutCache.h"
+
+
+DescriptorLayoutCache::DescriptorLayoutCache(VkDevice device)
+    : _device(device)
+{
+}
+
+
+DescriptorLayoutCache::~DescriptorLayoutCache()
+{
+    for (auto& [key, layout] : _layouts) {
+        vkDestroyDescriptorUpdateTemplate(_device, layout.updateTemplate, nullptr);
+        vkDestroyDescriptorSetLayout(_device, layout.layout, nullptr);
+    }
+}
+
+
+size_t DescriptorLayoutCache::KeyHash::operator()(const Key& key) const
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t value : key) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+
+const DescriptorLayout& DescriptorLayoutCache::get(std::vector<VkDescriptorSetLayoutBinding> bindings)
+{
+    std::sort(bindings.begin(), bindings.end(),
+        [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+    Key key;
+    key.reserve(bindings.size() * 4);
+    for (const auto& binding : bindings) {
+        key.insert(key.end(), { binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags });
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _layouts.find(key);
+    if (it == _layouts.end()) {
+        it = _layouts.emplace(std::move(key), create(bindings)).first;
+    }
+    return it->second;
+}
+
+
+DescriptorLayout DescriptorLayoutCache::create(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    DescriptorLayout result;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &result.layout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(bindings.size());
+    size_t offset = 0;
+    for (const auto& binding : bindings) {
+        VkDescriptorUpdateTemplateEntry entry{};
+        entry.dstBinding = binding.binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding.descriptorCount;
+        entry.descriptorType = binding.descriptorType;
+        entry.offset = offset;
+        entry.stride = sizeof(DescriptorData);
+        entries.push_back(entry);
+
+        offset += binding.descriptorCount * sizeof(DescriptorData);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    templateInfo.pDescriptorUpdateEntries = entries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = result.layout;
+
+    if (vkCreateDescriptorUpdateTemplate(_device, &templateInfo, nullptr, &result.updateTemplate) != VK_SUCCESS) {
+        vkDestroyDescriptorSetLayout(_device, result.layout, nullptr);
+        throw std::runtime_error("Failed to create descriptor update template!");
+    }
+
+    spdlog::debug("Descriptor set layout created ({} bindings, {} cached)", bindings.size(), _layouts.size() + 1);
+    return result;
+}
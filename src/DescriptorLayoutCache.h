@@ -0,0 +1,52 @@
+#pragma once
+#include "stdafx.h"
+#include <mutex>
+#include <unordered_map>
+
+
+// One descriptor as an update template reads it (see DescriptorLayoutCache)
+union DescriptorData
+{
+    VkDescriptorImageInfo imageInfo;
+    VkDescriptorBufferInfo bufferInfo;
+};
+
+
+// A set layout and the update template that writes a whole set of it in one call
+struct DescriptorLayout
+{
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+};
+
+
+// Set layouts by their bindings, so every set with the same bindings shares one layout (and pipelines created
+// against it stay compatible). Each layout comes with an update template: the descriptors of all bindings, in
+// binding order, as consecutive DescriptorData (binding with count n takes n entries).
+// Layouts live as long as the cache, users never destroy them.
+class DescriptorLayoutCache
+{
+public:
+    DescriptorLayoutCache(VkDevice device);
+    ~DescriptorLayoutCache();
+
+    DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+    DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+    // Bindings in any order, immutable samplers are not supported
+    const DescriptorLayout& get(std::vector<VkDescriptorSetLayoutBinding> bindings);
+
+private:
+    VkDevice _device;
+
+    // binding, type, count, stages of every binding, sorted by binding
+    using Key = std::vector<uint32_t>;
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    std::mutex _mutex;
+    std::unordered_map<Key, DescriptorLayout, KeyHash> _layouts;
+
+    DescriptorLayout create(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+};
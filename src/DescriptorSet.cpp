@@ -11,7 +11,8 @@ DescriptorSet::DescriptorSet(std::shared_ptr<VulkanContext> ctx, const std::vect
 
 DescriptorSet::~DescriptorSet()
 {
-    vkDestroyDescriptorSetLayout(_ctx->device, _descriptorSetLayout, nullptr);
+    // The layout belongs to the cache
+    _ctx->descriptorAllocator->free(_allocation);
 }
 
 
@@ -27,48 +28,56 @@ void DescriptorSet::createDescriptorSetLayout(const std::vector<Descriptor>& des
         bindings[i].pImmutableSamplers = nullptr; // Optional
     }
 
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
-
-    if (vkCreateDescriptorSetLayout(_ctx->device, &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor set layout!");
-    }
+    _layout = _ctx->descriptorLayoutCache->get(std::move(bindings));
 }
 
 
 void DescriptorSet::createDescriptorSet(const std::vector<Descriptor>& descriptors)
 {
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = _ctx->descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &_descriptorSetLayout;
-
-    if (vkAllocateDescriptorSets(_ctx->device, &allocInfo, &_descriptorSet) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate descriptor set!");
+    std::vector<VkDescriptorPoolSize> descriptorCounts;
+    for (const auto& d : descriptors) {
+        auto it = std::find_if(descriptorCounts.begin(), descriptorCounts.end(), [&](const VkDescriptorPoolSize& size) { return size.type == d.type; });
+        if (it == descriptorCounts.end()) descriptorCounts.push_back({ d.type, d.count });
+        else it->descriptorCount += d.count;
     }
-    std::vector<VkWriteDescriptorSet> descriptorWrites;
-    descriptorWrites.reserve(descriptors.size());
+    _allocation = _ctx->descriptorAllocator->allocate(_layout.layout, descriptorCounts);
 
-    for (const auto& d : descriptors) {
-        VkWriteDescriptorSet write{};
-        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write.dstSet = _descriptorSet;
-        write.dstBinding = d.binding;
-        write.dstArrayElement = 0;
-        write.descriptorType = d.type;
-        write.descriptorCount = d.count;
-
-        if (d.bufferInfo.has_value()) {
-            write.pBufferInfo = &d.bufferInfo.value();
-        } else if (d.imageInfo.has_value()) {
-            write.pImageInfo = &d.imageInfo.value();
-        }
+    update(descriptors);
+}
+
+
+void DescriptorSet::replace(const std::vector<Descriptor>& descriptors)
+{
+    DescriptorAllocator* allocator = _ctx->descriptorAllocator.get();
+    DescriptorAllocation oldAllocation = _allocation;
+    _ctx->deletionQueue.push([allocator, oldAllocation]() {
+        allocator->free(oldAllocation);
+    });
+
+    createDescriptorSet(descriptors);
+}
 
-        descriptorWrites.push_back(write);
+
+void DescriptorSet::update(const std::vector<Descriptor>& descriptors)
+{
+    // The update template reads the descriptors in binding order, one entry per array element
+    std::vector<const Descriptor*> sorted;
+    sorted.reserve(descriptors.size());
+    for (const auto& d : descriptors) sorted.push_back(&d);
+    std::sort(sorted.begin(), sorted.end(), [](const Descriptor* a, const Descriptor* b) { return a->binding < b->binding; });
+
+    std::vector<DescriptorData> data;
+    data.reserve(descriptors.size());
+
+    for (const Descriptor* d : sorted) {
+        DescriptorData entry{};
+        if (d->bufferInfo.has_value()) {
+            entry.bufferInfo = d->bufferInfo.value();
+        } else if (d->imageInfo.has_value()) {
+            entry.imageInfo = d->imageInfo.value();
+        }
+        data.insert(data.end(), d->count, entry);
     }
 
-    vkUpdateDescriptorSets(_ctx->device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-}
\ No newline at end of file
+    vkUpdateDescriptorSetWithTemplate(_ctx->device, _allocation.set, _layout.updateTemplate, data.data());
+}
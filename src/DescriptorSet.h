@@ -21,20 +21,30 @@ struct Descriptor
         : binding(binding), type(type), stages(stages), count(count), imageInfo(image) {}
 };
 
+// A descriptor set allocated from the context's DescriptorAllocator. Its layout (and update template) is shared
+// with every other set of the same bindings through the DescriptorLayoutCache.
 class DescriptorSet
 {
 public:
     DescriptorSet(std::shared_ptr<VulkanContext> ctx, const std::vector<Descriptor>& descriptors);
     ~DescriptorSet();
 
-    VkDescriptorSetLayout getDescriptorSetLayout() const { return _descriptorSetLayout; }
-    VkDescriptorSet getDescriptorSet() const { return _descriptorSet; }
+    // Rewrite the descriptors (same bindings and types), e.g. after the images they point to were recreated.
+    // The set must not be in use by the GPU.
+    void update(const std::vector<Descriptor>& descriptors);
+
+    // Same as update, but writes into a newly allocated set and switches to it. The old set is freed once the frames
+    // submitted so far have completed, so this is safe while frames using the set are in flight.
+    void replace(const std::vector<Descriptor>& descriptors);
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return _layout.layout; }
+    VkDescriptorSet getDescriptorSet() const { return _allocation.set; }
 
 private:
     std::shared_ptr<VulkanContext> _ctx;
 
-    VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
-    VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+    DescriptorLayout _layout;
+    DescriptorAllocation _allocation;
 
     void createDescriptorSetLayout(const std::vector<Descriptor>& descriptors);
     void createDescriptorSet(const std::vector<Descriptor>& descriptors);
@@ -61,27 +61,24 @@ FrameBuffer::~FrameBuffer() {
 
     if(_usingInternalColor) {
         vkDestroyImageView(_ctx->device, _colorImageView, nullptr);
-        vkDestroyImage(_ctx->device, _colorImage, nullptr);
-        vkFreeMemory(_ctx->device, _colorImageMemory, nullptr);
+        VulkanHelper::destroyImage(_ctx, _colorImage, _colorImageAllocation);
     }
 
     if(_usingInternalDepth) {
         vkDestroyImageView(_ctx->device, _depthImageView, nullptr);
-        vkDestroyImage(_ctx->device, _depthImage, nullptr);
-        vkFreeMemory(_ctx->device, _depthImageMemory, nullptr);
+        VulkanHelper::destroyImage(_ctx, _depthImage, _depthImageAllocation);
     }
 
     if(_usingInternalResolve) {
         vkDestroyImageView(_ctx->device, _resolveImageView, nullptr);
-        vkDestroyImage(_ctx->device, _resolveImage, nullptr);
-        vkFreeMemory(_ctx->device, _resolveImageMemory, nullptr);
+        VulkanHelper::destroyImage(_ctx, _resolveImage, _resolveImageAllocation);
     }
 }
 
 void FrameBuffer::createColorResources(VkExtent2D extent, VkFormat format, VkSampleCountFlagBits msaaSamples, VkImageUsageFlags usage) {
 
     VulkanHelper::createImage(_ctx, extent.width, extent.height, format, 1, 1, msaaSamples,
-        VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _colorImage, _colorImageMemory);
+        VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _colorImage, _colorImageAllocation);
 
     _colorImageView = VulkanHelper::createImageView(_ctx, _colorImage, format, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT);
 }
@@ -89,7 +86,7 @@ void FrameBuffer::createColorResources(VkExtent2D extent, VkFormat format, VkSam
 void FrameBuffer::createDepthResources(VkExtent2D extent, VkFormat format, VkSampleCountFlagBits msaaSamples, VkImageUsageFlags usage) {
 
     VulkanHelper::createImage(_ctx, extent.width, extent.height, format, 1, 1, msaaSamples,
-        VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthImage, _depthImageMemory);
+        VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthImage, _depthImageAllocation);
 
     _depthImageView = VulkanHelper::createImageView(_ctx, _depthImage, format, 1, 1, VK_IMAGE_ASPECT_DEPTH_BIT);
 }
@@ -97,7 +94,7 @@ void FrameBuffer::createDepthResources(VkExtent2D extent, VkFormat format, VkSam
 void FrameBuffer::createResolveResources(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage) {
 
     VulkanHelper::createImage(_ctx, extent.width, extent.height, format, 1, 1, VK_SAMPLE_COUNT_1_BIT,
-        VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _resolveImage, _resolveImageMemory);
+        VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _resolveImage, _resolveImageAllocation);
 
     _resolveImageView = VulkanHelper::createImageView(_ctx, _resolveImage, format, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT);
 }
\ No newline at end of file
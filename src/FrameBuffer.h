@@ -51,19 +51,19 @@ private:
     VkExtent2D _extent;
 
     VkImage _colorImage;
-    VkDeviceMemory _colorImageMemory;
+    Allocation _colorImageAllocation;
     VkImageView _colorImageView;
     bool _usingInternalColor = false;
     void createColorResources(VkExtent2D extent, VkFormat format, VkSampleCountFlagBits msaaSamples, VkImageUsageFlags usage);
 
     VkImage _depthImage;
-    VkDeviceMemory _depthImageMemory;
+    Allocation _depthImageAllocation;
     VkImageView _depthImageView;
     bool _usingInternalDepth = false;
     void createDepthResources(VkExtent2D extent, VkFormat format, VkSampleCountFlagBits msaaSamples, VkImageUsageFlags usage);
 
     VkImage _resolveImage;
-    VkDeviceMemory _resolveImageMemory;
+    Allocation _resolveImageAllocation;
     VkImageView _resolveImageView;
     bool _usingInternalResolve = false;
     void createResolveResources(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage);
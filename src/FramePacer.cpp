@@ -0,0 +1,94 @@
+#include "FramePacer.h"
+#include "utilities/Tracer.h"
+
+
+FramePacer::FramePacer(FramePacerParams params)
+    : _params(params)
+{
+    setTargetFps(_params.targetFps);
+    _lastFrameEnd = Clock::now();
+}
+
+
+void FramePacer::setMode(PacingMode mode)
+{
+    _params.mode = mode;
+    resetDeadline();
+    spdlog::info("Frame pacing: {}", modeToString(mode));
+}
+
+
+void FramePacer::setTargetFps(double fps)
+{
+    if (fps <= 0.0) {
+        spdlog::warn("Invalid target FPS {}, keeping {}", fps, _params.targetFps);
+        fps = _params.targetFps > 0.0 ? _params.targetFps : 60.0;
+    }
+    _params.targetFps = fps;
+    _period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    resetDeadline();
+}
+
+
+void FramePacer::resetDeadline()
+{
+    _nextDeadline = Clock::now() + _period;
+}
+
+
+void FramePacer::waitForNextFrame()
+{
+    if (_params.mode == PacingMode::TargetFps) {
+        TRACE_SCOPE("FramePacer::wait");
+
+        const auto spinThreshold = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(_params.spinThresholdMs));
+
+        // Coarse wait: the OS sleep can overshoot by a scheduler tick, so stop early
+        auto now = Clock::now();
+        if (_nextDeadline - now > spinThreshold) {
+            std::this_thread::sleep_for(_nextDeadline - now - spinThreshold);
+        }
+
+        // Fine wait: spin for the remaining time
+        while (Clock::now() < _nextDeadline) {
+            std::this_thread::yield();
+        }
+
+        // If we fell behind by more than a frame, start over instead of rushing to catch up
+        _nextDeadline += _period;
+        now = Clock::now();
+        if (now > _nextDeadline) _nextDeadline = now + _period;
+    }
+
+    auto frameEnd = Clock::now();
+    double frameTimeMs = std::chrono::duration<double, std::milli>(frameEnd - _lastFrameEnd).count();
+    _lastFrameEnd = frameEnd;
+    _averageFrameTimeMs = _averageFrameTimeMs == 0.0 ? frameTimeMs : glm::mix(_averageFrameTimeMs, frameTimeMs, 0.05);
+}
+
+
+VkPresentModeKHR FramePacer::getPreferredPresentMode() const
+{
+    // Display synced relies on FIFO blocking, the other modes must not be throttled by the presentation engine
+    return _params.mode == PacingMode::DisplaySynced ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_MAILBOX_KHR;
+}
+
+
+const char* FramePacer::modeToString(PacingMode mode)
+{
+    switch (mode) {
+        case PacingMode::Uncapped: return "uncapped";
+        case PacingMode::TargetFps: return "target";
+        case PacingMode::DisplaySynced: return "vsync";
+    }
+    return "unknown";
+}
+
+
+std::optional<PacingMode> FramePacer::modeFromString(const std::string& name)
+{
+    if (name == "uncapped") return PacingMode::Uncapped;
+    if (name == "target") return PacingMode::TargetFps;
+    if (name == "vsync") return PacingMode::DisplaySynced;
+    return std::nullopt;
+}
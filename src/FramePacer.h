@@ -0,0 +1,57 @@
+#pragma once
+#include "stdafx.h"
+
+
+enum class PacingMode
+{
+    Uncapped,       // Start the next frame as soon as the previous one was submitted
+    TargetFps,      // Hold every frame to a fixed period (sleep, then spin for the last bit)
+    DisplaySynced   // No CPU wait, the FIFO present queue throttles us to the refresh rate
+};
+
+
+struct FramePacerParams
+{
+    // Target FPS with a mailbox swap chain, as before the pacer (a fixed 16 ms delay)
+    PacingMode mode = PacingMode::TargetFps;
+    double targetFps = 60.0;
+
+    // The OS sleep is only trusted until this close to the deadline, the rest is a busy wait
+    double spinThresholdMs = 2.0;
+};
+
+
+// Decides how long the main loop waits between frames.
+// Deadlines are absolute (next = previous + period), so oversleeping one frame does not shift the following ones.
+class FramePacer
+{
+public:
+    FramePacer(FramePacerParams params = {});
+
+    // Call once per loop iteration, after drawFrame
+    void waitForNextFrame();
+
+    void setMode(PacingMode mode);
+    PacingMode getMode() const { return _params.mode; }
+    void setTargetFps(double fps);
+
+    // Swap chain present mode that suits the pacing mode (used when none is forced)
+    VkPresentModeKHR getPreferredPresentMode() const;
+
+    // Exponential moving average of the wall time between two waitForNextFrame calls
+    double getAverageFrameTimeMs() const { return _averageFrameTimeMs; }
+
+    static const char* modeToString(PacingMode mode);
+    static std::optional<PacingMode> modeFromString(const std::string& name);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    FramePacerParams _params;
+    Clock::duration _period;
+    Clock::time_point _nextDeadline;
+    Clock::time_point _lastFrameEnd;
+    double _averageFrameTimeMs = 0.0;
+
+    void resetDeadline();
+};
@@ -0,0 +1,175 @@
+#include "GpuCulling.h"
+#include "VulkanHelper.h"
+
+
+GpuCullingParams GpuCulling::defaultParams{};
+
+
+GpuCulling::GpuCulling(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight, GpuCullingParams params)
+    : _ctx(std::move(ctx)), _framesInFlight(framesInFlight), _params(params)
+{
+}
+
+
+GpuCulling::~GpuCulling()
+{
+    _pipeline = nullptr;
+    _descriptorSet = nullptr;
+    if (_commandBuffer) VulkanHelper::destroyBuffer(_ctx, _commandBuffer, _commandAllocation);
+    if (_visibleBuffer) VulkanHelper::destroyBuffer(_ctx, _visibleBuffer, _visibleAllocation);
+}
+
+
+uint32_t GpuCulling::addBatch(uint32_t capacity, uint32_t indexCount, float boundingRadius)
+{
+    if (_commandBuffer) {
+        throw std::runtime_error("GPU culling batches must be added before its resources are created!");
+    }
+
+    _batches.push_back({ _visibleCapacity, capacity, indexCount, boundingRadius });
+    _visibleCapacity += capacity;
+    return static_cast<uint32_t>(_batches.size() - 1);
+}
+
+
+void GpuCulling::createResources(VkDescriptorSetLayout instanceSetLayout)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(_ctx->physicalDevice, &properties);
+    const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+    auto alignUp = [alignment](VkDeviceSize size) { return (size + alignment - 1) / alignment * alignment; };
+
+    _commandRegionSize = alignUp(std::max<size_t>(1, _batches.size()) * sizeof(VkDrawIndexedIndirectCommand));
+    VulkanHelper::createBuffer(_ctx, _commandRegionSize * _framesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _commandBuffer, _commandAllocation);
+    memset(_commandAllocation.mapped, 0, static_cast<size_t>(_commandRegionSize * _framesInFlight));
+    _submittedCounts.assign(_framesInFlight, 0);
+
+    // Only the instance counts change, the rest of the commands is written once (firstInstance stays 0)
+    for (uint32_t frame = 0; frame < _framesInFlight; frame++) {
+        VkDrawIndexedIndirectCommand* commands = getCommands(frame);
+        for (size_t batch = 0; batch < _batches.size(); batch++) {
+            commands[batch].indexCount = _batches[batch].indexCount;
+        }
+    }
+
+    _visibleRegionSize = alignUp(std::max(1u, _visibleCapacity) * sizeof(uint32_t));
+    VulkanHelper::createBuffer(_ctx, _visibleRegionSize * _framesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _visibleBuffer, _visibleAllocation);
+
+    VkDescriptorBufferInfo commandInfo{};
+    commandInfo.buffer = _commandBuffer;
+    commandInfo.offset = 0;
+    commandInfo.range = _commandRegionSize;
+
+    VkDescriptorBufferInfo visibleInfo{};
+    visibleInfo.buffer = _visibleBuffer;
+    visibleInfo.offset = 0;
+    visibleInfo.range = _visibleRegionSize;
+
+    // The culled vertex shaders read the visible indices from the same set
+    _descriptorSet = std::make_unique<DescriptorSet>(_ctx, std::vector<Descriptor>{
+        Descriptor(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT, 1, commandInfo),
+        Descriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 1, visibleInfo),
+    });
+
+    ComputePipelineParams pipelineParams{};
+    pipelineParams.name = "CullingPipeline";
+    pipelineParams.descriptorSetLayouts = { instanceSetLayout, _descriptorSet->getDescriptorSetLayout() };
+    pipelineParams.pushConstantRanges = {{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants) }};
+    _pipeline = std::make_unique<ComputePipeline>(_ctx, "spv/cull/cull_comp.spv", pipelineParams);
+
+    spdlog::info("GPU culling created successfully ({} batches, {} instances)", _batches.size(), _visibleCapacity);
+}
+
+
+VkDrawIndexedIndirectCommand* GpuCulling::getCommands(uint32_t frameIndex) const
+{
+    return reinterpret_cast<VkDrawIndexedIndirectCommand*>(static_cast<uint8_t*>(_commandAllocation.mapped) + frameIndex * _commandRegionSize);
+}
+
+
+void GpuCulling::update(uint32_t frameIndex)
+{
+    _currentFrame = frameIndex;
+
+    // What the last frame of this slot drew (its fence has signaled), reset so frames without culling read 0
+    VkDrawIndexedIndirectCommand* commands = getCommands(frameIndex);
+    _visibleCount = 0;
+    for (size_t batch = 0; batch < _batches.size(); batch++) {
+        _visibleCount += commands[batch].instanceCount;
+        commands[batch].instanceCount = 0;
+    }
+    _submittedCount = _submittedCounts[frameIndex];
+    _submittedCounts[frameIndex] = 0;
+}
+
+
+void GpuCulling::beginCulling(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, float pixelsPerUnit)
+{
+    _pipeline->bind(commandBuffer);
+
+    VkDescriptorSet descriptorSet = _descriptorSet->getDescriptorSet();
+    const std::array<uint32_t, 2> offsets = {
+        static_cast<uint32_t>(_currentFrame * _commandRegionSize),
+        static_cast<uint32_t>(_currentFrame * _visibleRegionSize)
+    };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->getPipelineLayout(), 1, 1, &descriptorSet,
+        static_cast<uint32_t>(offsets.size()), offsets.data());
+
+    _pushConstants.viewProjection = viewProjection;
+    _pushConstants.pixelsPerUnit = pixelsPerUnit;
+    _pushConstants.minPixelRadius = _params.minPixelRadius;
+}
+
+
+void GpuCulling::cull(VkCommandBuffer commandBuffer, uint32_t batch, VkDescriptorSet instanceSet, uint32_t instanceOffset,
+                      uint32_t instanceCount)
+{
+    const Batch& info = _batches[batch];
+    instanceCount = std::min(instanceCount, info.capacity);
+    if (instanceCount == 0) return;
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->getPipelineLayout(), 0, 1, &instanceSet, 1, &instanceOffset);
+
+    _pushConstants.batch = batch;
+    _pushConstants.firstVisible = info.firstVisible;
+    _pushConstants.instanceCount = instanceCount;
+    _pushConstants.boundingRadius = info.boundingRadius;
+    vkCmdPushConstants(commandBuffer, _pipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &_pushConstants);
+
+    // One invocation per instance, local size of cull.comp
+    vkCmdDispatch(commandBuffer, (instanceCount + 63) / 64, 1, 1);
+
+    _submittedCounts[_currentFrame] += instanceCount;
+}
+
+
+void GpuCulling::endCulling(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+
+void GpuCulling::drawIndirect(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t batch) const
+{
+    VkDescriptorSet descriptorSet = _descriptorSet->getDescriptorSet();
+    const std::array<uint32_t, 2> offsets = {
+        static_cast<uint32_t>(_currentFrame * _commandRegionSize),
+        static_cast<uint32_t>(_currentFrame * _visibleRegionSize)
+    };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &descriptorSet,
+        static_cast<uint32_t>(offsets.size()), offsets.data());
+
+    const uint32_t firstVisible = _batches[batch].firstVisible;
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &firstVisible);
+
+    vkCmdDrawIndexedIndirect(commandBuffer, _commandBuffer,
+        _currentFrame * _commandRegionSize + batch * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+}
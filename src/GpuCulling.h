@@ -0,0 +1,117 @@
+#pragma once
+#include "stdafx.h"
+#include "VulkanContext.h"
+#include "DescriptorSet.h"
+#include "ComputePipeline.h"
+
+
+struct GpuCullingParams
+{
+    // Start with the GPU culled submission (the scene switches with C)
+    bool enabled = false;
+
+    // Instances whose bounding sphere is smaller than this on screen (radius in pixels) are culled
+    float minPixelRadius = 0.5f;
+};
+
+
+// GPU driven culling of instanced batches (see InstancedBodies). A compute pass tests the bounding sphere of every
+// instance against the view frustum and its size on screen, and appends the index of each survivor to the batch's
+// visible indices. Every batch has one VkDrawIndexedIndirectCommand whose instanceCount the survivors count up,
+// firstInstance stays 0 (non-zero needs drawIndirectFirstInstance). The batch is then drawn with one
+// vkCmdDrawIndexedIndirect and the culled shaders read instances[visible[firstVisible + gl_InstanceIndex]]
+// (INSTANCE_VISIBLE_SET in instances.glsl, the descriptor set of the culling, firstVisible is a vertex push
+// constant), the count never comes back to the CPU on the way.
+// Commands and visible indices are per frame in flight. The commands are host visible, update() reads the counts
+// of its slot once the fence has signaled, for statistics, and resets them.
+class GpuCulling
+{
+public:
+    GpuCulling(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight, GpuCullingParams params = getDefaultParams());
+    ~GpuCulling();
+
+    GpuCulling(const GpuCulling&) = delete;
+    GpuCulling& operator=(const GpuCulling&) = delete;
+
+    // Declares a batch of up to capacity instances of a mesh of indexCount indices that fits into a sphere of
+    // boundingRadius around its origin, returns its index. Only before createResources().
+    uint32_t addBatch(uint32_t capacity, uint32_t indexCount, float boundingRadius);
+
+    // Creates the buffers and the culling pipeline. instanceSetLayout is the layout of the batches' instance sets.
+    void createResources(VkDescriptorSetLayout instanceSetLayout);
+
+    // Once the fence of frameIndex has signaled: reads the counts of the last frame of the slot and resets them
+    void update(uint32_t frameIndex);
+
+    // Outside of render passes, before the batches are drawn: beginCulling binds the culling, cull dispatches one
+    // batch (instanceSet bound with instanceOffset holds instanceCount instances), endCulling makes the commands
+    // and visible indices visible to the draws and the counts to update()
+    void beginCulling(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, float pixelsPerUnit);
+    void cull(VkCommandBuffer commandBuffer, uint32_t batch, VkDescriptorSet instanceSet, uint32_t instanceOffset,
+              uint32_t instanceCount);
+    void endCulling(VkCommandBuffer commandBuffer);
+
+    // Draws the survivors of the batch with the bound pipeline, vertex buffers and sets. Binds the culling set
+    // (the visible indices) at set of pipelineLayout and pushes the batch's first visible index (a uint at offset 0,
+    // vertex stage).
+    void drawIndirect(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t batch) const;
+
+    // Set of the culled pipelines, at INSTANCE_VISIBLE_SET. Valid after createResources().
+    const DescriptorSet* getDescriptorSet() const { return _descriptorSet.get(); }
+
+    // Of the last frame read back by update()
+    uint32_t getVisibleCount() const { return _visibleCount; }
+    uint32_t getCulledCount() const { return _submittedCount - _visibleCount; }
+
+    // Params used by culling created without explicit ones (set from the command line)
+    static GpuCullingParams getDefaultParams() { return defaultParams; }
+    static void setDefaultParams(const GpuCullingParams& params) { defaultParams = params; }
+
+private:
+    static GpuCullingParams defaultParams;
+
+    std::shared_ptr<VulkanContext> _ctx;
+    uint32_t _framesInFlight;
+    GpuCullingParams _params;
+
+    struct Batch {
+        uint32_t firstVisible;
+        uint32_t capacity;
+        uint32_t indexCount;
+        float boundingRadius;
+    };
+    std::vector<Batch> _batches;
+    uint32_t _visibleCapacity = 0;
+
+    // Same layout as shaders/cull/cull.comp
+    struct PushConstants {
+        glm::mat4 viewProjection;
+        uint32_t batch;
+        uint32_t firstVisible;
+        uint32_t instanceCount;
+        float pixelsPerUnit;
+        float minPixelRadius;
+        float boundingRadius;
+    };
+    PushConstants _pushConstants{};
+
+    // [Commands] One per batch and frame in flight, host visible: written by update(), counted up by the culling
+    // shader, read back for the statistics
+    VkBuffer _commandBuffer = VK_NULL_HANDLE;
+    Allocation _commandAllocation;
+    VkDeviceSize _commandRegionSize = 0;
+    VkDrawIndexedIndirectCommand* getCommands(uint32_t frameIndex) const;
+
+    // [Visible] capacity instance indices per batch and frame in flight, written by the culling shader
+    VkBuffer _visibleBuffer = VK_NULL_HANDLE;
+    Allocation _visibleAllocation;
+    VkDeviceSize _visibleRegionSize = 0;
+
+    std::unique_ptr<DescriptorSet> _descriptorSet;
+    std::unique_ptr<ComputePipeline> _pipeline;
+
+    uint32_t _currentFrame = 0;
+    std::vector<uint32_t> _submittedCounts;     // Instances culled by the last frame of every slot
+    uint32_t _submittedCount = 0;
+    uint32_t _visibleCount = 0;
+};
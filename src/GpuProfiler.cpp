@@ -0,0 +1,234 @@
+#include "GpuProfiler.h"
+
+
+GpuProfiler::GpuProfiler(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight, uint32_t maxPassesPerFrame, uint32_t historySize)
+    : _ctx(std::move(ctx)), _maxPasses(maxPassesPerFrame), _historySize(historySize)
+{
+    _frames.resize(framesInFlight);
+
+    // Timestamps are only usable if the graphics queue family reports valid bits
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_ctx->physicalDevice, &properties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(_ctx->physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(_ctx->physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    QueueFamilyIndices indices = VulkanHelper::findQueueFamilies(_ctx->physicalDevice, _ctx->surface);
+    uint32_t validBits = queueFamilies[indices.graphicsFamily.value()].timestampValidBits;
+
+    _timingSupported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+    _timestampPeriod = properties.limits.timestampPeriod;
+    _timestampMask = (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+
+    if (_timingSupported) {
+        for (auto& frame : _frames) {
+            if (!createQueryPool(frame.queryPool)) {
+                spdlog::error("Failed to create timestamp query pool, GPU timings disabled");
+                _timingSupported = false;
+                break;
+            }
+        }
+        if (_timingSupported) spdlog::info("GPU profiler created successfully (timestamp period: {} ns)", _timestampPeriod);
+    } else {
+        spdlog::warn("Device does not support timestamp queries, GPU profiler only emits debug labels");
+    }
+
+    if (_ctx->debugUtilsEnabled) {
+        _vkCmdBeginDebugUtilsLabelEXT = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetInstanceProcAddr(_ctx->instance, "vkCmdBeginDebugUtilsLabelEXT");
+        _vkCmdEndDebugUtilsLabelEXT = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetInstanceProcAddr(_ctx->instance, "vkCmdEndDebugUtilsLabelEXT");
+    }
+}
+
+
+GpuProfiler::~GpuProfiler()
+{
+    for (auto& frame : _frames) {
+        if (frame.queryPool) vkDestroyQueryPool(_ctx->device, frame.queryPool, nullptr);
+    }
+}
+
+
+bool GpuProfiler::createQueryPool(VkQueryPool& queryPool) const
+{
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = _maxPasses * 2;
+    return vkCreateQueryPool(_ctx->device, &queryPoolInfo, nullptr, &queryPool) == VK_SUCCESS;
+}
+
+
+void GpuProfiler::reserve(uint32_t passesPerFrame)
+{
+    if (passesPerFrame <= _maxPasses) return;
+    _maxPasses = passesPerFrame;
+    if (!_timingSupported) return;
+
+    // Frames in flight may still write the old pools
+    VkDevice device = _ctx->device;
+    for (auto& frame : _frames) {
+        VkQueryPool oldPool = frame.queryPool;
+        frame.queryPool = VK_NULL_HANDLE;
+        frame.passNames.clear();
+        _ctx->deletionQueue.push([device, oldPool]() { vkDestroyQueryPool(device, oldPool, nullptr); });
+
+        if (!createQueryPool(frame.queryPool)) {
+            spdlog::error("Failed to create timestamp query pool, GPU timings disabled");
+            _timingSupported = false;
+            return;
+        }
+    }
+
+    spdlog::debug("GPU profiler query pools grown to {} passes", _maxPasses);
+}
+
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (!_openPasses.empty()) {
+        spdlog::warn("GPU profiler: {} pass(es) were not ended in the previous frame", _openPasses.size());
+        _openPasses.clear();
+    }
+
+    _currentFrame = frameIndex;
+    if (!_timingSupported) return;
+
+    // The fence of this frame slot has signaled, so its queries are (normally) available
+    collectResults(frameIndex);
+
+    _frames[frameIndex].passNames.clear();
+    vkCmdResetQueryPool(commandBuffer, _frames[frameIndex].queryPool, 0, _maxPasses * 2);
+}
+
+
+void GpuProfiler::beginPass(VkCommandBuffer commandBuffer, const std::string& name)
+{
+    if (_vkCmdBeginDebugUtilsLabelEXT) {
+        // Stable per-name color so passes are easy to tell apart in capture tools
+        size_t hash = std::hash<std::string>{}(name);
+        VkDebugUtilsLabelEXT label{};
+        label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+        label.pLabelName = name.c_str();
+        label.color[0] = ((hash >> 0) & 0xFF) / 255.0f;
+        label.color[1] = ((hash >> 8) & 0xFF) / 255.0f;
+        label.color[2] = ((hash >> 16) & 0xFF) / 255.0f;
+        label.color[3] = 1.0f;
+        _vkCmdBeginDebugUtilsLabelEXT(commandBuffer, &label);
+    }
+
+    if (!_timingSupported) {
+        _openPasses.push_back(0);
+        return;
+    }
+
+    FrameQueries& frame = _frames[_currentFrame];
+    if (frame.passNames.size() >= _maxPasses) {
+        spdlog::warn("GPU profiler: too many passes in one frame, '{}' is not timed", name);
+        _openPasses.push_back(UINT32_MAX);
+        return;
+    }
+
+    uint32_t passIndex = static_cast<uint32_t>(frame.passNames.size());
+    frame.passNames.push_back(name);
+    _openPasses.push_back(passIndex);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, passIndex * 2);
+}
+
+
+void GpuProfiler::endPass(VkCommandBuffer commandBuffer)
+{
+    if (_openPasses.empty()) {
+        spdlog::error("GPU profiler: endPass called without a matching beginPass");
+        return;
+    }
+    uint32_t passIndex = _openPasses.back();
+    _openPasses.pop_back();
+
+    if (_timingSupported && passIndex != UINT32_MAX) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _frames[_currentFrame].queryPool, passIndex * 2 + 1);
+    }
+
+    if (_vkCmdEndDebugUtilsLabelEXT) {
+        _vkCmdEndDebugUtilsLabelEXT(commandBuffer);
+    }
+}
+
+
+void GpuProfiler::collectResults(uint32_t frameIndex)
+{
+    FrameQueries& frame = _frames[frameIndex];
+    if (frame.passNames.empty()) return;
+
+    // Each query returns {timestamp, availability}, no WAIT flag so this never blocks
+    uint32_t queryCount = static_cast<uint32_t>(frame.passNames.size()) * 2;
+    std::vector<uint64_t> results(queryCount * 2, 0);
+    vkGetQueryPoolResults(_ctx->device, frame.queryPool, 0, queryCount,
+        results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    for (size_t i = 0; i < frame.passNames.size(); i++) {
+        uint64_t begin = results[i * 4 + 0];
+        bool beginAvailable = results[i * 4 + 1] != 0;
+        uint64_t end = results[i * 4 + 2];
+        bool endAvailable = results[i * 4 + 3] != 0;
+        if (!beginAvailable || !endAvailable) continue; // Drop the sample rather than wait
+
+        uint64_t ticks = ((end & _timestampMask) - (begin & _timestampMask)) & _timestampMask;
+        addSample(frame.passNames[i], ticks * _timestampPeriod * 1e-6);
+    }
+}
+
+
+void GpuProfiler::addSample(const std::string& name, double milliseconds)
+{
+    auto it = _history.find(name);
+    if (it == _history.end()) {
+        it = _history.emplace(name, PassHistory{}).first;
+        it->second.samples.reserve(_historySize);
+        _passOrder.push_back(name);
+    }
+
+    PassHistory& history = it->second;
+    if (history.samples.size() < _historySize) {
+        history.samples.push_back(milliseconds);
+    } else {
+        history.samples[history.next] = milliseconds;
+    }
+    history.next = (history.next + 1) % _historySize;
+}
+
+
+GpuPassStats GpuProfiler::getPassStats(const std::string& name) const
+{
+    GpuPassStats stats{};
+    auto it = _history.find(name);
+    if (it == _history.end() || it->second.samples.empty()) return stats;
+
+    std::vector<double> samples = it->second.samples;
+    stats.sampleCount = static_cast<uint32_t>(samples.size());
+    stats.minMs = *std::min_element(samples.begin(), samples.end());
+    stats.avgMs = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+
+    size_t p99Index = std::min(samples.size() - 1, static_cast<size_t>(std::ceil(samples.size() * 0.99)) - 1);
+    std::nth_element(samples.begin(), samples.begin() + p99Index, samples.end());
+    stats.p99Ms = samples[p99Index];
+    return stats;
+}
+
+
+void GpuProfiler::logStats() const
+{
+    if (!_timingSupported) {
+        spdlog::info("GPU timings are not supported on this device");
+        return;
+    }
+
+    spdlog::info("---------------- GPU pass timings (ms) ----------------");
+    for (const auto& name : _passOrder) {
+        GpuPassStats stats = getPassStats(name);
+        spdlog::info("  {:<24} min {:7.3f}  avg {:7.3f}  p99 {:7.3f}  ({} frames)", name, stats.minMs, stats.avgMs, stats.p99Ms, stats.sampleCount);
+    }
+    spdlog::info("-------------------------------------------------------");
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "stdafx.h"
+#include "VulkanContext.h"
+
+
+struct GpuPassStats
+{
+    double minMs = 0.0;
+    double avgMs = 0.0;
+    double p99Ms = 0.0;
+    uint32_t sampleCount = 0;
+};
+
+
+// Measures GPU time of named passes with timestamp queries (one query pool per frame in flight).
+// Results are fetched without waiting when the frame slot comes around again, so the CPU never stalls.
+// Passes are also wrapped in debug-utils labels so they show up by name in RenderDoc/Nsight.
+class GpuProfiler
+{
+public:
+    GpuProfiler(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight, uint32_t maxPassesPerFrame = 32, uint32_t historySize = 256);
+    ~GpuProfiler();
+
+    // Call right after the frame's fence has signaled and the command buffer has begun, before any pass
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // Passes can be nested, every beginPass needs a matching endPass
+    void beginPass(VkCommandBuffer commandBuffer, const std::string& name);
+    void endPass(VkCommandBuffer commandBuffer);
+
+    bool isTimingSupported() const { return _timingSupported; }
+
+    // Grows the query pools to time at least passesPerFrame passes (call outside of recording, e.g. after the render
+    // graph is compiled). Replaced pools are released through the deletion queue, their pending timings are dropped.
+    void reserve(uint32_t passesPerFrame);
+
+    // Statistics over the rolling window (last historySize frames)
+    std::vector<std::string> getPassNames() const { return _passOrder; }
+    GpuPassStats getPassStats(const std::string& name) const;
+    void logStats() const;
+
+private:
+    std::shared_ptr<VulkanContext> _ctx;
+
+    bool _timingSupported = false;
+    uint64_t _timestampMask = ~0ull;
+    double _timestampPeriod = 1.0; // Nanoseconds per tick
+
+    uint32_t _maxPasses;
+    uint32_t _historySize;
+
+    struct FrameQueries {
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        std::vector<std::string> passNames; // Pass i uses queries 2*i (begin) and 2*i+1 (end)
+    };
+    std::vector<FrameQueries> _frames;
+    uint32_t _currentFrame = 0;
+    std::vector<uint32_t> _openPasses;
+
+    struct PassHistory {
+        std::vector<double> samples; // Ring buffer of durations in ms
+        uint32_t next = 0;
+    };
+    std::unordered_map<std::string, PassHistory> _history;
+    std::vector<std::string> _passOrder; // First-seen order, for stable log output
+
+    // Debug utils labels (only if the instance extension is enabled)
+    PFN_vkCmdBeginDebugUtilsLabelEXT _vkCmdBeginDebugUtilsLabelEXT = nullptr;
+    PFN_vkCmdEndDebugUtilsLabelEXT _vkCmdEndDebugUtilsLabelEXT = nullptr;
+
+    bool createQueryPool(VkQueryPool& queryPool) const;
+    void collectResults(uint32_t frameIndex);
+    void addSample(const std::string& name, double milliseconds);
+};
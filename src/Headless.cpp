@@ -0,0 +1,116 @@
+#include "Headless.h"
+#include "loader/TextureLoader.h"
+#include "utilities/ThreadPool.h"
+#include "stb_image_write.h" // Implementation lives in GUI.cpp
+
+
+Headless::Headless()
+{
+}
+
+Headless::~Headless()
+{
+    spdlog::info("Headless renderer is getting destroyed...");
+    _renderer = nullptr;
+    _ctx = nullptr;
+}
+
+bool Headless::initialize(const SwapChainParams& swapChainParams, bool progressive)
+{
+    const VkExtent2D extent = swapChainParams.headlessExtent;
+    if (extent.width == 0 || extent.height == 0) {
+        spdlog::error("Invalid headless resolution {}x{}", extent.width, extent.height);
+        return false;
+    }
+
+    // Create Vulkan context without a window (no surface, no swapchain)
+    _ctx = std::make_shared<VulkanContext>(nullptr);
+
+    _renderer = std::make_unique<Renderer>(_ctx);
+    _renderer->initialize(swapChainParams);
+    if (!progressive) _renderer->finishLoading();
+
+    return true;
+}
+
+void Headless::renderFrames(const uint32_t frameCount, const std::string& outputDir)
+{
+    if (outputDir.empty()) {
+        // Benchmark mode: frames are still read back, just not written anywhere
+        renderFrames(frameCount, Renderer::FrameReadyCallback{});
+        return;
+    }
+
+    std::filesystem::create_directories(outputDir);
+    renderFrames(frameCount, [&outputDir](const uint8_t* pixels, uint32_t width, uint32_t height, uint64_t frameNumber) {
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "frame_%06llu.png", static_cast<unsigned long long>(frameNumber));
+        std::string path = (std::filesystem::path(outputDir) / fileName).string();
+        if (!stbi_write_png(path.c_str(), width, height, 4, pixels, width * 4)) {
+            spdlog::error("Failed to write frame to {}", path);
+        }
+    });
+}
+
+void Headless::renderFrames(const uint32_t frameCount, Renderer::FrameReadyCallback callback)
+{
+    _renderer->setFrameReadyCallback(std::move(callback));
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < frameCount; i++) {
+        _renderer->drawFrame();
+    }
+    _renderer->flushFrames();
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    double seconds = std::chrono::duration<double>(endTime - startTime).count();
+    spdlog::info("Rendered {} headless frames in {:.3f} s ({:.1f} FPS)", frameCount, seconds, seconds > 0.0 ? frameCount / seconds : 0.0);
+
+    _renderer->setFrameReadyCallback(nullptr);
+}
+
+void Headless::benchmarkStartup(const SwapChainParams& swapChainParams)
+{
+    const uint32_t workerCount = ThreadPool::getInstance()->getWorkerCount();
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t count = 1; count < workerCount; count *= 2) {
+        threadCounts.push_back(count);
+    }
+    threadCounts.push_back(workerCount);
+
+    const TextureLoaderParams defaultParams = TextureLoader::getDefaultParams();
+    std::vector<double> firstFrameSeconds;
+    std::vector<double> loadedSeconds;
+
+    // The first run is not measured, it only brings the images into the file cache
+    for (size_t run = 0; run <= threadCounts.size(); run++) {
+        TextureLoaderParams params = defaultParams;
+        params.maxThreads = run == 0 ? workerCount : threadCounts[run - 1];
+        TextureLoader::setDefaultParams(params);
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        Headless app;
+        if (!app.initialize(swapChainParams, true)) break;
+
+        // First frame on the GPU (with whatever is loaded by then)
+        app._renderer->drawFrame();
+        app._renderer->flushFrames();
+        auto firstFrameTime = std::chrono::high_resolution_clock::now();
+
+        app._renderer->finishLoading();
+        app._ctx->uploadManager->waitIdle();
+        auto loadedTime = std::chrono::high_resolution_clock::now();
+
+        if (run > 0) {
+            firstFrameSeconds.push_back(std::chrono::duration<double>(firstFrameTime - startTime).count());
+            loadedSeconds.push_back(std::chrono::duration<double>(loadedTime - startTime).count());
+        }
+    }
+
+    TextureLoader::setDefaultParams(defaultParams);
+
+    for (size_t i = 0; i < loadedSeconds.size(); i++) {
+        spdlog::info("Startup with {} decode threads: first frame {:.3f} s, fully loaded {:.3f} s ({:.2f}x)",
+            threadCounts[i], firstFrameSeconds[i], loadedSeconds[i], loadedSeconds[0] / loadedSeconds[i]);
+    }
+}
\ No newline at end of file
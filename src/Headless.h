@@ -0,0 +1,33 @@
+#pragma once
+#include "stdafx.h"
+#include "Renderer.h"
+
+// Runs the renderer without a window or surface, for batch jobs and benchmarks.
+// Frames are rendered back to back (no present throttling) and read back to host memory.
+class Headless
+{
+private:
+    std::shared_ptr<VulkanContext> _ctx = nullptr;
+    std::unique_ptr<Renderer> _renderer = nullptr;
+
+public:
+    Headless();
+    ~Headless();
+
+    Headless(const Headless&) = delete;
+    Headless& operator=(const Headless&) = delete;
+
+    // Resolution comes from swapChainParams.headlessExtent. Unless progressive, waits for the scene's assets,
+    // so every rendered frame shows the final textures.
+    bool initialize(const SwapChainParams& swapChainParams, bool progressive = false);
+
+    // Render frameCount frames, writing each one as a PNG into outputDir (if not empty)
+    void renderFrames(const uint32_t frameCount, const std::string& outputDir);
+
+    // Render frameCount frames and hand each one to the callback instead of writing files
+    void renderFrames(const uint32_t frameCount, Renderer::FrameReadyCallback callback);
+
+    // Starts the renderer once per decode thread count (1, 2, 4, ... all workers) and logs the time to the first
+    // frame and until the scene is loaded and uploaded, to see how startup scales with the number of cores
+    static void benchmarkStartup(const SwapChainParams& swapChainParams);
+};
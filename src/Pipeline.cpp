@@ -1,11 +1,16 @@
 #include "Pipeline.h"
 #include "VulkanHelper.h"
 #include "geometry/Vertex.h"
+#include "loader/AssetPack.h"
+#include "loader/AsyncFileReader.h"
+#include "utilities/Tracer.h"
 
 
 Pipeline::Pipeline(std::shared_ptr<VulkanContext> ctx, const std::string& vertShaderPath, const std::string& fragShaderPath, const PipelineParams& params)
     : _ctx(std::move(ctx)), _name(params.name)
 {
+    TRACE_SCOPE_CAT("Pipeline " + params.name, "asset");
+
     createPipelineLayout(params);
     createGraphicsPipeline(vertShaderPath, fragShaderPath, params);
 }
@@ -165,13 +170,14 @@ void Pipeline::createGraphicsPipeline(const std::string& vertShaderPath, const s
     colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
     colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
     colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(params.colorAttachmentCount, colorBlendAttachment);
 
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlending.logicOpEnable = VK_FALSE;
     colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
+    colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+    colorBlending.pAttachments = colorBlendAttachments.data();
     colorBlending.blendConstants[0] = 0.0f;
     colorBlending.blendConstants[1] = 0.0f;
     colorBlending.blendConstants[2] = 0.0f;
@@ -220,19 +226,12 @@ void Pipeline::createGraphicsPipeline(const std::string& vertShaderPath, const s
 
 
 std::vector<char> Pipeline::readBinaryFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-    if (!file.is_open()) {
-        spdlog::error("Failed to open file: {}", filename);
-        return {};
+    AssetView asset = AssetPack::getInstance()->find(filename);
+    if (asset) {
+        return std::vector<char>(asset.data, asset.data + asset.size);
     }
 
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
-
-    return buffer;
+    // A failed read is logged by the reader and comes back empty
+    FileReadResult file = AsyncFileReader::getInstance()->read(filename).get();
+    return std::vector<char>(file.data.begin(), file.data.end());
 }
\ No newline at end of file
@@ -36,6 +36,7 @@ struct PipelineParams
 
     // Color blending
     bool blendEnable = true;
+    uint32_t colorAttachmentCount = 1; // Outputs of the subpass (MRT), all blended the same way
 
     // Pipeline Name (for debugging purposes)
     std::string name = "";
@@ -8,9 +8,10 @@
 #include "geometry/HostMesh.h"
 #include "geometry/DeviceMesh.h"
 #include "geometry/MeshFactory.h"
+#include "utilities/Tracer.h"
 
 Renderer::Renderer(std::shared_ptr<VulkanContext> ctx)
-    : _ctx(std::move(ctx))
+    : _ctx(std::move(ctx)), _createdTime(std::chrono::high_resolution_clock::now())
 {
 }
 
@@ -19,21 +20,30 @@ Renderer::~Renderer()
     // Wait for any unfinished GPU tasks
     vkDeviceWaitIdle(_ctx->device);
 
+    // Final GPU timing report
+    if (_scene) logGpuTimings();
+
+    // Release everything that was waiting for its frames
+    _ctx->deletionQueue.flush();
+
     // //Destroy dummy texture
     // DeviceTexture::cleanupDummy();
 
     // _ctx = nullptr;
 }
 
-void Renderer::initialize()
+void Renderer::initialize(const SwapChainParams& swapChainParams)
 {
-    spdlog::info("Max Frames in flight: {}", MAX_FRAMES_IN_FLIGHT);
-
     // Create swap chain
-    _swapChain = std::make_shared<SwapChain>(_ctx);
+    _swapChain = std::make_shared<SwapChain>(_ctx, swapChainParams);
+    _framesInFlight = _swapChain->getFramesInFlight();
+    spdlog::info("Frames in flight: {} (max {})", _framesInFlight, MAX_FRAMES_IN_FLIGHT);
 
     // Initialize Scene
     _scene = std::make_unique<SolarSystemScene>(_ctx, _swapChain);
+
+    // Start copying the scene's textures and meshes while the rest is set up
+    _ctx->uploadManager->flush();
     
     // Create ImGUI
     // _gui = std::make_unique<GUI>(_ctx);
@@ -42,46 +52,45 @@ void Renderer::initialize()
 
     createCommandBuffers();
     createSyncObjects();
+
+    // Device memory after loading the scene
+    _ctx->memoryAllocator->logStats();
 }
 
 
 void Renderer::invalidate()
 {
-    vkDeviceWaitIdle(_ctx->device);
-
-    //recreateMainRenderResources();
-    //recreateObjectSelectionResources();
-    //_gui->init(_swapChain->getSwapChainExtent().width, _swapChain->getSwapChainExtent().height);
-}
-
-// void Renderer::recreateMainRenderResources()
-// {
-//     // Clean up framebuffers
-//     for (size_t i = 0; i < _mainFrameBuffers.size(); i++) {
-//         _mainFrameBuffers[i] = nullptr;
-//     }
-
-//     // Clean up Swapchain
-//     _swapChain->cleanupSwapChain();
-
-//     // Create new swapchain
-//     _swapChain->createSwapChain();
+    TRACE_SCOPE("Renderer::invalidate");
 
-//     // Create new framebuffers
-//     createMainFrameBuffers();
-// }
+    // A minimized window has no area, keep the old swap chain until it is restored
+    if (!_swapChain->recreate()) {
+        _swapChainOutOfDate = true;
+        return;
+    }
+    _swapChainOutOfDate = false;
+
+    // The image count may have changed, and the old semaphores can still be waited on by pending submits and presents
+    VkDevice device = _ctx->device;
+    std::vector<VkSemaphore> oldSemaphores = _imageAvailableSemaphores;
+    oldSemaphores.insert(oldSemaphores.end(), _renderFinishedSemaphores.begin(), _renderFinishedSemaphores.end());
+    _ctx->deletionQueue.push([device, oldSemaphores]() {
+        for (VkSemaphore semaphore : oldSemaphores) {
+            vkDestroySemaphore(device, semaphore, nullptr);
+        }
+    });
+    createSemaphores();
+    _imageCounter = 0;
 
+    // Size dependent scene resources (render graph, framebuffers)
+    _scene->onSwapChainRecreated();
 
-// void Renderer::recreateObjectSelectionResources()
-// {
-//     _objectSelectionFrameBuffer = nullptr;
-//     createObjectSelectionFrameBuffer();
-// }
+    //_gui->init(_swapChain->getSwapChainExtent().width, _swapChain->getSwapChainExtent().height);
+}
 
 
 void Renderer::createCommandBuffers() {
     // Allocate command buffer
-    _commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    _commandBuffers.resize(_framesInFlight);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -94,48 +103,95 @@ void Renderer::createCommandBuffers() {
     } else {
         spdlog::info("Command buffers allocated successfully");
     }
+
+    if (_swapChain->isHeadless()) {
+        _readbackCommandBuffers.resize(_framesInFlight);
+        _pendingReadbacks.resize(_framesInFlight);
+        if (vkAllocateCommandBuffers(_ctx->device, &allocInfo, _readbackCommandBuffers.data()) != VK_SUCCESS) {
+            spdlog::error("Failed to allocate readback command buffers!");
+        }
+    }
 }
 
 
 void Renderer::createSyncObjects() {
-    _imageAvailableSemaphores.resize(_swapChain->getSwapChainImageCount());
-    _renderFinishedSemaphores.resize(_swapChain->getSwapChainImageCount());
-    _inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    createSemaphores();
 
-    VkSemaphoreCreateInfo semaphoreInfo{};
-    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    _inFlightFences.resize(_framesInFlight);
+    _slotFrameNumbers.assign(_framesInFlight, 0);
 
     VkFenceCreateInfo fenceInfo{};
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; //Initially signaled
 
-    for (size_t i = 0; i < _swapChain->getSwapChainImageCount(); i++) {
-        if (vkCreateSemaphore(_ctx->device, &semaphoreInfo, nullptr, &_imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(_ctx->device, &semaphoreInfo, nullptr, &_renderFinishedSemaphores[i]) != VK_SUCCESS) {
-            spdlog::error("Failed to create semaphores for swap chain image {}!", i);
+    for(size_t i = 0; i < _framesInFlight; i++) {
+        if (vkCreateFence(_ctx->device, &fenceInfo, nullptr, &_inFlightFences[i]) != VK_SUCCESS) {
+            spdlog::error("Failed to create fences for frame {}!", i);
         }
     }
+}
 
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        if (vkCreateFence(_ctx->device, &fenceInfo, nullptr, &_inFlightFences[i]) != VK_SUCCESS) {
-            spdlog::error("Failed to create fences for frame {}!", i);
+
+void Renderer::createSemaphores() {
+    // Headless frames are never acquired or presented, so only fences are needed
+    size_t semaphoreCount = _swapChain->isHeadless() ? 0 : _swapChain->getSwapChainImageCount();
+    _imageAvailableSemaphores.resize(semaphoreCount);
+    _renderFinishedSemaphores.resize(semaphoreCount);
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (size_t i = 0; i < semaphoreCount; i++) {
+        if (vkCreateSemaphore(_ctx->device, &semaphoreInfo, nullptr, &_imageAvailableSemaphores[i]) != VK_SUCCESS ||
+            vkCreateSemaphore(_ctx->device, &semaphoreInfo, nullptr, &_renderFinishedSemaphores[i]) != VK_SUCCESS) {
+            spdlog::error("Failed to create semaphores for swap chain image {}!", i);
         }
     }
 }
 
 
 void Renderer::drawFrame() {
-    vkWaitForFences(_ctx->device, 1, &_inFlightFences[_frameCounter], VK_TRUE, UINT64_MAX);
+    TRACE_SCOPE("Renderer::drawFrame");
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(_ctx->device, _swapChain->getSwapChain(), UINT64_MAX, _imageAvailableSemaphores[_imageCounter], VK_NULL_HANDLE, &imageIndex);
+    {
+        TRACE_SCOPE("WaitForFence");
+        vkWaitForFences(_ctx->device, 1, &_inFlightFences[_frameCounter], VK_TRUE, UINT64_MAX);
+    }
+
+    // The fence covers every earlier submit too, so objects retired up to this slot's last frame are unused now
+    _ctx->deletionQueue.collect(_slotFrameNumbers[_frameCounter]);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+    // Uploads queued since the last frame go out before this frame's submit (which may use them)
+    _ctx->uploadManager->flush();
+
+    if (_swapChainOutOfDate) {
         invalidate();
-        return;
-    } else if (result != VK_SUCCESS) {
-        spdlog::error("Failed to acquire swap chain image!");
-        return;
+        if (_swapChainOutOfDate) return;
+    }
+
+    uint32_t imageIndex;
+    VkResult result;
+    const bool headless = _swapChain->isHeadless();
+
+    if (headless) {
+        // The previous frame rendered in this slot is complete, hand its pixels out before reusing the image
+        deliverReadback(_frameCounter);
+        imageIndex = _frameCounter;
+    } else {
+        TRACE_SCOPE("AcquireImage");
+        result = vkAcquireNextImageKHR(_ctx->device, _swapChain->getSwapChain(), UINT64_MAX, _imageAvailableSemaphores[_imageCounter], VK_NULL_HANDLE, &imageIndex);
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            // Nothing was acquired, the semaphore stays unsignaled
+            invalidate();
+            return;
+        } else if (result == VK_SUBOPTIMAL_KHR) {
+            // The image is still usable and the semaphore will signal, present it and recreate afterwards
+            _framebufferResized = true;
+        } else if (result != VK_SUCCESS) {
+            spdlog::error("Failed to acquire swap chain image!");
+            return;
+        }
     }
 
     // Reset the fence before drawing
@@ -165,10 +221,47 @@ void Renderer::drawFrame() {
     // updateUniformBuffer(_currentFrame);
 
     // Update Scene
-    _scene->update(_frameCounter);
+    {
+        TRACE_SCOPE("Scene::update");
+        _scene->update(_frameCounter);
+    }
 
     // Record command buffer
-    _scene->recordCommandBuffer(_commandBuffers[_frameCounter], imageIndex);
+    {
+        TRACE_SCOPE("RecordCommandBuffer");
+        _scene->recordCommandBuffer(_commandBuffers[_frameCounter], imageIndex);
+    }
+
+    if (headless) {
+        // Record the copy of the final image into host memory
+        VkCommandBuffer readbackCommandBuffer = _readbackCommandBuffers[_frameCounter];
+        vkResetCommandBuffer(readbackCommandBuffer, 0);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(readbackCommandBuffer, &beginInfo);
+        _swapChain->recordReadback(readbackCommandBuffer, imageIndex);
+        vkEndCommandBuffer(readbackCommandBuffer);
+
+        // No semaphores: nothing to acquire and nothing to present
+        std::array<VkCommandBuffer, 2> commandBuffers = {_commandBuffers[_frameCounter], readbackCommandBuffer};
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+
+        TRACE_SCOPE("QueueSubmit");
+        if (vkQueueSubmit(_ctx->graphicsQueue, 1, &submitInfo, _inFlightFences[_frameCounter]) != VK_SUCCESS) {
+            spdlog::error("Failed to submit draw command buffer!");
+            return;
+        }
+
+        _slotFrameNumbers[_frameCounter] = _ctx->deletionQueue.onFrameSubmitted();
+        _pendingReadbacks[_frameCounter] = _submittedFrameCount++;
+        _frameCounter = (_frameCounter + 1) % _framesInFlight;
+        return;
+    }
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -186,9 +279,19 @@ void Renderer::drawFrame() {
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(_ctx->graphicsQueue, 1, &submitInfo, _inFlightFences[_frameCounter]) != VK_SUCCESS) {
-        spdlog::error("Failed to submit draw command buffer!");
-        return;
+    {
+        TRACE_SCOPE("QueueSubmit");
+        if (vkQueueSubmit(_ctx->graphicsQueue, 1, &submitInfo, _inFlightFences[_frameCounter]) != VK_SUCCESS) {
+            spdlog::error("Failed to submit draw command buffer!");
+            return;
+        }
+    }
+    _slotFrameNumbers[_frameCounter] = _ctx->deletionQueue.onFrameSubmitted();
+
+    if (!_firstFrameSubmitted) {
+        _firstFrameSubmitted = true;
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - _createdTime).count();
+        spdlog::info("First frame submitted {:.0f} ms after the renderer was created{}", milliseconds, isLoading() ? " (assets still loading)" : "");
     }
 
     // Present the image to the swap chain (after the command buffer is done)
@@ -203,7 +306,10 @@ void Renderer::drawFrame() {
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr; // Optional
 
-    result = vkQueuePresentKHR(_ctx->presentQueue, &presentInfo);
+    {
+        TRACE_SCOPE("QueuePresent");
+        result = vkQueuePresentKHR(_ctx->presentQueue, &presentInfo);
+    }
     
     if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _framebufferResized) {
         _framebufferResized = false;
@@ -212,11 +318,65 @@ void Renderer::drawFrame() {
         spdlog::error("Failed to present swap chain image!");
     }
 
-    _frameCounter = (_frameCounter + 1) % MAX_FRAMES_IN_FLIGHT;
+    _frameCounter = (_frameCounter + 1) % _framesInFlight;
     _imageCounter = (_imageCounter + 1) % _swapChain->getSwapChainImageCount();
 }
 
 
+void Renderer::deliverReadback(uint32_t frameIndex) {
+    // Must only be called once the fence of frameIndex has signaled
+    if (!_pendingReadbacks[frameIndex].has_value()) return;
+
+    uint64_t frameNumber = _pendingReadbacks[frameIndex].value();
+    _pendingReadbacks[frameIndex].reset();
+
+    if (_frameReadyCallback) {
+        VkExtent2D extent = _swapChain->getSwapChainExtent();
+        _frameReadyCallback(_swapChain->getReadbackData(frameIndex), extent.width, extent.height, frameNumber);
+    }
+}
+
+
+void Renderer::flushFrames() {
+    if (!_swapChain->isHeadless()) return;
+
+    TRACE_SCOPE("Renderer::flushFrames");
+
+    // Deliver the remaining frames in submission order
+    for (uint32_t i = 0; i < _framesInFlight; i++) {
+        uint32_t frameIndex = (_frameCounter + i) % _framesInFlight;
+        vkWaitForFences(_ctx->device, 1, &_inFlightFences[frameIndex], VK_TRUE, UINT64_MAX);
+        deliverReadback(frameIndex);
+    }
+}
+
+
+void Renderer::logGpuTimings() const {
+    _scene->getGpuProfiler()->logStats();
+    _scene->logStats();
+}
+
+
+void Renderer::setPresentMode(VkPresentModeKHR presentMode) {
+    if (_swapChain->isHeadless() || _swapChain->getPresentMode() == presentMode) return;
+
+    _swapChain->setPresentMode(presentMode);
+    _swapChainOutOfDate = true; // drawFrame recreates it before acquiring
+    spdlog::info("Present mode: {} requested", VulkanHelper::presentModeToString(presentMode));
+}
+
+
+void Renderer::setParallelRecording(bool parallel) {
+    _scene->getCommandRecorder()->setParallel(parallel);
+    spdlog::info("Command recording: {}", parallel ? "parallel" : "serial");
+}
+
+
+bool Renderer::isParallelRecording() const {
+    return _scene->getCommandRecorder()->isParallel();
+}
+
+
 void Renderer::handleMouseClick(float mouseX, float mouseY) {
     // Handle mouse click events in the scene
     _scene->handleMouseClick(mouseX, mouseY);
@@ -232,4 +392,10 @@ void Renderer::handleMouseDrag(float dx, float dy) {
 void Renderer::handleMouseWheel(float dy) {
     // Handle mouse wheel events in the scene
     _scene->handleMouseWheel(dy);
+}
+
+
+void Renderer::handleKeyDown(int key) {
+    // Handle key down events in the scene
+    _scene->handleKeyDown(key);
 }
\ No newline at end of file
@@ -14,21 +14,43 @@
 class Renderer {
 
 public:
+    // Called with the read back pixels (RGBA8, tightly packed) of every frame rendered in headless mode
+    using FrameReadyCallback = std::function<void(const uint8_t* pixels, uint32_t width, uint32_t height, uint64_t frameNumber)>;
+
     Renderer(std::shared_ptr<VulkanContext> ctx);
     ~Renderer();
 
-    void initialize();
+    void initialize(const SwapChainParams& swapChainParams = {});
     void drawFrame();
     void informFramebufferResized() { _framebufferResized = true; };
 
+    // Headless mode
+    void setFrameReadyCallback(FrameReadyCallback callback) { _frameReadyCallback = std::move(callback); }
+    void flushFrames();
+
     SwapChain* getSwapChain() { return _swapChain.get(); };
 
+    // Scene assets still loading in the background (frames show placeholders meanwhile)
+    bool isLoading() const { return _scene && _scene->isLoading(); }
+    void finishLoading() { if (_scene) _scene->finishLoading(); }
+
     //Camera* getCamera() { return _camera.get(); };
     //GUI* getGUI() { return _gui.get(); };
 
+    // Dump min/avg/p99 GPU time of every pass to the log
+    void logGpuTimings() const;
+
+    // Recreates the swap chain with another present mode before the next frame (no-op when headless or unchanged)
+    void setPresentMode(VkPresentModeKHR presentMode);
+
+    // Switch between recording secondaries on the thread pool and on the render thread
+    void setParallelRecording(bool parallel);
+    bool isParallelRecording() const;
+
     void handleMouseClick(float mouseX, float mouseY);
     void handleMouseDrag(float dx, float dy);
     void handleMouseWheel(float dy);
+    void handleKeyDown(int key);
 
 private:
     std::shared_ptr<VulkanContext> _ctx;
@@ -39,8 +61,9 @@ private:
     // Scene
     std::unique_ptr<Scene> _scene = nullptr;
 
-    // Called when the window is resized
+    // Called when the window is resized, recreates the swap chain without idling the device
     void invalidate();
+    bool _swapChainOutOfDate = false; // Recreation is retried every frame until the surface has an area again
 
 
 
@@ -56,14 +79,30 @@ private:
     std::vector<VkCommandBuffer> _commandBuffers;
     void createCommandBuffers();
 
+    // Headless readback (a second command buffer per frame copies the final image to host memory)
+    std::vector<VkCommandBuffer> _readbackCommandBuffers;
+    std::vector<std::optional<uint64_t>> _pendingReadbacks;
+    FrameReadyCallback _frameReadyCallback;
+    uint64_t _submittedFrameCount = 0;
+    void deliverReadback(uint32_t frameIndex);
+
     // Sync objects
     std::vector<VkSemaphore> _imageAvailableSemaphores;
     std::vector<VkSemaphore> _renderFinishedSemaphores;
     std::vector<VkFence> _inFlightFences;
     void createSyncObjects();
+    void createSemaphores();
+
+    // Deletion queue frame number last submitted from each frame slot
+    std::vector<uint64_t> _slotFrameNumbers;
     
     bool _framebufferResized = false;
 
+    // Time to first frame is logged once
+    std::chrono::high_resolution_clock::time_point _createdTime;
+    bool _firstFrameSubmitted = false;
+
+    uint32_t _framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
     uint32_t _frameCounter = 0;
     uint32_t _imageCounter = 0;
 };
\ No newline at end of file
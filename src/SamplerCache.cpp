@@ -0,0 +1,75 @@
+#include "SamplerCache.h"
+#include <cstring>
+
+
+namespace {
+
+    uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+}
+
+
+SamplerCache::SamplerCache(VkDevice device)
+    : _device(device)
+{
+}
+
+
+SamplerCache::~SamplerCache()
+{
+    for (auto& [key, sampler] : _samplers) {
+        vkDestroySampler(_device, sampler, nullptr);
+    }
+}
+
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t value : key) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+
+VkSampler SamplerCache::get(const VkSamplerCreateInfo& info)
+{
+    const Key key = {
+        info.flags,
+        static_cast<uint32_t>(info.magFilter),
+        static_cast<uint32_t>(info.minFilter),
+        static_cast<uint32_t>(info.mipmapMode),
+        static_cast<uint32_t>(info.addressModeU),
+        static_cast<uint32_t>(info.addressModeV),
+        static_cast<uint32_t>(info.addressModeW),
+        floatBits(info.mipLodBias),
+        info.anisotropyEnable,
+        floatBits(info.anisotropyEnable ? info.maxAnisotropy : 0.0f),
+        info.compareEnable,
+        static_cast<uint32_t>(info.compareEnable ? info.compareOp : VK_COMPARE_OP_NEVER),
+        floatBits(info.minLod),
+        floatBits(info.maxLod),
+        static_cast<uint32_t>(info.borderColor),
+        info.unnormalizedCoordinates
+    };
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _samplers.find(key);
+    if (it != _samplers.end()) return it->second;
+
+    VkSampler sampler;
+    if (vkCreateSampler(_device, &info, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create sampler!");
+    }
+
+    _samplers.emplace(key, sampler);
+    return sampler;
+}
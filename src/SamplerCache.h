@@ -0,0 +1,33 @@
+#pragma once
+#include "stdafx.h"
+#include <mutex>
+#include <unordered_map>
+
+
+// Samplers by their create info, so textures with the same filtering share one sampler instead of each creating
+// its own (the device has a limit on live samplers, maxSamplerAllocationCount, 4000 on many GPUs).
+// Samplers live as long as the cache, users never destroy them.
+class SamplerCache
+{
+public:
+    SamplerCache(VkDevice device);
+    ~SamplerCache();
+
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    // pNext chains are not supported
+    VkSampler get(const VkSamplerCreateInfo& info);
+
+private:
+    VkDevice _device;
+
+    // Every field of VkSamplerCreateInfo after pNext, floats by their bits
+    using Key = std::array<uint32_t, 16>;
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    std::mutex _mutex;
+    std::unordered_map<Key, VkSampler, KeyHash> _samplers;
+};
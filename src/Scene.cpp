@@ -3,6 +3,8 @@
 Scene::Scene(std::shared_ptr<VulkanContext> ctx,  std::shared_ptr<SwapChain> swapChain)
     : _ctx(std::move(ctx)), _swapChain(std::move(swapChain))
 {
+    _gpuProfiler = std::make_unique<GpuProfiler>(_ctx, _swapChain->getFramesInFlight());
+    _commandRecorder = std::make_unique<CommandRecorder>(_ctx, _swapChain->getFramesInFlight());
 }
 
 
@@ -11,7 +13,16 @@ Scene::~Scene()
 }
 
 
+void Scene::createFrameAllocator(VkDeviceSize frameSize)
+{
+    _frameAllocator = std::make_unique<FrameAllocator>(_ctx, _swapChain->getFramesInFlight(), frameSize);
+}
+
+
 void Scene::update(uint32_t currentImage)
 {
     _currentFrame = currentImage;
+
+    // The renderer waited for this slot's fence, the data of its previous frame is no longer read
+    _frameAllocator->beginFrame(currentImage);
 }
\ No newline at end of file
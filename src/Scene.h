@@ -5,14 +5,17 @@
 #include "UniformBuffer.h"
 #include "DescriptorSet.h"
 #include "SwapChain.h"
+#include "GpuProfiler.h"
+#include "CommandRecorder.h"
+#include "memory/FrameAllocator.h"
 
 class Scene
 {
 public:
     Scene(std::shared_ptr<VulkanContext> ctx, std::shared_ptr<SwapChain> swapChain);
-    ~Scene();
+    virtual ~Scene();
 
-    // Update the scene (called every frame before drawing) (0 < currentImage < MAX_FRAMES_IN_FLIGHT)
+    // Update the scene (called every frame before drawing) (0 <= currentImage < SwapChain::getFramesInFlight())
     virtual void update(uint32_t currentImage);
 
     // Child classes should implement this method to create their own scene
@@ -23,6 +26,31 @@ public:
     virtual void handleMouseDrag(float dx, float dy) = 0;
     virtual void handleMouseWheel(float dy) = 0;
 
+    // Keys the window does not handle itself (SDL keycodes)
+    virtual void handleKeyDown(int key) {}
+
+    // Called after the swap chain was recreated (resize), size dependent resources should be rebuilt here.
+    // Frames using the old resources may still be in flight, release them through the context's deletion queue.
+    virtual void onSwapChainRecreated() {}
+
+    // Assets still loading in the background, the scene renders with placeholders until they are swapped in
+    virtual bool isLoading() const { return false; }
+
+    // Blocks until every asset is loaded and swapped in
+    virtual void finishLoading() {}
+
+    // Scene specific statistics, logged with the GPU timings
+    virtual void logStats() const {}
+
+    // GPU timings of the passes recorded by the scene
+    GpuProfiler* getGpuProfiler() const { return _gpuProfiler.get(); }
+
+    // Secondary command buffer recording (parallel by default)
+    CommandRecorder* getCommandRecorder() const { return _commandRecorder.get(); }
+
+    // Per-frame uniform data, reset in update()
+    FrameAllocator* getFrameAllocator() const { return _frameAllocator.get(); }
+
 protected:
     std::shared_ptr<VulkanContext> _ctx;
 
@@ -30,4 +58,15 @@ protected:
 
     // Current frame index
     uint32_t _currentFrame = 0;
+
+    // Child classes wrap their passes with beginPass/endPass
+    std::unique_ptr<GpuProfiler> _gpuProfiler;
+
+    // Child classes record their passes into secondaries through this
+    std::unique_ptr<CommandRecorder> _commandRecorder;
+
+    // Child classes write data that changes every frame through this (bound with dynamic offsets). They create it
+    // with createFrameAllocator once they know how many bytes they write per frame, before the first update().
+    std::unique_ptr<FrameAllocator> _frameAllocator;
+    void createFrameAllocator(VkDeviceSize frameSize);
 };
@@ -2,6 +2,23 @@
 #include "geometry/MeshFactory.h"
 #include "TextureSampler.h"
 #include "TextureCubemap.h"
+#include "utilities/Tracer.h"
+
+
+namespace {
+    // Texels per workgroup along the blurred axis, TILE_SIZE in blur.comp
+    constexpr uint32_t computeBlurTileSize = 128;
+    constexpr int computeBlurMaxTapSpacing = 4;     // blur.comp clamps filterRadius to it
+
+    // Room for the planets drawn as instances, the asteroids come on top (see createModels)
+    constexpr uint32_t planetInstanceCapacity = 64;
+
+    // Contiguous [begin, end) range of chunk out of chunkCount, so draw order is kept across chunks
+    std::pair<size_t, size_t> chunkRange(size_t drawCount, uint32_t chunk, uint32_t chunkCount)
+    {
+        return std::make_pair(drawCount * chunk / chunkCount, drawCount * (chunk + 1) / chunkCount);
+    }
+}
 
 
 SolarSystemScene::SolarSystemScene(std::shared_ptr<VulkanContext> ctx, std::shared_ptr<SwapChain> swapChain)
@@ -17,17 +34,16 @@ SolarSystemScene::SolarSystemScene(std::shared_ptr<VulkanContext> ctx, std::shar
     _sceneInfo.cameraPosition = glm::vec3(0.0f);
     _sceneInfo.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
 
-    // Create UBO for scene information
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        _sceneInfoUBOs[i] = std::make_unique<UniformBuffer<SceneInfo>>(_ctx);
-        _sceneDescriptorSets[i] = std::make_unique<DescriptorSet>(_ctx, std::vector<Descriptor>{
-            Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1, _sceneInfoUBOs[i]->getDescriptorInfo())
-        });
-    }
-
     createRenderPasses();
     createFrameBuffers();
-    createModels();
+    createModels(); // Creates the frame allocator
+
+    // Scene information is written to the frame allocator every frame, the set selects it with a dynamic offset
+    _sceneDescriptorSet = std::make_unique<DescriptorSet>(_ctx, std::vector<Descriptor>{
+        Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1, _frameAllocator->getDescriptorInfo(sizeof(SceneInfo)))
+    });
+
+    createRenderGraph();
     createPipelines();
     connectPipelines();
     
@@ -45,101 +61,82 @@ SolarSystemScene::~SolarSystemScene()
     vkDeviceWaitIdle(_ctx->device);
 
     _planetPipeline = nullptr;
+    _instancedPlanetPipeline = nullptr;
+    _culledPlanetPipeline = nullptr;
     _orbitPipeline = nullptr;
     _glowSpherePipeline = nullptr;
     _skyBoxPipeline = nullptr;
     _sunPipeline = nullptr;
     _earthPipeline = nullptr;
+    _virtualTextureFeedbackPipeline = nullptr;
+    _gpuCulling = nullptr;
 
-    _renderPass = nullptr;
-    _offscreenRenderPass = nullptr;
-    _offscreenRenderPassMSAA = nullptr;
+    _renderGraph = nullptr;
     _objectSelectionRenderPass = nullptr;
+
+    _ctx->bindlessTextures->removeTexture(_asteroidTextureIndex);
 }
 
 
 void SolarSystemScene::createPipelines()
 {
-    VkDescriptorSetLayout sceneDSL = _sceneDescriptorSets[0]->getDescriptorSetLayout();
+    VkDescriptorSetLayout sceneDSL = _sceneDescriptorSet->getDescriptorSetLayout();
+    VkDescriptorSetLayout bindlessDSL = _ctx->bindlessTextures->getDescriptorSetLayout();
+    VkDescriptorSetLayout virtualTextureDSL = _virtualTextures->getDescriptorSet()->getDescriptorSetLayout();
 
     // Texture sampler for post-processing
     _ppTextureSampler = std::make_unique<TextureSampler>(_ctx, 1, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
 
-    // Glow pass pipeline
-    PipelineParams glowPassPipelineParams;
-    glowPassPipelineParams.name = "GlowPassPipeline";
-    glowPassPipelineParams.descriptorSetLayouts = {sceneDSL};
-    glowPassPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GlowPassPushConstants)}};
-    glowPassPipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    glowPassPipelineParams.msaaSamples = _msaaSamples;
-    _glowPipeline = std::make_unique<Pipeline>(_ctx, "spv/glow/glow_vert.spv", "spv/glow/glow_frag.spv", glowPassPipelineParams);
-
-    VkDescriptorImageInfo glowPassOutputTexture{};
-    glowPassOutputTexture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    glowPassOutputTexture.imageView = _offscreenFrameBuffers[0]->getResolveImageView();
-    glowPassOutputTexture.sampler = _ppTextureSampler->getSampler();
-
-
-    // Blur pass pipeline (vertical)
+    // Bloom and composite descriptor sets
     _blurSettingsUBO = std::make_unique<UniformBuffer<BlurSettings>>(_ctx);
     _blurSettingsUBO->update(blurSettings);
+    writePostProcessDescriptorSets();
+
+    // Bloom pipelines, shared by all levels (their render passes only differ in size, so they are compatible)
+    PipelineParams bloomPipelineParams {};
+    bloomPipelineParams.name = "BloomDownsamplePipeline";
+    bloomPipelineParams.vertexBindingDescription = std::nullopt;
+    bloomPipelineParams.vertexAttributeDescriptions = {};
+    bloomPipelineParams.cullMode = VK_CULL_MODE_NONE;
+    bloomPipelineParams.descriptorSetLayouts = { _bloomLevels[0].downsampleDescriptorSet->getDescriptorSetLayout() };
+    bloomPipelineParams.pushConstantRanges = {};
+    bloomPipelineParams.renderPass = _renderGraph->getRenderPass("Bloom Downsample 1");
+    bloomPipelineParams.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    bloomPipelineParams.depthTest = false;
+    bloomPipelineParams.depthWrite = false;
+    bloomPipelineParams.blendEnable = false; // Every pixel is overwritten, the targets are never cleared
+    _bloomDownsamplePipeline = std::make_unique<Pipeline>(_ctx, "spv/blur/blur_vert.spv", "spv/bloom/downsample_frag.spv", bloomPipelineParams);
 
-    std::vector<Descriptor> blurVertDescriptors = {
-        Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _blurSettingsUBO->getDescriptorInfo()),
-        Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, glowPassOutputTexture), // Glow texture
-    };
-    _blurVertDescriptorSet = std::make_unique<DescriptorSet>(_ctx, blurVertDescriptors);
-
-    VkDescriptorImageInfo blurVertPassOutputTexture{};
-    blurVertPassOutputTexture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    blurVertPassOutputTexture.imageView = _offscreenFrameBuffers[1]->getResolveImageView();
-    blurVertPassOutputTexture.sampler = _ppTextureSampler->getSampler();
-
-    PipelineParams blurPassPipelineParams {};
+    // Blur pass pipeline (vertical)
+    PipelineParams blurPassPipelineParams = bloomPipelineParams;
     blurPassPipelineParams.name = "BlurPassPipeline - Vertical";
-    blurPassPipelineParams.vertexBindingDescription = std::nullopt;
-    blurPassPipelineParams.vertexAttributeDescriptions = {};
-    blurPassPipelineParams.cullMode = VK_CULL_MODE_NONE;
-    blurPassPipelineParams.descriptorSetLayouts = { _blurVertDescriptorSet->getDescriptorSetLayout() }; 
-    blurPassPipelineParams.pushConstantRanges = {};
-    blurPassPipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    blurPassPipelineParams.msaaSamples = _msaaSamples;
+    blurPassPipelineParams.descriptorSetLayouts = { _bloomLevels[0].blurVertDescriptorSet->getDescriptorSetLayout() };
+    blurPassPipelineParams.renderPass = _renderGraph->getRenderPass("Bloom Blur Vertical 1");
     int blurDirection = 0; // 0 for vertical
     VkSpecializationMapEntry blurDirectionMapEntry = {0, 0, sizeof(int)};
     blurPassPipelineParams.fragmentShaderSpecializationInfo = VkSpecializationInfo {1, &blurDirectionMapEntry, sizeof(int), &blurDirection};
     _blurVertPipeline = std::make_unique<Pipeline>(_ctx, "spv/blur/blur_vert.spv", "spv/blur/blur_frag.spv", blurPassPipelineParams);
 
-
     // Blur pass pipeline (horizontal)
-    std::vector<Descriptor> blurHorizDescriptors = {
-        Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _blurSettingsUBO->getDescriptorInfo()),
-        Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, blurVertPassOutputTexture), // Blur vert texture
-    };
-    _blurHorizDescriptorSet = std::make_unique<DescriptorSet>(_ctx, blurHorizDescriptors);
-
-    VkDescriptorImageInfo blurHorizPassOutputTexture{};
-    blurHorizPassOutputTexture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    blurHorizPassOutputTexture.imageView = _offscreenFrameBuffers[2]->getResolveImageView();;
-    blurHorizPassOutputTexture.sampler = _ppTextureSampler->getSampler();
-
     blurPassPipelineParams.name = "BlurPassPipeline - Horizontal";
+    blurPassPipelineParams.descriptorSetLayouts = { _bloomLevels[0].blurHorizDescriptorSet->getDescriptorSetLayout() };
+    blurPassPipelineParams.renderPass = _renderGraph->getRenderPass("Bloom Blur Horizontal 1");
     blurDirection = 1;     // 1 for horizontal
-    blurPassPipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
     _blurHorizPipeline = std::make_unique<Pipeline>(_ctx, "spv/blur/blur_vert.spv", "spv/blur/blur_frag.spv", blurPassPipelineParams);
 
+    if (_bloomLevels.size() > 1) {
+        bloomPipelineParams.name = "BloomUpsamplePipeline";
+        bloomPipelineParams.descriptorSetLayouts = { _bloomLevels[0].upsampleDescriptorSet->getDescriptorSetLayout() };
+        bloomPipelineParams.renderPass = _renderGraph->getRenderPass("Bloom Upsample 1");
+        _bloomUpsamplePipeline = std::make_unique<Pipeline>(_ctx, "spv/blur/blur_vert.spv", "spv/bloom/upsample_frag.spv", bloomPipelineParams);
+    }
 
-    // Composite pass pipeline
-    VkDescriptorImageInfo normalPassOutputTexture{};
-    normalPassOutputTexture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    normalPassOutputTexture.imageView = _offscreenFrameBuffers[3]->getResolveImageView();
-    normalPassOutputTexture.sampler = _ppTextureSampler->getSampler();
-
-    std::vector<Descriptor> compositeDescriptors = {
-        Descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, blurHorizPassOutputTexture),   // Blur texture
-        Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, normalPassOutputTexture),      // Normal scene texture
-    };
-    _compositeDescriptorSet = std::make_unique<DescriptorSet>(_ctx, compositeDescriptors);
 
+    if (_blurMode == BlurMode::Compute) {
+        createComputeBlurPipelines();
+    }
+
+    // Composite pass pipeline
     PipelineParams compositePipelineParams {};
     compositePipelineParams.name = "CompositePipeline";
     compositePipelineParams.vertexBindingDescription = std::nullopt; // This is a fullscreen triangle, so we don't need vertex binding description
@@ -147,27 +144,49 @@ void SolarSystemScene::createPipelines()
     compositePipelineParams.cullMode = VK_CULL_MODE_NONE;
     compositePipelineParams.descriptorSetLayouts = { _compositeDescriptorSet->getDescriptorSetLayout() };
     compositePipelineParams.pushConstantRanges = {};
-    compositePipelineParams.renderPass = _renderPass->getRenderPass();
-    compositePipelineParams.msaaSamples = _msaaSamples;
+    compositePipelineParams.renderPass = _renderGraph->getRenderPass("Composite");
+    compositePipelineParams.msaaSamples = _renderGraph->getPassSamples("Composite");
+    compositePipelineParams.depthTest = false;
+    compositePipelineParams.depthWrite = false;
+    compositePipelineParams.blendEnable = false;
     _compositePipeline = std::make_unique<Pipeline>(_ctx, "spv/composite/composite_vert.spv", "spv/composite/composite_frag.spv", compositePipelineParams);
 
     
     // Planet pipeline
     PipelineParams planetPipelineParams;
     planetPipelineParams.name = "PlanetPipeline";
-    planetPipelineParams.descriptorSetLayouts = {sceneDSL, _planets[0]->getDescriptorSet()->getDescriptorSetLayout()};
-    planetPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4)}};
-    planetPipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    planetPipelineParams.msaaSamples = _msaaSamples;
+    planetPipelineParams.descriptorSetLayouts = {sceneDSL, bindlessDSL, virtualTextureDSL};
+    planetPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(Planet::PushConstants)}};
+    planetPipelineParams.renderPass = _renderGraph->getRenderPass("Main");
+    planetPipelineParams.msaaSamples = _renderGraph->getPassSamples("Main");
+    planetPipelineParams.colorAttachmentCount = 2; // Scene color and glow
     _planetPipeline = std::make_unique<Pipeline>(_ctx, "spv/planet/planet_vert.spv", "spv/planet/planet_frag.spv", planetPipelineParams);
 
+    // Instanced planet pipeline: same shading, the bodies come from the instance set (set 3) instead of push constants
+    VkDescriptorSetLayout instanceDSL = _planetInstances->getDescriptorSet()->getDescriptorSetLayout();
+    PipelineParams instancedPlanetPipelineParams = planetPipelineParams;
+    instancedPlanetPipelineParams.name = "InstancedPlanetPipeline";
+    instancedPlanetPipelineParams.descriptorSetLayouts = {sceneDSL, bindlessDSL, virtualTextureDSL, instanceDSL};
+    instancedPlanetPipelineParams.pushConstantRanges = {};
+    _instancedPlanetPipeline = std::make_unique<Pipeline>(_ctx, "spv/planet/planet_instanced_vert.spv", "spv/planet/planet_frag.spv", instancedPlanetPipelineParams);
+
+    // Culling of the instanced bodies, reads the same instance sets. The culled pipeline draws the survivors
+    // through the visible indices of the culling set (set 4), from the batch's first one (push constant).
+    _gpuCulling->createResources(instanceDSL);
+    PipelineParams culledPlanetPipelineParams = instancedPlanetPipelineParams;
+    culledPlanetPipelineParams.name = "CulledPlanetPipeline";
+    culledPlanetPipelineParams.descriptorSetLayouts.push_back(_gpuCulling->getDescriptorSet()->getDescriptorSetLayout());
+    culledPlanetPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t)}};
+    _culledPlanetPipeline = std::make_unique<Pipeline>(_ctx, "spv/planet/planet_instanced_culled_vert.spv", "spv/planet/planet_frag.spv", culledPlanetPipelineParams);
+
     // Orbit pipeline
     PipelineParams orbitPipelineParams;
     orbitPipelineParams.name = "OrbitPipeline";
     orbitPipelineParams.descriptorSetLayouts = {sceneDSL};
     orbitPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4)}};
-    orbitPipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    orbitPipelineParams.msaaSamples = _msaaSamples;
+    orbitPipelineParams.renderPass = _renderGraph->getRenderPass("Main");
+    orbitPipelineParams.msaaSamples = _renderGraph->getPassSamples("Main");
+    orbitPipelineParams.colorAttachmentCount = 2; // Scene color and glow
     orbitPipelineParams.depthTest = true;
     orbitPipelineParams.depthWrite = false;
     _orbitPipeline = std::make_unique<Pipeline>(_ctx, "spv/orbit/orbit_vert.spv", "spv/orbit/orbit_frag.spv", orbitPipelineParams);
@@ -175,10 +194,11 @@ void SolarSystemScene::createPipelines()
     // GlowSphere pipeline
     PipelineParams glowSpherePipelineParams;
     glowSpherePipelineParams.name = "GlowSpherePipeline";
-    glowSpherePipelineParams.descriptorSetLayouts = {sceneDSL, _glowSpheres[0]->getDescriptorSet()->getDescriptorSetLayout()};
-    glowSpherePipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4)}};
-    glowSpherePipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    glowSpherePipelineParams.msaaSamples = _msaaSamples;
+    glowSpherePipelineParams.descriptorSetLayouts = {sceneDSL};
+    glowSpherePipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GlowSphere::PushConstants)}};
+    glowSpherePipelineParams.renderPass = _renderGraph->getRenderPass("Main");
+    glowSpherePipelineParams.msaaSamples = _renderGraph->getPassSamples("Main");
+    glowSpherePipelineParams.colorAttachmentCount = 2; // Scene color and glow
     glowSpherePipelineParams.depthTest = true;
     glowSpherePipelineParams.depthWrite = false;
     glowSpherePipelineParams.frontFace = VK_FRONT_FACE_CLOCKWISE;
@@ -187,10 +207,11 @@ void SolarSystemScene::createPipelines()
     // SkyBox pipeline
     PipelineParams skyBoxPipelineParams;
     skyBoxPipelineParams.name = "SkyBoxPipeline";
-    skyBoxPipelineParams.descriptorSetLayouts = {sceneDSL, _skyBox->getDescriptorSet()->getDescriptorSetLayout()};
-    skyBoxPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT , 0, sizeof(glm::mat4)}};
-    skyBoxPipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    skyBoxPipelineParams.msaaSamples = _msaaSamples;
+    skyBoxPipelineParams.descriptorSetLayouts = {sceneDSL, bindlessDSL};
+    skyBoxPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SkyBox::PushConstants)}};
+    skyBoxPipelineParams.renderPass = _renderGraph->getRenderPass("Main");
+    skyBoxPipelineParams.msaaSamples = _renderGraph->getPassSamples("Main");
+    skyBoxPipelineParams.colorAttachmentCount = 2; // Scene color and glow
     skyBoxPipelineParams.depthTest = true;
     skyBoxPipelineParams.depthWrite = false;
     skyBoxPipelineParams.frontFace = VK_FRONT_FACE_CLOCKWISE;
@@ -199,19 +220,37 @@ void SolarSystemScene::createPipelines()
     // Earth pipeline
     PipelineParams earthPipelineParams;
     earthPipelineParams.name = "EarthPipeline";
-    earthPipelineParams.descriptorSetLayouts = {sceneDSL, _earth->getDescriptorSet()->getDescriptorSetLayout()};
-    earthPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4)}};
-    earthPipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    earthPipelineParams.msaaSamples = _msaaSamples;
+    earthPipelineParams.descriptorSetLayouts = {sceneDSL, bindlessDSL, virtualTextureDSL};
+    earthPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(Planet::PushConstants)}};
+    earthPipelineParams.renderPass = _renderGraph->getRenderPass("Main");
+    earthPipelineParams.msaaSamples = _renderGraph->getPassSamples("Main");
+    earthPipelineParams.colorAttachmentCount = 2; // Scene color and glow
     _earthPipeline = std::make_unique<Pipeline>(_ctx, "spv/earth/earth_vert.spv", "spv/earth/earth_frag.spv", earthPipelineParams);
 
+    // Virtual texture feedback pipeline: depth only, the fragment shader marks the tiles in a storage buffer.
+    // The layout matches the planet pipeline, set 1 is not used. Without virtual textures the pass is culled.
+    if (_virtualTextures->getTextureCount() > 0) {
+        PipelineParams feedbackPipelineParams;
+        feedbackPipelineParams.name = "VirtualTextureFeedbackPipeline";
+        feedbackPipelineParams.descriptorSetLayouts = {sceneDSL, bindlessDSL, virtualTextureDSL};
+        feedbackPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(Planet::PushConstants)}};
+        feedbackPipelineParams.renderPass = _renderGraph->getRenderPass("Virtual Texture Feedback");
+        feedbackPipelineParams.msaaSamples = _renderGraph->getPassSamples("Virtual Texture Feedback");
+        feedbackPipelineParams.colorAttachmentCount = 0;
+        float feedbackLodBias = std::log2(_virtualTextures->getFeedbackScale()); // The pass is smaller, its derivatives bigger
+        VkSpecializationMapEntry feedbackLodBiasMapEntry = {0, 0, sizeof(float)};
+        feedbackPipelineParams.fragmentShaderSpecializationInfo = VkSpecializationInfo {1, &feedbackLodBiasMapEntry, sizeof(float), &feedbackLodBias};
+        _virtualTextureFeedbackPipeline = std::make_unique<Pipeline>(_ctx, "spv/planet/planet_vert.spv", "spv/vtfeedback/feedback_frag.spv", feedbackPipelineParams);
+    }
+
     // Sun pipeline
     PipelineParams sunPipelineParams;
     sunPipelineParams.name = "SunPipeline";
     sunPipelineParams.descriptorSetLayouts = {sceneDSL};
     sunPipelineParams.pushConstantRanges = {{VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4)}};
-    sunPipelineParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    sunPipelineParams.msaaSamples = _msaaSamples;
+    sunPipelineParams.renderPass = _renderGraph->getRenderPass("Main");
+    sunPipelineParams.msaaSamples = _renderGraph->getPassSamples("Main");
+    sunPipelineParams.colorAttachmentCount = 2; // Scene color and glow
     _sunPipeline = std::make_unique<Pipeline>(_ctx, "spv/sun/sun_vert.spv", "spv/sun/sun_frag.spv", sunPipelineParams);
 
     // Object selection pipeline
@@ -225,6 +264,150 @@ void SolarSystemScene::createPipelines()
 }
 
 
+void SolarSystemScene::writePostProcessDescriptorSets()
+{
+    auto postProcessTexture = [this](RGResource image) {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = _renderGraph->getImageView(image);
+        imageInfo.sampler = _ppTextureSampler->getSampler();
+        return imageInfo;
+    };
+
+    auto storageImage = [this](RGResource image) {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageInfo.imageView = _renderGraph->getImageView(image);
+        return imageInfo;
+    };
+
+    // Frames in flight may still be bound to the current sets, so they are replaced rather than rewritten
+    auto write = [this](std::unique_ptr<DescriptorSet>& set, const std::vector<Descriptor>& descriptors) {
+        _ctx->deletionQueue.pushObject(std::move(set));
+        set = std::make_unique<DescriptorSet>(_ctx, descriptors);
+    };
+
+    for (size_t i = 0; i < _bloomLevels.size(); i++) {
+        BloomLevel& level = _bloomLevels[i];
+        RGResource downsampleSource = i == 0 ? _glowTarget : _bloomLevels[i - 1].downsampled;
+
+        write(level.downsampleDescriptorSet, {
+            Descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, postProcessTexture(downsampleSource)), // Previous level
+        });
+        write(level.blurVertDescriptorSet, {
+            Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _blurSettingsUBO->getDescriptorInfo()),
+            Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, postProcessTexture(level.downsampled)), // Downsampled texture
+        });
+        write(level.blurHorizDescriptorSet, {
+            Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _blurSettingsUBO->getDescriptorInfo()),
+            Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, postProcessTexture(level.blurredVert)), // Blur vert texture
+        });
+
+        // The blur targets only have storage usage while the compute path is live
+        if (_blurMode == BlurMode::Compute) {
+            write(level.computeBlurVertDescriptorSet, {
+                Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1, _blurSettingsUBO->getDescriptorInfo()),
+                Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 1, postProcessTexture(level.downsampled)),
+                Descriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1, storageImage(level.blurredVert)),
+            });
+            write(level.computeBlurHorizDescriptorSet, {
+                Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1, _blurSettingsUBO->getDescriptorInfo()),
+                Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 1, postProcessTexture(level.blurredVert)),
+                Descriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1, storageImage(level.blurred)),
+            });
+        }
+
+        if (i + 1 < _bloomLevels.size()) {
+            const BloomLevel& lower = _bloomLevels[i + 1];
+            RGResource lowerBloom = i + 2 < _bloomLevels.size() ? lower.upsampled : lower.blurred;
+            write(level.upsampleDescriptorSet, {
+                Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _blurSettingsUBO->getDescriptorInfo()),
+                Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, postProcessTexture(lowerBloom)),     // Lower level
+                Descriptor(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, postProcessTexture(level.blurred)), // This level
+            });
+        }
+    }
+
+    write(_compositeDescriptorSet, {
+        Descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, postProcessTexture(_bloomTarget)), // Bloom texture
+        Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, postProcessTexture(_sceneTarget)), // Normal scene texture
+    });
+}
+
+
+void SolarSystemScene::createComputeBlurPipelines()
+{
+    // Direction, kernel radius and the widest tap spacing (filterRadius) the shared tile covers are baked in,
+    // the kernel weights are computed by the shader
+    struct BlurSpecialization {
+        int blurDirection;
+        int kernelRadius;
+        int maxTapSpacing;
+    } specialization = { 0, std::clamp(_computeBlurRadius, 1, 32), computeBlurMaxTapSpacing };
+    std::array<VkSpecializationMapEntry, 3> mapEntries = {{
+        { 0, offsetof(BlurSpecialization, blurDirection), sizeof(int) },
+        { 1, offsetof(BlurSpecialization, kernelRadius), sizeof(int) },
+        { 2, offsetof(BlurSpecialization, maxTapSpacing), sizeof(int) },
+    }};
+
+    ComputePipelineParams computeBlurPipelineParams {};
+    computeBlurPipelineParams.name = "ComputeBlurPipeline - Vertical";
+    computeBlurPipelineParams.descriptorSetLayouts = { _bloomLevels[0].computeBlurVertDescriptorSet->getDescriptorSetLayout() };
+    computeBlurPipelineParams.specializationInfo = VkSpecializationInfo { static_cast<uint32_t>(mapEntries.size()), mapEntries.data(), sizeof(BlurSpecialization), &specialization };
+    _computeBlurVertPipeline = std::make_unique<ComputePipeline>(_ctx, "spv/blur/blur_comp.spv", computeBlurPipelineParams);
+
+    computeBlurPipelineParams.name = "ComputeBlurPipeline - Horizontal";
+    computeBlurPipelineParams.descriptorSetLayouts = { _bloomLevels[0].computeBlurHorizDescriptorSet->getDescriptorSetLayout() };
+    specialization.blurDirection = 1;
+    _computeBlurHorizPipeline = std::make_unique<ComputePipeline>(_ctx, "spv/blur/blur_comp.spv", computeBlurPipelineParams);
+}
+
+
+void SolarSystemScene::setBlurMode(BlurMode mode)
+{
+    if (mode == _blurMode) return;
+    _blurMode = mode;
+    _renderGraphDirty = true; // Rebuilt before the next frame is recorded
+    spdlog::info("Bloom blur: {}", mode == BlurMode::Compute ? "compute" : "raster");
+}
+
+
+void SolarSystemScene::setSubmissionMode(SubmissionMode mode)
+{
+    _submissionMode = mode;
+    spdlog::info("Instance submission: {}", mode == SubmissionMode::GpuCulled ? "GPU culled" : "CPU");
+}
+
+
+void SolarSystemScene::rebuildRenderGraph()
+{
+    TRACE_SCOPE("SolarSystemScene::rebuildRenderGraph");
+
+    // The previous images stay alive in the deletion queue until the frames using them are done
+    _renderGraph->compile(_swapChain->getSwapChainExtent());
+    _gpuProfiler->reserve(_renderGraph->getProfiledPassCount() + 1); // + GPU Culling
+    writePostProcessDescriptorSets();
+    if (_blurMode == BlurMode::Compute && !_computeBlurVertPipeline) {
+        createComputeBlurPipelines();
+    }
+
+    _renderGraphDirty = false;
+}
+
+
+void SolarSystemScene::onSwapChainRecreated()
+{
+    TRACE_SCOPE("SolarSystemScene::onSwapChainRecreated");
+
+    _renderGraph->updateImportedImage(_swapChainTarget, _swapChain->getSwapChainImages(), _swapChain->getSwapChainImageViews());
+    rebuildRenderGraph();
+
+    // Object selection targets follow the swap chain size
+    _ctx->deletionQueue.pushObject(std::move(_objectSelectionFrameBuffer));
+    createFrameBuffers();
+}
+
+
 void SolarSystemScene::connectPipelines()
 {
     // Set the pipeline for the skybox
@@ -235,6 +418,12 @@ void SolarSystemScene::connectPipelines()
         planet->setPipeline(_planetPipeline);
     }
 
+    // Set the pipeline for the instanced bodies
+    _planetInstances->setPipeline(_instancedPlanetPipeline);
+    _asteroidInstances->setPipeline(_instancedPlanetPipeline);
+    _planetInstances->setCulledPipeline(_culledPlanetPipeline);
+    _asteroidInstances->setCulledPipeline(_culledPlanetPipeline);
+
     // Set the pipeline for orbits
     for (const auto& orbit : _orbits) {
         orbit->setPipeline(_orbitPipeline);
@@ -259,12 +448,83 @@ void SolarSystemScene::createModels()
     HostMesh ring = MeshFactory::createAnnulusMesh(1.3f, 2.2f, 64);
     HostMesh quad =  MeshFactory::createQuadMesh(1.f, 1.f, true);
     HostMesh cube = MeshFactory::createCubeMesh(1.f, 1.f, 1.f);
+    HostMesh rock = MeshFactory::createSphereMesh(1.f, 12, 8); // Asteroids are tiny on screen and many
 
     // Create device meshes (GPU resources)
     std::shared_ptr<DeviceMesh> sphereDMesh = std::make_shared<DeviceMesh>(_ctx, sphere);
     std::shared_ptr<DeviceMesh> ringDMesh = std::make_shared<DeviceMesh>(_ctx, ring);
     std::shared_ptr<DeviceMesh> quadDMesh = std::make_shared<DeviceMesh>(_ctx, quad);
     std::shared_ptr<DeviceMesh> cubeDMesh = std::make_shared<DeviceMesh>(_ctx, cube);
+    std::shared_ptr<DeviceMesh> rockDMesh = std::make_shared<DeviceMesh>(_ctx, rock);
+
+    // Planet textures are decoded in the background. The models start out with flat placeholders (colored so
+    // that e.g. a missing normal map is still flat) and get each real texture once it is uploaded, see update().
+    // Color maps baked into tiles (TextureBaker --virtual) are streamed by the virtual texture system instead of
+    // loaded whole, their planets keep a 1x1 texture in the set and sample the virtual texture. The other color
+    // maps only keep the mips their planet's size on screen needs, within a memory budget (see update()).
+    _textureLoader = std::make_unique<TextureLoader>(_ctx);
+    _textureResidency = std::make_unique<TextureResidency>(_ctx);
+    _virtualTextures = std::make_unique<VirtualTextureSystem>(_ctx, _swapChain->getFramesInFlight());
+    const std::array<uint8_t, 4> gray = { 128, 128, 128, 255 };
+    std::shared_ptr<Texture2D> streamedTexture = std::make_shared<Texture2D>(_ctx, gray.data(), 1, 1, VK_FORMAT_R8G8B8A8_SRGB, 1);
+
+    struct ColorMap {
+        TextureResidency::Handle handle = 0;
+        uint32_t virtualTexture = VirtualTextureSystem::None;
+    };
+    // The feedback pass stores from a fragment shader, without that the baked maps are loaded whole
+    if (!_ctx->fragmentStoresAndAtomicsSupported) {
+        spdlog::warn("Virtual textures need fragmentStoresAndAtomics, color maps are loaded whole");
+    }
+    auto addColorMap = [this](const std::string& path, std::array<uint8_t, 4> placeholderColor) {
+        ColorMap map;
+        if (_ctx->fragmentStoresAndAtomicsSupported && VirtualTextureSystem::hasTiles(path)) {
+            map.virtualTexture = _virtualTextures->add(VirtualTextureSystem::getTilesPath(path));
+        }
+        if (map.virtualTexture == VirtualTextureSystem::None) {
+            map.handle = _textureResidency->add(path, VK_FORMAT_R8G8B8A8_SRGB, placeholderColor);
+        }
+        return map;
+    };
+    auto getColorMap = [this, streamedTexture](const ColorMap& map) {
+        return map.virtualTexture == VirtualTextureSystem::None ? _textureResidency->get(map.handle) : streamedTexture;
+    };
+
+    ColorMap mercuryColor = addColorMap("textures/mercury/8k_mercury.jpg", gray);
+    ColorMap venusColor = addColorMap("textures/venus/4k_venus_atmosphere.jpg", gray);
+    ColorMap earthColor = addColorMap("textures/earth/10k_earth_day.jpg", gray);
+    ColorMap earthUnlit = addColorMap("textures/earth/10k_earth_night.jpg", { 0, 0, 0, 255 });
+    TextureLoader::Handle earthNormal = _textureLoader->add("textures/earth/2k_earth_normal.png", VK_FORMAT_R8G8B8A8_UNORM, { 128, 128, 255, 255 });
+    TextureLoader::Handle earthSpecular = _textureLoader->add("textures/earth/2k_earth_specular.jpeg", VK_FORMAT_R8G8B8A8_UNORM, { 0, 0, 0, 255 });
+    TextureLoader::Handle earthOverlay = _textureLoader->add("textures/earth/8k_earth_clouds.png", VK_FORMAT_R8G8B8A8_SRGB, { 0, 0, 0, 0 });
+    ColorMap moonColor = addColorMap("textures/moon/8k_moon.jpg", gray);
+    ColorMap marsColor = addColorMap("textures/mars/8k_mars.jpg", gray);
+    ColorMap jupiterColor = addColorMap("textures/jupiter/4k_jupiter.jpg", gray);
+    ColorMap saturnColor = addColorMap("textures/saturn/8k_saturn.jpg", gray);
+    TextureLoader::Handle saturnRing = _textureLoader->add("textures/saturn/8k_saturn_ring_alpha.png", VK_FORMAT_R8G8B8A8_SRGB, { 0, 0, 0, 0 });
+    ColorMap uranusColor = addColorMap("textures/uranus/1k_uranus.jpg", gray);
+    ColorMap neptuneColor = addColorMap("textures/neptune/2k_neptune.jpg", gray);
+    ColorMap plutoColor = addColorMap("textures/pluto/2k_pluto.jpg", gray);
+    _textureLoader->loadAsync();
+
+    // Everything written to the frame allocator per frame is declared now: the scene info, the page table and
+    // the instances of both batches
+    createFrameAllocator(FrameAllocator::getFrameSize(_ctx, {
+        sizeof(SceneInfo),
+        _virtualTextures->getPageTableBytes(),
+        InstancedBodies::getFrameBytes(planetInstanceCapacity),
+        InstancedBodies::getFrameBytes(AsteroidBelt::getDefaultParams().count),
+    }));
+    _virtualTextures->createResources(*_frameAllocator);
+
+    auto swapInBaseColor = [this](const ColorMap& map, std::shared_ptr<Planet> planet) {
+        if (map.virtualTexture != VirtualTextureSystem::None) {
+            planet->setVirtualTexture(map.virtualTexture);
+            return;
+        }
+        _textureResidency->onChanged(map.handle, [planet](const std::shared_ptr<Texture2D>& texture) { planet->setBaseColorTexture(texture); });
+        _residentColorMaps.push_back({ planet, map.handle });
+    };
 
     // SkyBox
     std::shared_ptr<TextureCubemap> skyTexture = std::make_shared<TextureCubemap>(_ctx, "textures/skybox", VK_FORMAT_R8G8B8A8_SRGB);
@@ -275,88 +535,136 @@ void SolarSystemScene::createModels()
     _selectableObjects[_sun->getID()] = _sun;
 
     // Mercury
-    std::shared_ptr<Texture2D> mercuryColorTexture = std::make_shared<Texture2D>(_ctx, "textures/mercury/8k_mercury.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> mercuryColorTexture = getColorMap(mercuryColor);
     std::shared_ptr<Planet> mercury = std::make_shared<Planet>(_ctx, "Mercury", sphereDMesh, mercuryColorTexture, _sun, 
         sizeMercury, orbitRadMercury, orbitAtT0Mercury, orbitSpeedMercury, spinAtT0Mercury, spinSpeedMercury);
     _selectableObjects[mercury->getID()] = mercury;
+    swapInBaseColor(mercuryColor, mercury);
     _planets.push_back(std::move(mercury));
 
     // Venus
-    std::shared_ptr<Texture2D> venusColorTexture = std::make_shared<Texture2D>(_ctx, "textures/venus/4k_venus_atmosphere.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> venusColorTexture = getColorMap(venusColor);
     std::shared_ptr<Planet> venus = std::make_shared<Planet>(_ctx, "Venus", sphereDMesh, venusColorTexture, _sun, 
         sizeVenus, orbitRadVenus, orbitAtT0Venus, orbitSpeedVenus, spinAtT0Venus, spinSpeedVenus);
     _glowSpheres.push_back(std::make_unique<GlowSphere>(_ctx, "VenusGlow", sphereDMesh, venus, glm::vec4(0.74f, 0.69f, 0.2f, 1.f), 3.f, 4.f, sizeVenus * 1.03f, false));
     _selectableObjects[venus->getID()] = venus;
+    swapInBaseColor(venusColor, venus);
     _planets.push_back(std::move(venus));
 
     // Earth
-    std::shared_ptr<Texture2D> colorTexture = std::make_shared<Texture2D>(_ctx, "textures/earth/10k_earth_day.jpg", VK_FORMAT_R8G8B8A8_SRGB);
-    std::shared_ptr<Texture2D> unlitTexture = std::make_shared<Texture2D>(_ctx, "textures/earth/10k_earth_night.jpg", VK_FORMAT_R8G8B8A8_SRGB);
-    std::shared_ptr<Texture2D> normalTexture = std::make_shared<Texture2D>(_ctx, "textures/earth/2k_earth_normal.png", VK_FORMAT_R8G8B8A8_UNORM);
-    std::shared_ptr<Texture2D> specularTexture = std::make_shared<Texture2D>(_ctx, "textures/earth/2k_earth_specular.jpeg", VK_FORMAT_R8G8B8A8_UNORM);
-    std::shared_ptr<Texture2D> overlayTexture = std::make_shared<Texture2D>(_ctx, "textures/earth/8k_earth_clouds.png", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> colorTexture = getColorMap(earthColor);
+    std::shared_ptr<Texture2D> unlitTexture = getColorMap(earthUnlit);
+    std::shared_ptr<Texture2D> normalTexture = _textureLoader->get(earthNormal);
+    std::shared_ptr<Texture2D> specularTexture = _textureLoader->get(earthSpecular);
+    std::shared_ptr<Texture2D> overlayTexture = _textureLoader->get(earthOverlay);
     std::shared_ptr<Earth> earth = std::make_shared<Earth>(_ctx, "Earth", sphereDMesh, colorTexture, unlitTexture, normalTexture, specularTexture, overlayTexture, _sun,
          sizeEarth, orbitRadEarth, orbitAtT0Earth, orbitSpeedEarth, spinAtT0Earth, spinSpeedEarth);
     _earth = earth;
     _glowSpheres.push_back(std::make_unique<GlowSphere>(_ctx, "EarthGlow", sphereDMesh, _earth, glm::vec4(0.45f, 0.55f, 1.f, 1.f), 3.f, 4.f, sizeEarth * 1.03f, false));
     _selectableObjects[earth->getID()] = earth;
+    earth->setVirtualTextures(earthColor.virtualTexture, earthUnlit.virtualTexture);
+    if (earthColor.virtualTexture == VirtualTextureSystem::None) {
+        _textureResidency->onChanged(earthColor.handle, [earth](const std::shared_ptr<Texture2D>& texture) { earth->setBaseColorTexture(texture); });
+        _residentColorMaps.push_back({ earth, earthColor.handle });
+    }
+    if (earthUnlit.virtualTexture == VirtualTextureSystem::None) {
+        _textureResidency->onChanged(earthUnlit.handle, [earth](const std::shared_ptr<Texture2D>& texture) { earth->setUnlitColorTexture(texture); });
+        _residentColorMaps.push_back({ earth, earthUnlit.handle });
+    }
+    _textureLoader->onLoaded(earthNormal, [earth](const std::shared_ptr<Texture2D>& texture) { earth->setNormalMapTexture(texture); });
+    _textureLoader->onLoaded(earthSpecular, [earth](const std::shared_ptr<Texture2D>& texture) { earth->setSpecularTexture(texture); });
+    _textureLoader->onLoaded(earthOverlay, [earth](const std::shared_ptr<Texture2D>& texture) { earth->setOverlayColorTexture(texture); });
     _planets.push_back(std::move(earth));
 
     // Earth Moon
-    std::shared_ptr<Texture2D> moonColorTexture = std::make_shared<Texture2D>(_ctx, "textures/moon/8k_moon.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> moonColorTexture = getColorMap(moonColor);
     std::shared_ptr<Planet> moon = std::make_shared<Planet>(_ctx, "Moon", sphereDMesh, moonColorTexture, _earth, 
         sizeMoon, orbitRadMoon, orbitAtT0Moon, orbitSpeedMoon, spinAtT0Moon, spinSpeedMoon);
     _selectableObjects[moon->getID()] = moon;
+    swapInBaseColor(moonColor, moon);
     _planets.push_back(std::move(moon));
 
     // Mars
-    std::shared_ptr<Texture2D> marsColorTexture = std::make_shared<Texture2D>(_ctx, "textures/mars/8k_mars.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> marsColorTexture = getColorMap(marsColor);
     std::shared_ptr<Planet> mars = std::make_shared<Planet>(_ctx, "Mars", sphereDMesh, marsColorTexture, _sun,
         sizeMars, orbitRadMars, orbitAtT0Mars, orbitSpeedMars, spinAtT0Mars, spinSpeedMars);
     _selectableObjects[mars->getID()] = mars;
+    swapInBaseColor(marsColor, mars);
     _planets.push_back(std::move(mars));
 
     // Jupiter
-    std::shared_ptr<Texture2D> jupiterColorTexture = std::make_shared<Texture2D>(_ctx, "textures/jupiter/4k_jupiter.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> jupiterColorTexture = getColorMap(jupiterColor);
     std::shared_ptr<Planet> jupiter = std::make_shared<Planet>(_ctx, "Jupiter", sphereDMesh, jupiterColorTexture, _sun, 
         sizeJupiter, orbitRadJupiter, orbitAtT0Jupiter, orbitSpeedJupiter, spinAtT0Jupiter, spinSpeedJupiter);
     _selectableObjects[jupiter->getID()] = jupiter;
+    swapInBaseColor(jupiterColor, jupiter);
     _planets.push_back(std::move(jupiter));
 
     // Saturn
-    std::shared_ptr<Texture2D> saturnColorTexture = std::make_shared<Texture2D>(_ctx, "textures/saturn/8k_saturn.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> saturnColorTexture = getColorMap(saturnColor);
     std::shared_ptr<Planet> saturn = std::make_shared<Planet>(_ctx, "Saturn", sphereDMesh, saturnColorTexture, _sun,
         sizeSaturn, orbitRadSaturn, orbitAtT0Saturn, orbitSpeedSaturn, spinAtT0Saturn, spinSpeedSaturn);
     _selectableObjects[saturn->getID()] = saturn;
+    swapInBaseColor(saturnColor, saturn);
     _planets.push_back(std::move(saturn));
 
     // Saturn Ring
-    std::shared_ptr<Texture2D> ringTexture = std::make_shared<Texture2D>(_ctx, "textures/saturn/8k_saturn_ring_alpha.png", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> ringTexture = _textureLoader->get(saturnRing);
     std::shared_ptr<Planet> saturn_ring = std::make_shared<Planet>(_ctx, "SaturnRing", ringDMesh, ringTexture, _sun, 
         sizeSaturnRing, orbitRadSaturn, orbitAtT0Saturn, orbitSpeedSaturn, spinAtT0Saturn, spinSpeedSaturn);
+    _textureLoader->onLoaded(saturnRing, [saturn_ring](const std::shared_ptr<Texture2D>& texture) { saturn_ring->setBaseColorTexture(texture); });
     _planets.push_back(std::move(saturn_ring));
 
     // Uranus
-    std::shared_ptr<Texture2D> uranusColorTexture = std::make_shared<Texture2D>(_ctx, "textures/uranus/1k_uranus.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> uranusColorTexture = getColorMap(uranusColor);
     std::shared_ptr<Planet> uranus = std::make_shared<Planet>(_ctx, "Uranus", sphereDMesh, uranusColorTexture, _sun,
         sizeUranus, orbitRadUranus, orbitAtT0Uranus, orbitSpeedUranus, spinAtT0Uranus, spinSpeedUranus);
     _selectableObjects[uranus->getID()] = uranus;
+    swapInBaseColor(uranusColor, uranus);
     _planets.push_back(std::move(uranus));
 
     // Neptune
-    std::shared_ptr<Texture2D> neptuneColorTexture = std::make_shared<Texture2D>(_ctx, "textures/neptune/2k_neptune.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> neptuneColorTexture = getColorMap(neptuneColor);
     std::shared_ptr<Planet> neptune = std::make_shared<Planet>(_ctx, "Neptune", sphereDMesh, neptuneColorTexture, _sun, 
         sizeNeptune, orbitRadNeptune, orbitAtT0Neptune, orbitSpeedNeptune, spinAtT0Neptune, spinSpeedNeptune);
     _selectableObjects[neptune->getID()] = neptune;
+    swapInBaseColor(neptuneColor, neptune);
     _planets.push_back(std::move(neptune));
 
     // Pluto
-    std::shared_ptr<Texture2D> plutoColorTexture = std::make_shared<Texture2D>(_ctx, "textures/pluto/2k_pluto.jpg", VK_FORMAT_R8G8B8A8_SRGB);
+    std::shared_ptr<Texture2D> plutoColorTexture = getColorMap(plutoColor);
     std::shared_ptr<Planet> pluto = std::make_shared<Planet>(_ctx, "Pluto", sphereDMesh, plutoColorTexture, _sun,
         sizePluto, orbitRadPluto, orbitAtT0Pluto, orbitSpeedPluto, spinAtT0Pluto, spinSpeedPluto);
     _selectableObjects[pluto->getID()] = pluto;
+    swapInBaseColor(plutoColor, pluto);
     _planets.push_back(std::move(pluto));
 
+    // Planets that share the sphere and the planet pipeline go out as one instanced draw. Earth has its own
+    // shader and the ring its own mesh, they keep their single draws.
+    auto isInstanced = [this, &sphereDMesh](const std::shared_ptr<Planet>& planet) {
+        return planet != _earth && planet->getDeviceMesh() == sphereDMesh.get();
+    };
+    _planetInstances = std::make_unique<InstancedBodies>(_ctx, "PlanetInstances", sphereDMesh, *_frameAllocator, planetInstanceCapacity);
+    for (const auto& planet : _planets) {
+        if (isInstanced(planet)) _planetInstances->add(planet);
+    }
+
+    // Asteroid belt between Mars and Jupiter, untextured rocks tinted per instance
+    const std::array<uint8_t, 4> white = { 255, 255, 255, 255 };
+    _asteroidTexture = std::make_shared<Texture2D>(_ctx, white.data(), 1, 1, VK_FORMAT_R8G8B8A8_SRGB, 1);
+    _asteroidTextureIndex = _ctx->bindlessTextures->addTexture(_asteroidTexture->getDescriptorInfo());
+    auto asteroidBelt = std::make_shared<AsteroidBelt>(_sun, _asteroidTextureIndex);
+    _asteroidInstances = std::make_unique<InstancedBodies>(_ctx, "AsteroidBelt", rockDMesh, *_frameAllocator, asteroidBelt->getCount());
+    _asteroidInstances->add(std::move(asteroidBelt));
+
+    // Both meshes are unit spheres
+    _gpuCulling = std::make_unique<GpuCulling>(_ctx, _swapChain->getFramesInFlight());
+    _planetInstances->addCullingBatch(*_gpuCulling, 1.0f);
+    _asteroidInstances->addCullingBatch(*_gpuCulling, 1.0f);
+    if (GpuCulling::getDefaultParams().enabled) {
+        setSubmissionMode(SubmissionMode::GpuCulled);
+    }
+
 
     // Mercury Orbit
     _orbits.push_back(std::make_unique<Orbit>(_ctx, "MercuryOrbit", quadDMesh, _sun, orbitRadMercury, orbitAtT0Mercury, orbitSpeedMercury));
@@ -392,46 +700,24 @@ void SolarSystemScene::createModels()
     // Glow spheres
     _sunGlowSphere = std::make_unique<GlowSphere>(_ctx, "SunGlow", sphereDMesh, _sun, glm::vec4(1.f, 0.4f, 0.0f, 0.4f), 0.5f, 3.0f, sizeSun * 2.f, true);
     //TODO: need to expose these parameters in the UI
+
+    // Draw order of the main pass
+    _mainDrawables.clear();
+    _mainDrawables.push_back(_skyBox.get());
+    _mainDrawables.push_back(_sun.get());
+    _mainDrawables.push_back(_sunGlowSphere.get()); // Only writes glow, before the planets so they occlude it
+    _mainDrawables.push_back(_planetInstances.get());
+    for (const auto& planet : _planets) {
+        if (!isInstanced(planet)) _mainDrawables.push_back(planet.get());
+    }
+    _mainDrawables.push_back(_asteroidInstances.get());
+    for (const auto& glowSphere : _glowSpheres) _mainDrawables.push_back(glowSphere.get());
+    for (const auto& orbit : _orbits) _mainDrawables.push_back(orbit.get());
 }
 
 
 void SolarSystemScene::createRenderPasses() {
     
-    RenderPassParams offscreenRenderPassParams;
-    offscreenRenderPassParams.name = "Offscreen Renderpass - No MSAA";
-    offscreenRenderPassParams.colorFormat = VK_FORMAT_R8G8B8A8_SRGB;
-    offscreenRenderPassParams.depthFormat = VulkanHelper::findDepthFormat(_ctx);
-    offscreenRenderPassParams.colorAttachmentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    offscreenRenderPassParams.depthAttachmentLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    offscreenRenderPassParams.useColor = true;
-    offscreenRenderPassParams.useDepth = true;
-    offscreenRenderPassParams.useResolve = false;
-    offscreenRenderPassParams.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
-    _offscreenRenderPass = std::make_unique<RenderPass>(_ctx, offscreenRenderPassParams);
-
-    offscreenRenderPassParams.name = "Offscreen Renderpass - MSAA";
-    offscreenRenderPassParams.resolveFormat = VK_FORMAT_R8G8B8A8_SRGB;
-    offscreenRenderPassParams.colorAttachmentLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    offscreenRenderPassParams.resolveAttachmentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    offscreenRenderPassParams.useResolve = true;
-    offscreenRenderPassParams.msaaSamples = _msaaSamples;
-    _offscreenRenderPassMSAA = std::make_unique<RenderPass>(_ctx, offscreenRenderPassParams);
-
-    RenderPassParams screenRenderPassParams;
-    screenRenderPassParams.name = "Onscreen Renderpass";
-    screenRenderPassParams.colorFormat = _swapChain->getSwapChainImageFormat();
-    screenRenderPassParams.depthFormat = VulkanHelper::findDepthFormat(_ctx);
-    screenRenderPassParams.resolveFormat = _swapChain->getSwapChainImageFormat();
-    screenRenderPassParams.colorAttachmentLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    screenRenderPassParams.depthAttachmentLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    screenRenderPassParams.resolveAttachmentLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    screenRenderPassParams.useColor = true;
-    screenRenderPassParams.useDepth = true;
-    screenRenderPassParams.useResolve = true;
-    screenRenderPassParams.msaaSamples = _msaaSamples;
-    screenRenderPassParams.isMultiPass = false;
-    _renderPass = std::make_unique<RenderPass>(_ctx, screenRenderPassParams);
-
     RenderPassParams objectSelectionRenderPassParams;
     objectSelectionRenderPassParams.name = "Object Selection Renderpass";
     objectSelectionRenderPassParams.colorFormat = VK_FORMAT_R32_UINT;
@@ -450,55 +736,6 @@ void SolarSystemScene::createRenderPasses() {
 
 void SolarSystemScene::createFrameBuffers() {
     
-    _offscreenFrameBuffers.resize(4); // 4 offscreen framebuffers (1 for glow, 1 for vertical blur, 1 for horizontal blur, 1 for normal rendering)
-
-    // Offscreen Framebuffers (No MSAA)
-    FrameBufferParams offscreenFrameBufferParams{};
-    offscreenFrameBufferParams.extent.width = static_cast<int>(_swapChain->getSwapChainExtent().width);
-    offscreenFrameBufferParams.extent.height = static_cast<int>(_swapChain->getSwapChainExtent().height);
-    offscreenFrameBufferParams.renderPass = _offscreenRenderPass->getRenderPass();
-    offscreenFrameBufferParams.hasColor = true;
-    offscreenFrameBufferParams.hasDepth = true;
-    offscreenFrameBufferParams.hasResolve = false;
-    offscreenFrameBufferParams.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
-    offscreenFrameBufferParams.colorFormat = VK_FORMAT_R8G8B8A8_SRGB;
-    offscreenFrameBufferParams.depthFormat = VulkanHelper::findDepthFormat(_ctx);
-    offscreenFrameBufferParams.colorUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    offscreenFrameBufferParams.depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    // Create offscreen framebuffers without MSAA here
-
-    // Offscreen Framebuffer (MSAA)
-    offscreenFrameBufferParams.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    offscreenFrameBufferParams.hasResolve = true;
-    offscreenFrameBufferParams.msaaSamples = _msaaSamples;
-    offscreenFrameBufferParams.resolveFormat = VK_FORMAT_R8G8B8A8_SRGB;
-    offscreenFrameBufferParams.colorUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
-    offscreenFrameBufferParams.depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    offscreenFrameBufferParams.resolveUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-    _offscreenFrameBuffers[0] = std::make_unique<FrameBuffer>(_ctx, offscreenFrameBufferParams); // Glow pass framebuffer
-    _offscreenFrameBuffers[1] = std::make_unique<FrameBuffer>(_ctx, offscreenFrameBufferParams); // Vertical blur framebuffer
-    _offscreenFrameBuffers[2] = std::make_unique<FrameBuffer>(_ctx, offscreenFrameBufferParams); // Horizontal blur framebuffer
-    _offscreenFrameBuffers[3] = std::make_unique<FrameBuffer>(_ctx, offscreenFrameBufferParams); // Normal rendering framebuffer
-
-    // Main Framebuffers
-    FrameBufferParams frameBufferParams{};
-    frameBufferParams.extent = _swapChain->getSwapChainExtent();
-    frameBufferParams.renderPass = _renderPass->getRenderPass();
-    frameBufferParams.msaaSamples = _msaaSamples;
-    frameBufferParams.hasColor = true;
-    frameBufferParams.hasDepth = true;
-    frameBufferParams.hasResolve = true;
-    frameBufferParams.colorFormat = _swapChain->getSwapChainImageFormat();
-    frameBufferParams.depthFormat = VulkanHelper::findDepthFormat(_ctx);
-    frameBufferParams.colorUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
-    frameBufferParams.depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    _mainFrameBuffers.resize(_swapChain->getSwapChainImageViews().size());
-    for (size_t i = 0; i < _swapChain->getSwapChainImageViews().size(); i++) {
-        frameBufferParams.resolveImageView = _swapChain->getSwapChainImageViews()[i];
-        _mainFrameBuffers[i] = std::make_unique<FrameBuffer>(_ctx, frameBufferParams);
-    }
-
     // Object Selection Framebuffer
     FrameBufferParams objectSelectionFrameBufferParams{};
     objectSelectionFrameBufferParams.extent = _swapChain->getSwapChainExtent();
@@ -515,10 +752,225 @@ void SolarSystemScene::createFrameBuffers() {
 }
 
 
+void SolarSystemScene::createRenderGraph()
+{
+    _renderGraph = std::make_unique<RenderGraph>(_ctx);
+
+    const VkFormat colorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    const VkFormat depthFormat = VulkanHelper::findDepthFormat(_ctx);
+
+    // MSAA color and depth never leave the main pass, they are resolved into the scene and glow targets
+    RGResource sceneMSAA = _renderGraph->createImage("Scene MSAA", { colorFormat, 1.0f, _msaaSamples });
+    RGResource glowMSAA = _renderGraph->createImage("Glow MSAA", { colorFormat, 1.0f, _msaaSamples });
+    RGResource sceneDepth = _renderGraph->createImage("Scene Depth", { depthFormat, 1.0f, _msaaSamples });
+    _glowTarget = _renderGraph->createImage("Glow", { colorFormat });
+    _sceneTarget = _renderGraph->createImage("Scene", { colorFormat });
+    _swapChainTarget = _renderGraph->importImage("SwapChain", _swapChain->getSwapChainImageFormat(),
+        _swapChain->getSwapChainImages(), _swapChain->getSwapChainImageViews(), _swapChain->getFinalLayout()); // Present, or read back when headless
+
+    /*
+        Virtual texture feedback: Render the virtual textured planets at low resolution, every pixel marks the tile
+        it would sample. Nothing reads the depth, the marks go to a buffer the graph does not track.
+    */
+    RGResource feedbackDepth = _renderGraph->createImage("Virtual Texture Feedback Depth", { depthFormat, _virtualTextures->getFeedbackScale() });
+    _renderGraph->addGraphicsPass("Virtual Texture Feedback")
+        .setDepthOutput(feedbackDepth)
+        .setSideEffects()
+        .setCondition([this]() { return _virtualTextures->getTextureCount() > 0; })
+        .setRecord([this](VkCommandBuffer cmd, uint32_t, uint32_t) {
+            for (const auto& planet : _planets) {
+                if (planet->hasVirtualTexture()) planet->drawVirtualTextureFeedback(cmd, *this, *_virtualTextureFeedbackPipeline);
+            }
+        });
+
+    /*
+        First pass (Main): Shade the scene, every drawable also writes its glow into the second color attachment
+        (light sources their color, planets black so they occlude the glow)
+    */
+    _renderGraph->addGraphicsPass("Main")
+        .addColorOutput(sceneMSAA)
+        .addResolveOutput(_sceneTarget)
+        .addColorOutput(glowMSAA)
+        .addResolveOutput(_glowTarget)
+        .setDepthOutput(sceneDepth)
+        .setRecord([this](VkCommandBuffer cmd, uint32_t chunk, uint32_t chunkCount) {
+            auto [begin, end] = chunkRange(_mainDrawables.size(), chunk, chunkCount);
+            for (size_t i = begin; i < end; i++) {
+                _mainDrawables[i]->draw(cmd, *this);
+            }
+        }, [this]() { return _commandRecorder->getChunkCount(static_cast<uint32_t>(_mainDrawables.size())); });
+
+    /*
+        Bloom passes: Downsample the glow through the levels, blur every level, then upsample and accumulate
+        Full-screen passes write every pixel, so they need neither MSAA, depth nor a clear
+    */
+    VkExtent2D extent = _swapChain->getSwapChainExtent();
+    uint32_t levelCount = std::clamp(blurSettings.levelCount, 1u, 8u);
+    while (levelCount > 1 && (std::min(extent.width, extent.height) >> levelCount) < 4) {
+        levelCount--; // Don't go below a few texels
+    }
+    if (levelCount != blurSettings.levelCount) {
+        spdlog::warn("Bloom level count {} not usable at {}x{}, using {}", blurSettings.levelCount, extent.width, extent.height, levelCount);
+        blurSettings.levelCount = levelCount;
+    }
+
+    // Half float, the levels are summed up and must not clip
+    const VkFormat bloomFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    _bloomLevels.clear();
+    _bloomLevels.resize(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        BloomLevel& level = _bloomLevels[i];
+        const std::string suffix = " " + std::to_string(i + 1);
+        const float scale = 1.0f / static_cast<float>(2u << i);
+
+        level.downsampled = _renderGraph->createImage("Bloom Downsampled" + suffix, { bloomFormat, scale });
+        level.blurredVert = _renderGraph->createImage("Bloom Blurred Vertical" + suffix, { bloomFormat, scale });
+        level.blurred = _renderGraph->createImage("Bloom Blurred" + suffix, { bloomFormat, scale });
+        if (i + 1 < levelCount) {
+            level.upsampled = _renderGraph->createImage("Bloom Upsampled" + suffix, { bloomFormat, scale });
+        }
+    }
+    _bloomTarget = levelCount > 1 ? _bloomLevels[0].upsampled : _bloomLevels[0].blurred;
+
+    auto drawFullScreen = [](VkCommandBuffer cmd, Pipeline& pipeline, const DescriptorSet& descriptorSet) {
+        pipeline.bind(cmd);
+        VkDescriptorSet set = descriptorSet.getDescriptorSet();
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.getPipelineLayout(), 0, 1, &set, 0, nullptr);
+        vkCmdDraw(cmd, 3, 1, 0, 0); // Draw a full-screen triangle
+    };
+
+    // One workgroup per tile of a row (horizontal) or column (vertical)
+    auto dispatchBlur = [this](VkCommandBuffer cmd, ComputePipeline& pipeline, const DescriptorSet& descriptorSet, RGResource target, bool horizontal) {
+        pipeline.bind(cmd);
+        VkDescriptorSet set = descriptorSet.getDescriptorSet();
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getPipelineLayout(), 0, 1, &set, 0, nullptr);
+
+        VkExtent2D extent = _renderGraph->getImageExtent(target);
+        uint32_t lineLength = horizontal ? extent.width : extent.height;
+        uint32_t lineCount = horizontal ? extent.height : extent.width;
+        vkCmdDispatch(cmd, (lineLength + computeBlurTileSize - 1) / computeBlurTileSize, lineCount, 1);
+    };
+
+    // Only one of the blur paths is live, switching recompiles the graph
+    auto isRasterBlur = [this]() { return _blurMode == BlurMode::Raster; };
+    auto isComputeBlur = [this]() { return _blurMode == BlurMode::Compute; };
+
+    for (uint32_t i = 0; i < levelCount; i++) {
+        const std::string suffix = " " + std::to_string(i + 1);
+        RGResource source = i == 0 ? _glowTarget : _bloomLevels[i - 1].downsampled;
+
+        _renderGraph->addGraphicsPass("Bloom Downsample" + suffix)
+            .setProfileGroup("Bloom")
+            .addTextureInput(source)
+            .addColorOutput(_bloomLevels[i].downsampled, RGLoad::DontCare)
+            .setRecord([this, i, drawFullScreen](VkCommandBuffer cmd, uint32_t, uint32_t) {
+                drawFullScreen(cmd, *_bloomDownsamplePipeline, *_bloomLevels[i].downsampleDescriptorSet);
+            });
+
+        _renderGraph->addGraphicsPass("Bloom Blur Vertical" + suffix)
+            .setProfileGroup("Bloom")
+            .setCondition(isRasterBlur)
+            .addTextureInput(_bloomLevels[i].downsampled)
+            .addColorOutput(_bloomLevels[i].blurredVert, RGLoad::DontCare)
+            .setRecord([this, i, drawFullScreen](VkCommandBuffer cmd, uint32_t, uint32_t) {
+                drawFullScreen(cmd, *_blurVertPipeline, *_bloomLevels[i].blurVertDescriptorSet);
+            });
+
+        _renderGraph->addGraphicsPass("Bloom Blur Horizontal" + suffix)
+            .setProfileGroup("Bloom")
+            .setCondition(isRasterBlur)
+            .addTextureInput(_bloomLevels[i].blurredVert)
+            .addColorOutput(_bloomLevels[i].blurred, RGLoad::DontCare)
+            .setRecord([this, i, drawFullScreen](VkCommandBuffer cmd, uint32_t, uint32_t) {
+                drawFullScreen(cmd, *_blurHorizPipeline, *_bloomLevels[i].blurHorizDescriptorSet);
+            });
+
+        _renderGraph->addComputePass("Bloom Compute Blur Vertical" + suffix)
+            .setProfileGroup("Bloom")
+            .setCondition(isComputeBlur)
+            .addTextureInput(_bloomLevels[i].downsampled)
+            .addStorageOutput(_bloomLevels[i].blurredVert)
+            .setRecord([this, i, dispatchBlur](VkCommandBuffer cmd, uint32_t, uint32_t) {
+                dispatchBlur(cmd, *_computeBlurVertPipeline, *_bloomLevels[i].computeBlurVertDescriptorSet, _bloomLevels[i].blurredVert, false);
+            });
+
+        _renderGraph->addComputePass("Bloom Compute Blur Horizontal" + suffix)
+            .setProfileGroup("Bloom")
+            .setCondition(isComputeBlur)
+            .addTextureInput(_bloomLevels[i].blurredVert)
+            .addStorageOutput(_bloomLevels[i].blurred)
+            .setRecord([this, i, dispatchBlur](VkCommandBuffer cmd, uint32_t, uint32_t) {
+                dispatchBlur(cmd, *_computeBlurHorizPipeline, *_bloomLevels[i].computeBlurHorizDescriptorSet, _bloomLevels[i].blurred, true);
+            });
+    }
+
+    // Smallest level first, each upsample adds the (already accumulated) level below
+    for (uint32_t i = levelCount - 1; i-- > 0;) {
+        const BloomLevel& lower = _bloomLevels[i + 1];
+        RGResource lowerBloom = i + 2 < levelCount ? lower.upsampled : lower.blurred;
+
+        _renderGraph->addGraphicsPass("Bloom Upsample " + std::to_string(i + 1))
+            .setProfileGroup("Bloom")
+            .addTextureInput(lowerBloom)
+            .addTextureInput(_bloomLevels[i].blurred)
+            .addColorOutput(_bloomLevels[i].upsampled, RGLoad::DontCare)
+            .setRecord([this, i, drawFullScreen](VkCommandBuffer cmd, uint32_t, uint32_t) {
+                drawFullScreen(cmd, *_bloomUpsamplePipeline, *_bloomLevels[i].upsampleDescriptorSet);
+            });
+    }
+
+    /*
+        Last pass (Composite): Combine the normal rendering with the bloom
+    */
+    _renderGraph->addGraphicsPass("Composite")
+        .addTextureInput(_bloomTarget)
+        .addTextureInput(_sceneTarget)
+        .addColorOutput(_swapChainTarget, RGLoad::DontCare)
+        .setRecord([this](VkCommandBuffer cmd, uint32_t, uint32_t) {
+            // Bind the composite pipeline
+            _compositePipeline->bind(cmd);
+
+            // Bind the descriptor set for the composite pass
+            std::array<VkDescriptorSet, 1> compositeDescriptorSets = {
+                _compositeDescriptorSet->getDescriptorSet() // Composite descriptor set
+            };
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _compositePipeline->getPipelineLayout(), 0, 1, compositeDescriptorSets.data(), 0, nullptr);
+
+            // Draw a full-screen quad for the composite pass
+            vkCmdDraw(cmd, 3, 1, 0, 0); // Draw a full-screen triangle for the composite pass
+        });
+
+    _renderGraph->compile(_swapChain->getSwapChainExtent());
+
+    // Timestamps for every pass and group of the graph, and for the GPU culling recorded before it
+    _gpuProfiler->reserve(_renderGraph->getProfiledPassCount() + 1);
+}
+
+
+void SolarSystemScene::finishLoading()
+{
+    _textureLoader->finish();
+    _textureResidency->finish();
+}
+
+
 void SolarSystemScene::update(uint32_t currentImage)
 {
     Scene::update(currentImage);
 
+    // Swap in the textures that finished loading, before anything is recorded with the old descriptor sets
+    _textureLoader->update();
+
+    // Tiles the frame of this slot asked for, and this frame's page table
+    _virtualTextures->update(currentImage, *_frameAllocator);
+
+    // Visible instances of the frame this slot culled last
+    _gpuCulling->update(currentImage);
+
+    if (_renderGraphDirty) {
+        rebuildRenderGraph();
+    }
+
     static auto startTime = std::chrono::high_resolution_clock::now();
     auto currentTime = std::chrono::high_resolution_clock::now();
 
@@ -539,6 +991,10 @@ void SolarSystemScene::update(uint32_t currentImage)
         glowSphere->calculateModelMatrix();
     }
 
+    // This frame's instances, after the model matrices they are copied from
+    _planetInstances->update(*_frameAllocator, time * 4000.f);
+    _asteroidInstances->update(*_frameAllocator, time * 4000.f);
+
     // Update camera position based on time
     _camera->setTarget(_selectableObjects[_currentTargetObjectID]->getPosition());
     _camera->advanceAnimation(time - _sceneInfo.time);
@@ -550,13 +1006,35 @@ void SolarSystemScene::update(uint32_t currentImage)
     _sceneInfo.time = time;
     _sceneInfo.cameraPosition = _camera->getPosition();
 
-    // Update the scene information UBO
-    _sceneInfoUBOs[_currentFrame]->update(_sceneInfo);
+    // How big every color map shows up decides its mips. The angular radius of the sphere gives its radius in
+    // pixels, planets behind the camera count as not visible.
+    const float pixelsPerUnit = std::abs(_sceneInfo.projection[1][1]) * swapChainExtent.height * 0.5f;
+    for (const auto& [planet, handle] : _residentColorMaps) {
+        const glm::mat4& model = planet->getModelMatrix();
+        const float radius = glm::length(glm::vec3(model[0]));
+        const glm::vec3 viewPosition = glm::vec3(_sceneInfo.view * model[3]);
+        const float distance = glm::length(viewPosition);
+
+        float pixels = 0.0f;
+        if (distance <= radius) {
+            pixels = static_cast<float>(swapChainExtent.height); // Inside, as big as it gets
+        } else if (viewPosition.z < radius) {
+            pixels = radius / std::sqrt(distance * distance - radius * radius) * pixelsPerUnit;
+        }
+        _textureResidency->setScreenRadius(handle, pixels);
+    }
+    _textureResidency->update();
+
+    // Write this frame's uniforms, draws bind them with the returned offset
+    _sceneInfoOffset = _frameAllocator->push(_sceneInfo);
 }
 
 
 void SolarSystemScene::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t targetSwapImageIndex)
 {
+    // The fence of this frame slot has signaled, so its secondary command buffers can be recycled
+    _commandRecorder->beginFrame(_currentFrame);
+
     // Begin Command buffer recording
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -568,223 +1046,29 @@ void SolarSystemScene::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32
         return;
     }
 
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } }; // Clear color
-    clearValues[1].depthStencil = { 1.0f, 0 };             // Clear depth value
+    // Collect last timings of this frame slot and reset its queries
+    _gpuProfiler->beginFrame(commandBuffer, _currentFrame);
 
-    // Solar System Scene uses bloom effect
+    // New virtual texture tiles, before the passes sample the atlas
+    _virtualTextures->recordUploads(commandBuffer);
 
-    /*
-        First pass (Glow): Render glowing objects to offscreen framebuffer
-    */
-    VkRenderPassBeginInfo renderPassBeginInfo{};
-    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassBeginInfo.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    renderPassBeginInfo.framebuffer = _offscreenFrameBuffers[0]->getFrameBuffer();
-    renderPassBeginInfo.renderArea.offset = {0, 0};
-    renderPassBeginInfo.renderArea.extent = _offscreenFrameBuffers[0]->getExtent();
-    renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassBeginInfo.pClearValues = clearValues.data();
-    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    VkViewport offscreenViewport{};
-    offscreenViewport.x = 0.0f;
-    offscreenViewport.y = 0.0f;
-    offscreenViewport.width = _offscreenFrameBuffers[0]->getExtent().width;
-    offscreenViewport.height = _offscreenFrameBuffers[0]->getExtent().height;
-    offscreenViewport.minDepth = 0.0f;
-    offscreenViewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &offscreenViewport);
-
-    VkRect2D offscreenScissor{};
-    offscreenScissor.offset = {0, 0};
-    offscreenScissor.extent = _offscreenFrameBuffers[0]->getExtent();
-    vkCmdSetScissor(commandBuffer, 0, 1, &offscreenScissor);
-
-
-    // Draw sun
-    _sun->draw(commandBuffer, *this);
-
-    // Draw sun glow sphere
-    _sunGlowSphere->draw(commandBuffer, *this);
-
-    // Draw sun and planets
-    // {
-    //     VkBuffer vertexBuffers[] = {_sun->getDeviceMesh()->getVertexBuffer()};
-    //     VkDeviceSize offsets[] = {0};
-    //     vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets); // We can have multiple vertex buffers
-    //     vkCmdBindIndexBuffer(commandBuffer, _sun->getDeviceMesh()->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32); // We can only use one index buffer at a time
-
-    //     std::array<VkDescriptorSet, 1> descriptorSets = {
-    //         _sceneDescriptorSets[_currentFrame]->getDescriptorSet()  // Per-frame descriptor set
-    //     };
-    //     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _glowPipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 0, nullptr);
-
-    //     // Push constants for model
-    //     GlowPassPushConstants pushConstants{};
-    //     pushConstants.model = _sun->getModelMatrix();
-    //     pushConstants.glowColor = _sun->glowColor;
-    //     vkCmdPushConstants(commandBuffer, _glowPipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GlowPassPushConstants), &pushConstants);
-
-    //     vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_sun->getDeviceMesh()->getIndicesCount()), 1, 0, 0, 0); 
-    // }
+    // GPU culled instances: the compute pass writes the indirect draws the main pass reads
+    if (_submissionMode == SubmissionMode::GpuCulled) {
+        const float pixelsPerUnit = std::abs(_sceneInfo.projection[1][1]) * _swapChain->getSwapChainExtent().height * 0.5f;
 
-    // Bind glow pipeline
-    _glowPipeline->bind(commandBuffer);
-    
-    for(int m=0; m<static_cast<int>(_planets.size()); m++) {
-        VkBuffer vertexBuffers[] = {_planets[m]->getDeviceMesh()->getVertexBuffer()};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets); // We can have multiple vertex buffers
-        vkCmdBindIndexBuffer(commandBuffer, _planets[m]->getDeviceMesh()->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32); // We can only use one index buffer at a time
-
-        std::array<VkDescriptorSet, 1> descriptorSets = {
-            _sceneDescriptorSets[_currentFrame]->getDescriptorSet()  // Per-frame descriptor set
-        };
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _glowPipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 0, nullptr);
-
-        // Push constants for model
-        GlowPassPushConstants pushConstants{};
-        pushConstants.model = _planets[m]->getModelMatrix();
-        pushConstants.glowColor = glm::vec3(0.f);
-        vkCmdPushConstants(commandBuffer, _glowPipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GlowPassPushConstants), &pushConstants);
-
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_planets[m]->getDeviceMesh()->getIndicesCount()), 1, 0, 0, 0);
+        _gpuProfiler->beginPass(commandBuffer, "GPU Culling");
+        _gpuCulling->beginCulling(commandBuffer, _sceneInfo.projection * _sceneInfo.view, pixelsPerUnit);
+        _planetInstances->recordCulling(commandBuffer, *_gpuCulling);
+        _asteroidInstances->recordCulling(commandBuffer, *_gpuCulling);
+        _gpuCulling->endCulling(commandBuffer);
+        _gpuProfiler->endPass(commandBuffer);
     }
 
-    vkCmdEndRenderPass(commandBuffer);
-
-    /*
-        Second pass (Vertical Blur): Apply vertical blur to the glow pass output
-    */
-    renderPassBeginInfo.framebuffer = _offscreenFrameBuffers[1]->getFrameBuffer();
-    renderPassBeginInfo.renderArea.extent = _offscreenFrameBuffers[1]->getExtent();
-    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // Solar System Scene uses bloom effect, see createRenderGraph for the passes
+    _renderGraph->execute(commandBuffer, targetSwapImageIndex, *_commandRecorder, *_gpuProfiler);
 
-    offscreenViewport.width = _offscreenFrameBuffers[1]->getExtent().width;
-    offscreenViewport.height = _offscreenFrameBuffers[1]->getExtent().height;
-    vkCmdSetViewport(commandBuffer, 0, 1, &offscreenViewport);
-
-    offscreenScissor.extent = _offscreenFrameBuffers[1]->getExtent();
-    vkCmdSetScissor(commandBuffer, 0, 1, &offscreenScissor);
-
-    _blurVertPipeline->bind(commandBuffer);
-    std::array<VkDescriptorSet, 1> blurVertDescriptorSets = {
-        _blurVertDescriptorSet->getDescriptorSet()                 // Blur descriptor set
-    };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _blurVertPipeline->getPipelineLayout(), 0, 1, blurVertDescriptorSets.data(), 0, nullptr);
-
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0); // Draw a full-screen triangle for the blur pass
-    vkCmdEndRenderPass(commandBuffer);
-
-    
-    /*
-        Third pass (Horizontal Blur): Apply horizontal blur to the vertical blur output
-    */
-    renderPassBeginInfo.framebuffer = _offscreenFrameBuffers[2]->getFrameBuffer();
-    renderPassBeginInfo.renderArea.extent = _offscreenFrameBuffers[2]->getExtent();
-    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    offscreenViewport.width = _offscreenFrameBuffers[2]->getExtent().width;
-    offscreenViewport.height = _offscreenFrameBuffers[2]->getExtent().height;
-    vkCmdSetViewport(commandBuffer, 0, 1, &offscreenViewport);
-
-    offscreenScissor.extent = _offscreenFrameBuffers[2]->getExtent();
-    vkCmdSetScissor(commandBuffer, 0, 1, &offscreenScissor);
-
-    _blurHorizPipeline->bind(commandBuffer);
-    std::array<VkDescriptorSet, 1> blurHorizDescriptorSets = {
-        _blurHorizDescriptorSet->getDescriptorSet()                 // Blur descriptor set
-    };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _blurHorizPipeline->getPipelineLayout(), 0, 1, blurHorizDescriptorSets.data(), 0, nullptr);
-
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0); // Draw a full-screen triangle for the blur pass
-    vkCmdEndRenderPass(commandBuffer);
-
-
-    /*
-        Fourth pass (Normal Shading)
-    */
-    VkRenderPassBeginInfo mainRenderPassBeginInfo{};
-    mainRenderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    mainRenderPassBeginInfo.renderPass = _offscreenRenderPassMSAA->getRenderPass();
-    mainRenderPassBeginInfo.framebuffer = _offscreenFrameBuffers[3]->getFrameBuffer();
-    mainRenderPassBeginInfo.renderArea.offset = { 0, 0 };
-    mainRenderPassBeginInfo.renderArea.extent = _offscreenFrameBuffers[3]->getExtent();
-    mainRenderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    mainRenderPassBeginInfo.pClearValues = clearValues.data();
-    vkCmdBeginRenderPass(commandBuffer, &mainRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    offscreenViewport.width = _offscreenFrameBuffers[3]->getExtent().width;
-    offscreenViewport.height = _offscreenFrameBuffers[3]->getExtent().height;
-    vkCmdSetViewport(commandBuffer, 0, 1, &offscreenViewport);
-
-    offscreenScissor.extent = _offscreenFrameBuffers[3]->getExtent();
-    vkCmdSetScissor(commandBuffer, 0, 1, &offscreenScissor);
-
-    // Draw skybox
-    _skyBox->draw(commandBuffer, *this);
-
-    // Draw sun
-    _sun->draw(commandBuffer, *this);
-
-    // Draw planets
-    for (const auto& planet : _planets) {
-        planet->draw(commandBuffer, *this);
-    }
-
-    // // Draw Glow spheres
-    for (const auto& glowSphere : _glowSpheres) {
-        glowSphere->draw(commandBuffer, *this);
-    }
-
-    // Draw orbits
-    for (const auto& orbit : _orbits) {
-        orbit->draw(commandBuffer, *this);
-    }
-
-    vkCmdEndRenderPass(commandBuffer);
-
-
-    /*
-        Fifth pass (Composite): Combine the normal rendering with the glow pass
-    */
-    VkRenderPassBeginInfo compositeRenderPassBeginInfo{};
-    compositeRenderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    compositeRenderPassBeginInfo.renderPass = _renderPass->getRenderPass();
-    compositeRenderPassBeginInfo.framebuffer = _mainFrameBuffers[targetSwapImageIndex]->getFrameBuffer();
-    compositeRenderPassBeginInfo.renderArea.offset = { 0, 0 };
-    compositeRenderPassBeginInfo.renderArea.extent = _swapChain->getSwapChainExtent();
-    compositeRenderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    compositeRenderPassBeginInfo.pClearValues = clearValues.data();
-    vkCmdBeginRenderPass(commandBuffer, &compositeRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float) _swapChain->getSwapChainExtent().width;
-    viewport.height = (float) _swapChain->getSwapChainExtent().height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = _swapChain->getSwapChainExtent();
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-    // Bind the composite pipeline
-    _compositePipeline->bind(commandBuffer);
-
-    // Bind the descriptor set for the composite pass
-    std::array<VkDescriptorSet, 1> compositeDescriptorSets = {
-        _compositeDescriptorSet->getDescriptorSet() // Composite descriptor set
-    };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _compositePipeline->getPipelineLayout(), 0, 1, compositeDescriptorSets.data(), 0, nullptr);
-
-    // Draw a full-screen quad for the composite pass
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0); // Draw a full-screen triangle for the composite pass
-    vkCmdEndRenderPass(commandBuffer);
+    // The feedback is read by update() once the frame's fence has signaled
+    _virtualTextures->recordFeedbackBarrier(commandBuffer);
 
     // End the command buffer recording
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
@@ -842,10 +1126,10 @@ uint32_t SolarSystemScene::querySelectionImage(float mouseX, float mouseY) {
         vkCmdBindIndexBuffer(cmdBuffer, pair.second->getDeviceMesh()->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32); // We can only use one index buffer at a time
 
         std::array<VkDescriptorSet, 1> descriptorSets = {
-            _sceneDescriptorSets[_currentFrame]->getDescriptorSet()  // Per-frame descriptor set
+            _sceneDescriptorSet->getDescriptorSet()  // Scene info of the last updated frame
             // Per-model descriptor set is not needed here beacuse we dont care about material when drawing ids.
         };
-        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _objectSelectionPipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 0, nullptr);
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _objectSelectionPipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 1, &_sceneInfoOffset);
 
         // Push constants for model
         ObjectSelectionPushConstants pushConstants {pair.second->getModelMatrix(), pair.second->getID()};
@@ -860,26 +1144,22 @@ uint32_t SolarSystemScene::querySelectionImage(float mouseX, float mouseY) {
 
     // Create a staging buffer to read the pixel data from the object selection image
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    Allocation stagingBufferAllocation;
     VkDeviceSize imageSize = _swapChain->getSwapChainExtent().width * _swapChain->getSwapChainExtent().height * sizeof(uint32_t); // Assuming 1 bytes per pixel (uint32_t)
     VulkanHelper::createBuffer(_ctx, imageSize, 
         VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-        stagingBuffer, stagingBufferMemory);
+        stagingBuffer, stagingBufferAllocation);
 
     // Copy the object selection image to the staging buffer for reading pixel data
     VulkanHelper::copyImageToBuffer(_ctx, _objectSelectionFrameBuffer->getColorImage(), stagingBuffer, _swapChain->getSwapChainExtent().width, _swapChain->getSwapChainExtent().height);
 
-    // Map the memory and read the pixel data
+    // Read the pixel data (the staging memory stays mapped)
     uint32_t* pixelData = new uint32_t[_swapChain->getSwapChainExtent().width * _swapChain->getSwapChainExtent().height];
-    void* data;
-    vkMapMemory(_ctx->device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(pixelData, data, (size_t)imageSize);
+    memcpy(pixelData, stagingBufferAllocation.mapped, (size_t)imageSize);
 
-    // Unmap and free the staging buffer
-    vkUnmapMemory(_ctx->device, stagingBufferMemory);
-    vkDestroyBuffer(_ctx->device, stagingBuffer, nullptr);
-    vkFreeMemory(_ctx->device, stagingBufferMemory, nullptr);
+    // Free the staging buffer
+    VulkanHelper::destroyBuffer(_ctx, stagingBuffer, stagingBufferAllocation);
 
     // Read mouseX and mouseY pixel data
     int mousePixel = static_cast<int>(mouseX) + static_cast<int>(mouseY) * _swapChain->getSwapChainExtent().width;
@@ -932,4 +1212,29 @@ void SolarSystemScene::handleMouseWheel(float dy)
     // For example, you can update the camera zoom level
     float zoomDelta = dy * _camera->getRadius() * 0.03f; // Adjust the zoom speed as needed
     _camera->changeZoom(zoomDelta);
+}
+
+
+void SolarSystemScene::handleKeyDown(int key)
+{
+    // Switch the bloom blur between the raster and the compute path
+    if (key == SDLK_B) {
+        setBlurMode(_blurMode == BlurMode::Raster ? BlurMode::Compute : BlurMode::Raster);
+    }
+
+    // Switch the instanced bodies between CPU draws and GPU culled indirect draws
+    if (key == SDLK_C) {
+        setSubmissionMode(_submissionMode == SubmissionMode::Cpu ? SubmissionMode::GpuCulled : SubmissionMode::Cpu);
+    }
+}
+
+
+void SolarSystemScene::logStats() const
+{
+    if (_submissionMode != SubmissionMode::GpuCulled) return;
+
+    // Read back from the last frame of the current slot
+    const uint32_t visible = _gpuCulling->getVisibleCount();
+    const uint32_t total = visible + _gpuCulling->getCulledCount();
+    spdlog::info("GPU culling: {} of {} instances visible ({:.1f}%)", visible, total, total > 0 ? 100.0 * visible / total : 0.0);
 }
\ No newline at end of file
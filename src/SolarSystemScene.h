@@ -4,15 +4,23 @@
 #include "VulkanContext.h"
 #include "Scene.h"
 #include "Pipeline.h"
+#include "ComputePipeline.h"
 #include "FrameBuffer.h"
 #include "RenderPass.h"
 #include "TextureSampler.h"
+#include "rendergraph/RenderGraph.h"
 #include "models/Planet.h"
 #include "models/Sun.h"
 #include "models/Earth.h"
 #include "models/Orbit.h"
 #include "models/GlowSphere.h"
 #include "models/SkyBox.h"
+#include "models/InstancedBodies.h"
+#include "models/AsteroidBelt.h"
+#include "loader/TextureLoader.h"
+#include "loader/TextureResidency.h"
+#include "VirtualTextureSystem.h"
+#include "GpuCulling.h"
 
 
 class SolarSystemScene : public Scene
@@ -27,8 +35,23 @@ public:
     void handleMouseClick(float mouseX, float mouseY) override;
     void handleMouseDrag(float dx, float dy) override;
     void handleMouseWheel(float dy) override;
+    void handleKeyDown(int key) override;
+    void logStats() const override;
 
-    const DescriptorSet* getSceneDescriptorSet() const { return _sceneDescriptorSets[_currentFrame].get(); }
+    void onSwapChainRecreated() override;
+
+    bool isLoading() const override { return (_textureLoader && _textureLoader->isLoading()) || (_textureResidency && _textureResidency->isLoading()); }
+    void finishLoading() override;
+
+    // Set 0 of the main pass pipelines, bind it with the dynamic offset of the current frame's SceneInfo
+    const DescriptorSet* getSceneDescriptorSet() const { return _sceneDescriptorSet.get(); }
+    uint32_t getSceneInfoOffset() const { return _sceneInfoOffset; }
+
+    // Set 2 of the planet pipelines
+    const VirtualTextureSystem* getVirtualTextureSystem() const { return _virtualTextures.get(); }
+
+    // Culling of the instanced bodies when this frame's draws come from it, nullptr for CPU draws
+    const GpuCulling* getGpuCulling() const { return _submissionMode == SubmissionMode::GpuCulled ? _gpuCulling.get() : nullptr; }
 
 private:
 
@@ -41,8 +64,8 @@ private:
         alignas(16) glm::vec3 cameraPosition;
         alignas(16) glm::vec3 lightColor;
     } _sceneInfo;
-    std::array<std::unique_ptr<UniformBuffer<SceneInfo>>, MAX_FRAMES_IN_FLIGHT> _sceneInfoUBOs;
-    std::array<std::unique_ptr<DescriptorSet>, MAX_FRAMES_IN_FLIGHT> _sceneDescriptorSets;
+    std::unique_ptr<DescriptorSet> _sceneDescriptorSet; // Dynamic UBO in the frame allocator, shared by all frames
+    uint32_t _sceneInfoOffset = 0;
 
     // Camera
     std::unique_ptr<Camera> _camera = nullptr;
@@ -51,30 +74,39 @@ private:
     // MSAA
     VkSampleCountFlagBits _msaaSamples;
 
-    // Render passes
-    std::unique_ptr<RenderPass> _renderPass;
-    std::unique_ptr<RenderPass> _offscreenRenderPass;
-    std::unique_ptr<RenderPass> _offscreenRenderPassMSAA;
+    // Render graph (main, bloom and composite passes)
+    std::unique_ptr<RenderGraph> _renderGraph;
+    RGResource _glowTarget;
+    RGResource _bloomTarget;
+    RGResource _sceneTarget;
+    RGResource _swapChainTarget;
+    void createRenderGraph();
+
+    // Render passes (object selection runs outside of the graph, on demand)
     std::unique_ptr<RenderPass> _objectSelectionRenderPass;
     void createRenderPasses();
 
     // Framebuffers
-    std::vector<std::unique_ptr<FrameBuffer>> _mainFrameBuffers;
-    std::vector<std::unique_ptr<FrameBuffer>> _offscreenFrameBuffers;
     std::unique_ptr<FrameBuffer> _objectSelectionFrameBuffer;
     void createFrameBuffers();
 
     // Pipelines
     std::shared_ptr<Pipeline> _planetPipeline;
+    std::shared_ptr<Pipeline> _instancedPlanetPipeline;
+    std::shared_ptr<Pipeline> _culledPlanetPipeline;     // Instanced planets drawn from the GPU culling's visible indices
     std::shared_ptr<Pipeline> _orbitPipeline;
     std::shared_ptr<Pipeline> _glowSpherePipeline;
     std::shared_ptr<Pipeline> _skyBoxPipeline;
     std::shared_ptr<Pipeline> _sunPipeline;
     std::shared_ptr<Pipeline> _earthPipeline;
+    std::unique_ptr<Pipeline> _virtualTextureFeedbackPipeline;
 
-    std::unique_ptr<Pipeline> _glowPipeline;
+    std::unique_ptr<Pipeline> _bloomDownsamplePipeline;
     std::unique_ptr<Pipeline> _blurVertPipeline;
     std::unique_ptr<Pipeline> _blurHorizPipeline;
+    std::unique_ptr<Pipeline> _bloomUpsamplePipeline;
+    std::unique_ptr<ComputePipeline> _computeBlurVertPipeline;   // Created the first time the compute blur is used
+    std::unique_ptr<ComputePipeline> _computeBlurHorizPipeline;
     std::unique_ptr<Pipeline> _compositePipeline;
     std::unique_ptr<Pipeline> _objectSelectionPipeline;
     void createPipelines();
@@ -88,26 +120,64 @@ private:
     std::shared_ptr<Sun> _sun;
     std::unique_ptr<GlowSphere> _sunGlowSphere;
     std::shared_ptr<Earth> _earth;
+    std::unique_ptr<InstancedBodies> _planetInstances;     // Planets that share the sphere and the planet shader, one draw
+    std::unique_ptr<InstancedBodies> _asteroidInstances;   // The asteroid belt, one draw
+
+    // The instanced bodies are either drawn as they are, or culled by a compute pass that writes their indirect
+    // draws (C switches).
+    enum class SubmissionMode { Cpu, GpuCulled };
+    SubmissionMode _submissionMode = SubmissionMode::Cpu;
+    std::unique_ptr<GpuCulling> _gpuCulling;
+    void setSubmissionMode(SubmissionMode mode);
+    std::shared_ptr<Texture2D> _asteroidTexture;           // White, the asteroids are tinted per instance
+    uint32_t _asteroidTextureIndex = BindlessTextures::None;
     std::unordered_map<int, std::shared_ptr<SelectableModel>> _selectableObjects; // Selectable objects
+    std::vector<Model*> _mainDrawables; // Main pass draw order: skybox, sun, sun glow, planets, asteroids, glow spheres, orbits
+    std::unique_ptr<TextureLoader> _textureLoader; // Planet textures, swapped in by update() as they finish
+    std::unique_ptr<VirtualTextureSystem> _virtualTextures; // Planet maps baked into tiles, streamed by what is visible
+    std::unique_ptr<TextureResidency> _textureResidency; // Color maps, with the mips their planet's size on screen needs
+    std::vector<std::pair<std::shared_ptr<Planet>, TextureResidency::Handle>> _residentColorMaps;
     void createModels();
 
     // Texture Sampler for intermediate passes
     std::unique_ptr<TextureSampler> _ppTextureSampler;
 
-    // Glow pass
-    struct GlowPassPushConstants {
-        alignas(16) glm::mat4 model;
-        alignas(16) glm::vec3 glowColor;
-    };
-    
-    // Blur pass
+    // Bloom: the glow is downsampled through a chain of half size levels, every level is blurred,
+    // then the levels are upsampled and accumulated back up to the first one
     struct BlurSettings {
-        float blurScale = 2.0f;
+        float filterRadius = 1.0f;   // Blur tap spacing and upsample tent radius, in texels of the level
         float blurStrength = 1.5f;
+        uint32_t levelCount = 5;     // 1/2, 1/4, ... of the swapchain resolution (the render graph is built with it)
     } blurSettings;
     std::unique_ptr<UniformBuffer<BlurSettings>> _blurSettingsUBO;
-    std::unique_ptr<DescriptorSet> _blurVertDescriptorSet;
-    std::unique_ptr<DescriptorSet> _blurHorizDescriptorSet;
+
+    struct BloomLevel {
+        RGResource downsampled;
+        RGResource blurredVert;
+        RGResource blurred;
+        RGResource upsampled;       // Not used by the last level, it is upsampled as is
+        std::unique_ptr<DescriptorSet> downsampleDescriptorSet;
+        std::unique_ptr<DescriptorSet> blurVertDescriptorSet;
+        std::unique_ptr<DescriptorSet> blurHorizDescriptorSet;
+        std::unique_ptr<DescriptorSet> computeBlurVertDescriptorSet;
+        std::unique_ptr<DescriptorSet> computeBlurHorizDescriptorSet;
+        std::unique_ptr<DescriptorSet> upsampleDescriptorSet;
+    };
+    std::vector<BloomLevel> _bloomLevels;
+    void writePostProcessDescriptorSets();
+
+    // The per-level blur runs either as two full-screen raster passes or as two compute passes
+    // that blur a tile from shared memory (B switches, to compare both on the same hardware)
+    enum class BlurMode { Raster, Compute };
+    BlurMode _blurMode = BlurMode::Raster;
+    int _computeBlurRadius = 4;         // Kernel radius of the compute blur (specialization constant)
+    void setBlurMode(BlurMode mode);
+    void createComputeBlurPipelines();
+
+    // Set when the passes of the graph changed, it is recompiled before the next frame.
+    // Old images and descriptor sets are released through the deletion queue, so frames in flight keep theirs.
+    bool _renderGraphDirty = false;
+    void rebuildRenderGraph();
 
     // Composite pass
     std::unique_ptr<DescriptorSet> _compositeDescriptorSet;
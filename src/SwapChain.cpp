@@ -1,9 +1,14 @@
 #include "SwapChain.h"
 
 
-SwapChain::SwapChain(std::shared_ptr<VulkanContext> ctx)
- : _ctx(ctx) 
+SwapChain::SwapChain(std::shared_ptr<VulkanContext> ctx, SwapChainParams params)
+ : _ctx(ctx), _params(params)
 {
+    _framesInFlight = std::clamp<uint32_t>(_params.framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+    if (_framesInFlight != _params.framesInFlight) {
+        spdlog::warn("Requested {} frames in flight, using {} (supported range is 1..{})", _params.framesInFlight, _framesInFlight, MAX_FRAMES_IN_FLIGHT);
+    }
+
     createSwapChain();
 }
 
@@ -14,12 +19,17 @@ SwapChain::~SwapChain() {
 
 bool SwapChain::firstTimeCreation = true;
 
-void SwapChain::createSwapChain()
+void SwapChain::createSwapChain(VkSwapchainKHR oldSwapChain)
 {
+    if (isHeadless()) {
+        createOffscreenImages();
+        return;
+    }
+
     SwapChainSupportDetails swapChainSupport = VulkanHelper::querySwapChainSupport(_ctx->physicalDevice, _ctx->surface);
     
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    _presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
     
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -52,14 +62,14 @@ void SwapChain::createSwapChain()
     
     swapChainCreateInfo.preTransform = swapChainSupport.capabilities.currentTransform;
     swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    swapChainCreateInfo.presentMode = presentMode;
+    swapChainCreateInfo.presentMode = _presentMode;
     swapChainCreateInfo.clipped = VK_TRUE;
-    swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+    swapChainCreateInfo.oldSwapchain = oldSwapChain; // Lets the driver reuse resources and keep presenting the old images
     
     if (vkCreateSwapchainKHR(_ctx->device, &swapChainCreateInfo, nullptr, &_swapChain) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create swap chain!");
     }
-    if (firstTimeCreation) spdlog::info("Swap chain created successfully.");
+    if (firstTimeCreation) spdlog::info("Swap chain created successfully. (present mode: {})", VulkanHelper::presentModeToString(_presentMode));
     
     vkGetSwapchainImagesKHR(_ctx->device, _swapChain, &imageCount, nullptr);
     _swapChainImages.resize(imageCount);
@@ -79,11 +89,129 @@ void SwapChain::createSwapChain()
 }
 
 
+bool SwapChain::recreate()
+{
+    // Headless images have a fixed size
+    if (isHeadless()) return true;
+
+    SwapChainSupportDetails swapChainSupport = VulkanHelper::querySwapChainSupport(_ctx->physicalDevice, _ctx->surface);
+    VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
+    if (extent.width == 0 || extent.height == 0) return false;
+
+    VkSwapchainKHR oldSwapChain = _swapChain;
+    std::vector<VkImageView> oldImageViews = std::move(_swapChainImageViews);
+    _swapChainImageViews.clear();
+    _swapChainImages.clear();
+
+    createSwapChain(oldSwapChain);
+
+    // Frames recorded against the old swap chain may still be in flight. Without a present fence
+    // (VK_EXT_swapchain_maintenance1) the frame fences are the closest signal that it is unused.
+    VkDevice device = _ctx->device;
+    _ctx->deletionQueue.push([device, oldSwapChain, oldImageViews]() {
+        for (VkImageView imageView : oldImageViews) {
+            vkDestroyImageView(device, imageView, nullptr);
+        }
+        vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+    });
+
+    spdlog::debug("Swap chain recreated ({}x{}, {} images)", _swapChainExtent.width, _swapChainExtent.height, _swapChainImages.size());
+    return true;
+}
+
+
 void SwapChain::cleanupSwapChain() {
     for (size_t i = 0; i < _swapChainImageViews.size(); i++) {
         vkDestroyImageView(_ctx->device, _swapChainImageViews[i], nullptr);
     }
-    vkDestroySwapchainKHR(_ctx->device, _swapChain, nullptr);
+    _swapChainImageViews.clear();
+
+    if (isHeadless()) {
+        // Offscreen images are owned by us, not by a VkSwapchainKHR
+        for (size_t i = 0; i < _swapChainImages.size(); i++) {
+            VulkanHelper::destroyImage(_ctx, _swapChainImages[i], _offscreenImageAllocations[i]);
+        }
+        _offscreenImageAllocations.clear();
+        _readbackBuffers.clear();
+    } else {
+        vkDestroySwapchainKHR(_ctx->device, _swapChain, nullptr);
+        _swapChain = nullptr;
+    }
+    _swapChainImages.clear();
+}
+
+
+void SwapChain::createOffscreenImages() {
+    // RGBA8 so read back pixels can be written to disk without swizzling
+    _swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    _swapChainExtent = _params.headlessExtent;
+
+    // One image per frame in flight, so a frame can be read back while the next one renders
+    const uint32_t imageCount = _framesInFlight;
+    _swapChainImages.resize(imageCount);
+    _offscreenImageAllocations.resize(imageCount);
+    _swapChainImageViews.resize(imageCount);
+    _readbackBuffers.resize(imageCount);
+
+    VkDeviceSize readbackSize = static_cast<VkDeviceSize>(_swapChainExtent.width) * _swapChainExtent.height * 4;
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VulkanHelper::createImage(_ctx, _swapChainExtent.width, _swapChainExtent.height, _swapChainImageFormat, 1, 1,
+            VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            _swapChainImages[i], _offscreenImageAllocations[i]);
+        _swapChainImageViews[i] = VulkanHelper::createImageView(_ctx, _swapChainImages[i], _swapChainImageFormat, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        _readbackBuffers[i] = std::make_unique<Buffer>(_ctx);
+        _readbackBuffers[i]->initialize(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+
+    if (firstTimeCreation) spdlog::info("Headless swap chain created successfully. ({}x{}, {} images)", _swapChainExtent.width, _swapChainExtent.height, imageCount);
+    firstTimeCreation = false;
+}
+
+
+void SwapChain::recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    if (!isHeadless()) {
+        spdlog::error("Readback is only supported by headless swap chains!");
+        return;
+    }
+
+    // Wait for the final render pass to finish writing and move the image to transfer layout
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = getFinalLayout();
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = _swapChainImages[imageIndex];
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { _swapChainExtent.width, _swapChainExtent.height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, _swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _readbackBuffers[imageIndex]->getBuffer(), 1, &region);
+
+    // Make the copy visible to the host once the frame fence signals
+    VkBufferMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = _readbackBuffers[imageIndex]->getBuffer();
+    hostBarrier.offset = 0;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+}
+
+
+const uint8_t* SwapChain::getReadbackData(uint32_t imageIndex) const {
+    if (!isHeadless()) return nullptr;
+    return static_cast<const uint8_t*>(_readbackBuffers[imageIndex]->getMappedMemory());
 }
 
 
@@ -98,12 +226,27 @@ VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfac
 }
 
 VkPresentModeKHR SwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+    auto isAvailable = [&](VkPresentModeKHR mode) {
+        return std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end();
+    };
+
+    // Requested mode
+    if (_params.presentMode.has_value()) {
+        if (isAvailable(_params.presentMode.value())) return _params.presentMode.value();
+        if (firstTimeCreation) spdlog::warn("Present mode {} is not supported, falling back", VulkanHelper::presentModeToString(_params.presentMode.value()));
+
+        // Relaxed FIFO still asks for vsync, do not fall back to a tearing mode
+        if (_params.presentMode.value() == VK_PRESENT_MODE_FIFO_RELAXED_KHR) return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
     // Check for mailbox mode first (triple buffering)
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
+    if (isAvailable(VK_PRESENT_MODE_MAILBOX_KHR)) return VK_PRESENT_MODE_MAILBOX_KHR;
+
+    // Immediate only if an unthrottled mode was asked for
+    if (_params.presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR || _params.presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (isAvailable(VK_PRESENT_MODE_IMMEDIATE_KHR)) return VK_PRESENT_MODE_IMMEDIATE_KHR;
     }
+
     // Fallback to FIFO mode (double buffering)
     return VK_PRESENT_MODE_FIFO_KHR;
 }
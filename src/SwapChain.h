@@ -2,35 +2,78 @@
 
 #include "stdafx.h"
 #include "VulkanContext.h"
+#include "Buffer.h"
 
 
+struct SwapChainParams
+{
+    // Only used when the context is headless (windowed swap chains follow the surface size)
+    VkExtent2D headlessExtent = { 1920, 1080 };
+
+    // Preferred present mode, falls back to mailbox, then immediate, then FIFO (always supported) when unavailable
+    std::optional<VkPresentModeKHR> presentMode;
+
+    // Number of frames the CPU may record ahead of the GPU (1..MAX_FRAMES_IN_FLIGHT)
+    uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+};
+
+
+// In headless mode the swap chain owns plain offscreen images (one per frame in flight)
+// that are rendered into and read back instead of being presented.
 class SwapChain {
 public:
-    SwapChain(std::shared_ptr<VulkanContext> ctx);
+    SwapChain(std::shared_ptr<VulkanContext> ctx, SwapChainParams params = {});
     ~SwapChain();
 
-    void createSwapChain();
+    void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
     void cleanupSwapChain();
 
+    // Rebuilds the swap chain for the current surface size, handing the old one to oldSwapchain.
+    // The retired swap chain and its views go to the deletion queue instead of idling the device.
+    // Returns false (and keeps the old swap chain) while the surface has no area, e.g. when minimized.
+    bool recreate();
+
+    // Present mode asked for by the next recreate() (with the same fallbacks as SwapChainParams::presentMode)
+    void setPresentMode(VkPresentModeKHR presentMode) { _params.presentMode = presentMode; }
+
     VkSwapchainKHR getSwapChain() const { return _swapChain; }
     VkFormat getSwapChainImageFormat() const { return _swapChainImageFormat; }
     VkExtent2D getSwapChainExtent() const { return _swapChainExtent; }
     const std::vector<VkImage>& getSwapChainImages() const { return _swapChainImages; }
     const std::vector<VkImageView>& getSwapChainImageViews() const { return _swapChainImageViews; }
     const int getSwapChainImageCount() const { return static_cast<int>(_swapChainImages.size()); }
+    VkPresentModeKHR getPresentMode() const { return _presentMode; }
+    uint32_t getFramesInFlight() const { return _framesInFlight; }
+
+    bool isHeadless() const { return _ctx->isHeadless(); }
+
+    // Layout the final render pass should leave the swap chain image in
+    VkImageLayout getFinalLayout() const { return isHeadless() ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+
+    // Headless only: copy a rendered image into its host visible readback buffer
+    void recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    const uint8_t* getReadbackData(uint32_t imageIndex) const;
 
 private:
     std::shared_ptr<VulkanContext> _ctx;
+    SwapChainParams _params;
 
     VkSwapchainKHR _swapChain = nullptr;
     VkFormat _swapChainImageFormat;
     VkExtent2D _swapChainExtent;
+    VkPresentModeKHR _presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t _framesInFlight;
     std::vector<VkImage> _swapChainImages;
     std::vector<VkImageView> _swapChainImageViews;
 
+    // Headless resources
+    std::vector<Allocation> _offscreenImageAllocations;
+    std::vector<std::unique_ptr<Buffer>> _readbackBuffers;
+    void createOffscreenImages();
+
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
     static bool firstTimeCreation;
-};
\ No newline at end of file
+};
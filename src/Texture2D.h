@@ -1,6 +1,8 @@
 #pragma once
 #include "stdafx.h"
 #include "VulkanContext.h"
+#include "UploadManager.h"
+#include "loader/HostTexture.h"
 
 // Texture on GPU
 class Texture2D
@@ -8,6 +10,8 @@ class Texture2D
 public:
     Texture2D(std::shared_ptr<VulkanContext> ctx, const std::string& path, VkFormat format);
     Texture2D(std::shared_ptr<VulkanContext> ctx, const void* pixelData, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels = 0);
+    // Uploads every level of the texture as it is (block compressed formats included), no mipmaps are generated
+    Texture2D(std::shared_ptr<VulkanContext> ctx, const HostTexture& texture);
     ~Texture2D();
 
     void cleanup();
@@ -18,6 +22,10 @@ public:
 
     VkDescriptorImageInfo getDescriptorInfo() const;
 
+    // The texture can be used by frames submitted from now on, this tells when the GPU copy has finished
+    const UploadFuture& getUploadFuture() const { return _uploadFuture; }
+    bool isReady() const { return _uploadFuture.isReady(); }
+
     // Singleton pattern for dummy texture
     static Texture2D* getDummy(std::shared_ptr<VulkanContext> ctx);
     static void cleanupDummy();
@@ -31,11 +39,14 @@ private:
     uint32_t _mipLevels;
     
     VkImage _textureImage;
-    VkDeviceMemory _textureImageMemory;
+    Allocation _textureImageAllocation;
     VkImageView _textureImageView;
     VkSampler _textureSampler;
-    
-    void generateMipmaps();
+
+    UploadFuture _uploadFuture;
+
+    void uploadPixels(const void* pixelData, VkDeviceSize imageSize);
+    void createSampler();
 
     static Texture2D* dummyTexture;
 };
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "TextureCubemap.h"
+#include "loader/AssetPack.h"
+#include "loader/AsyncFileReader.h"
+#include "utilities/ThreadPool.h"
 
 #include "stb_image.h"
 
@@ -15,38 +18,42 @@ TextureCubemap::TextureCubemap(std::shared_ptr<VulkanContext> ctx, const std::st
         path + "/nz.png"
     };
 
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels[6];
-
+    // All six faces are read at once, then decoded side by side
+    AssetView assets[6];
+    std::future<FileReadResult> reads[6];
     for (size_t i = 0; i < faces.size(); ++i) {
-        pixels[i] = stbi_load(faces[i].c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        if (!pixels[i]) {
-            spdlog::error("Failed to load cubemap texture image! {}", faces[i]);
-            return;
-        }
+        assets[i] = AssetPack::getInstance()->find(faces[i]);
+        if (!assets[i]) reads[i] = AsyncFileReader::getInstance()->read(faces[i]);
     }
 
-    int imageSize = texWidth * texHeight * 4;
-    int totalSize = imageSize * 6;
-
-    // Create staging buffer
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    VulkanHelper::createBuffer(_ctx, totalSize, 
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-        stagingBuffer, stagingBufferMemory);
+    FileReadResult files[6];
+    for (size_t i = 0; i < faces.size(); ++i) {
+        if (assets[i]) continue;
+        files[i] = reads[i].get();
+        assets[i] = { files[i].data.data(), files[i].data.size() };
+    }
 
+    int widths[6] = {}, heights[6] = {};
+    stbi_uc* pixels[6] = {};
+    ThreadPool::getInstance()->parallelFor(6, [&](uint32_t i) {
+        int channels;
+        if (assets[i].size > 0) pixels[i] = stbi_load_from_memory(assets[i].data, static_cast<int>(assets[i].size), &widths[i], &heights[i], &channels, STBI_rgb_alpha);
+        std::vector<uint8_t>().swap(files[i].data);
+    });
 
-    // Copy pixel data to staging buffer
-    void* data;
-    vkMapMemory(_ctx->device, stagingBufferMemory, 0, totalSize, 0, &data);
-    for (size_t i = 0; i < 6; ++i) {
-        memcpy(static_cast<char*>(data) + imageSize * i, pixels[i], static_cast<size_t>(imageSize));
-        stbi_image_free(pixels[i]);
+    for (size_t i = 0; i < faces.size(); ++i) {
+        if (!pixels[i] || widths[i] != widths[0] || heights[i] != heights[0]) {
+            spdlog::error("Failed to load cubemap texture image! {}", faces[i]);
+            for (stbi_uc* face : pixels) {
+                if (face) stbi_image_free(face);
+            }
+            return;
+        }
     }
-    vkUnmapMemory(_ctx->device, stagingBufferMemory);
+    int texWidth = widths[0];
+    int texHeight = heights[0];
 
+    VkDeviceSize rowBytes = static_cast<VkDeviceSize>(texWidth) * 4;
 
     // Create Image
     VulkanHelper::createImage(_ctx, texWidth, texHeight,
@@ -57,21 +64,19 @@ TextureCubemap::TextureCubemap(std::shared_ptr<VulkanContext> ctx, const std::st
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        _cubemapImage, _cubemapImageMemory,
+        _cubemapImage, _cubemapImageAllocation,
         VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT);
 
-    // Transition image layout to transfer destination optimal
-    VulkanHelper::transitionImageLayout(_ctx, _cubemapImage, format, 1, 6, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-    // Copy from staging buffer to the cubemap image
-    VulkanHelper::copyBufferToCubemap(_ctx, stagingBuffer, _cubemapImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-
-    // Staging buffer is no longer needed, so we can destroy it
-    vkDestroyBuffer(_ctx->device, stagingBuffer, nullptr); // Destroy the staging buffer
-    vkFreeMemory(_ctx->device, stagingBufferMemory, nullptr); // Free the staging buffer memory
+    // Copy and transition to shader read only are batched with the other uploads, every face is a layer and its
+    // rows go straight from the decoded image into the staging ring
+    _uploadFuture = _ctx->uploadManager->uploadImage(_cubemapImage, texWidth, texHeight, 1, 6, rowBytes,
+        [&](void* dst, uint32_t layer, uint32_t firstRow, uint32_t rowCount) {
+            memcpy(dst, pixels[layer] + firstRow * rowBytes, static_cast<size_t>(rowCount * rowBytes));
+        }, false);
 
-    // Transition the image layout to shader read only optimal
-    VulkanHelper::transitionImageLayout(_ctx, _cubemapImage, format, 1, 6, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    for (size_t i = 0; i < 6; ++i) {
+        stbi_image_free(pixels[i]);
+    }
 
     // Create ImageView
     _cubemapImageView = VulkanHelper::createImageView(_ctx, _cubemapImage, format, 1, 6, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_CUBE);
@@ -96,9 +101,7 @@ TextureCubemap::TextureCubemap(std::shared_ptr<VulkanContext> ctx, const std::st
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 
-    if (vkCreateSampler(_ctx->device, &samplerInfo, nullptr, &_cubemapSampler) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create texture sampler!");
-    }
+    _cubemapSampler = _ctx->samplerCache->get(samplerInfo);
 
     spdlog::info("Cubemap texture loaded successfully.");
 
@@ -106,10 +109,10 @@ TextureCubemap::TextureCubemap(std::shared_ptr<VulkanContext> ctx, const std::st
 
 TextureCubemap::~TextureCubemap()
 {
-    vkDestroySampler(_ctx->device, _cubemapSampler, nullptr);
+    _uploadFuture.wait();
+
     vkDestroyImageView(_ctx->device, _cubemapImageView, nullptr);
-    vkDestroyImage(_ctx->device, _cubemapImage, nullptr);
-    vkFreeMemory(_ctx->device, _cubemapImageMemory, nullptr);
+    VulkanHelper::destroyImage(_ctx, _cubemapImage, _cubemapImageAllocation);
 }
 
 
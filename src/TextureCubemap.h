@@ -19,6 +19,8 @@ public:
 
     VkDescriptorImageInfo getDescriptorInfo() const;
 
+    bool isReady() const { return _uploadFuture.isReady(); }
+
 private:
     std::shared_ptr<VulkanContext> _ctx;
 
@@ -28,7 +30,9 @@ private:
     uint32_t _mipLevels;
     
     VkImage _cubemapImage;
-    VkDeviceMemory _cubemapImageMemory;
+    Allocation _cubemapImageAllocation;
     VkImageView _cubemapImageView;
     VkSampler _cubemapSampler;
+
+    UploadFuture _uploadFuture;
 };
\ No newline at end of file
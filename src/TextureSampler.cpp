@@ -27,12 +27,5 @@ TextureSampler::TextureSampler(std::shared_ptr<VulkanContext> ctx, uint32_t mipL
     samplerInfo.minLod = 0.0f;
     samplerInfo.maxLod = static_cast<float>(mipLevels);
 
-    if(vkCreateSampler(_ctx->device, &samplerInfo, nullptr, &_textureSampler) != VK_SUCCESS) {
-        spdlog::error("Failed to create texture sampler!");
-    }
+    _textureSampler = _ctx->samplerCache->get(samplerInfo);
 }
-
-TextureSampler::~TextureSampler()
-{
-    vkDestroySampler(_ctx->device, _textureSampler, nullptr);
-}
\ No newline at end of file
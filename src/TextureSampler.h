@@ -6,12 +6,11 @@ class TextureSampler
 {
 public:
     TextureSampler(std::shared_ptr<VulkanContext> ctx, uint32_t mipLevels, VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
-    ~TextureSampler();
 
     VkSampler getSampler() const { return _textureSampler; }
 
 private:
     std::shared_ptr<VulkanContext> _ctx;
 
-    VkSampler _textureSampler;
+    VkSampler _textureSampler;          // Owned by the context's sampler cache
 };
\ No newline at end of file
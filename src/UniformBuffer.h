@@ -20,7 +20,7 @@ private:
     std::shared_ptr<VulkanContext> _ctx;
 
     VkBuffer _uniformBuffer;
-    VkDeviceMemory _uniformBufferMemory;
+    Allocation _uniformBufferAllocation;
     void* _uniformBufferMapped;
 };
 
@@ -35,18 +35,16 @@ UniformBuffer<T>::UniformBuffer(std::shared_ptr<VulkanContext> ctx)
         bufferSize, 
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-        _uniformBuffer, _uniformBufferMemory);
+        _uniformBuffer, _uniformBufferAllocation);
 
-    // Map the buffer memory into CPU addressable space
-    vkMapMemory(_ctx->device, _uniformBufferMemory, 0, bufferSize, 0, &_uniformBufferMapped);
+    // The allocator keeps host visible memory mapped
+    _uniformBufferMapped = _uniformBufferAllocation.mapped;
 }
 
 template<typename T>
 UniformBuffer<T>::~UniformBuffer()
 {
-    vkUnmapMemory(_ctx->device, _uniformBufferMemory);
-    vkDestroyBuffer(_ctx->device, _uniformBuffer, nullptr);
-    vkFreeMemory(_ctx->device, _uniformBufferMemory, nullptr);
+    VulkanHelper::destroyBuffer(_ctx, _uniformBuffer, _uniformBufferAllocation);
 }
 
 template <typename T>
@@ -0,0 +1,563 @@
+#include "UploadManager.h"
+#include "VulkanHelper.h"
+#include "utilities/Tracer.h"
+
+
+bool UploadFuture::isReady() const
+{
+    return !_manager || _manager->isComplete(_value);
+}
+
+
+void UploadFuture::wait() const
+{
+    if (_manager) _manager->wait(_value);
+}
+
+
+// Chunks start at this alignment, a multiple of every texel size the engine uploads
+static constexpr VkDeviceSize StagingAlignment = 16;
+
+
+UploadManager::UploadManager(VkDevice device, MemoryAllocator* allocator, UploadQueues queues, UploadManagerParams params)
+    : _device(device), _allocator(allocator), _queues(queues), _params(params)
+{
+    // A chunk must fit into the half of the ring the pending batch may fill
+    _params.stagingRingSize = _params.stagingRingSize / StagingAlignment * StagingAlignment;
+    _params.maxChunkSize = std::clamp<VkDeviceSize>(_params.maxChunkSize, StagingAlignment, _params.stagingRingSize / 2);
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &_timeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload timeline semaphore!");
+    }
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    poolInfo.queueFamilyIndex = _queues.graphicsFamily;
+    if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_graphicsCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload command pool!");
+    }
+
+    if (hasDedicatedTransferQueue()) {
+        poolInfo.queueFamilyIndex = _queues.transferFamily;
+        if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_transferCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload command pool!");
+        }
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = _params.stagingRingSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(_device, &bufferInfo, nullptr, &_stagingBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create staging ring buffer!");
+    }
+
+    _stagingAllocation = _allocator->allocateForBuffer(_stagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging);
+    if (!_stagingAllocation.isValid()) {
+        throw std::runtime_error("Failed to allocate staging ring memory!");
+    }
+
+    spdlog::info("Upload manager created successfully ({}, {} MB staging ring)", hasDedicatedTransferQueue() ?
+        fmt::format("transfer queue family {}", _queues.transferFamily) : "graphics queue", _params.stagingRingSize / (1024 * 1024));
+}
+
+
+UploadManager::~UploadManager()
+{
+    waitIdle();
+
+    // Nobody waited for these, their resources may already be gone so they are dropped instead of submitted
+    if (hasPending()) {
+        spdlog::warn("Upload manager destroyed with {} unsubmitted uploads", _pending.uploadCount);
+        vkEndCommandBuffer(_pending.transferCommandBuffer);
+        releaseBatch(_pending);
+    }
+
+    vkDestroyBuffer(_device, _stagingBuffer, nullptr);
+    _allocator->free(_stagingAllocation);
+
+    vkDestroyCommandPool(_device, _graphicsCommandPool, nullptr);
+    if (_transferCommandPool) vkDestroyCommandPool(_device, _transferCommandPool, nullptr);
+    vkDestroySemaphore(_device, _timeline, nullptr);
+}
+
+
+VkCommandBuffer UploadManager::getTransferCommandBuffer()
+{
+    if (hasPending()) return _pending.transferCommandBuffer;
+
+    // Copies are recorded as they come in, ownership transfers and mipmaps when the batch is submitted
+    _pending.number = _nextBatchNumber++;
+    _pending.ringStart = _ringHead;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = hasDedicatedTransferQueue() ? _transferCommandPool : _graphicsCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(_device, &allocInfo, &_pending.transferCommandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(_pending.transferCommandBuffer, &beginInfo);
+
+    if (!hasDedicatedTransferQueue()) {
+        _pending.graphicsCommandBuffer = _pending.transferCommandBuffer;
+    }
+    return _pending.transferCommandBuffer;
+}
+
+
+VkDeviceSize UploadManager::allocateStaging(VkDeviceSize size)
+{
+    const VkDeviceSize ringSize = _params.stagingRingSize;
+    const VkDeviceSize alignedSize = (size + StagingAlignment - 1) / StagingAlignment * StagingAlignment;
+
+    for (;;) {
+        // Chunks never wrap around, the end of the ring is skipped instead
+        VkDeviceSize offset = _ringHead % ringSize;
+        VkDeviceSize padding = offset + alignedSize > ringSize ? ringSize - offset : 0;
+        auto fits = [&]() { return _ringHead + padding + alignedSize - _ringTail <= ringSize; };
+
+        if (!fits()) collect();
+        if (fits()) {
+            getTransferCommandBuffer(); // The batch owns the range from here on
+            _ringHead += padding;
+            VkDeviceSize chunkOffset = _ringHead % ringSize;
+            _ringHead += alignedSize;
+            return chunkOffset;
+        }
+
+        // Ring is full: wait for the oldest batch, when nothing is in flight the pending batch holds all of it
+        if (_inFlight.empty()) submitPending();
+
+        TRACE_SCOPE_CAT("UploadManager::waitForRing", "asset");
+        waitTimeline(_inFlight.front().number * 2);
+        collect();
+    }
+}
+
+
+void UploadManager::submitIfHalfFull()
+{
+    // Submitting at half keeps the other half free for the next batch to record into while this one copies
+    if (hasPending() && _ringHead - _pending.ringStart >= _params.stagingRingSize / 2) submitPending();
+}
+
+
+UploadFuture UploadManager::finishUpload()
+{
+    _pending.uploadCount++;
+    UploadFuture future(this, _pending.number * 2);
+    submitIfHalfFull();
+    return future;
+}
+
+
+UploadFuture UploadManager::uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    if (size == 0) return {};
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    for (VkDeviceSize copied = 0; copied < size;) {
+        VkDeviceSize chunkSize = std::min(size - copied, _params.maxChunkSize);
+        VkDeviceSize stagingOffset = allocateStaging(chunkSize);
+        memcpy(getStagingPointer(stagingOffset), src + copied, static_cast<size_t>(chunkSize));
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = stagingOffset;
+        copyRegion.dstOffset = dstOffset + copied;
+        copyRegion.size = chunkSize;
+        vkCmdCopyBuffer(_pending.transferCommandBuffer, _stagingBuffer, dstBuffer, 1, &copyRegion);
+
+        copied += chunkSize;
+        if (copied < size) submitIfHalfFull();
+    }
+
+    // Earlier chunks were submitted before this batch on the same queue, its barriers cover them too
+    _pending.buffers.push_back({ dstBuffer, dstOffset, size, dstStage, dstAccess });
+    return finishUpload();
+}
+
+
+UploadFuture UploadManager::uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layerCount,
+    VkDeviceSize rowBytes, const RowWriter& writeRows, bool generateMipmaps)
+{
+    if (width == 0 || height == 0 || layerCount == 0) return {};
+    if (rowBytes > _params.maxChunkSize) {
+        spdlog::error("Image rows of {} bytes do not fit into an upload chunk!", rowBytes);
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const uint32_t rowsPerChunk = static_cast<uint32_t>(std::min<VkDeviceSize>(_params.maxChunkSize / rowBytes, height));
+    bool first = true;
+
+    for (uint32_t layer = 0; layer < layerCount; layer++) {
+        for (uint32_t firstRow = 0; firstRow < height; firstRow += rowsPerChunk) {
+            uint32_t rowCount = std::min(rowsPerChunk, height - firstRow);
+            VkDeviceSize stagingOffset = allocateStaging(rowBytes * rowCount);
+            VkCommandBuffer commandBuffer = _pending.transferCommandBuffer;
+
+            if (first) {
+                // Whole image to TRANSFER_DST, nothing written before has to be kept
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image;
+                barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, layerCount };
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+                first = false;
+            }
+
+            writeRows(getStagingPointer(stagingOffset), layer, firstRow, rowCount);
+
+            // A band of rows of the first mip (the transfer family is only used with a 1x1x1 copy granularity)
+            VkBufferImageCopy region{};
+            region.bufferOffset = stagingOffset;
+            region.bufferRowLength = 0; // Tightly packed
+            region.bufferImageHeight = 0;
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, layer, 1 };
+            region.imageOffset = { 0, static_cast<int32_t>(firstRow), 0 };
+            region.imageExtent = { width, rowCount, 1 };
+            vkCmdCopyBufferToImage(commandBuffer, _stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+            if (layer + 1 < layerCount || firstRow + rowCount < height) submitIfHalfFull();
+        }
+    }
+
+    _pending.images.push_back({ image, width, height, mipLevels, layerCount, generateMipmaps && mipLevels > 1 });
+    return finishUpload();
+}
+
+
+UploadFuture UploadManager::uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layerCount,
+    const void* data, VkDeviceSize size, bool generateMipmaps)
+{
+    if (width == 0 || height == 0 || layerCount == 0) return {};
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    const VkDeviceSize rowBytes = size / (static_cast<VkDeviceSize>(height) * layerCount);
+    return uploadImage(image, width, height, mipLevels, layerCount, rowBytes,
+        [&](void* dst, uint32_t layer, uint32_t firstRow, uint32_t rowCount) {
+            memcpy(dst, src + (static_cast<VkDeviceSize>(layer) * height + firstRow) * rowBytes, static_cast<size_t>(rowBytes * rowCount));
+        }, generateMipmaps);
+}
+
+
+UploadFuture UploadManager::uploadImageLevels(VkImage image, uint32_t width, uint32_t height, uint32_t blockExtent, VkDeviceSize blockBytes,
+    const std::vector<const void*>& levelData)
+{
+    const uint32_t mipLevels = static_cast<uint32_t>(levelData.size());
+    if (width == 0 || height == 0 || mipLevels == 0 || blockExtent == 0) return {};
+
+    const VkDeviceSize largestRowBytes = (width + blockExtent - 1) / blockExtent * blockBytes;
+    if (largestRowBytes > _params.maxChunkSize) {
+        spdlog::error("Image rows of {} bytes do not fit into an upload chunk!", largestRowBytes);
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    bool first = true;
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        const uint32_t levelWidth = std::max(1u, width >> level);
+        const uint32_t levelHeight = std::max(1u, height >> level);
+        const uint32_t blockRows = (levelHeight + blockExtent - 1) / blockExtent;
+        const VkDeviceSize rowBytes = (levelWidth + blockExtent - 1) / blockExtent * blockBytes;
+        const uint32_t rowsPerChunk = static_cast<uint32_t>(std::min<VkDeviceSize>(_params.maxChunkSize / rowBytes, blockRows));
+        const uint8_t* src = static_cast<const uint8_t*>(levelData[level]);
+
+        for (uint32_t firstRow = 0; firstRow < blockRows; firstRow += rowsPerChunk) {
+            uint32_t rowCount = std::min(rowsPerChunk, blockRows - firstRow);
+            VkDeviceSize stagingOffset = allocateStaging(rowBytes * rowCount);
+            VkCommandBuffer commandBuffer = _pending.transferCommandBuffer;
+
+            if (first) {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image;
+                barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+                first = false;
+            }
+
+            memcpy(getStagingPointer(stagingOffset), src + firstRow * rowBytes, static_cast<size_t>(rowBytes * rowCount));
+
+            // Bands start on a block row, the last one of a level may end inside its blocks (partial blocks at the edge)
+            uint32_t firstTexelRow = firstRow * blockExtent;
+            VkBufferImageCopy region{};
+            region.bufferOffset = stagingOffset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+            region.imageOffset = { 0, static_cast<int32_t>(firstTexelRow), 0 };
+            region.imageExtent = { levelWidth, std::min(rowCount * blockExtent, levelHeight - firstTexelRow), 1 };
+            vkCmdCopyBufferToImage(commandBuffer, _stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+            if (level + 1 < mipLevels || firstRow + rowCount < blockRows) submitIfHalfFull();
+        }
+    }
+
+    _pending.images.push_back({ image, width, height, mipLevels, 1, false });
+    return finishUpload();
+}
+
+
+void UploadManager::submitPending()
+{
+    TRACE_SCOPE_CAT("UploadManager::submit", "asset");
+
+    Batch& batch = _pending;
+    const bool dedicated = hasDedicatedTransferQueue();
+
+    // With a transfer family, every resource is released by it and acquired by the graphics family with the
+    // same (old, new) layout pair. Without one, the same barriers are plain transfer -> first use dependencies.
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    VkPipelineStageFlags dstStages = 0;
+
+    for (const auto& image : batch.images) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = image.generateMipmaps ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = dedicated ? _queues.transferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = dedicated ? _queues.graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image.image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, image.mipLevels, 0, image.layerCount };
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = image.generateMipmaps ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+        imageBarriers.push_back(barrier);
+        dstStages |= image.generateMipmaps ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+
+    for (const auto& buffer : batch.buffers) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = dedicated ? _queues.transferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = dedicated ? _queues.graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = buffer.buffer;
+        barrier.offset = buffer.offset;
+        barrier.size = buffer.size;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = buffer.dstAccess;
+        bufferBarriers.push_back(barrier);
+        dstStages |= buffer.dstStage;
+    }
+
+    if (dedicated) {
+        // Release on the transfer queue (the destination access is ignored there)
+        for (auto& barrier : imageBarriers) barrier.dstAccessMask = 0;
+        for (auto& barrier : bufferBarriers) barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(batch.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr,
+            static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+            static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        vkEndCommandBuffer(batch.transferCommandBuffer);
+
+        // Acquire on the graphics queue (the source access is ignored there)
+        for (size_t i = 0; i < imageBarriers.size(); i++) {
+            imageBarriers[i].srcAccessMask = 0;
+            imageBarriers[i].dstAccessMask = batch.images[i].generateMipmaps ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+        }
+        for (size_t i = 0; i < bufferBarriers.size(); i++) {
+            bufferBarriers[i].srcAccessMask = 0;
+            bufferBarriers[i].dstAccessMask = batch.buffers[i].dstAccess;
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = _graphicsCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        vkAllocateCommandBuffers(_device, &allocInfo, &batch.graphicsCommandBuffer);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(batch.graphicsCommandBuffer, &beginInfo);
+    }
+
+    // The first scope of these barriers reaches back to the copies (same queue) or the semaphore wait (transfer queue).
+    // Their second scope covers later submits on the graphics queue too, so frames can use the resources right away.
+    // A batch that only holds the first chunks of a large upload has nothing to hand over yet.
+    if (dstStages != 0) {
+        vkCmdPipelineBarrier(batch.graphicsCommandBuffer, dedicated ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0,
+            0, nullptr,
+            static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+            static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    for (const auto& image : batch.images) {
+        if (image.generateMipmaps) {
+            VulkanHelper::cmdGenerateMipmaps(batch.graphicsCommandBuffer, image.image, image.width, image.height, image.mipLevels, image.layerCount);
+        }
+    }
+    vkEndCommandBuffer(batch.graphicsCommandBuffer);
+
+    // Transfer part signals 2n - 1, graphics part 2n
+    uint64_t transferValue = batch.number * 2 - 1;
+    uint64_t graphicsValue = batch.number * 2;
+
+    if (dedicated) {
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &transferValue;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.transferCommandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &_timeline;
+
+        if (vkQueueSubmit(_queues.transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            spdlog::error("Failed to submit upload batch to the transfer queue!");
+        }
+    }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = dedicated ? 1 : 0;
+    timelineInfo.pWaitSemaphoreValues = &transferValue;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &graphicsValue;
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = dedicated ? 1 : 0;
+    submitInfo.pWaitSemaphores = &_timeline;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.graphicsCommandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &_timeline;
+
+    if (vkQueueSubmit(_queues.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        spdlog::error("Failed to submit upload batch to the graphics queue!");
+    }
+
+    batch.ringEnd = _ringHead;
+    spdlog::debug("Upload batch {} submitted ({} uploads, {:.1f} MB)", batch.number, batch.uploadCount, (batch.ringEnd - batch.ringStart) / (1024.0 * 1024.0));
+
+    _inFlight.push_back(std::move(batch));
+    _pending = Batch{};
+}
+
+
+void UploadManager::releaseBatch(Batch& batch)
+{
+    if (batch.transferCommandBuffer != batch.graphicsCommandBuffer && batch.transferCommandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(_device, _transferCommandPool, 1, &batch.transferCommandBuffer);
+    }
+    if (batch.graphicsCommandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(_device, _graphicsCommandPool, 1, &batch.graphicsCommandBuffer);
+    }
+    batch.transferCommandBuffer = VK_NULL_HANDLE;
+    batch.graphicsCommandBuffer = VK_NULL_HANDLE;
+}
+
+
+void UploadManager::collect()
+{
+    uint64_t completed = getCompletedValue();
+    while (!_inFlight.empty() && _inFlight.front().number * 2 <= completed) {
+        _ringTail = _inFlight.front().ringEnd; // Its staging range can be overwritten now
+        releaseBatch(_inFlight.front());
+        _inFlight.pop_front();
+    }
+}
+
+
+void UploadManager::flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (hasPending()) submitPending();
+    collect();
+}
+
+
+void UploadManager::waitIdle()
+{
+    uint64_t last = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_inFlight.empty()) return;
+        last = _inFlight.back().number * 2;
+    }
+    wait(last);
+}
+
+
+uint64_t UploadManager::getCompletedValue() const
+{
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(_device, _timeline, &value);
+    return value;
+}
+
+
+bool UploadManager::isComplete(uint64_t value) const
+{
+    return getCompletedValue() >= value;
+}
+
+
+void UploadManager::wait(uint64_t value)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (hasPending() && value >= _pending.number * 2) submitPending();
+    }
+
+    TRACE_SCOPE_CAT("UploadManager::wait", "asset");
+    waitTimeline(value);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    collect();
+}
+
+
+void UploadManager::waitTimeline(uint64_t value)
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &_timeline;
+    waitInfo.pValues = &value;
+    vkWaitSemaphores(_device, &waitInfo, UINT64_MAX);
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+#pragma once
+#include "stdafx.h"
+#include "memory/MemoryAllocator.h"
+#include <deque>
+#include <mutex>
+
+class UploadManager;
+
+
+// Completion of an upload. Resources are usable by later graphics submits as soon as their batch was
+// flushed (the graphics queue waits for the transfer on the GPU), this is for the CPU side.
+class UploadFuture
+{
+public:
+    UploadFuture() = default;
+    UploadFuture(UploadManager* manager, uint64_t value) : _manager(manager), _value(value) {}
+
+    bool isValid() const { return _manager != nullptr; }
+
+    // Non blocking: the GPU has finished the upload
+    bool isReady() const;
+
+    // Blocks until the upload has finished (flushes its batch first if it was not submitted yet)
+    void wait() const;
+
+    uint64_t getValue() const { return _value; }
+
+private:
+    UploadManager* _manager = nullptr;
+    uint64_t _value = 0;
+};
+
+
+struct UploadQueues
+{
+    uint32_t graphicsFamily = 0;
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+    uint32_t transferFamily = 0;        // Same as graphicsFamily when the device has no separate transfer family
+    VkQueue transferQueue = VK_NULL_HANDLE;
+};
+
+
+struct UploadManagerParams
+{
+    // Persistently mapped staging memory every upload streams through
+    VkDeviceSize stagingRingSize = 64ull * 1024 * 1024;
+
+    // Uploads are split into copies of at most this size, so the GPU copies one chunk while the next is written
+    VkDeviceSize maxChunkSize = 8ull * 1024 * 1024;
+};
+
+
+// Batches buffer and image uploads into one command buffer instead of a submit and a queue wait per copy.
+// Copies run on the transfer queue family when the device has one, the graphics queue then takes ownership
+// of the resources and generates mipmaps (blits need a graphics queue). Both submits signal one timeline
+// semaphore: batch n is complete at value 2n, which is what the returned futures wait for.
+//
+// All data goes through a fixed staging ring in chunks, so an upload of any size needs at most stagingRingSize
+// of host memory. A batch is submitted once it fills half of the ring, and when the ring is full the oldest
+// batch is waited for. Data can be written straight into the ring by a RowWriter, without an extra copy.
+//
+// Recording is thread safe. Submits use the graphics queue, so uploads and flush() must run on the thread
+// that submits frames.
+class UploadManager
+{
+public:
+    // Writes rowCount rows of layer, starting at firstRow, to dst (tightly packed rows)
+    using RowWriter = std::function<void(void* dst, uint32_t layer, uint32_t firstRow, uint32_t rowCount)>;
+
+    UploadManager(VkDevice device, MemoryAllocator* allocator, UploadQueues queues, UploadManagerParams params = {});
+    ~UploadManager();
+
+    UploadManager(const UploadManager&) = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+
+    // Copies size bytes of data to dstBuffer at dstOffset. dstStage/dstAccess describe the first use of the buffer.
+    UploadFuture uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0,
+        VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+
+    // Fills the first mip level of every layer of an image in UNDEFINED layout, rowBytes per row. writeRows is called
+    // once per chunk with the mapped ring memory (under the manager's lock, so it must not upload anything itself).
+    // The image ends up in SHADER_READ_ONLY_OPTIMAL, with the remaining mipLevels blitted from the first if generateMipmaps.
+    UploadFuture uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layerCount,
+        VkDeviceSize rowBytes, const RowWriter& writeRows, bool generateMipmaps);
+
+    // Same, from tightly packed data (layer after layer)
+    UploadFuture uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layerCount,
+        const void* data, VkDeviceSize size, bool generateMipmaps);
+
+    // Fills every mip level of an image in UNDEFINED layout from precomputed data (levelData[i] is level i, largest
+    // first), nothing is generated. Texels are stored in blockExtent x blockExtent blocks of blockBytes (1 x 1 blocks
+    // of the texel size for uncompressed formats), tightly packed. The image ends up in SHADER_READ_ONLY_OPTIMAL.
+    UploadFuture uploadImageLevels(VkImage image, uint32_t width, uint32_t height, uint32_t blockExtent, VkDeviceSize blockBytes,
+        const std::vector<const void*>& levelData);
+
+    // Submits the pending batch (if any) and releases the staging memory of finished batches
+    void flush();
+
+    // Waits for every submitted batch
+    void waitIdle();
+
+    bool isComplete(uint64_t value) const;
+    void wait(uint64_t value);
+
+    bool hasDedicatedTransferQueue() const { return _queues.transferFamily != _queues.graphicsFamily; }
+
+private:
+    VkDevice _device;
+    MemoryAllocator* _allocator;
+    UploadQueues _queues;
+    UploadManagerParams _params;
+
+    VkSemaphore _timeline = VK_NULL_HANDLE;
+    VkCommandPool _transferCommandPool = VK_NULL_HANDLE; // Only with a dedicated transfer family
+    VkCommandPool _graphicsCommandPool = VK_NULL_HANDLE;
+
+    // Staging ring, head and tail count bytes since creation (offset in the buffer is modulo the ring size)
+    VkBuffer _stagingBuffer = VK_NULL_HANDLE;
+    Allocation _stagingAllocation;
+    VkDeviceSize _ringHead = 0;     // Next byte to hand out
+    VkDeviceSize _ringTail = 0;     // Bytes before this are no longer read by the GPU
+
+    // Destinations of the copies, they get their ownership transfer / final layout when the batch is submitted
+    // (in the batch holding their last chunk, earlier chunks are ordered before it on the same queue)
+    struct PendingImage {
+        VkImage image;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        uint32_t layerCount;
+        bool generateMipmaps;
+    };
+
+    struct PendingBuffer {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        VkPipelineStageFlags dstStage;
+        VkAccessFlags dstAccess;
+    };
+
+    struct Batch {
+        uint64_t number = 0;                                        // Complete at timeline value 2 * number
+        VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;     // Same as graphicsCommandBuffer without a transfer family
+        VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+        std::vector<PendingImage> images;
+        std::vector<PendingBuffer> buffers;
+        VkDeviceSize ringStart = 0;                                 // Ring range used by the batch
+        VkDeviceSize ringEnd = 0;
+        uint32_t uploadCount = 0;
+    };
+
+    std::mutex _mutex;
+    Batch _pending;
+    std::deque<Batch> _inFlight;
+    uint64_t _nextBatchNumber = 1;
+
+    bool hasPending() const { return _pending.transferCommandBuffer != VK_NULL_HANDLE; }
+    VkCommandBuffer getTransferCommandBuffer(); // Begins a batch if there is none
+    VkDeviceSize allocateStaging(VkDeviceSize size); // Returns the offset in the staging buffer, may submit and wait
+    void* getStagingPointer(VkDeviceSize offset) const { return static_cast<uint8_t*>(_stagingAllocation.mapped) + offset; }
+    void submitIfHalfFull();
+    UploadFuture finishUpload();
+    void submitPending();
+    void releaseBatch(Batch& batch);
+    void collect();
+    uint64_t getCompletedValue() const;
+    void waitTimeline(uint64_t value);
+};
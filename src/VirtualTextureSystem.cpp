@@ -0,0 +1,516 @@
+#include "VirtualTextureSystem.h"
+#include "VulkanHelper.h"
+#include "loader/AsyncFileReader.h"
+#include "loader/BlockCompression.h"
+#include "utilities/ThreadPool.h"
+#include "utilities/Tracer.h"
+
+
+namespace {
+
+    // Layout of the page table buffer in virtualtexture.glsl (std430, uvec4 arrays)
+    struct GpuTexture {
+        uint32_t info[4];                                           // mipCount, width, height, -
+        uint32_t mips[VirtualTextureSystem::MaxMips][4];            // width, height, tilesX | tilesY << 16, first entry
+    };
+    struct GpuPageTable {
+        uint32_t atlas[4];                                          // tiles per row, tile size, border, atlas size
+        GpuTexture textures[VirtualTextureSystem::MaxTextures];
+    };
+    constexpr size_t EntriesOffset = sizeof(GpuPageTable) / sizeof(uint32_t);
+
+    uint32_t packEntry(uint32_t slotX, uint32_t slotY, uint32_t mip)
+    {
+        return slotX | (slotY << 12) | (mip << 24);
+    }
+
+}
+
+
+VirtualTextureSystem::VirtualTextureSystem(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight, VirtualTextureParams params)
+    : _ctx(std::move(ctx)), _framesInFlight(framesInFlight), _params(params)
+{
+}
+
+
+VirtualTextureSystem::~VirtualTextureSystem()
+{
+    // Reads and decompressions still in flight call back into this
+    {
+        std::unique_lock<std::mutex> lock(_loadMutex);
+        _loadCondition.wait(lock, [this]() { return _inFlight == 0; });
+    }
+
+    if (_atlasView) vkDestroyImageView(_ctx->device, _atlasView, nullptr);
+    if (_atlasImage) VulkanHelper::destroyImage(_ctx, _atlasImage, _atlasAllocation);
+    if (_stagingBuffer) VulkanHelper::destroyBuffer(_ctx, _stagingBuffer, _stagingAllocation);
+    if (_feedbackBuffer) VulkanHelper::destroyBuffer(_ctx, _feedbackBuffer, _feedbackAllocation);
+}
+
+
+std::string VirtualTextureSystem::getTilesPath(const std::string& imagePath)
+{
+    return std::filesystem::path(imagePath).replace_extension(".vtex").string();
+}
+
+
+bool VirtualTextureSystem::hasTiles(const std::string& imagePath)
+{
+    const std::string path = getTilesPath(imagePath);
+    std::error_code error;
+    return AssetPack::getInstance()->find(path) || std::filesystem::exists(path, error);
+}
+
+
+uint32_t VirtualTextureSystem::add(const std::string& path)
+{
+    if (_descriptorSet) {
+        spdlog::error("Virtual textures have to be added before the resources are created: {}", path);
+        return None;
+    }
+    if (_textures.size() >= MaxTextures) {
+        spdlog::error("Too many virtual textures (at most {}): {}", MaxTextures, path);
+        return None;
+    }
+
+    Texture texture;
+    texture.path = path;
+    if (!VirtualTextureFile::loadIndex(path, texture.index)) {
+        spdlog::error("Failed to load virtual texture: {}", path);
+        return None;
+    }
+    const VirtualTextureFile::Index& index = texture.index;
+    if (index.mips.size() > MaxMips) {
+        spdlog::error("Virtual texture has {} mips, at most {} are supported: {}", index.mips.size(), MaxMips, path);
+        return None;
+    }
+
+    // All textures share one atlas, so their tiles have to be alike
+    if (_textures.empty()) {
+        _tileFormat = index.format;
+        _tileSize = index.tileSize;
+        _tileBorder = index.border;
+    } else if (index.format != _tileFormat || index.tileSize != _tileSize || index.border != _tileBorder) {
+        spdlog::error("Virtual texture tiles differ from the first texture's (format {}, {}+{} texels): {}",
+            static_cast<uint32_t>(index.format), index.tileSize, 2 * index.border, path);
+        return None;
+    }
+
+    texture.packed = AssetPack::getInstance()->find(path);
+    texture.firstPage = _pageCount;
+    _pageCount += static_cast<uint32_t>(index.tiles.size());
+    _textures.push_back(std::move(texture));
+    return static_cast<uint32_t>(_textures.size() - 1);
+}
+
+
+VkDeviceSize VirtualTextureSystem::getPageTableBytes() const
+{
+    return (EntriesOffset + std::max(1u, _pageCount)) * sizeof(uint32_t);
+}
+
+
+void VirtualTextureSystem::createResources(const FrameAllocator& frameAllocator)
+{
+    // Pipelines bind the set whether there are virtual textures or not, the atlas is a single tile then
+    uint32_t atlasTiles = _textures.empty() ? 1 : std::max(1u, _params.atlasTiles);
+    if (_textures.empty()) {
+        _tileFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        _tileSize = 128;
+        _tileBorder = 4;
+    }
+
+    _atlasFormat = _tileFormat;
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(_ctx->physicalDevice, _tileFormat, &formatProperties);
+    if (BlockCompression::isBlockCompressed(_tileFormat) && !(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+        // Four times the bytes per tile, a quarter of the tiles keeps the budget
+        _decompressTiles = true;
+        _atlasFormat = BlockCompression::getFallbackFormat(_tileFormat);
+        atlasTiles = std::max(1u, atlasTiles / 2);
+        spdlog::warn("Virtual texture tile format {} cannot be sampled, tiles are decompressed", static_cast<uint32_t>(_tileFormat));
+    }
+
+    // Slot coordinates are packed into 12 bits of an entry
+    const uint32_t paddedSize = _tileSize + 2 * _tileBorder;
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(_ctx->physicalDevice, &properties);
+    atlasTiles = std::min({ atlasTiles, properties.limits.maxImageDimension2D / paddedSize, 4096u });
+    _atlasTilesPerRow = atlasTiles;
+    _atlasSize = atlasTiles * paddedSize;
+    _tileBytes = BlockCompression::getLevelSize(_atlasFormat, paddedSize, paddedSize);
+
+    // Atlas, no mip levels: every tile has its own, trilinear filtering is done by the shader
+    VulkanHelper::createImage(_ctx, _atlasSize, _atlasSize, _atlasFormat, 1, 1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _atlasImage, _atlasAllocation);
+    _atlasView = VulkanHelper::createImageView(_ctx, _atlasImage, _atlasFormat, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Bilinear only, an anisotropic footprint would reach past the tile border
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxLod = 0.0f;
+    _atlasSampler = _ctx->samplerCache->get(samplerInfo);
+
+    // Slots are handed out from the top left
+    _slots.assign(static_cast<size_t>(atlasTiles) * atlasTiles, Slot{});
+    _freeSlots.clear();
+    for (uint32_t slot = static_cast<uint32_t>(_slots.size()); slot-- > 0;) _freeSlots.push_back(slot);
+    _pageStates.assign(_pageCount, PageState::Missing);
+    _pageSlots.assign(_pageCount, None);
+
+    VulkanHelper::createBuffer(_ctx, _framesInFlight * _params.maxUploadsPerFrame * _tileBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _stagingBuffer, _stagingAllocation);
+
+    // Page table: the texture info is written once, the entries whenever residency changes
+    _pageTable.assign(getPageTableBytes() / sizeof(uint32_t), None);
+    GpuPageTable* header = reinterpret_cast<GpuPageTable*>(_pageTable.data());
+    memset(header, 0, sizeof(GpuPageTable));
+    header->atlas[0] = _atlasTilesPerRow;
+    header->atlas[1] = _tileSize;
+    header->atlas[2] = _tileBorder;
+    header->atlas[3] = _atlasSize;
+    for (size_t t = 0; t < _textures.size(); t++) {
+        const Texture& texture = _textures[t];
+        GpuTexture& gpuTexture = header->textures[t];
+        gpuTexture.info[0] = static_cast<uint32_t>(texture.index.mips.size());
+        gpuTexture.info[1] = texture.index.width;
+        gpuTexture.info[2] = texture.index.height;
+        for (size_t mip = 0; mip < texture.index.mips.size(); mip++) {
+            const VirtualTextureFile::Mip& level = texture.index.mips[mip];
+            gpuTexture.mips[mip][0] = level.width;
+            gpuTexture.mips[mip][1] = level.height;
+            gpuTexture.mips[mip][2] = level.tilesX | (level.tilesY << 16);
+            gpuTexture.mips[mip][3] = texture.firstPage + level.firstTile;
+        }
+    }
+    _entriesDirty = true;
+
+    // Feedback, cleared by update() after it is read
+    _feedbackRegionSize = std::max<VkDeviceSize>(_pageCount, 1) * sizeof(uint32_t);
+    const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+    _feedbackRegionSize = (_feedbackRegionSize + alignment - 1) / alignment * alignment;
+    VulkanHelper::createBuffer(_ctx, _feedbackRegionSize * _framesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _feedbackBuffer, _feedbackAllocation);
+    memset(_feedbackAllocation.mapped, 0, static_cast<size_t>(_feedbackRegionSize * _framesInFlight));
+
+    VkDescriptorImageInfo atlasInfo{};
+    atlasInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    atlasInfo.imageView = _atlasView;
+    atlasInfo.sampler = _atlasSampler;
+
+    VkDescriptorBufferInfo feedbackInfo{};
+    feedbackInfo.buffer = _feedbackBuffer;
+    feedbackInfo.offset = 0;
+    feedbackInfo.range = _feedbackRegionSize;
+
+    _descriptorSet = std::make_unique<DescriptorSet>(_ctx, std::vector<Descriptor>{
+        Descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, atlasInfo),
+        Descriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT, 1, frameAllocator.getDescriptorInfo(_pageTable.size() * sizeof(uint32_t))),
+        Descriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT, 1, feedbackInfo),
+    });
+
+    spdlog::info("Virtual texture system created successfully ({} textures, {} tiles, {}x{} atlas of {} tiles, {:.1f} MB)",
+        _textures.size(), _pageCount, _atlasSize, _atlasSize, _slots.size(), _slots.size() * _tileBytes / (1024.0 * 1024.0));
+}
+
+
+VirtualTextureSystem::Page VirtualTextureSystem::getPage(uint32_t page) const
+{
+    uint32_t texture = 0;
+    while (texture + 1 < _textures.size() && _textures[texture + 1].firstPage <= page) texture++;
+
+    const VirtualTextureFile::Index& index = _textures[texture].index;
+    const uint32_t tile = page - _textures[texture].firstPage;
+    uint32_t mip = 0;
+    while (mip + 1 < index.mips.size() && index.mips[mip + 1].firstTile <= tile) mip++;
+
+    const uint32_t tileInMip = tile - index.mips[mip].firstTile;
+    return { texture, mip, tileInMip % index.mips[mip].tilesX, tileInMip / index.mips[mip].tilesX };
+}
+
+
+uint32_t VirtualTextureSystem::getPageIndex(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y) const
+{
+    return _textures[texture].firstPage + _textures[texture].index.getTileIndex(mip, x, y);
+}
+
+
+uint32_t VirtualTextureSystem::getParentPage(uint32_t page) const
+{
+    const Page info = getPage(page);
+    const VirtualTextureFile::Index& index = _textures[info.texture].index;
+    if (info.mip + 1 >= index.mips.size()) return None;
+
+    // Odd sized levels can have a last tile whose parent texels start in the tile before
+    const VirtualTextureFile::Mip& parent = index.mips[info.mip + 1];
+    return getPageIndex(info.texture, info.mip + 1, std::min(info.x / 2, parent.tilesX - 1), std::min(info.y / 2, parent.tilesY - 1));
+}
+
+
+void VirtualTextureSystem::update(uint32_t frameIndex, FrameAllocator& frameAllocator)
+{
+    TRACE_SCOPE("VirtualTextureSystem::update");
+
+    _currentFrame = frameIndex;
+    _frameNumber++;
+    _uploads.clear();
+
+    // What the last frame of this slot sampled (its fence has signaled). The coarsest tiles are always wanted.
+    std::vector<uint32_t> requested;
+    uint32_t* feedback = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(_feedbackAllocation.mapped) + frameIndex * _feedbackRegionSize);
+    for (uint32_t page = 0; page < _pageCount; page++) {
+        if (feedback[page] != 0) requested.push_back(page);
+    }
+    memset(feedback, 0, static_cast<size_t>(_pageCount) * sizeof(uint32_t));
+    for (const Texture& texture : _textures) {
+        requested.push_back(texture.firstPage + static_cast<uint32_t>(texture.index.tiles.size()) - 1);
+    }
+    requestTiles(requested);
+
+    // Tiles that arrived, the rest waits for the next frames
+    std::vector<LoadedTile> loaded;
+    {
+        std::lock_guard<std::mutex> lock(_loadMutex);
+        const size_t count = std::min<size_t>(_loadedTiles.size(), _params.maxUploadsPerFrame);
+        loaded.assign(std::make_move_iterator(_loadedTiles.begin()), std::make_move_iterator(_loadedTiles.begin() + count));
+        _loadedTiles.erase(_loadedTiles.begin(), _loadedTiles.begin() + count);
+    }
+
+    const uint32_t paddedSize = _tileSize + 2 * _tileBorder;
+    uint8_t* staging = static_cast<uint8_t*>(_stagingAllocation.mapped) + frameIndex * _params.maxUploadsPerFrame * _tileBytes;
+    for (LoadedTile& tile : loaded) {
+        _pendingTiles--;
+
+        // Failed reads stay in the loading state, so they are not asked for again every frame
+        const uint8_t* data = tile.packed ? tile.packed : tile.data.data();
+        if (!tile.packed && tile.data.size() != _tileBytes) continue;
+
+        const uint32_t slot = findSlot();
+        if (slot == None) {
+            // Everything in the atlas is in view, try again once something is not
+            _pageStates[tile.page] = PageState::Missing;
+            continue;
+        }
+
+        Slot& target = _slots[slot];
+        if (target.page != None) {
+            _pageStates[target.page] = PageState::Missing;
+            _pageSlots[target.page] = None;
+        }
+        target.page = tile.page;
+        target.lastSeen = _frameNumber;
+        target.pinned = getParentPage(tile.page) == None;
+        _pageStates[tile.page] = PageState::Resident;
+        _pageSlots[tile.page] = slot;
+
+        const VkDeviceSize stagingOffset = _uploads.size() * _tileBytes;
+        memcpy(staging + stagingOffset, data, static_cast<size_t>(_tileBytes));
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = frameIndex * _params.maxUploadsPerFrame * _tileBytes + stagingOffset;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageOffset = { static_cast<int32_t>((slot % _atlasTilesPerRow) * paddedSize), static_cast<int32_t>((slot / _atlasTilesPerRow) * paddedSize), 0 };
+        region.imageExtent = { paddedSize, paddedSize, 1 };
+        _uploads.push_back(region);
+        _entriesDirty = true;
+    }
+
+    if (_entriesDirty) writeEntries();
+
+    FrameAllocation pageTable = frameAllocator.allocate(_pageTable.size() * sizeof(uint32_t));
+    memcpy(pageTable.data, _pageTable.data(), _pageTable.size() * sizeof(uint32_t));
+    _pageTableOffset = pageTable.offset;
+    _feedbackOffset = static_cast<uint32_t>(frameIndex * _feedbackRegionSize);
+}
+
+
+void VirtualTextureSystem::requestTiles(const std::vector<uint32_t>& pages)
+{
+    // A requested tile and all of its ancestors: the resident ones were sampled (as the tile or as its stand-in),
+    // the missing ones are loaded
+    std::vector<uint32_t> missing;
+    for (uint32_t page : pages) {
+        for (uint32_t ancestor = page; ancestor != None; ancestor = getParentPage(ancestor)) {
+            if (_pageStates[ancestor] == PageState::Resident) {
+                _slots[_pageSlots[ancestor]].lastSeen = _frameNumber;
+            } else if (_pageStates[ancestor] == PageState::Missing) {
+                missing.push_back(ancestor);
+            }
+        }
+    }
+    if (missing.empty()) return;
+
+    // Coarse mips first, they stand in for everything below them
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    std::vector<std::pair<uint32_t, uint32_t>> byMip;
+    byMip.reserve(missing.size());
+    for (uint32_t page : missing) byMip.push_back({ getPage(page).mip, page });
+    std::stable_sort(byMip.begin(), byMip.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (const auto& [mip, page] : byMip) {
+        if (_pendingTiles >= _params.maxPendingTiles) break;
+
+        const Texture& texture = _textures[getPage(page).texture];
+        const VirtualTextureFile::Tile& tile = texture.index.tiles[page - texture.firstPage];
+        _pageStates[page] = PageState::Loading;
+        _pendingTiles++;
+        {
+            std::lock_guard<std::mutex> lock(_loadMutex);
+            _inFlight++;
+        }
+
+        // Decompression runs on the thread pool, not on the reader thread
+        auto decompress = [this, page](const uint8_t* blocks, size_t size, std::shared_ptr<std::vector<uint8_t>> keepAlive) {
+            ThreadPool::getInstance()->submit([this, page, blocks, size, keepAlive]() {
+                const uint32_t paddedSize = _tileSize + 2 * _tileBorder;
+                LoadedTile loaded{ page, {}, nullptr };
+                if (size == BlockCompression::getLevelSize(_tileFormat, paddedSize, paddedSize)) {
+                    loaded.data.resize(static_cast<size_t>(_tileBytes));
+                    if (!BlockCompression::decompress(_tileFormat, blocks, paddedSize, paddedSize, loaded.data.data())) loaded.data.clear();
+                }
+                finishLoad(std::move(loaded));
+            });
+        };
+
+        if (texture.packed) {
+            const uint8_t* data = texture.packed.data + tile.offset;
+            const bool inBounds = tile.offset + tile.size <= texture.packed.size;
+            if (_decompressTiles && inBounds) {
+                decompress(data, tile.size, nullptr);
+            } else {
+                finishLoad({ page, {}, inBounds && tile.size == _tileBytes ? data : nullptr });
+            }
+            continue;
+        }
+
+        AsyncFileReader::getInstance()->read(texture.path, tile.offset, tile.size, [this, page, decompress](FileReadResult& result) {
+            if (_decompressTiles && result.success) {
+                auto data = std::make_shared<std::vector<uint8_t>>(std::move(result.data));
+                decompress(data->data(), data->size(), data);
+            } else {
+                finishLoad({ page, std::move(result.data), nullptr });
+            }
+        });
+    }
+}
+
+
+void VirtualTextureSystem::finishLoad(LoadedTile tile)
+{
+    // Notify under the lock, the destructor may return (and destroy the condition) as soon as it sees 0
+    std::lock_guard<std::mutex> lock(_loadMutex);
+    _loadedTiles.push_back(std::move(tile));
+    _inFlight--;
+    _loadCondition.notify_all();
+}
+
+
+uint32_t VirtualTextureSystem::findSlot()
+{
+    if (!_freeSlots.empty()) {
+        uint32_t slot = _freeSlots.back();
+        _freeSlots.pop_back();
+        return slot;
+    }
+
+    // Least recently seen, but never a tile the latest feedback asked for
+    uint32_t best = None;
+    for (uint32_t slot = 0; slot < _slots.size(); slot++) {
+        const Slot& candidate = _slots[slot];
+        if (candidate.pinned || candidate.lastSeen >= _frameNumber) continue;
+        if (best == None || candidate.lastSeen < _slots[best].lastSeen) best = slot;
+    }
+    return best;
+}
+
+
+void VirtualTextureSystem::writeEntries()
+{
+    // Coarse to fine, so a missing tile can take the entry of its parent
+    uint32_t* entries = _pageTable.data() + EntriesOffset;
+    for (uint32_t t = 0; t < _textures.size(); t++) {
+        const VirtualTextureFile::Index& index = _textures[t].index;
+        for (uint32_t mip = static_cast<uint32_t>(index.mips.size()); mip-- > 0;) {
+            const VirtualTextureFile::Mip& level = index.mips[mip];
+            for (uint32_t y = 0; y < level.tilesY; y++) {
+                for (uint32_t x = 0; x < level.tilesX; x++) {
+                    const uint32_t page = getPageIndex(t, mip, x, y);
+                    if (_pageStates[page] == PageState::Resident) {
+                        const uint32_t slot = _pageSlots[page];
+                        entries[page] = packEntry(slot % _atlasTilesPerRow, slot / _atlasTilesPerRow, mip);
+                    } else if (mip + 1 < index.mips.size()) {
+                        const VirtualTextureFile::Mip& parent = index.mips[mip + 1];
+                        entries[page] = entries[getPageIndex(t, mip + 1, std::min(x / 2, parent.tilesX - 1), std::min(y / 2, parent.tilesY - 1))];
+                    } else {
+                        entries[page] = None;
+                    }
+                }
+            }
+        }
+    }
+    _entriesDirty = false;
+}
+
+
+void VirtualTextureSystem::recordUploads(VkCommandBuffer commandBuffer)
+{
+    if (_uploads.empty() && _atlasInitialized) return;
+
+    // Earlier frames may still sample the slots that are overwritten, the barrier waits for their fragment shaders
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = _atlasInitialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = _atlasImage;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+        _atlasInitialized ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    if (!_uploads.empty()) {
+        vkCmdCopyBufferToImage(commandBuffer, _stagingBuffer, _atlasImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(_uploads.size()), _uploads.data());
+    }
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    _atlasInitialized = true;
+    _uploads.clear();
+}
+
+
+void VirtualTextureSystem::recordFeedbackBarrier(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+
+void VirtualTextureSystem::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set) const
+{
+    VkDescriptorSet descriptorSet = _descriptorSet->getDescriptorSet();
+    const std::array<uint32_t, 2> offsets = { _pageTableOffset, _feedbackOffset };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &descriptorSet,
+        static_cast<uint32_t>(offsets.size()), offsets.data());
+}
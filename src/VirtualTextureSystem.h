@@ -0,0 +1,175 @@
+#pragma once
+#include "stdafx.h"
+#include "VulkanContext.h"
+#include "DescriptorSet.h"
+#include "loader/AssetPack.h"
+#include "loader/VirtualTextureFile.h"
+#include "memory/FrameAllocator.h"
+#include <condition_variable>
+#include <mutex>
+
+
+struct VirtualTextureParams
+{
+    // The physical atlas holds atlasTiles x atlasTiles tiles, this is the memory budget of all virtual textures
+    // (32 is 4352x4352 texels, 18 MB in BC7). Devices without BC7 get RGBA8 tiles and a quarter of them.
+    uint32_t atlasTiles = 32;
+
+    // Tiles copied into the atlas per frame, and tile reads in flight
+    uint32_t maxUploadsPerFrame = 32;
+    uint32_t maxPendingTiles = 128;
+
+    // Resolution of the feedback pass relative to the swap chain
+    float feedbackScale = 0.25f;
+};
+
+
+// Sparse virtual texturing for the huge planet maps (.vtex files written by the TextureBaker with --virtual).
+// Only the tiles the camera actually sees are resident, in one physical atlas of fixed size:
+//  - a feedback pass renders the virtual textured models at low resolution and marks the tile every pixel
+//    would sample (texture, mip, x, y) in a per-frame buffer,
+//  - update() reads the marks back once the frame slot comes around again, reads the missing tiles on the
+//    AsyncFileReader (or straight from the asset pack), coarse mips first, and evicts the least recently seen
+//    tiles to make room,
+//  - recordUploads() copies the tiles that arrived into their atlas slots,
+//  - the page table (one entry per tile of every texture) maps a tile to its atlas slot. Tiles that are not
+//    resident point at their closest resident ancestor, so the shader always finds something to sample.
+// The coarsest tile of each texture is never evicted.
+//
+// Shaders include shaders/include/virtualtexture.glsl and bind getDescriptorSet() with bind().
+// The feedback pass needs fragmentStoresAndAtomics (VulkanContext::fragmentStoresAndAtomicsSupported).
+class VirtualTextureSystem
+{
+public:
+    static constexpr uint32_t None = UINT32_MAX;  // Texture id of "no virtual texture"
+    static constexpr uint32_t MaxTextures = 32;
+    static constexpr uint32_t MaxMips = 16;
+
+    VirtualTextureSystem(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight, VirtualTextureParams params = {});
+    ~VirtualTextureSystem();
+
+    VirtualTextureSystem(const VirtualTextureSystem&) = delete;
+    VirtualTextureSystem& operator=(const VirtualTextureSystem&) = delete;
+
+    // Has a .vtex file for the image (in the asset pack or on disk)
+    static bool hasTiles(const std::string& imagePath);
+    static std::string getTilesPath(const std::string& imagePath);
+
+    // Declares a texture, returns its id (None on failure). Only before createResources().
+    uint32_t add(const std::string& path);
+
+    // Bytes of the page table update() allocates from the frame allocator every frame, for the textures added so far
+    VkDeviceSize getPageTableBytes() const;
+
+    // Creates the atlas, buffers and descriptor set for the textures added so far (the page table lives in the
+    // frame allocator)
+    void createResources(const FrameAllocator& frameAllocator);
+
+    // Once the fence of frameIndex has signaled: reads its feedback, starts loading the missing tiles, picks the
+    // tiles uploaded this frame and writes the page table to the frame allocator
+    void update(uint32_t frameIndex, FrameAllocator& frameAllocator);
+
+    // Copies this frame's tiles into the atlas, before anything samples it
+    void recordUploads(VkCommandBuffer commandBuffer);
+
+    // Makes the feedback written by the frame visible to update(), after the feedback pass
+    void recordFeedbackBarrier(VkCommandBuffer commandBuffer);
+
+    // Binds the set with the current frame's offsets
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set) const;
+    const DescriptorSet* getDescriptorSet() const { return _descriptorSet.get(); }
+
+    uint32_t getTextureCount() const { return static_cast<uint32_t>(_textures.size()); }
+    float getFeedbackScale() const { return _params.feedbackScale; }
+
+private:
+    std::shared_ptr<VulkanContext> _ctx;
+    uint32_t _framesInFlight;
+    VirtualTextureParams _params;
+
+    struct Texture {
+        std::string path;
+        VirtualTextureFile::Index index;
+        AssetView packed;               // The whole file, when it is in the asset pack
+        uint32_t firstPage = 0;         // Pages of all textures are numbered one after the other
+    };
+    std::vector<Texture> _textures;
+    uint32_t _pageCount = 0;
+    uint32_t _tileSize = 0;
+    uint32_t _tileBorder = 0;
+    VkFormat _tileFormat = VK_FORMAT_UNDEFINED;
+
+    struct Page {
+        uint32_t texture;
+        uint32_t mip;
+        uint32_t x;
+        uint32_t y;
+    };
+    Page getPage(uint32_t page) const;
+    uint32_t getPageIndex(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y) const;
+    uint32_t getParentPage(uint32_t page) const; // None for the coarsest tile
+
+    // [Residency]
+    enum class PageState : uint8_t { Missing, Loading, Resident };
+    std::vector<PageState> _pageStates;
+    std::vector<uint32_t> _pageSlots;           // Atlas slot of resident pages
+
+    struct Slot {
+        uint32_t page = None;
+        uint64_t lastSeen = 0;                  // Frame whose feedback last asked for the page (or a descendant)
+        bool pinned = false;
+    };
+    std::vector<Slot> _slots;
+    std::vector<uint32_t> _freeSlots;
+    uint64_t _frameNumber = 0;
+
+    uint32_t findSlot();
+    void requestTiles(const std::vector<uint32_t>& pages);
+
+    // [Loading] Tiles arrive on reader and worker threads
+    struct LoadedTile {
+        uint32_t page;
+        std::vector<uint8_t> data;
+        const uint8_t* packed = nullptr;        // Points into the asset pack instead of data
+    };
+    std::mutex _loadMutex;
+    std::condition_variable _loadCondition;
+    std::vector<LoadedTile> _loadedTiles;
+    uint32_t _inFlight = 0;                     // Reads and decompressions not finished yet
+    uint32_t _pendingTiles = 0;                 // Requested and not uploaded yet (render thread only)
+    bool _decompressTiles = false;              // The device cannot sample the tile format, the atlas is RGBA8
+
+    void finishLoad(LoadedTile tile);
+
+    // [Atlas]
+    VkFormat _atlasFormat = VK_FORMAT_UNDEFINED;
+    uint32_t _atlasTilesPerRow = 0;
+    uint32_t _atlasSize = 0;
+    VkImage _atlasImage = VK_NULL_HANDLE;
+    Allocation _atlasAllocation;
+    VkImageView _atlasView = VK_NULL_HANDLE;
+    VkSampler _atlasSampler = VK_NULL_HANDLE;
+    bool _atlasInitialized = false;
+    VkDeviceSize _tileBytes = 0;                // One tile in the atlas format
+
+    // Staging of the frame's uploads, a region per frame in flight
+    VkBuffer _stagingBuffer = VK_NULL_HANDLE;
+    Allocation _stagingAllocation;
+    std::vector<VkBufferImageCopy> _uploads;
+
+    // [Page table] Texture and level info, then one entry per page: atlas slot x | slot y << 12 | mip << 24
+    // (of the page or its closest resident ancestor), or None. Copied to the frame allocator every frame.
+    std::vector<uint32_t> _pageTable;
+    bool _entriesDirty = true;
+    uint32_t _pageTableOffset = 0;
+    void writeEntries();
+
+    // [Feedback] One uint per page and frame in flight, set to 1 by the feedback shader
+    VkBuffer _feedbackBuffer = VK_NULL_HANDLE;
+    Allocation _feedbackAllocation;
+    VkDeviceSize _feedbackRegionSize = 0;
+    uint32_t _feedbackOffset = 0;
+
+    std::unique_ptr<DescriptorSet> _descriptorSet;
+    uint32_t _currentFrame = 0;
+};
@@ -6,10 +6,15 @@ VulkanContext::VulkanContext(SDL_Window* window)
 {
     createVulkanInstance();
     setupDebugMessenger();
-    createSurface(window);
+    if (!isHeadless()) createSurface(window);
     pickPhysicalDevice();
     createLogicalDevice();
-    createDescriptorPool();
+    memoryAllocator = std::make_unique<MemoryAllocator>(physicalDevice, device);
+    uploadManager = std::make_unique<UploadManager>(device, memoryAllocator.get(), UploadQueues{ graphicsQueueFamily, graphicsQueue, transferQueueFamily, transferQueue });
+    descriptorAllocator = std::make_unique<DescriptorAllocator>(device);
+    descriptorLayoutCache = std::make_unique<DescriptorLayoutCache>(device);
+    samplerCache = std::make_unique<SamplerCache>(device);
+    bindlessTextures = std::make_unique<BindlessTextures>(physicalDevice, device, deletionQueue);
     createCommandPool();
     loadPipelineCache("pipeline_cache.bin");
 }
@@ -18,11 +23,19 @@ VulkanContext::~VulkanContext() {
     // Save the pipeline cache to a file
     savePipelineCache("pipeline_cache.bin");
     spdlog::info("Destroying Vulkan context...");
+    // Deferred deletions (e.g. Texture2D cleanup) may still use the upload manager, and flushing needs the GPU done
+    vkDeviceWaitIdle(device);
+    deletionQueue.flush();
+    uploadManager = nullptr;
+    bindlessTextures = nullptr;
+    descriptorAllocator = nullptr;
+    descriptorLayoutCache = nullptr;
+    samplerCache = nullptr;
+    memoryAllocator = nullptr;
     vkDestroyCommandPool(device, commandPool, nullptr);
-    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
     vkDestroyPipelineCache(device, pipelineCache, nullptr);
     vkDestroyDevice(device, nullptr);
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (surface) vkDestroySurfaceKHR(instance, surface, nullptr);
 
     if (debugMessenger) {
         auto destroyDebugUtilsMessengerEXT = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
@@ -60,16 +73,21 @@ void VulkanContext::createVulkanInstance() {
     }
 
     // Required extensions 
-    // SDL extensions
-    uint32_t sdlExtensionCount = 0;
-    const char * const *sdlExtensionsRaw = SDL_Vulkan_GetInstanceExtensions(&sdlExtensionCount);
-    std::vector<const char*> requiredExtensions(sdlExtensionsRaw, sdlExtensionsRaw + sdlExtensionCount);
+    std::vector<const char*> requiredExtensions;
+
+    // SDL extensions (surface extensions are not needed in headless mode)
+    if (!isHeadless()) {
+        uint32_t sdlExtensionCount = 0;
+        const char * const *sdlExtensionsRaw = SDL_Vulkan_GetInstanceExtensions(&sdlExtensionCount);
+        requiredExtensions.assign(sdlExtensionsRaw, sdlExtensionsRaw + sdlExtensionCount);
+    }
 
     // Debug Utils extension
     if(!isInstanceExtensionAvailable(VK_EXT_DEBUG_UTILS_EXTENSION_NAME)) {
         spdlog::warn("Debug Utils extension not available!");
     }else {
         requiredExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        debugUtilsEnabled = true;
     }
 
     // Other extensions can be added here as needed
@@ -136,14 +154,20 @@ void VulkanContext::pickPhysicalDevice() {
         VkPhysicalDeviceProperties deviceProperties;
         vkGetPhysicalDeviceProperties(device, &deviceProperties);
         if (isDeviceSuitable(device)) {
+            // In headless mode any device will do, but keep looking for a discrete GPU
+            bool isDiscreteGPU = (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU);
+            if (physicalDevice != VK_NULL_HANDLE && !isDiscreteGPU) continue;
             physicalDevice = device;
-            spdlog::info("Found Suitable GPU: {}", deviceProperties.deviceName);
-            break;
+            if (isDiscreteGPU) break;
         }
     }
     if (physicalDevice == VK_NULL_HANDLE) {
         throw std::runtime_error("Failed to find a suitable GPU!");
     }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    spdlog::info("Found Suitable GPU: {}", deviceProperties.deviceName);
 }
 
 void VulkanContext::createLogicalDevice() {
@@ -162,6 +186,7 @@ void VulkanContext::createLogicalDevice() {
         if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
             graphicsFamily = i;
         }
+        if (isHeadless()) continue;
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
         if (presentSupport) {
@@ -169,12 +194,35 @@ void VulkanContext::createLogicalDevice() {
         }
     }
 
+    // Nothing is presented in headless mode, the "present" queue is just the graphics queue
+    if (isHeadless()) {
+        presentFamily = graphicsFamily;
+    }
+
+    // Uploads prefer a transfer-only family (the copy engine), then any family without graphics.
+    // Images are streamed in bands of rows, which needs a family that can copy at any texel offset.
+    std::optional<uint32_t> transferFamily;
+    for (uint32_t i = 0; i < queueFamilyCount; ++i) {
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) continue;
+        VkExtent3D granularity = queueFamilies[i].minImageTransferGranularity;
+        if (granularity.width != 1 || granularity.height != 1 || granularity.depth != 1) continue;
+        if (!(flags & VK_QUEUE_COMPUTE_BIT)) {
+            transferFamily = i;
+            break;
+        }
+        if (!transferFamily.has_value()) transferFamily = i;
+    }
+    if (!transferFamily.has_value()) {
+        transferFamily = graphicsFamily;
+    }
+
     // Create logical device
     VkDeviceCreateInfo deviceCreateInfo{};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     // Specify the queue create info for graphics and present queues
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {graphicsFamily.value(), presentFamily.value()};
+    std::set<uint32_t> uniqueQueueFamilies = {graphicsFamily.value(), presentFamily.value(), transferFamily.value()};
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo{};
@@ -188,18 +236,38 @@ void VulkanContext::createLogicalDevice() {
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     // Specify the device extensions
-    const std::vector<const char*> deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    std::vector<const char*> deviceExtensions;
+    if (!isHeadless()) {
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
+    // Optional features, the scene falls back to loading the virtual textured maps whole without them
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+    fragmentStoresAndAtomicsSupported = supportedFeatures.features.fragmentStoresAndAtomics;
+
     // Specify the device features
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE; // Enable anisotropic filtering
     deviceFeatures.sampleRateShading = VK_TRUE; // Enable sample rate shading
+    deviceFeatures.fragmentStoresAndAtomics = fragmentStoresAndAtomicsSupported; // Virtual texture feedback is written by a fragment shader
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
+    // Core 1.2 features
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.timelineSemaphore = VK_TRUE; // Upload completion (UploadManager)
+    vulkan12Features.descriptorIndexing = VK_TRUE; // Bindless texture table (BindlessTextures)
+    vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+    vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    deviceCreateInfo.pNext = &vulkan12Features;
+
     if (vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create logical device!");
     }
@@ -209,32 +277,14 @@ void VulkanContext::createLogicalDevice() {
     // Get the graphics queue handle
     vkGetDeviceQueue(device, graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, presentFamily.value(), 0, &presentQueue);
-}
-
-void VulkanContext::createDescriptorPool() {
-
-    // Descriptor usage counts per type
-    uint32_t totalUBOs = 100;
-    uint32_t totalSamplers = 70;
-    uint32_t maxSets = 50;
-
-    std::vector<VkDescriptorPoolSize> poolSizes = {
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, totalUBOs },
-        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, totalSamplers }
-    };
+    vkGetDeviceQueue(device, transferFamily.value(), 0, &transferQueue);
 
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = maxSets;
-
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor pool!");
-    }
-
-    spdlog::info("Descriptor pool created successfully");
+    graphicsQueueFamily = graphicsFamily.value();
+    transferQueueFamily = transferFamily.value();
+    if (transferQueueFamily != graphicsQueueFamily) {
+        spdlog::info("Using queue family {} for transfers", transferQueueFamily);
     }
+}
 
 void VulkanContext::createCommandPool() {
     QueueFamilyIndices queueFamilyIndices = VulkanHelper::findQueueFamilies(physicalDevice, surface);
@@ -260,6 +310,11 @@ bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
     // Check if the device is discrete GPU
     bool isDiscreteGPU = (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU);
 
+    // Headless rendering only needs a graphics queue (software drivers like lavapipe are fine)
+    if (isHeadless()) {
+        return VulkanHelper::findQueueFamilies(device, VK_NULL_HANDLE).graphicsFamily.has_value();
+    }
+
     // Check if the device supports certain extensions
     std::set<std::string> requiredExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
     uint32_t extensionCount;
@@ -1,10 +1,18 @@
 #pragma once
 #include "stdafx.h"
 #include "VulkanHelper.h"
+#include "DeletionQueue.h"
+#include "memory/MemoryAllocator.h"
+#include "UploadManager.h"
+#include "BindlessTextures.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorLayoutCache.h"
+#include "SamplerCache.h"
 
 
 class VulkanContext {
 public:
+    // Pass a null window to create a headless context (no surface, no swapchain extension)
     VulkanContext(SDL_Window* window);
     ~VulkanContext();
 
@@ -20,12 +28,41 @@ public:
     
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue;              // Graphics queue if the device has no separate transfer family
+
+    uint32_t graphicsQueueFamily = 0;
+    uint32_t transferQueueFamily = 0;
 
     VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
-    VkDescriptorPool descriptorPool;
     VkCommandPool commandPool;
 
+    // All engine buffers and images get their memory from here (see VulkanHelper::createBuffer/createImage)
+    std::unique_ptr<MemoryAllocator> memoryAllocator;
+
+    // Texture and mesh data goes to the GPU through this (batched, on the transfer queue if there is one)
+    std::unique_ptr<UploadManager> uploadManager;
+
+    // Objects replaced while frames are in flight are destroyed through this (see Renderer::drawFrame)
+    DeletionQueue deletionQueue;
+
+    // Every model texture, indexed from push constants (see BindlessTextures)
+    std::unique_ptr<BindlessTextures> bindlessTextures;
+
+    // Descriptor sets come from here (grows by adding pools), their layouts and update templates from the layout
+    // cache, and samplers from the sampler cache (see DescriptorSet, Texture2D)
+    std::unique_ptr<DescriptorAllocator> descriptorAllocator;
+    std::unique_ptr<DescriptorLayoutCache> descriptorLayoutCache;
+    std::unique_ptr<SamplerCache> samplerCache;
+
+    bool isHeadless() const { return window == nullptr; }
+
+    // VK_EXT_debug_utils is enabled on the instance (labels, object names)
+    bool debugUtilsEnabled = false;
+
+    // fragmentStoresAndAtomics is enabled (virtual texture feedback, see VirtualTextureSystem)
+    bool fragmentStoresAndAtomicsSupported = false;
+
 private:
     bool _validationLayersAvailable = true;
 
@@ -34,7 +71,6 @@ private:
     void createSurface(SDL_Window* window);
     void pickPhysicalDevice();
     void createLogicalDevice();
-    void createDescriptorPool();
     void createCommandPool();
 
     // Debug messenger for validation layers
@@ -54,7 +54,7 @@ namespace VulkanHelper {
                       VkDeviceSize size, 
                       VkBufferUsageFlags usage, 
                       VkMemoryPropertyFlags properties, 
-                      VkBuffer& buffer, VkDeviceMemory& bufferMemory) 
+                      VkBuffer& buffer, Allocation& allocation) 
     {
         // Create buffer
         VkBufferCreateInfo bufferInfo{};
@@ -68,22 +68,31 @@ namespace VulkanHelper {
             return;
         }
     
-        // Get memory requirements for the buffer
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(ctx->device, buffer, &memRequirements);
-    
-        // Allocate memory for the buffer
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(ctx, memRequirements.memoryTypeBits, properties);
-        if (vkAllocateMemory(ctx->device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        // Category is only used for the memory statistics
+        MemoryCategory category = MemoryCategory::Other;
+        if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+            category = MemoryCategory::UniformBuffer;
+        } else if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+            category = MemoryCategory::Geometry;
+        } else if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)) {
+            category = MemoryCategory::Staging;
+        } else if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && (usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT)) {
+            category = MemoryCategory::Readback;
+        }
+
+        // Sub-allocate and bind the buffer memory
+        allocation = ctx->memoryAllocator->allocateForBuffer(buffer, properties, category);
+        if (!allocation.isValid()) {
             spdlog::error("Failed to allocate buffer memory!");
-            return;
         }
-    
-        // Bind the buffer memory to the buffer
-        vkBindBufferMemory(ctx->device, buffer, bufferMemory, 0);
+    }
+
+
+    void destroyBuffer(const std::shared_ptr<VulkanContext>& ctx, VkBuffer& buffer, Allocation& allocation)
+    {
+        if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(ctx->device, buffer, nullptr);
+        ctx->memoryAllocator->free(allocation);
+        buffer = VK_NULL_HANDLE;
     }
 
 
@@ -204,7 +213,7 @@ namespace VulkanHelper {
                      VkImageTiling tiling, 
                      VkImageUsageFlags usage, 
                      VkMemoryPropertyFlags properties, 
-                     VkImage& image, VkDeviceMemory& imageMemory,
+                     VkImage& image, Allocation& allocation,
                      VkImageCreateFlags flags) 
     {
         VkImageCreateInfo imageInfo{};
@@ -228,19 +237,20 @@ namespace VulkanHelper {
             return;
         }
     
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(ctx->device, image, &memRequirements);
-    
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(ctx, memRequirements.memoryTypeBits, properties);
-        if (vkAllocateMemory(ctx->device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+        // Large images end up in dedicated allocations, the rest is sub-allocated
+        bool attachment = usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        allocation = ctx->memoryAllocator->allocateForImage(image, properties, attachment ? MemoryCategory::Attachment : MemoryCategory::Texture);
+        if (!allocation.isValid()) {
             spdlog::error("Failed to allocate image memory!");
-            return;
         }
-    
-        vkBindImageMemory(ctx->device, image, imageMemory, 0);
+    }
+
+
+    void destroyImage(const std::shared_ptr<VulkanContext>& ctx, VkImage& image, Allocation& allocation)
+    {
+        if (image != VK_NULL_HANDLE) vkDestroyImage(ctx->device, image, nullptr);
+        ctx->memoryAllocator->free(allocation);
+        image = VK_NULL_HANDLE;
     }
 
 
@@ -321,6 +331,65 @@ namespace VulkanHelper {
     }
 
 
+    void cmdGenerateMipmaps(VkCommandBuffer commandBuffer,
+                            VkImage image,
+                            uint32_t width,
+                            uint32_t height,
+                            uint32_t mipLevels,
+                            uint32_t arrayLayers)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = image;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = arrayLayers;
+        barrier.subresourceRange.levelCount = 1;
+
+        int32_t mipWidth = static_cast<int32_t>(width);
+        int32_t mipHeight = static_cast<int32_t>(height);
+
+        for (uint32_t i = 1; i < mipLevels; i++) {
+            // Wait for the previous mip level to be written, then read from it
+            barrier.subresourceRange.baseMipLevel = i - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = { 0, 0, 0 };
+            blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+            blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, arrayLayers };
+            blit.dstOffsets[0] = { 0, 0, 0 };
+            blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+            blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, arrayLayers };
+            vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+            // The previous level is done
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            if (mipWidth > 1) mipWidth /= 2;
+            if (mipHeight > 1) mipHeight /= 2;
+        }
+
+        // The last level was only written
+        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
     
         SwapChainSupportDetails details;
@@ -362,10 +431,15 @@ namespace VulkanHelper {
             if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
                 indices.graphicsFamily = i;
             }
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
-            if (presentSupport) {
-                indices.presentFamily = i;
+            if (surface == VK_NULL_HANDLE) {
+                // Headless: nothing is presented, so the graphics family doubles as the present family
+                indices.presentFamily = indices.graphicsFamily;
+            } else {
+                VkBool32 presentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+                if (presentSupport) {
+                    indices.presentFamily = i;
+                }
             }
             if (indices.isComplete()) {
                 break;
@@ -440,4 +514,22 @@ namespace VulkanHelper {
         }
     }
 
+    std::string presentModeToString(VkPresentModeKHR presentMode) {
+        switch (presentMode) {
+            case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+            case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+            case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+            default: return "Unknown Present Mode (" + std::to_string(presentMode) + ")";
+        }
+    }
+
+    std::optional<VkPresentModeKHR> presentModeFromString(const std::string& name) {
+        if (name == "immediate") return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        if (name == "mailbox") return VK_PRESENT_MODE_MAILBOX_KHR;
+        if (name == "fifo") return VK_PRESENT_MODE_FIFO_KHR;
+        if (name == "fifo-relaxed") return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        return std::nullopt;
+    }
+
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "stdafx.h"
 #include "VulkanContext.h"
+#include "memory/MemoryAllocator.h"
 
 class VulkanContext;
 
@@ -26,16 +27,23 @@ namespace VulkanHelper {
 
     uint32_t findMemoryType(const std::shared_ptr<VulkanContext>& ctx, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
-    void createBuffer(const std::shared_ptr<VulkanContext>& ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    // Memory comes from the context's MemoryAllocator, host visible allocations are already mapped (Allocation::mapped)
+    void createBuffer(const std::shared_ptr<VulkanContext>& ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation);
+    void destroyBuffer(const std::shared_ptr<VulkanContext>& ctx, VkBuffer& buffer, Allocation& allocation);
     void copyBuffer(const std::shared_ptr<VulkanContext>& ctx, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
     void copyBufferToImage(const std::shared_ptr<VulkanContext>& ctx, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
     void copyBufferToCubemap(const std::shared_ptr<VulkanContext>& ctx, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
     void copyImageToBuffer(const std::shared_ptr<VulkanContext>& ctx, VkImage image, VkBuffer buffer, uint32_t width, uint32_t height);
 
-    void createImage(const std::shared_ptr<VulkanContext>& ctx, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels, uint32_t arrayLayers, VkSampleCountFlagBits numSamples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, VkImageCreateFlags flags = 0);
+    void createImage(const std::shared_ptr<VulkanContext>& ctx, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels, uint32_t arrayLayers, VkSampleCountFlagBits numSamples, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation, VkImageCreateFlags flags = 0);
+    void destroyImage(const std::shared_ptr<VulkanContext>& ctx, VkImage& image, Allocation& allocation);
     VkImageView createImageView(const std::shared_ptr<VulkanContext>& ctx, VkImage image, VkFormat format, uint32_t mipLevels, uint32_t arrayLayers, VkImageAspectFlags aspectFlags, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D);
     void transitionImageLayout(const std::shared_ptr<VulkanContext>& ctx, VkImage image, VkFormat format, uint32_t mipLevels, uint32_t arrayLayers, VkImageLayout oldLayout, VkImageLayout newLayout);
 
+    // Records blits from every mip level to the next. Expects all levels in TRANSFER_DST_OPTIMAL with level 0 written,
+    // leaves them in SHADER_READ_ONLY_OPTIMAL. Needs a graphics queue and a format with linear filter blit support.
+    void cmdGenerateMipmaps(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t arrayLayers);
+
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
 
@@ -45,5 +53,7 @@ namespace VulkanHelper {
     bool hasStencilComponent(VkFormat format);
 
     std::string formatToString(VkFormat format);
+    std::string presentModeToString(VkPresentModeKHR presentMode);
+    std::optional<VkPresentModeKHR> presentModeFromString(const std::string& name);
 
 }
\ No newline at end of file
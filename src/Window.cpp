@@ -1,6 +1,7 @@
 #include "Window.h"
 
 #include "stdafx.h"
+#include "utilities/Tracer.h"
 
 
 Window::Window()
@@ -24,7 +25,7 @@ Window::~Window()
     SDL_Quit();
 }
 
-bool Window::initialize(const std::string& title, const uint16_t width, const uint16_t height)
+bool Window::initialize(const std::string& title, const uint16_t width, const uint16_t height, SwapChainParams swapChainParams, const FramePacerParams& pacerParams)
 {
     // Initialize SDL
     if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS)) {
@@ -44,9 +45,17 @@ bool Window::initialize(const std::string& title, const uint16_t width, const ui
     // Create Vulkan context
     _ctx = std::make_shared<VulkanContext>(_window);
 
+    // Frame pacing
+    _framePacer = FramePacer(pacerParams);
+    spdlog::info("Frame pacing: {}", FramePacer::modeToString(pacerParams.mode));
+    _presentModeForced = swapChainParams.presentMode.has_value();
+    if (!_presentModeForced) {
+        swapChainParams.presentMode = _framePacer.getPreferredPresentMode();
+    }
+
     // Create the Vulkan renderer
     _renderer = std::make_unique<Renderer>(_ctx);
-    _renderer->initialize();
+    _renderer->initialize(swapChainParams);
 
     // Always on top
     //SDL_SetWindowAlwaysOnTop(_window, true);
@@ -67,23 +76,33 @@ void Window::startRenderingLoop()
     bool isPaused = false;
     
     while (isRunning) {
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-                case SDL_EVENT_QUIT:
-                    isRunning = false;
-                    break;
-                case SDL_EVENT_WINDOW_MINIMIZED:
-                    isPaused = true; // Pause rendering when the window is minimized
-                    break;
-                case SDL_EVENT_WINDOW_RESTORED:
-                    isPaused = false; // Resume rendering when the window is restored
-                    break;
+        TRACE_SCOPE("Frame");
+
+        {
+            TRACE_SCOPE("PollEvents");
+            while (SDL_PollEvent(&event)) {
+                switch (event.type) {
+                    case SDL_EVENT_QUIT:
+                        isRunning = false;
+                        break;
+                    case SDL_EVENT_WINDOW_MINIMIZED:
+                        isPaused = true; // Pause rendering when the window is minimized
+                        break;
+                    case SDL_EVENT_WINDOW_RESTORED:
+                        isPaused = false; // Resume rendering when the window is restored
+                        break;
+                }
             }
         }
 
         if(!isPaused) _renderer->drawFrame(); // Call the renderer's drawFrame method
 
-        SDL_Delay(16); // Simulate a frame delay (60 FPS)
+        // Wait according to the pacing mode (no-op when uncapped or display synced)
+        if (isPaused) {
+            SDL_Delay(16); // Nothing to render, do not spin while minimized
+        } else {
+            _framePacer.waitForNextFrame();
+        }
     }
 }
 
@@ -188,4 +207,38 @@ void Window::onKeyDown(int key, int scancode, int modifiers)
     if (key == SDLK_A) {
         spdlog::info("Key A pressed");
     }
+
+    // Dump GPU pass timings
+    if (key == SDLK_P) {
+        _renderer->logGpuTimings();
+    }
+
+    // Cycle frame pacing mode (uncapped -> target FPS -> display synced)
+    if (key == SDLK_F) {
+        switch (_framePacer.getMode()) {
+            case PacingMode::Uncapped: _framePacer.setMode(PacingMode::TargetFps); break;
+            case PacingMode::TargetFps: _framePacer.setMode(PacingMode::DisplaySynced); break;
+            case PacingMode::DisplaySynced: _framePacer.setMode(PacingMode::Uncapped); break;
+        }
+        // The present mode follows the pacing (FIFO only when display synced), unless it was given on the command line
+        if (!_presentModeForced) {
+            _renderer->setPresentMode(_framePacer.getPreferredPresentMode());
+        } else if (_framePacer.getMode() == PacingMode::DisplaySynced && _renderer->getSwapChain()->getPresentMode() != VK_PRESENT_MODE_FIFO_KHR) {
+            spdlog::warn("Present mode is {}, display synced pacing will not throttle (set by --present-mode)", VulkanHelper::presentModeToString(_renderer->getSwapChain()->getPresentMode()));
+        }
+        spdlog::info("Average frame time: {:.2f} ms", _framePacer.getAverageFrameTimeMs());
+    }
+
+    // Toggle parallel command recording
+    if (key == SDLK_R) {
+        _renderer->setParallelRecording(!_renderer->isParallelRecording());
+    }
+
+    // Dump the CPU timeline
+    if (key == SDLK_T) {
+        Tracer::getInstance()->dumpChromeTrace("trace.json");
+    }
+
+    // Everything else is up to the scene (B: raster / compute bloom blur, C: CPU / GPU culled instances)
+    _renderer->handleKeyDown(key);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "stdafx.h"
 #include "Renderer.h"
+#include "FramePacer.h"
 
 class Window
 {
@@ -9,6 +10,8 @@ protected:
     SDL_Window* _window = nullptr;
     std::shared_ptr<VulkanContext> _ctx = nullptr;
     std::unique_ptr<Renderer> _renderer = nullptr;
+    FramePacer _framePacer;
+    bool _presentModeForced = false;    // --present-mode given, pacing changes keep it
 
     static bool eventCallback(void *userdata, SDL_Event *event);
 
@@ -32,6 +35,7 @@ public:
     Window(const Window&) = delete;
     Window& operator=(const Window&) = delete;
 
-    bool initialize(const std::string& title, const uint16_t width, const uint16_t height);
+    // If swapChainParams has no present mode, the one matching the pacing mode is used
+    bool initialize(const std::string& title, const uint16_t width, const uint16_t height, SwapChainParams swapChainParams = {}, const FramePacerParams& pacerParams = {});
     void startRenderingLoop();
 };
\ No newline at end of file
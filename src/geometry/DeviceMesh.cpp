@@ -1,57 +1,37 @@
 #include "DeviceMesh.h"
 #include "../VulkanHelper.h"
+#include "../utilities/Tracer.h"
 
 DeviceMesh::DeviceMesh(std::shared_ptr<VulkanContext> ctx, const HostMesh& mesh)
     : _ctx(std::move(ctx))
 {
+    TRACE_SCOPE_CAT("DeviceMesh", "asset");
+
     _indexCount = static_cast<uint32_t>(mesh.indices.size());
     createVertexBuffer(mesh);
     createIndexBuffer(mesh);
 }
 
 DeviceMesh::~DeviceMesh() {
-    vkDestroyBuffer(_ctx->device, _vertexBuffer, nullptr);
-    vkFreeMemory(_ctx->device, _vertexBufferMemory, nullptr);
-
-    vkDestroyBuffer(_ctx->device, _indexBuffer, nullptr);
-    vkFreeMemory(_ctx->device, _indexBufferMemory, nullptr);
+    _uploadFuture.wait();
+    VulkanHelper::destroyBuffer(_ctx, _vertexBuffer, _vertexBufferAllocation);
+    VulkanHelper::destroyBuffer(_ctx, _indexBuffer, _indexBufferAllocation);
 }
 
 void DeviceMesh::createVertexBuffer(const HostMesh& mesh)
 {
-        // Create Vertex Buffer
-        VkDeviceSize bufferSize = sizeof(mesh.vertices[0]) * mesh.vertices.size(); // Size of the vertex buffer
+    // Create Vertex Buffer
+    VkDeviceSize bufferSize = sizeof(mesh.vertices[0]) * mesh.vertices.size(); // Size of the vertex buffer
+
+    VulkanHelper::createBuffer(_ctx,
+        bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        _vertexBuffer, _vertexBufferAllocation);
 
-        // Create staging buffer which is visible by both GPU and CPU
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        VulkanHelper::createBuffer(_ctx,
-            bufferSize, 
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-            stagingBuffer, stagingBufferMemory);
-    
-        void* data;
-        // Map the buffer memory into CPU addressable space
-        vkMapMemory(_ctx->device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        // Copy the vertex data to the mapped memory
-        memcpy(data, mesh.vertices.data(), (size_t)bufferSize);
-        // Unmap the memory
-        vkUnmapMemory(_ctx->device, stagingBufferMemory); 
-    
-        // Create the vertex buffer
-        VulkanHelper::createBuffer(_ctx,
-            bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            _vertexBuffer, _vertexBufferMemory);
-    
-        // Copy the data from the staging buffer to the vertex buffer
-        VulkanHelper::copyBuffer(_ctx, stagingBuffer, _vertexBuffer, bufferSize);
-    
-        // Cleanup staging buffer
-        vkDestroyBuffer(_ctx->device, stagingBuffer, nullptr); // Destroy the staging buffer
-        vkFreeMemory(_ctx->device, stagingBufferMemory, nullptr); // Free the staging buffer memory
+    // Staged and copied with the other uploads of the batch
+    _uploadFuture = _ctx->uploadManager->uploadBuffer(_vertexBuffer, mesh.vertices.data(), bufferSize, 0,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 }
 
 void DeviceMesh::createIndexBuffer(const HostMesh& mesh)
@@ -59,34 +39,13 @@ void DeviceMesh::createIndexBuffer(const HostMesh& mesh)
     // Create Index Buffer
     VkDeviceSize bufferSize = sizeof(mesh.indices[0]) * mesh.indices.size(); // Size of the index buffer
 
-    // Create staging buffer which is visible by both GPU and CPU
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    VulkanHelper::createBuffer(_ctx,
-        bufferSize, 
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-        stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    // Map the buffer memory into CPU addressable space
-    vkMapMemory(_ctx->device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    // Copy the index data to the mapped memory
-    memcpy(data, mesh.indices.data(), (size_t)bufferSize);
-    // Unmap the memory
-    vkUnmapMemory(_ctx->device, stagingBufferMemory); 
-
-    // Create the index buffer
     VulkanHelper::createBuffer(_ctx,
         bufferSize,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        _indexBuffer, _indexBufferMemory);
-
-    // Copy the data from the staging buffer to the index buffer
-    VulkanHelper::copyBuffer(_ctx, stagingBuffer, _indexBuffer, bufferSize);
+        _indexBuffer, _indexBufferAllocation);
 
-    // Cleanup staging buffer
-    vkDestroyBuffer(_ctx->device, stagingBuffer, nullptr); // Destroy the staging buffer
-    vkFreeMemory(_ctx->device, stagingBufferMemory, nullptr); // Free the staging buffer memory
+    // Queued after the vertex buffer, so this future covers both
+    _uploadFuture = _ctx->uploadManager->uploadBuffer(_indexBuffer, mesh.indices.data(), bufferSize, 0,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
 }
\ No newline at end of file
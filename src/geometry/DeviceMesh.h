@@ -13,16 +13,21 @@ public:
     uint32_t getIndicesCount() const { return _indexCount; }
     VkBuffer getVertexBuffer() const { return _vertexBuffer; }
     VkBuffer getIndexBuffer() const { return _indexBuffer; }
+
+    // Usable by frames submitted from now on, this tells when the GPU copy has finished
+    bool isReady() const { return _uploadFuture.isReady(); }
     
 private:
     std::shared_ptr<VulkanContext> _ctx;
 
     VkBuffer _vertexBuffer;
-    VkDeviceMemory _vertexBufferMemory;
+    Allocation _vertexBufferAllocation;
     VkBuffer _indexBuffer;
-    VkDeviceMemory _indexBufferMemory;
+    Allocation _indexBufferAllocation;
     uint32_t _indexCount;
 
+    UploadFuture _uploadFuture;
+
     void createVertexBuffer(const HostMesh& mesh);
     void createIndexBuffer(const HostMesh& mesh);
 };
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "AssetPack.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+AssetPack::~AssetPack()
+{
+    close();
+}
+
+
+bool AssetPack::open(const std::string& path)
+{
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    _mapped = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!_mapped) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    _mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    _fileHandle = file;
+    _mappingHandle = mapping;
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size <= 0) {
+        ::close(file);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file); // The mapping keeps the file alive
+    if (mapped == MAP_FAILED) return false;
+
+    // Payloads are laid out in first use order, so the whole file is read ahead front to back
+    madvise(mapped, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+    madvise(mapped, static_cast<size_t>(fileStat.st_size), MADV_WILLNEED);
+
+    _mapped = static_cast<const uint8_t*>(mapped);
+    _mappedSize = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    Header header;
+    if (_mappedSize < sizeof(Header)) {
+        spdlog::error("Asset pack is truncated: {}", path);
+        close();
+        return false;
+    }
+    memcpy(&header, _mapped, sizeof(Header));
+
+    const size_t indexEnd = sizeof(Header) + static_cast<size_t>(header.entryCount) * sizeof(Entry);
+    if (header.magic != Magic || header.version != Version || indexEnd > _mappedSize ||
+        header.stringsOffset > _mappedSize || header.stringsSize > _mappedSize - header.stringsOffset) {
+        spdlog::error("Not a valid asset pack (version {}): {}", Version, path);
+        close();
+        return false;
+    }
+
+    _entries = reinterpret_cast<const Entry*>(_mapped + sizeof(Header));
+    _entryCount = header.entryCount;
+    _strings = reinterpret_cast<const char*>(_mapped + header.stringsOffset);
+
+    for (uint32_t i = 0; i < _entryCount; i++) {
+        const Entry& entry = _entries[i];
+        if (entry.offset > _mappedSize || entry.size > _mappedSize - entry.offset ||
+            static_cast<uint64_t>(entry.pathOffset) + entry.pathLength > header.stringsSize) {
+            spdlog::error("Asset pack entry {} is out of bounds: {}", i, path);
+            close();
+            return false;
+        }
+    }
+
+    spdlog::info("Asset pack opened successfully ({}, {} assets, {:.1f} MB)", path, _entryCount, _mappedSize / (1024.0 * 1024.0));
+    return true;
+}
+
+
+void AssetPack::close()
+{
+    if (!_mapped) return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(_mapped);
+    CloseHandle(static_cast<HANDLE>(_mappingHandle));
+    CloseHandle(static_cast<HANDLE>(_fileHandle));
+    _fileHandle = nullptr;
+    _mappingHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(_mapped), _mappedSize);
+#endif
+
+    _mapped = nullptr;
+    _mappedSize = 0;
+    _entries = nullptr;
+    _entryCount = 0;
+    _strings = nullptr;
+}
+
+
+AssetView AssetPack::find(const std::string& path)
+{
+    const std::string key = normalizePath(path);
+
+    if (_recording) {
+        std::lock_guard<std::mutex> lock(_recordMutex);
+        if (_recordedPaths.insert(key).second) _recordedOrder.push_back(key);
+    }
+
+    if (!_mapped) return {};
+
+    const uint64_t hash = hashPath(key);
+    const Entry* end = _entries + _entryCount;
+    const Entry* it = std::lower_bound(_entries, end, hash, [](const Entry& entry, uint64_t value) { return entry.pathHash < value; });
+    for (; it != end && it->pathHash == hash; ++it) {
+        if (key.compare(0, std::string::npos, _strings + it->pathOffset, it->pathLength) == 0) {
+            return { _mapped + it->offset, static_cast<size_t>(it->size) };
+        }
+    }
+    return {};
+}
+
+
+void AssetPack::startRecording()
+{
+    _recording = true;
+}
+
+
+bool AssetPack::saveRecordedOrder(const std::string& path) const
+{
+    std::lock_guard<std::mutex> lock(_recordMutex);
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        spdlog::error("Failed to write asset order file: {}", path);
+        return false;
+    }
+    for (const auto& recordedPath : _recordedOrder) {
+        file << recordedPath << '\n';
+    }
+    spdlog::info("Asset first use order saved to file: {} ({} paths)", path, _recordedOrder.size());
+    return true;
+}
+
+
+std::string AssetPack::normalizePath(const std::string& path)
+{
+    std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+    if (normalized.rfind("./", 0) == 0) normalized.erase(0, 2);
+    return normalized;
+}
+
+
+uint64_t AssetPack::hashPath(const std::string& normalizedPath)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : normalizedPath) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "../stdafx.h"
+#include "../utilities/Singleton.h"
+#include <atomic>
+#include <mutex>
+
+
+// Bytes of one asset inside the mapped pack, valid until the pack is closed
+struct AssetView
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    explicit operator bool() const { return data != nullptr; }
+};
+
+
+// Every asset of the engine in one file, memory mapped. Loaders ask it for a relative path ("textures/earth/...")
+// first and read the loose file only when the pack does not have it (or no pack is open), so development works
+// without repacking. Payloads are read straight from the mapping, e.g. into the upload staging ring.
+//
+// Layout (little endian):
+//   Header
+//   Entry[entryCount]      sorted by pathHash, looked up by binary search
+//   path strings           to tell hash collisions apart
+//   payloads               each aligned to Alignment, in the order the packer was given (first use first)
+//
+// It also records the order in which paths are first asked for, which the AssetPacker uses to lay out the
+// payloads so a cold start reads the file front to back.
+class AssetPack : public Singleton<AssetPack>
+{
+    friend class Singleton<AssetPack>;
+
+public:
+    static constexpr uint32_t Magic = 0x4B504556; // "VEPK"
+    static constexpr uint32_t Version = 1;
+    static constexpr uint64_t Alignment = 64;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+
+    struct Entry {
+        uint64_t pathHash;
+        uint64_t offset;        // From the start of the file
+        uint64_t size;
+        uint32_t pathOffset;    // Into the path strings
+        uint32_t pathLength;
+    };
+
+    ~AssetPack();
+
+    // Maps the pack, replacing the one open before. False if the file is missing or invalid.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return _mapped != nullptr; }
+
+    // The asset, or an empty view when it is not in the pack
+    AssetView find(const std::string& path);
+
+    // Records the paths asked for from now on, in first use order
+    void startRecording();
+    bool saveRecordedOrder(const std::string& path) const;
+
+    // Key of a path: forward slashes, no "./" and ".." parts
+    static std::string normalizePath(const std::string& path);
+    static uint64_t hashPath(const std::string& normalizedPath);
+
+private:
+    AssetPack() = default;
+
+    const uint8_t* _mapped = nullptr;
+    size_t _mappedSize = 0;
+#if defined(_WIN32)
+    void* _fileHandle = nullptr;
+    void* _mappingHandle = nullptr;
+#endif
+
+    const Entry* _entries = nullptr;
+    uint32_t _entryCount = 0;
+    const char* _strings = nullptr;
+
+    std::atomic<bool> _recording{false};
+    mutable std::mutex _recordMutex;
+    std::vector<std::string> _recordedOrder;
+    std::unordered_set<std::string> _recordedPaths;
+};
@@ -0,0 +1,382 @@
+#include "AsyncFileReader.h"
+#include "../utilities/Tracer.h"
+
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+    #define IO_URING_AVAILABLE 1
+#else
+    #define IO_URING_AVAILABLE 0
+#endif
+
+
+#if IO_URING_AVAILABLE
+namespace {
+
+    // No liburing, the three syscalls and the shared rings are all it takes
+    int ioUringSetup(uint32_t entries, io_uring_params* params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int ringFd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+}
+#endif
+
+
+AsyncFileReader::AsyncFileReader()
+{
+    if (initializeRing()) {
+        _completionThread = std::thread(&AsyncFileReader::completionLoop, this);
+        spdlog::info("Async file reader created successfully (io_uring, {} reads in flight)", _params.queueDepth);
+        return;
+    }
+
+    for (uint32_t i = 0; i < _params.fallbackThreads; i++) {
+        _readerThreads.emplace_back(&AsyncFileReader::readerLoop, this);
+    }
+    spdlog::info("Async file reader created successfully ({} reader threads)", _params.fallbackThreads);
+}
+
+
+AsyncFileReader::~AsyncFileReader()
+{
+    // Callbacks of reads still in flight may refer to things that are being destroyed, let them finish first
+    bool ringFailed = false;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _slotCondition.wait(lock, [this]() { return _inFlight == 0; });
+        _stopping = true;
+        ringFailed = _ringFailed;
+    }
+
+    if (isUsingIoUring()) {
+#if IO_URING_AVAILABLE
+        if (ringFailed) {
+            // The completion thread is in readerLoop
+            _queueCondition.notify_all();
+        } else {
+            // A no-op wakes the completion thread up so it sees _stopping
+            std::lock_guard<std::mutex> lock(_mutex);
+            uint32_t tail = *_sqTail;
+            uint32_t index = tail & _sqMask;
+            io_uring_sqe* sqe = static_cast<io_uring_sqe*>(_sqes) + index;
+            memset(sqe, 0, sizeof(io_uring_sqe));
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = 0;
+            _sqArray[index] = index;
+            __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+            ioUringEnter(_ringFd, 1, 0, 0);
+        }
+#endif
+        _completionThread.join();
+        destroyRing();
+    } else {
+        _queueCondition.notify_all();
+        for (auto& thread : _readerThreads) thread.join();
+    }
+}
+
+
+std::future<FileReadResult> AsyncFileReader::read(const std::string& path)
+{
+    auto promise = std::make_shared<std::promise<FileReadResult>>();
+    std::future<FileReadResult> future = promise->get_future();
+    read(path, [promise](FileReadResult& result) { promise->set_value(std::move(result)); });
+    return future;
+}
+
+
+void AsyncFileReader::read(const std::string& path, Callback callback)
+{
+    Request* request = new Request();
+    request->result.path = path;
+    request->callback = std::move(callback);
+    start(request);
+}
+
+
+void AsyncFileReader::read(const std::string& path, uint64_t offset, size_t size, Callback callback)
+{
+    Request* request = new Request();
+    request->result.path = path;
+    request->result.data.resize(size);
+    request->callback = std::move(callback);
+    request->wholeFile = false;
+    request->fileOffset = offset;
+    start(request);
+}
+
+
+void AsyncFileReader::start(Request* request)
+{
+    if (!isUsingIoUring()) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _inFlight++;
+            _queue.push_back(request);
+        }
+        _queueCondition.notify_one();
+        return;
+    }
+
+#if IO_URING_AVAILABLE
+    // Opening is synchronous, the size decides the buffer
+    request->fd = ::open(request->result.path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat fileStat;
+    if (request->fd < 0 || fstat(request->fd, &fileStat) != 0) {
+        complete(request);
+        return;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(fileStat.st_size);
+    if (request->wholeFile) {
+        request->result.data.resize(static_cast<size_t>(fileSize));
+    } else if (request->fileOffset > fileSize || request->result.data.size() > fileSize - request->fileOffset) {
+        complete(request);
+        return;
+    }
+    if (request->result.data.empty()) {
+        request->result.success = true;
+        complete(request);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _slotCondition.wait(lock, [this]() { return _ringFailed || _inFlight < _params.queueDepth; });
+    _inFlight++;
+    if (_ringFailed) {
+        _queue.push_back(request);
+        lock.unlock();
+        _queueCondition.notify_one();
+        return;
+    }
+    _submitted.insert(request);
+    submitRead(request);
+#endif
+}
+
+
+bool AsyncFileReader::initializeRing()
+{
+#if IO_URING_AVAILABLE
+    io_uring_params params{};
+    int ringFd = ioUringSetup(_params.queueDepth, &params);
+    if (ringFd < 0) {
+        spdlog::warn("io_uring is not available (error {}), reading files on threads", errno);
+        return false;
+    }
+
+    // The completion queue gets twice the entries, every read has at most one entry in flight
+    _params.queueDepth = std::min(_params.queueDepth, params.sq_entries);
+
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+
+    _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    _cqRing = singleMmap ? _sqRing : mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    _ringFd = ringFd;
+
+    if (_sqRing == MAP_FAILED || _cqRing == MAP_FAILED || _sqes == MAP_FAILED) {
+        spdlog::warn("Failed to map the io_uring queues, reading files on threads");
+        destroyRing();
+        return false;
+    }
+
+    uint8_t* sq = static_cast<uint8_t*>(_sqRing);
+    _sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    _sqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    _sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+
+    uint8_t* cq = static_cast<uint8_t*>(_cqRing);
+    _cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    _cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    _cqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    _cqes = cq + params.cq_off.cqes;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+void AsyncFileReader::destroyRing()
+{
+#if IO_URING_AVAILABLE
+    if (_sqes && _sqes != MAP_FAILED) munmap(_sqes, _sqesSize);
+    if (_cqRing && _cqRing != MAP_FAILED && _cqRing != _sqRing) munmap(_cqRing, _cqRingSize);
+    if (_sqRing && _sqRing != MAP_FAILED) munmap(_sqRing, _sqRingSize);
+    if (_ringFd >= 0) ::close(_ringFd);
+#endif
+    _sqes = _cqRing = _sqRing = nullptr;
+    _ringFd = -1;
+}
+
+
+void AsyncFileReader::submitRead(Request* request)
+{
+#if IO_URING_AVAILABLE
+    // Whatever is left to read, short reads come back here for the rest
+    request->iovec.base = request->result.data.data() + request->bytesRead;
+    request->iovec.length = request->result.data.size() - request->bytesRead;
+
+    uint32_t tail = *_sqTail;
+    uint32_t index = tail & _sqMask;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(_sqes) + index;
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = IORING_OP_READV; // Plain READ needs a newer kernel
+    sqe->fd = request->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&request->iovec);
+    sqe->len = 1;
+    sqe->off = request->fileOffset + request->bytesRead;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    _sqArray[index] = index;
+    __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    while (ioUringEnter(_ringFd, 1, 0, 0) < 0 && errno == EINTR) {}
+#else
+    (void)request;
+#endif
+}
+
+
+void AsyncFileReader::completionLoop()
+{
+#if IO_URING_AVAILABLE
+    Tracer::getInstance()->setThreadName("File reader");
+
+    while (true) {
+        if (ioUringEnter(_ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            spdlog::error("Failed to wait for io_uring completions (error {}), reading files on a thread", errno);
+            failRing();
+            readerLoop();
+            return;
+        }
+
+        uint32_t head = *_cqHead;
+        const uint32_t tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+        bool wokenUp = false;
+
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = static_cast<io_uring_cqe*>(_cqes)[head & _cqMask];
+            Request* request = reinterpret_cast<Request*>(cqe.user_data);
+            if (!request) {
+                wokenUp = true;
+                continue;
+            }
+
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                submitRead(request);
+                continue;
+            }
+            if (cqe.res > 0) {
+                request->bytesRead += static_cast<size_t>(cqe.res);
+                if (request->bytesRead < request->result.data.size()) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    submitRead(request);
+                    continue;
+                }
+                request->result.success = true;
+            }
+
+            // Done, or failed (0 is an unexpected end of file)
+            complete(request);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _submitted.erase(request);
+                _inFlight--;
+            }
+            _slotCondition.notify_all();
+        }
+        __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+
+        if (wokenUp && _stopping) return;
+    }
+#endif
+}
+
+
+void AsyncFileReader::failRing()
+{
+    // The reads in the ring never complete, they fail and later ones go to readerLoop on the completion thread
+    std::vector<Request*> lost;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ringFailed = true;
+        lost.assign(_submitted.begin(), _submitted.end());
+        _submitted.clear();
+    }
+
+    for (Request* request : lost) {
+        request->result.success = false;
+        complete(request);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _inFlight -= static_cast<uint32_t>(lost.size());
+    }
+    _slotCondition.notify_all();
+}
+
+
+void AsyncFileReader::readerLoop()
+{
+    while (true) {
+        Request* request;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _queueCondition.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+            if (_queue.empty()) return;
+            request = _queue.front();
+            _queue.pop_front();
+        }
+
+        {
+            TRACE_SCOPE_CAT("Read " + std::filesystem::path(request->result.path).filename().string(), "asset");
+            std::ifstream file(request->result.path, std::ios::binary | std::ios::ate);
+            if (file.is_open()) {
+                if (request->wholeFile) request->result.data.resize(static_cast<size_t>(file.tellg()));
+                file.seekg(static_cast<std::streamoff>(request->fileOffset));
+                file.read(reinterpret_cast<char*>(request->result.data.data()), request->result.data.size());
+                request->result.success = static_cast<bool>(file);
+            }
+        }
+
+        complete(request);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _inFlight--;
+        }
+        _slotCondition.notify_all();
+    }
+}
+
+
+void AsyncFileReader::complete(Request* request)
+{
+#if IO_URING_AVAILABLE
+    if (request->fd >= 0) ::close(request->fd);
+#endif
+    if (!request->result.success) {
+        spdlog::error("Failed to read file: {}", request->result.path);
+        request->result.data.clear();
+    }
+    request->callback(request->result);
+    delete request;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "../stdafx.h"
+#include "../utilities/Singleton.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+
+
+// A file (or a range of it) read by the AsyncFileReader
+struct FileReadResult
+{
+    std::string path;
+    std::vector<uint8_t> data;
+    bool success = false;
+};
+
+
+struct AsyncFileReaderParams
+{
+    // Reads in flight at once (io_uring queue depth), further reads wait for a free slot
+    uint32_t queueDepth = 64;
+
+    // Threads doing blocking reads when io_uring is not available
+    uint32_t fallbackThreads = 8;
+};
+
+
+// Reads whole files with many reads in flight at once, so slow disks (network, cold cache) are not waited on one
+// file after the other. On Linux the reads go through an io_uring, one completion thread reaps them. Elsewhere (or
+// when the kernel refuses io_uring) a few dedicated threads do blocking reads. They are not the engine's thread pool
+// on purpose: its workers may be waiting on these reads.
+//
+// Callbacks run on the completion / reader thread. Keep them short and hand the decoding to the thread pool.
+// Assets in the AssetPack are mapped already, callers look there first.
+class AsyncFileReader : public Singleton<AsyncFileReader>
+{
+    friend class Singleton<AsyncFileReader>;
+
+public:
+    using Callback = std::function<void(FileReadResult& result)>;
+
+    ~AsyncFileReader();
+
+    void read(const std::string& path, Callback callback);
+    std::future<FileReadResult> read(const std::string& path);
+
+    // size bytes from offset on, fails if the file is shorter
+    void read(const std::string& path, uint64_t offset, size_t size, Callback callback);
+
+    bool isUsingIoUring() const { return _ringFd >= 0; }
+
+private:
+    AsyncFileReader();
+
+    AsyncFileReaderParams _params;
+
+    struct Request {
+        FileReadResult result;
+        Callback callback;
+        int fd = -1;
+        bool wholeFile = true;
+        uint64_t fileOffset = 0;
+        size_t bytesRead = 0;
+        struct { void* base; size_t length; } iovec;   // Layout of struct iovec, for readv
+    };
+
+    std::mutex _mutex;
+    std::condition_variable _slotCondition;     // A read finished, a slot is free
+    uint32_t _inFlight = 0;
+    std::atomic<bool> _stopping{false};
+
+    // [io_uring]
+    int _ringFd = -1;
+    void* _sqRing = nullptr;
+    size_t _sqRingSize = 0;
+    void* _cqRing = nullptr;
+    size_t _cqRingSize = 0;
+    void* _sqes = nullptr;
+    size_t _sqesSize = 0;
+    uint32_t* _sqTail = nullptr;
+    uint32_t _sqMask = 0;
+    uint32_t* _sqArray = nullptr;
+    uint32_t* _cqHead = nullptr;
+    uint32_t* _cqTail = nullptr;
+    uint32_t _cqMask = 0;
+    void* _cqes = nullptr;
+    std::thread _completionThread;
+    std::unordered_set<Request*> _submitted;    // Reads in the ring, under _mutex
+    bool _ringFailed = false;                   // The completion thread reads on its own since, under _mutex
+
+    bool initializeRing();
+    void destroyRing();
+    void start(Request* request);
+    void submitRead(Request* request); // Under _mutex
+    void completionLoop();
+    void failRing();
+
+    // [Fallback]
+    std::vector<std::thread> _readerThreads;
+    std::deque<Request*> _queue;
+    std::condition_variable _queueCondition;
+    void readerLoop();
+
+    void complete(Request* request);
+};
@@ -0,0 +1,485 @@
+#include "BlockCompression.h"
+#include "../utilities/ThreadPool.h"
+#include <atomic>
+#include <cfloat>
+#include <climits>
+
+
+namespace BlockCompression {
+
+    namespace {
+
+        using Block = std::array<std::array<uint8_t, 4>, 16>; // 4x4 RGBA texels, row by row
+
+        // Texels outside the image repeat the last row / column
+        void fetchBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+        {
+            for (uint32_t y = 0; y < 4; y++) {
+                uint32_t sy = std::min(blockY * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; x++) {
+                    uint32_t sx = std::min(blockX * 4 + x, width - 1);
+                    memcpy(block[y * 4 + x].data(), rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                }
+            }
+        }
+
+        void storeBlock(uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, const Block& block)
+        {
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++) {
+                for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++) {
+                    memcpy(rgba + (static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x) * 4, block[y * 4 + x].data(), 4);
+                }
+            }
+        }
+
+        // Endpoints along the principal axis of the first channelCount channels (least squares fit of a line)
+        void fitLine(const Block& block, int channelCount, float* start, float* end)
+        {
+            float mean[4] = {};
+            for (const auto& texel : block) {
+                for (int c = 0; c < channelCount; c++) mean[c] += texel[c] / 16.f;
+            }
+
+            float covariance[4][4] = {};
+            for (const auto& texel : block) {
+                for (int i = 0; i < channelCount; i++) {
+                    for (int j = 0; j < channelCount; j++) {
+                        covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+                    }
+                }
+            }
+
+            // Power iteration converges to the main eigenvector quickly enough for 16 points
+            float axis[4] = { 1.f, 1.f, 1.f, 1.f };
+            for (int iteration = 0; iteration < 8; iteration++) {
+                float next[4] = {};
+                float length = 0.f;
+                for (int i = 0; i < channelCount; i++) {
+                    for (int j = 0; j < channelCount; j++) next[i] += covariance[i][j] * axis[j];
+                    length += next[i] * next[i];
+                }
+                if (length < 1e-12f) break; // Flat block, any axis does
+                length = std::sqrt(length);
+                for (int i = 0; i < channelCount; i++) axis[i] = next[i] / length;
+            }
+
+            float minT = FLT_MAX;
+            float maxT = -FLT_MAX;
+            for (const auto& texel : block) {
+                float t = 0.f;
+                for (int c = 0; c < channelCount; c++) t += (texel[c] - mean[c]) * axis[c];
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+
+            for (int c = 0; c < channelCount; c++) {
+                start[c] = std::clamp(mean[c] + axis[c] * minT, 0.f, 255.f);
+                end[c] = std::clamp(mean[c] + axis[c] * maxT, 0.f, 255.f);
+            }
+        }
+
+        int squaredDistance(const uint8_t* a, const uint8_t* b, int channelCount)
+        {
+            int sum = 0;
+            for (int c = 0; c < channelCount; c++) {
+                int d = static_cast<int>(a[c]) - static_cast<int>(b[c]);
+                sum += d * d;
+            }
+            return sum;
+        }
+
+
+        // [BC1]
+
+        uint16_t packRGB565(const float* color)
+        {
+            uint16_t r = static_cast<uint16_t>(std::lround(color[0] * 31.f / 255.f));
+            uint16_t g = static_cast<uint16_t>(std::lround(color[1] * 63.f / 255.f));
+            uint16_t b = static_cast<uint16_t>(std::lround(color[2] * 31.f / 255.f));
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        void unpackRGB565(uint16_t color, uint8_t* rgb)
+        {
+            uint8_t r = (color >> 11) & 31;
+            uint8_t g = (color >> 5) & 63;
+            uint8_t b = color & 31;
+            rgb[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+            rgb[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+            rgb[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+        }
+
+        void bc1Palette(uint16_t color0, uint16_t color1, uint8_t palette[4][4])
+        {
+            unpackRGB565(color0, palette[0]);
+            unpackRGB565(color1, palette[1]);
+            palette[0][3] = palette[1][3] = 255;
+            for (int c = 0; c < 3; c++) {
+                if (color0 > color1) {
+                    palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+                    palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+                } else {
+                    palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+                    palette[3][c] = 0;
+                }
+            }
+            palette[2][3] = 255;
+            palette[3][3] = color0 > color1 ? 255 : 0; // Transparent black in 3 color mode
+        }
+
+        void encodeBC1(const Block& block, uint8_t* out)
+        {
+            float start[4], end[4];
+            fitLine(block, 3, start, end);
+
+            uint16_t color0 = packRGB565(end);
+            uint16_t color1 = packRGB565(start);
+            if (color0 < color1) std::swap(color0, color1); // 4 color mode
+
+            uint8_t palette[4][4];
+            bc1Palette(color0, color1, palette);
+
+            uint32_t indices = 0;
+            if (color0 != color1) {
+                for (int i = 0; i < 16; i++) {
+                    int best = 0;
+                    int bestDistance = INT_MAX;
+                    for (int p = 0; p < 4; p++) {
+                        int distance = squaredDistance(block[i].data(), palette[p], 3);
+                        if (distance < bestDistance) {
+                            bestDistance = distance;
+                            best = p;
+                        }
+                    }
+                    indices |= static_cast<uint32_t>(best) << (2 * i);
+                }
+            }
+
+            memcpy(out, &color0, 2);
+            memcpy(out + 2, &color1, 2);
+            memcpy(out + 4, &indices, 4);
+        }
+
+        void decodeBC1(const uint8_t* in, Block& block)
+        {
+            uint16_t color0, color1;
+            uint32_t indices;
+            memcpy(&color0, in, 2);
+            memcpy(&color1, in + 2, 2);
+            memcpy(&indices, in + 4, 4);
+
+            uint8_t palette[4][4];
+            bc1Palette(color0, color1, palette);
+            for (int i = 0; i < 16; i++) {
+                memcpy(block[i].data(), palette[(indices >> (2 * i)) & 3], 4);
+            }
+        }
+
+
+        // [BC4] (one channel, BC5 is two of these)
+
+        void encodeBC4(const Block& block, int channel, uint8_t* out)
+        {
+            uint8_t minValue = 255;
+            uint8_t maxValue = 0;
+            for (const auto& texel : block) {
+                minValue = std::min(minValue, texel[channel]);
+                maxValue = std::max(maxValue, texel[channel]);
+            }
+
+            // red0 > red1 selects the 8 value mode: index 0 is red0, 1 is red1, 2..7 step from red0 to red1
+            uint64_t bits = 0;
+            if (maxValue > minValue) {
+                for (int i = 0; i < 16; i++) {
+                    int step = static_cast<int>(std::lround((block[i][channel] - minValue) * 7.f / (maxValue - minValue)));
+                    uint64_t index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+                    bits |= index << (3 * i);
+                }
+            }
+
+            out[0] = maxValue;
+            out[1] = minValue;
+            for (int i = 0; i < 6; i++) {
+                out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+            }
+        }
+
+        void decodeBC4(const uint8_t* in, int channel, Block& block)
+        {
+            uint8_t palette[8];
+            palette[0] = in[0];
+            palette[1] = in[1];
+            if (palette[0] > palette[1]) {
+                for (int i = 2; i < 8; i++) palette[i] = static_cast<uint8_t>(((8 - i) * palette[0] + (i - 1) * palette[1]) / 7);
+            } else {
+                for (int i = 2; i < 6; i++) palette[i] = static_cast<uint8_t>(((6 - i) * palette[0] + (i - 1) * palette[1]) / 5);
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+
+            uint64_t bits = 0;
+            for (int i = 0; i < 6; i++) {
+                bits |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+            }
+            for (int i = 0; i < 16; i++) {
+                block[i][channel] = palette[(bits >> (3 * i)) & 7];
+            }
+        }
+
+
+        // [BC7] mode 6: one subset, 7 bit RGBA endpoints with a shared bit each, 4 bit indices
+
+        const int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        uint8_t bc7Interpolate(uint8_t e0, uint8_t e1, int weight)
+        {
+            return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+        }
+
+        // Little endian bit stream over the 16 bytes of a block
+        class BitWriter {
+        public:
+            explicit BitWriter(uint8_t* out) : _out(out) { memset(_out, 0, 16); }
+            void write(uint32_t value, int bitCount) {
+                for (int i = 0; i < bitCount; i++, _position++) {
+                    if ((value >> i) & 1) _out[_position / 8] |= static_cast<uint8_t>(1 << (_position % 8));
+                }
+            }
+        private:
+            uint8_t* _out;
+            int _position = 0;
+        };
+
+        class BitReader {
+        public:
+            explicit BitReader(const uint8_t* in) : _in(in) {}
+            uint32_t read(int bitCount) {
+                uint32_t value = 0;
+                for (int i = 0; i < bitCount; i++, _position++) {
+                    value |= static_cast<uint32_t>((_in[_position / 8] >> (_position % 8)) & 1) << i;
+                }
+                return value;
+            }
+        private:
+            const uint8_t* _in;
+            int _position = 0;
+        };
+
+        // Picks 7 bit values and a shared low bit for an endpoint, whichever reconstructs it best
+        void quantizeBC7Endpoint(const float* color, uint8_t* quantized, uint8_t& pBit)
+        {
+            int bestError = INT_MAX;
+            for (uint8_t p = 0; p < 2; p++) {
+                int error = 0;
+                uint8_t candidate[4];
+                for (int c = 0; c < 4; c++) {
+                    int value = std::clamp(static_cast<int>(std::lround((color[c] - p) / 2.f)), 0, 127);
+                    candidate[c] = static_cast<uint8_t>(value);
+                    int d = ((value << 1) | p) - static_cast<int>(std::lround(color[c]));
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    pBit = p;
+                    memcpy(quantized, candidate, 4);
+                }
+            }
+        }
+
+        void encodeBC7(const Block& block, uint8_t* out)
+        {
+            float start[4], end[4];
+            fitLine(block, 4, start, end);
+
+            uint8_t quantized[2][4];
+            uint8_t pBits[2];
+            quantizeBC7Endpoint(start, quantized[0], pBits[0]);
+            quantizeBC7Endpoint(end, quantized[1], pBits[1]);
+
+            uint8_t endpoints[2][4];
+            for (int e = 0; e < 2; e++) {
+                for (int c = 0; c < 4; c++) endpoints[e][c] = static_cast<uint8_t>((quantized[e][c] << 1) | pBits[e]);
+            }
+
+            uint8_t palette[16][4];
+            for (int i = 0; i < 16; i++) {
+                for (int c = 0; c < 4; c++) palette[i][c] = bc7Interpolate(endpoints[0][c], endpoints[1][c], bc7Weights4[i]);
+            }
+
+            uint8_t indices[16];
+            for (int i = 0; i < 16; i++) {
+                int best = 0;
+                int bestDistance = INT_MAX;
+                for (int p = 0; p < 16; p++) {
+                    int distance = squaredDistance(block[i].data(), palette[p], 4);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                indices[i] = static_cast<uint8_t>(best);
+            }
+
+            // The first index is stored without its top bit, so it has to be below 8 (swap the endpoints otherwise)
+            if (indices[0] >= 8) {
+                std::swap(quantized[0], quantized[1]);
+                std::swap(pBits[0], pBits[1]);
+                for (auto& index : indices) index = static_cast<uint8_t>(15 - index);
+            }
+
+            BitWriter writer(out);
+            writer.write(1 << 6, 7); // Mode 6
+            for (int c = 0; c < 4; c++) {
+                writer.write(quantized[0][c], 7);
+                writer.write(quantized[1][c], 7);
+            }
+            writer.write(pBits[0], 1);
+            writer.write(pBits[1], 1);
+            writer.write(indices[0], 3);
+            for (int i = 1; i < 16; i++) writer.write(indices[i], 4);
+        }
+
+        bool decodeBC7(const uint8_t* in, Block& block)
+        {
+            BitReader reader(in);
+            if (reader.read(7) != (1 << 6)) return false; // Not mode 6
+
+            uint8_t quantized[2][4];
+            for (int c = 0; c < 4; c++) {
+                quantized[0][c] = static_cast<uint8_t>(reader.read(7));
+                quantized[1][c] = static_cast<uint8_t>(reader.read(7));
+            }
+            uint8_t pBits[2];
+            pBits[0] = static_cast<uint8_t>(reader.read(1));
+            pBits[1] = static_cast<uint8_t>(reader.read(1));
+
+            for (int i = 0; i < 16; i++) {
+                int index = static_cast<int>(reader.read(i == 0 ? 3 : 4));
+                for (int c = 0; c < 4; c++) {
+                    uint8_t e0 = static_cast<uint8_t>((quantized[0][c] << 1) | pBits[0]);
+                    uint8_t e1 = static_cast<uint8_t>((quantized[1][c] << 1) | pBits[1]);
+                    block[i][c] = bc7Interpolate(e0, e1, bc7Weights4[index]);
+                }
+            }
+            return true;
+        }
+
+    }
+
+
+    uint32_t getBlockSize(VkFormat format)
+    {
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            return 8;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+
+    size_t getLevelSize(VkFormat format, uint32_t width, uint32_t height)
+    {
+        uint32_t blockSize = getBlockSize(format);
+        if (blockSize == 0) return static_cast<size_t>(width) * height * 4;
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+    }
+
+
+    VkFormat getFallbackFormat(VkFormat format)
+    {
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        default:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        }
+    }
+
+
+    std::vector<uint8_t> compress(VkFormat format, const uint8_t* rgba, uint32_t width, uint32_t height)
+    {
+        const uint32_t blockSize = getBlockSize(format);
+        if (blockSize == 0) throw std::runtime_error("Unsupported block compression format!");
+
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * blockSize);
+
+        ThreadPool::getInstance()->parallelFor(blocksY, [&](uint32_t blockY) {
+            Block block;
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+                fetchBlock(rgba, width, height, blockX, blockY, block);
+                uint8_t* out = blocks.data() + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+                switch (format) {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    encodeBC1(block, out);
+                    break;
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                    encodeBC4(block, 0, out);
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                    encodeBC4(block, 0, out);
+                    encodeBC4(block, 1, out + 8);
+                    break;
+                default:
+                    encodeBC7(block, out);
+                    break;
+                }
+            }
+        });
+
+        return blocks;
+    }
+
+
+    bool decompress(VkFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba)
+    {
+        const uint32_t blockSize = getBlockSize(format);
+        if (blockSize == 0) return false;
+
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        std::atomic<bool> supported{true};
+
+        ThreadPool::getInstance()->parallelFor(blocksY, [&](uint32_t blockY) {
+            Block block;
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+                const uint8_t* in = blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+
+                // Channels a format does not have read as 0, alpha as 1
+                for (auto& texel : block) texel = { 0, 0, 0, 255 };
+
+                switch (format) {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    decodeBC1(in, block);
+                    for (auto& texel : block) texel[3] = 255; // RGB formats ignore the 3 color mode alpha
+                    break;
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                    decodeBC4(in, 0, block);
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                    decodeBC4(in, 0, block);
+                    decodeBC4(in + 8, 1, block);
+                    break;
+                default:
+                    if (!decodeBC7(in, block)) supported = false;
+                    break;
+                }
+                storeBlock(rgba, width, height, blockX, blockY, block);
+            }
+        });
+
+        return supported;
+    }
+
+}
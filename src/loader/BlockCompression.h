@@ -0,0 +1,28 @@
+#pragma once
+#include "../stdafx.h"
+
+// CPU encoders and decoders for the BC formats the engine bakes its textures into.
+// Encoding is for the offline baker, decoding is the fallback for devices without BC support.
+//   BC1  RGB, 4 bpp (opaque color)
+//   BC4  R, 4 bpp (single channel masks)
+//   BC5  RG, 8 bpp (tangent space normals, z is rebuilt in the shader)
+//   BC7  RGBA, 8 bpp (color with or without alpha). Only mode 6 is written, and only mode 6 is decoded.
+namespace BlockCompression {
+
+    // Bytes per 4x4 block, 0 if the format is not one of the above
+    uint32_t getBlockSize(VkFormat format);
+    inline bool isBlockCompressed(VkFormat format) { return getBlockSize(format) != 0; }
+
+    // Bytes of a width x height level (texels for RGBA8 formats)
+    size_t getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+    // The RGBA8 format a block compressed format is decoded to (keeps sRGB)
+    VkFormat getFallbackFormat(VkFormat format);
+
+    // Encodes tightly packed RGBA8 pixels, rows of blocks are encoded in parallel on the thread pool
+    std::vector<uint8_t> compress(VkFormat format, const uint8_t* rgba, uint32_t width, uint32_t height);
+
+    // Decodes into tightly packed RGBA8 (BC4 into R, BC5 into RG, like sampling would), false if unsupported
+    bool decompress(VkFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba);
+
+}
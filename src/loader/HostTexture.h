@@ -0,0 +1,23 @@
+#pragma once
+#include "../stdafx.h"
+
+// Texture representation on CPU: every mip level of a 2D image (possibly block compressed), level 0 first
+struct HostTexture
+{
+    struct Level {
+        size_t offset;  // Into data
+        size_t size;
+    };
+
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> data;
+    const uint8_t* externalData = nullptr;  // Levels live in memory owned elsewhere (a mapped asset pack) instead of data
+    std::vector<Level> levels;
+
+    uint32_t getMipLevels() const { return static_cast<uint32_t>(levels.size()); }
+    const uint8_t* getLevelData(uint32_t level) const { return (externalData ? externalData : data.data()) + levels[level].offset; }
+    uint32_t getLevelWidth(uint32_t level) const { return std::max(1u, width >> level); }
+    uint32_t getLevelHeight(uint32_t level) const { return std::max(1u, height >> level); }
+};
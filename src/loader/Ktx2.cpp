@@ -0,0 +1,254 @@
+#include "Ktx2.h"
+#include "BlockCompression.h"
+
+
+namespace Ktx2 {
+
+    namespace {
+
+        const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        struct Header {
+            uint32_t vkFormat;
+            uint32_t typeSize;
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t pixelDepth;
+            uint32_t layerCount;
+            uint32_t faceCount;
+            uint32_t levelCount;
+            uint32_t supercompressionScheme;
+
+            uint32_t dfdByteOffset;
+            uint32_t dfdByteLength;
+            uint32_t kvdByteOffset;
+            uint32_t kvdByteLength;
+            uint32_t sgdByteOffset[2];  // uint64 in the file, split into words so the struct has no padding
+            uint32_t sgdByteLength[2];
+        };
+        static_assert(sizeof(Header) == 68, "KTX2 header must be tightly packed");
+
+        struct LevelIndex {
+            uint64_t byteOffset;
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;
+        };
+
+        // Data format descriptor values (Khronos Data Format Specification 1.3)
+        const uint32_t ColorModelRGBSDA = 1;
+        const uint32_t ColorModelBC1A = 128;
+        const uint32_t ColorModelBC4 = 131;
+        const uint32_t ColorModelBC5 = 132;
+        const uint32_t ColorModelBC7 = 134;
+        const uint32_t ColorPrimariesBT709 = 1;
+        const uint32_t TransferLinear = 1;
+        const uint32_t TransferSRGB = 2;
+        const uint32_t ChannelQualifierLinear = 0x10;
+
+        bool isSupported(VkFormat format)
+        {
+            return BlockCompression::isBlockCompressed(format) || format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+        }
+
+        bool isSRGB(VkFormat format)
+        {
+            return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK || format == VK_FORMAT_R8G8B8A8_SRGB;
+        }
+
+        // Basic descriptor block, the samples say which bits of a texel block hold which channel
+        std::vector<uint32_t> createDataFormatDescriptor(VkFormat format)
+        {
+            struct Sample { uint32_t bitOffset; uint32_t bitLength; uint32_t channel; uint32_t upper; };
+            std::vector<Sample> samples;
+            uint32_t colorModel;
+            uint32_t blockExtent = 4;
+            uint32_t bytesPerBlock = BlockCompression::getBlockSize(format);
+
+            switch (format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                colorModel = ColorModelBC1A;
+                samples = { { 0, 64, 0, UINT32_MAX } };
+                break;
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+                colorModel = ColorModelBC4;
+                samples = { { 0, 64, 0, UINT32_MAX } };
+                break;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                colorModel = ColorModelBC5;
+                samples = { { 0, 64, 0, UINT32_MAX }, { 64, 64, 1, UINT32_MAX } };
+                break;
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                colorModel = ColorModelBC7;
+                samples = { { 0, 128, 0, UINT32_MAX } };
+                break;
+            default: // RGBA8
+                colorModel = ColorModelRGBSDA;
+                blockExtent = 1;
+                bytesPerBlock = 4;
+                samples = { { 0, 8, 0, 255 }, { 8, 8, 1, 255 }, { 16, 8, 2, 255 },
+                            { 24, 8, 15 | (isSRGB(format) ? ChannelQualifierLinear : 0), 255 } }; // Alpha is never sRGB encoded
+                break;
+            }
+
+            const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+            std::vector<uint32_t> words;
+            words.push_back(4 + blockSize);                 // dfdTotalSize
+            words.push_back(0);                             // Khronos vendor, basic descriptor type
+            words.push_back(2 | (blockSize << 16));         // Version 1.3, block size
+            words.push_back(colorModel | (ColorPrimariesBT709 << 8) | ((isSRGB(format) ? TransferSRGB : TransferLinear) << 16));
+            words.push_back((blockExtent - 1) | ((blockExtent - 1) << 8));
+            words.push_back(bytesPerBlock);
+            words.push_back(0);
+            for (const auto& sample : samples) {
+                words.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+                words.push_back(0);                         // Sample position
+                words.push_back(0);                         // Lower
+                words.push_back(sample.upper);
+            }
+            return words;
+        }
+
+    }
+
+
+    bool load(const std::string& path, HostTexture& texture)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            spdlog::error("Failed to open KTX2 file: {}", path);
+            return false;
+        }
+
+        std::vector<uint8_t> fileData(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(fileData.data()), fileData.size());
+        if (!file) {
+            spdlog::error("Failed to read KTX2 file: {}", path);
+            return false;
+        }
+
+        if (!load(fileData.data(), fileData.size(), texture)) {
+            spdlog::error("Unsupported KTX2 file: {}", path);
+            return false;
+        }
+        return true;
+    }
+
+
+    bool load(const uint8_t* data, size_t size, HostTexture& texture, bool referenceData)
+    {
+        if (size < sizeof(identifier) + sizeof(Header) || memcmp(data, identifier, sizeof(identifier)) != 0) {
+            spdlog::error("Not a KTX2 container");
+            return false;
+        }
+
+        Header header;
+        memcpy(&header, data + sizeof(identifier), sizeof(Header));
+
+        const VkFormat format = static_cast<VkFormat>(header.vkFormat);
+        if (header.supercompressionScheme != 0 || !isSupported(format)) {
+            spdlog::error("KTX2 format {} (supercompression {}) is not supported", header.vkFormat, header.supercompressionScheme);
+            return false;
+        }
+        if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.pixelWidth == 0 || header.pixelHeight == 0) {
+            spdlog::error("Only 2D KTX2 textures are supported");
+            return false;
+        }
+
+        // A level count of 0 asks for runtime generated mipmaps, the base level is all there is
+        const uint32_t levelCount = std::max(1u, header.levelCount);
+        const size_t levelIndexOffset = sizeof(identifier) + sizeof(Header);
+        if (size < levelIndexOffset + levelCount * sizeof(LevelIndex)) {
+            spdlog::error("KTX2 level index is truncated");
+            return false;
+        }
+
+        texture.format = format;
+        texture.width = header.pixelWidth;
+        texture.height = header.pixelHeight;
+        texture.data.clear();
+        texture.externalData = nullptr;
+        texture.levels.clear();
+
+        std::vector<LevelIndex> levelIndex(levelCount);
+        memcpy(levelIndex.data(), data + levelIndexOffset, levelCount * sizeof(LevelIndex));
+
+        size_t totalSize = 0;
+        for (uint32_t level = 0; level < levelCount; level++) {
+            const LevelIndex& entry = levelIndex[level];
+            const size_t expectedSize = BlockCompression::getLevelSize(format, texture.getLevelWidth(level), texture.getLevelHeight(level));
+            if (entry.byteLength != expectedSize || entry.byteOffset > size || entry.byteLength > size - entry.byteOffset) {
+                spdlog::error("KTX2 level {} is truncated or has an unexpected size", level);
+                return false;
+            }
+            texture.levels.push_back({ referenceData ? static_cast<size_t>(entry.byteOffset) : totalSize, expectedSize });
+            totalSize += expectedSize;
+        }
+
+        if (referenceData) {
+            texture.externalData = data;
+            return true;
+        }
+
+        texture.data.resize(totalSize);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            memcpy(texture.data.data() + texture.levels[level].offset, data + levelIndex[level].byteOffset, texture.levels[level].size);
+        }
+        return true;
+    }
+
+
+    bool save(const std::string& path, const HostTexture& texture)
+    {
+        if (!isSupported(texture.format) || texture.levels.empty()) {
+            spdlog::error("Cannot write KTX2 file with format {}: {}", static_cast<uint32_t>(texture.format), path);
+            return false;
+        }
+
+        const uint32_t levelCount = texture.getMipLevels();
+        const std::vector<uint32_t> dfd = createDataFormatDescriptor(texture.format);
+
+        Header header{};
+        header.vkFormat = static_cast<uint32_t>(texture.format);
+        header.typeSize = 1;
+        header.pixelWidth = texture.width;
+        header.pixelHeight = texture.height;
+        header.pixelDepth = 0;
+        header.layerCount = 0;
+        header.faceCount = 1;
+        header.levelCount = levelCount;
+        header.supercompressionScheme = 0;
+        header.dfdByteOffset = static_cast<uint32_t>(sizeof(identifier) + sizeof(Header) + levelCount * sizeof(LevelIndex));
+        header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+        // Levels are stored smallest first, each aligned to the texel block size
+        const size_t alignment = BlockCompression::isBlockCompressed(texture.format) ? BlockCompression::getBlockSize(texture.format) : 4;
+        std::vector<LevelIndex> levelIndex(levelCount);
+        size_t offset = header.dfdByteOffset + header.dfdByteLength;
+        for (uint32_t i = levelCount; i-- > 0;) {
+            offset = (offset + alignment - 1) / alignment * alignment;
+            levelIndex[i] = { offset, texture.levels[i].size, texture.levels[i].size };
+            offset += texture.levels[i].size;
+        }
+
+        std::vector<uint8_t> fileData(offset, 0);
+        memcpy(fileData.data(), identifier, sizeof(identifier));
+        memcpy(fileData.data() + sizeof(identifier), &header, sizeof(Header));
+        memcpy(fileData.data() + sizeof(identifier) + sizeof(Header), levelIndex.data(), levelCount * sizeof(LevelIndex));
+        memcpy(fileData.data() + header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            memcpy(fileData.data() + levelIndex[level].byteOffset, texture.getLevelData(level), texture.levels[level].size);
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            spdlog::error("Failed to open KTX2 file for writing: {}", path);
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(fileData.data()), fileData.size());
+        return static_cast<bool>(file);
+    }
+
+}
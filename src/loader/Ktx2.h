@@ -0,0 +1,17 @@
+#pragma once
+#include "../stdafx.h"
+#include "HostTexture.h"
+
+// Reader and writer for the KTX 2.0 container (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html),
+// limited to what the texture baker writes: one 2D image (no array layers, no cube faces) with all of its mip
+// levels, no supercompression. Formats are BC1 / BC4 / BC5 / BC7 and RGBA8.
+namespace Ktx2 {
+
+    bool load(const std::string& path, HostTexture& texture);
+
+    // With referenceData the levels are not copied, the texture points into data (which has to outlive it)
+    bool load(const uint8_t* data, size_t size, HostTexture& texture, bool referenceData = false);
+
+    bool save(const std::string& path, const HostTexture& texture);
+
+}
@@ -1,4 +1,7 @@
 #include "ObjLoader.h"
+#include "AssetPack.h"
+#include "AsyncFileReader.h"
+#include <sstream>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
@@ -15,8 +18,22 @@ namespace ObjLoader {
         std::vector<tinyobj::material_t> materials;
         std::string warn, err;
 
-        // Load the OBJ file
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str())) {
+        // Read the whole OBJ file, from the asset pack or the async reader, then parse it from memory
+        std::string text;
+        AssetView asset = AssetPack::getInstance()->find(modelPath);
+        if (asset) {
+            text.assign(reinterpret_cast<const char*>(asset.data), asset.size);
+        } else {
+            FileReadResult file = AsyncFileReader::getInstance()->read(modelPath).get();
+            if (!file.success) throw std::runtime_error("Failed to load OBJ file: " + modelPath);
+            text.assign(file.data.begin(), file.data.end());
+        }
+        std::istringstream stream(std::move(text));
+
+        // .mtl files are looked up from the working directory, like tinyobj does when given a path
+        tinyobj::MaterialFileReader materialReader("");
+
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream, &materialReader)) {
             throw std::runtime_error("Failed to load OBJ file: " + warn + " " + err);
         }
 
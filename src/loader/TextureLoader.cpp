@@ -0,0 +1,404 @@
+#include "TextureLoader.h"
+#include "AssetPack.h"
+#include "AsyncFileReader.h"
+#include "BlockCompression.h"
+#include "Ktx2.h"
+#include "../UploadManager.h"
+#include "../utilities/ThreadPool.h"
+#include "../utilities/Tracer.h"
+#include "stb_image.h" // Implementation lives in Texture2D.cpp
+#include <condition_variable>
+#include <queue>
+
+
+TextureLoaderParams TextureLoader::defaultParams{};
+
+
+namespace {
+
+    // For devices that cannot sample the baked format: every level decoded to RGBA8, the mips stay precomputed
+    bool decompressToFallback(HostTexture& texture)
+    {
+        HostTexture decoded;
+        decoded.format = BlockCompression::getFallbackFormat(texture.format);
+        decoded.width = texture.width;
+        decoded.height = texture.height;
+        for (uint32_t level = 0; level < texture.getMipLevels(); level++) {
+            size_t size = BlockCompression::getLevelSize(decoded.format, texture.getLevelWidth(level), texture.getLevelHeight(level));
+            decoded.levels.push_back({ decoded.data.size(), size });
+            decoded.data.resize(decoded.data.size() + size);
+        }
+        for (uint32_t level = 0; level < texture.getMipLevels(); level++) {
+            uint8_t* rgba = decoded.data.data() + decoded.levels[level].offset;
+            if (!BlockCompression::decompress(texture.format, texture.getLevelData(level), texture.getLevelWidth(level), texture.getLevelHeight(level), rgba)) {
+                return false;
+            }
+        }
+        texture = std::move(decoded);
+        return true;
+    }
+
+}
+
+
+// Shared with the decode tasks and the read callbacks, so they can finish safely when the loader goes away early
+struct TextureLoader::DecodeState
+{
+    struct DecodedImage {
+        AssetView asset;                // File bytes mapped from the asset pack...
+        std::vector<uint8_t> fileData;  // ...or read by the AsyncFileReader
+        bool readBaked = false;         // The bytes are the .ktx2 next to the source image
+
+        stbi_uc* pixels = nullptr;
+        int width = 0;
+        int height = 0;
+        bool isBaked = false;           // Decoded into baked instead of pixels
+        HostTexture baked;              // May point into asset / fileData
+    };
+
+    size_t firstEntry = 0;
+    std::vector<std::string> paths;     // Per texture of the load
+    std::vector<uintmax_t> fileSizes;
+    std::vector<DecodedImage> images;
+    std::atomic<bool> cancelled{false};
+    std::atomic<int64_t> decodeMicroseconds{0};
+    std::atomic<uint32_t> bakedCount{0};
+    std::atomic<uint32_t> fallbackCount{0};
+    std::vector<VkFormat> unsupportedFormats; // Block compressed formats the device cannot sample
+    std::chrono::high_resolution_clock::time_point startTime;
+    uint32_t threadCount = 0;
+
+    std::mutex mutex;
+    std::condition_variable readyCondition;
+    std::vector<uint32_t> ready;        // Bytes are there, not decoding yet
+    uint32_t taken = 0;                 // Decodes started
+    std::condition_variable condition;
+    std::queue<uint32_t> finished;
+
+    ~DecodeState() {
+        for (auto& image : images) {
+            if (image.pixels) stbi_image_free(image.pixels);
+        }
+    }
+
+    void setReady(uint32_t index)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(index);
+        }
+        readyCondition.notify_one();
+    }
+
+    // Wakes the decode threads that wait for bytes, they return without starting another decode
+    void cancel()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+        }
+        readyCondition.notify_all();
+    }
+
+    static void decode(const std::shared_ptr<DecodeState>& state)
+    {
+        const uint32_t count = static_cast<uint32_t>(state->images.size());
+        while (true) {
+            // Biggest file whose bytes are there, so no large image starts last
+            uint32_t index;
+            bool lastTaken;
+            {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                state->readyCondition.wait(lock, [&]() { return state->cancelled || !state->ready.empty() || state->taken == count; });
+                if (state->cancelled || state->ready.empty()) return;
+                auto it = std::max_element(state->ready.begin(), state->ready.end(),
+                    [&](uint32_t a, uint32_t b) { return state->fileSizes[a] < state->fileSizes[b]; });
+                index = *it;
+                state->ready.erase(it);
+                lastTaken = ++state->taken == count;
+            }
+
+            // The other threads wait for bytes that will never come
+            if (lastTaken) state->readyCondition.notify_all();
+
+            const std::string& path = state->paths[index];
+            DecodedImage& image = state->images[index];
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            {
+                TRACE_SCOPE_CAT("Decode " + std::filesystem::path(path).filename().string(), "asset");
+
+                const uint8_t* bytes = image.asset ? image.asset.data : image.fileData.data();
+                const size_t size = image.asset ? image.asset.size : image.fileData.size();
+
+                // A baked texture has its mips already, stb images get theirs generated on the GPU.
+                // Baked levels are not copied, the upload reads them from the file bytes.
+                if (image.readBaked && size > 0) {
+                    image.isBaked = Ktx2::load(bytes, size, image.baked, true);
+
+                    const auto& unsupported = state->unsupportedFormats;
+                    if (image.isBaked && std::find(unsupported.begin(), unsupported.end(), image.baked.format) != unsupported.end()) {
+                        if (decompressToFallback(image.baked)) {
+                            state->fallbackCount++;
+                        } else {
+                            spdlog::error("Failed to decompress baked texture: {}", path);
+                            image.isBaked = false;
+                        }
+                    }
+                    if (image.isBaked) state->bakedCount++;
+                } else if (size > 0) {
+                    int channels;
+                    image.pixels = stbi_load_from_memory(bytes, static_cast<int>(size), &image.width, &image.height, &channels, STBI_rgb_alpha);
+                }
+
+                // Only baked levels still point into the file bytes
+                if (!image.isBaked || image.baked.externalData == nullptr) std::vector<uint8_t>().swap(image.fileData);
+            }
+            auto endTime = std::chrono::high_resolution_clock::now();
+            state->decodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.push(index);
+            }
+            state->condition.notify_one();
+        }
+    }
+};
+
+
+TextureLoader::TextureLoader(std::shared_ptr<VulkanContext> ctx, TextureLoaderParams params)
+    : _ctx(std::move(ctx)), _params(params)
+{
+}
+
+
+TextureLoader::~TextureLoader()
+{
+    // Decodes that already started finish on their own, the rest is skipped
+    if (_state) _state->cancel();
+}
+
+
+TextureLoader::Handle TextureLoader::add(const std::string& path, VkFormat format, std::array<uint8_t, 4> placeholderColor)
+{
+    _entries.push_back({ path, format, placeholderColor, nullptr, false, {} });
+    return static_cast<Handle>(_entries.size() - 1);
+}
+
+
+void TextureLoader::load()
+{
+    startLoad(false);
+    finish();
+}
+
+
+void TextureLoader::loadAsync()
+{
+    startLoad(true);
+}
+
+
+void TextureLoader::startLoad(bool withPlaceholders)
+{
+    // One load at a time
+    if (_state) finish();
+
+    const uint32_t count = static_cast<uint32_t>(_entries.size() - _loadedCount);
+    if (count == 0) return;
+
+    _state = std::make_shared<DecodeState>();
+    _state->firstEntry = _loadedCount;
+    _state->startTime = std::chrono::high_resolution_clock::now();
+    _state->images.resize(count);
+    _state->fileSizes.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        _state->paths.push_back(_entries[_loadedCount + i].path);
+    }
+    _remaining = count;
+
+    // Decided here, the decode tasks do not touch the device
+    const VkFormat blockFormats[] = { VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGB_SRGB_BLOCK, VK_FORMAT_BC4_UNORM_BLOCK,
+                                      VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK };
+    for (VkFormat format : blockFormats) {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(_ctx->physicalDevice, format, &formatProperties);
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+            _state->unsupportedFormats.push_back(format);
+        }
+    }
+
+    // Where the bytes come from: the baked .ktx2 if there is one, else the source image. Mapped from the asset pack
+    // when it has the file, read from disk otherwise. File size is a good enough guess of the decode time.
+    AssetPack* pack = AssetPack::getInstance();
+    std::vector<std::string> readPaths(count);
+    for (uint32_t i = 0; i < count; i++) {
+        DecodeState::DecodedImage& image = _state->images[i];
+        const std::string& path = _state->paths[i];
+        std::string bakedPath = std::filesystem::path(path).replace_extension(".ktx2").string();
+        std::error_code error;
+
+        if ((image.asset = pack->find(bakedPath))) {
+            image.readBaked = true;
+        } else if (std::filesystem::exists(bakedPath, error)) {
+            image.readBaked = true;
+            readPaths[i] = bakedPath;
+        } else if (!(image.asset = pack->find(path))) {
+            readPaths[i] = path;
+        }
+
+        if (image.asset) {
+            _state->fileSizes[i] = image.asset.size;
+            _state->ready.push_back(i);
+        } else {
+            _state->fileSizes[i] = std::filesystem::file_size(readPaths[i], error);
+            if (error) _state->fileSizes[i] = 0;
+        }
+    }
+
+    // Every read goes in flight right away, biggest first, decodes pick up whatever has arrived
+    std::vector<uint32_t> readOrder;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!readPaths[i].empty()) readOrder.push_back(i);
+    }
+    std::stable_sort(readOrder.begin(), readOrder.end(), [this](uint32_t a, uint32_t b) { return _state->fileSizes[a] > _state->fileSizes[b]; });
+
+    std::shared_ptr<DecodeState> state = _state;
+    AsyncFileReader* reader = AsyncFileReader::getInstance();
+    for (uint32_t index : readOrder) {
+        reader->read(readPaths[index], [state, index](FileReadResult& result) {
+            // A failed read decodes nothing, the texture shows up white
+            state->images[index].fileData = std::move(result.data);
+            state->setReady(index);
+        });
+    }
+
+    if (withPlaceholders) {
+        TRACE_SCOPE_CAT("Placeholders", "asset");
+        for (uint32_t i = 0; i < count; i++) {
+            Entry& entry = _entries[_loadedCount + i];
+            entry.texture = std::make_shared<Texture2D>(_ctx, entry.placeholderColor.data(), 1, 1, entry.format, 1);
+        }
+    }
+
+    // Every task drains the ready list, so the thread count caps the decodes running at once
+    ThreadPool* pool = ThreadPool::getInstance();
+    uint32_t threadCount = _params.maxThreads == 0 ? pool->getWorkerCount() : std::min(_params.maxThreads, pool->getWorkerCount());
+    _state->threadCount = std::max(1u, std::min(threadCount, count));
+
+    for (uint32_t i = 0; i < _state->threadCount; i++) {
+        pool->submit([state]() { DecodeState::decode(state); });
+    }
+}
+
+
+void TextureLoader::update()
+{
+    if (!_state) return;
+
+    uint32_t created = 0;
+    while (created < std::max(1u, _params.maxCreatesPerUpdate)) {
+        uint32_t index;
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            if (_state->finished.empty()) break;
+            index = _state->finished.front();
+            _state->finished.pop();
+        }
+        createTexture(index);
+        created++;
+    }
+
+    // The frame recorded next already samples the new textures, so their copies are submitted before it
+    if (created > 0) _ctx->uploadManager->flush();
+
+    if (_remaining == 0) endLoad();
+}
+
+
+void TextureLoader::finish()
+{
+    if (!_state) return;
+
+    TRACE_SCOPE_CAT("TextureLoader::finish", "asset");
+    while (_remaining > 0) {
+        uint32_t index;
+        {
+            std::unique_lock<std::mutex> lock(_state->mutex);
+            _state->condition.wait(lock, [this]() { return !_state->finished.empty(); });
+            index = _state->finished.front();
+            _state->finished.pop();
+        }
+        createTexture(index);
+
+        // Start the copy now instead of after the last decode
+        _ctx->uploadManager->flush();
+    }
+
+    endLoad();
+}
+
+
+void TextureLoader::onLoaded(Handle handle, LoadedCallback callback)
+{
+    Entry& entry = _entries[handle];
+    if (entry.loaded) {
+        callback(entry.texture);
+    } else {
+        entry.callbacks.push_back(std::move(callback));
+    }
+}
+
+
+void TextureLoader::createTexture(uint32_t index)
+{
+    Entry& entry = _entries[_state->firstEntry + index];
+    DecodeState::DecodedImage& image = _state->images[index];
+
+    std::shared_ptr<Texture2D> texture;
+    if (image.isBaked) {
+        TRACE_SCOPE_CAT("Upload " + std::filesystem::path(entry.path).filename().string(), "asset");
+        texture = std::make_shared<Texture2D>(_ctx, image.baked);
+        image.baked = {};
+        std::vector<uint8_t>().swap(image.fileData);
+    } else if (!image.pixels) {
+        // Keep the scene usable, the texture just shows up white
+        spdlog::error("Failed to load texture image! {}", entry.path);
+        const uint8_t white[4] = { 255, 255, 255, 255 };
+        texture = std::make_shared<Texture2D>(_ctx, white, 1, 1, entry.format, 1);
+    } else {
+        TRACE_SCOPE_CAT("Upload " + std::filesystem::path(entry.path).filename().string(), "asset");
+        texture = std::make_shared<Texture2D>(_ctx, image.pixels, image.width, image.height, entry.format);
+        stbi_image_free(image.pixels);
+        image.pixels = nullptr;
+    }
+
+    // Frames in flight may still sample the placeholder
+    _ctx->deletionQueue.pushObject(std::move(entry.texture));
+
+    entry.texture = std::move(texture);
+    entry.loaded = true;
+    for (auto& callback : entry.callbacks) {
+        callback(entry.texture);
+    }
+    entry.callbacks.clear();
+
+    _remaining--;
+}
+
+
+void TextureLoader::endLoad()
+{
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double milliseconds = std::chrono::duration<double, std::milli>(endTime - _state->startTime).count();
+    spdlog::info("Loaded {} textures ({} baked) in {:.0f} ms ({} decode threads, {:.0f} ms of decoding)",
+        _state->images.size(), _state->bakedCount.load(), milliseconds, _state->threadCount, _state->decodeMicroseconds.load() / 1000.0);
+    if (_state->fallbackCount > 0) {
+        spdlog::warn("{} baked textures were decompressed to RGBA8, the device cannot sample their format", _state->fallbackCount.load());
+    }
+
+    _loadedCount = _state->firstEntry + _state->images.size();
+    _state->cancel(); // Releases decode threads still waiting
+    _state = nullptr;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "../stdafx.h"
+#include "../VulkanContext.h"
+#include "../Texture2D.h"
+
+
+struct TextureLoaderParams
+{
+    // Images decoded at the same time, 0 uses every worker of the thread pool
+    uint32_t maxThreads = 0;
+
+    // Textures created per update(), each one holds up the frame while its pixels go through the staging ring
+    uint32_t maxCreatesPerUpdate = 1;
+};
+
+
+// Loads the textures a scene declares up front. Images are decoded on the thread pool, biggest file first, and
+// the render thread creates each texture and queues its upload as soon as its decode finishes, so the GPU copies
+// run while the remaining images are still decoding.
+//
+// With loadAsync() the scene does not wait at all: get() returns a 1x1 placeholder until the real texture is
+// created by update(), which then hands it to the onLoaded() callbacks to swap it in.
+// Textures are created on the render thread only (the upload manager is not used from the workers).
+//
+// When a .ktx2 file sits next to the image (written by the TextureBaker tool), it is loaded instead: block
+// compressed, with every mip level precomputed. Devices that cannot sample its format get it decoded on the worker.
+class TextureLoader
+{
+public:
+    using Handle = uint32_t;
+    using LoadedCallback = std::function<void(const std::shared_ptr<Texture2D>& texture)>;
+
+    explicit TextureLoader(std::shared_ptr<VulkanContext> ctx, TextureLoaderParams params = getDefaultParams());
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    // Declares a texture. placeholderColor (RGBA) stands in for it until it is loaded.
+    Handle add(const std::string& path, VkFormat format, std::array<uint8_t, 4> placeholderColor = { 255, 255, 255, 255 });
+
+    // Decodes and uploads everything declared so far. Blocks until every texture is created.
+    void load();
+
+    // Starts decoding everything declared so far and returns right away, get() returns placeholders until then
+    void loadAsync();
+
+    // Creates textures whose decode has finished and calls their callbacks. Call once per frame, before recording.
+    void update();
+
+    // Blocks until every texture of the current load is created
+    void finish();
+
+    bool isLoading() const { return _state != nullptr; }
+
+    // The texture or its placeholder
+    std::shared_ptr<Texture2D> get(Handle handle) const { return _entries[handle].texture; }
+
+    // Called once the real texture exists (right away if it already does)
+    void onLoaded(Handle handle, LoadedCallback callback);
+
+    // Params used by loaders created without explicit ones (set from the command line)
+    static TextureLoaderParams getDefaultParams() { return defaultParams; }
+    static void setDefaultParams(const TextureLoaderParams& params) { defaultParams = params; }
+
+private:
+    std::shared_ptr<VulkanContext> _ctx;
+    TextureLoaderParams _params;
+
+    struct Entry {
+        std::string path;
+        VkFormat format;
+        std::array<uint8_t, 4> placeholderColor;
+        std::shared_ptr<Texture2D> texture;
+        bool loaded = false;
+        std::vector<LoadedCallback> callbacks;
+    };
+    std::vector<Entry> _entries;
+    size_t _loadedCount = 0; // Entries before this belong to an earlier load
+
+    // Decode tasks of the current load, shared with the workers
+    struct DecodeState;
+    std::shared_ptr<DecodeState> _state;
+    uint32_t _remaining = 0;
+
+    void startLoad(bool withPlaceholders);
+    void createTexture(uint32_t index);
+    void endLoad();
+
+    static TextureLoaderParams defaultParams;
+};
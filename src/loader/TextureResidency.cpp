@@ -0,0 +1,518 @@
+#include "TextureResidency.h"
+#include "AssetPack.h"
+#include "AsyncFileReader.h"
+#include "BlockCompression.h"
+#include "Ktx2.h"
+#include "../UploadManager.h"
+#include "../utilities/ThreadPool.h"
+#include "../utilities/Tracer.h"
+#include "stb_image.h" // Implementation lives in Texture2D.cpp
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+
+TextureResidencyParams TextureResidency::defaultParams{};
+
+
+namespace {
+
+    float srgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+
+    uint8_t linearToSrgb8(float value)
+    {
+        value = std::clamp(value, 0.f, 1.f);
+        float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::lround(encoded * 255.f));
+    }
+
+
+    // Halves an RGBA8 image with a 2x2 box filter (odd edges repeat their last texel), averaging sRGB colors in
+    // linear space like the GPU blit of the mip chain does
+    std::vector<uint8_t> downsample(const uint8_t* src, uint32_t width, uint32_t height, bool srgb)
+    {
+        static const std::array<float, 256> srgbTable = []() {
+            std::array<float, 256> table{};
+            for (int i = 0; i < 256; i++) table[i] = srgbToLinear(i / 255.f);
+            return table;
+        }();
+
+        const uint32_t dstWidth = std::max(1u, width / 2);
+        const uint32_t dstHeight = std::max(1u, height / 2);
+        std::vector<uint8_t> dst(static_cast<size_t>(dstWidth) * dstHeight * 4);
+
+        for (uint32_t y = 0; y < dstHeight; y++) {
+            const uint32_t y0 = std::min(y * 2, height - 1);
+            const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < dstWidth; x++) {
+                const uint32_t x0 = std::min(x * 2, width - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                const uint8_t* texels[4] = {
+                    &src[(static_cast<size_t>(y0) * width + x0) * 4], &src[(static_cast<size_t>(y0) * width + x1) * 4],
+                    &src[(static_cast<size_t>(y1) * width + x0) * 4], &src[(static_cast<size_t>(y1) * width + x1) * 4] };
+                uint8_t* out = &dst[(static_cast<size_t>(y) * dstWidth + x) * 4];
+
+                for (int c = 0; c < 4; c++) {
+                    // Alpha is linear either way
+                    if (srgb && c < 3) {
+                        float sum = 0.f;
+                        for (const uint8_t* texel : texels) sum += srgbTable[texel[c]];
+                        out[c] = linearToSrgb8(sum / 4.f);
+                    } else {
+                        uint32_t sum = 0;
+                        for (const uint8_t* texel : texels) sum += texel[c];
+                        out[c] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+        return dst;
+    }
+
+
+    bool isSrgb(VkFormat format)
+    {
+        return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+    }
+
+
+    uint32_t getFullMipLevels(uint32_t width, uint32_t height)
+    {
+        return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    }
+
+}
+
+
+// Shared with the read callbacks and decode tasks, so they can finish safely when the manager goes away early
+struct TextureResidency::LoadState
+{
+    struct Result {
+        Handle handle;
+        bool coarse = false;            // The first load, picks the coarse mip itself
+        bool success = false;
+
+        // Levels from mip on. Baked textures have all of them, stb images only the first (the GPU makes the rest).
+        uint32_t mip = 0;
+        HostTexture texture;
+        bool generateMips = false;
+
+        // Of the full texture
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levelCount = 0;
+        uint32_t coarseMip = 0;
+    };
+
+    uint32_t minResidentSize = 0;
+    std::vector<VkFormat> unsupportedFormats; // Block compressed formats the device cannot sample
+    std::atomic<bool> cancelled{false};
+    std::atomic<VkDeviceSize> retiringBytes{0}; // Replaced textures waiting in the deletion queue
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Result> finished;
+
+    void push(Result result)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(std::move(result));
+        }
+        condition.notify_one();
+    }
+
+    // Finest level that fits in minResidentSize
+    uint32_t getCoarseMip(uint32_t width, uint32_t height, uint32_t levelCount) const
+    {
+        uint32_t mip = 0;
+        while (mip + 1 < levelCount && std::max(std::max(1u, width >> mip), std::max(1u, height >> mip)) > minResidentSize) mip++;
+        return mip;
+    }
+
+    // mip None is the coarse mip. Only the kept levels are copied out of the file bytes.
+    Result decode(Handle handle, uint32_t mip, VkFormat format, const uint8_t* bytes, size_t size, bool baked, bool packed) const
+    {
+        Result result;
+        result.handle = handle;
+        result.coarse = mip == None;
+        if (size == 0) return result;
+
+        if (baked) {
+            HostTexture source;
+            if (!Ktx2::load(bytes, size, source, true)) return result;
+
+            result.width = source.width;
+            result.height = source.height;
+            result.levelCount = source.getMipLevels();
+            result.coarseMip = getCoarseMip(source.width, source.height, result.levelCount);
+            result.mip = result.coarse ? result.coarseMip : std::min(mip, result.levelCount - 1);
+
+            HostTexture& texture = result.texture;
+            texture.format = source.format;
+            texture.width = source.getLevelWidth(result.mip);
+            texture.height = source.getLevelHeight(result.mip);
+
+            const bool unsupported = std::find(unsupportedFormats.begin(), unsupportedFormats.end(), source.format) != unsupportedFormats.end();
+            if (unsupported) texture.format = BlockCompression::getFallbackFormat(source.format);
+
+            if (packed && !unsupported && source.externalData) {
+                // The asset pack stays mapped, the upload reads the levels right from it
+                texture.externalData = source.externalData;
+                texture.levels.assign(source.levels.begin() + result.mip, source.levels.end());
+            } else {
+                for (uint32_t level = result.mip; level < result.levelCount; level++) {
+                    const uint32_t width = source.getLevelWidth(level);
+                    const uint32_t height = source.getLevelHeight(level);
+                    const size_t levelSize = unsupported ? BlockCompression::getLevelSize(texture.format, width, height) : source.levels[level].size;
+                    const size_t offset = texture.data.size();
+                    texture.levels.push_back({ offset, levelSize });
+                    texture.data.resize(offset + levelSize);
+
+                    if (!unsupported) {
+                        std::memcpy(texture.data.data() + offset, source.getLevelData(level), levelSize);
+                    } else if (!BlockCompression::decompress(source.format, source.getLevelData(level), width, height, texture.data.data() + offset)) {
+                        return result;
+                    }
+                }
+            }
+        } else {
+            int width, height, channels;
+            stbi_uc* pixels = stbi_load_from_memory(bytes, static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+            if (!pixels) return result;
+
+            result.width = width;
+            result.height = height;
+            result.levelCount = getFullMipLevels(width, height);
+            result.coarseMip = getCoarseMip(width, height, result.levelCount);
+            result.mip = result.coarse ? result.coarseMip : std::min(mip, result.levelCount - 1);
+
+            // Only the first kept level, the GPU blits the rest like for any other stb texture
+            std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+            stbi_image_free(pixels);
+            uint32_t levelWidth = width;
+            uint32_t levelHeight = height;
+            for (uint32_t i = 0; i < result.mip; i++) {
+                level = downsample(level.data(), levelWidth, levelHeight, isSrgb(format));
+                levelWidth = std::max(1u, levelWidth / 2);
+                levelHeight = std::max(1u, levelHeight / 2);
+            }
+
+            HostTexture& texture = result.texture;
+            texture.format = format;
+            texture.width = levelWidth;
+            texture.height = levelHeight;
+            texture.levels.push_back({ 0, level.size() });
+            texture.data = std::move(level);
+            result.generateMips = true;
+        }
+
+        result.success = true;
+        return result;
+    }
+};
+
+
+TextureResidency::TextureResidency(std::shared_ptr<VulkanContext> ctx, TextureResidencyParams params)
+    : _ctx(std::move(ctx)), _params(params)
+{
+    _state = std::make_shared<LoadState>();
+    _state->minResidentSize = std::max(1u, _params.minResidentSize);
+
+    // Decided here, the decode tasks do not touch the device
+    const VkFormat blockFormats[] = { VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGB_SRGB_BLOCK, VK_FORMAT_BC4_UNORM_BLOCK,
+                                      VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK };
+    for (VkFormat format : blockFormats) {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(_ctx->physicalDevice, format, &formatProperties);
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+            _state->unsupportedFormats.push_back(format);
+        }
+    }
+}
+
+
+TextureResidency::~TextureResidency()
+{
+    // Reads and decodes in flight finish on their own, their results are dropped
+    _state->cancelled = true;
+}
+
+
+TextureResidency::Handle TextureResidency::add(const std::string& path, VkFormat format, std::array<uint8_t, 4> placeholderColor)
+{
+    Entry entry;
+    entry.path = path;
+    entry.format = format;
+    entry.texture = std::make_shared<Texture2D>(_ctx, placeholderColor.data(), 1, 1, format, 1);
+    _entries.push_back(std::move(entry));
+
+    Handle handle = static_cast<Handle>(_entries.size() - 1);
+    startLoad(handle, None);
+    return handle;
+}
+
+
+void TextureResidency::setScreenRadius(Handle handle, float pixels)
+{
+    Entry& entry = _entries[handle];
+    entry.screenRadius = std::max(entry.screenRadius, pixels);
+}
+
+
+uint32_t TextureResidency::getWantedMip(const Entry& entry) const
+{
+    if (entry.screenRadius <= 0.0f) return entry.coarseMip;
+
+    // An equirectangular map wraps the sphere once around the equator. At the center of the disk one pixel spans
+    // 1 / radius of a radian, that is width / (2 pi radius) texels of level 0.
+    float texelsPerPixel = entry.width / (2.0f * glm::pi<float>() * entry.screenRadius);
+    float mip = std::floor(std::log2(std::max(texelsPerPixel, 1e-6f)) + _params.lodBias);
+    return static_cast<uint32_t>(std::clamp(mip, 0.0f, static_cast<float>(entry.coarseMip)));
+}
+
+
+VkDeviceSize TextureResidency::getBytes(const Entry& entry, uint32_t mip) const
+{
+    if (mip == None) return 0;
+
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = mip; level < entry.levelCount; level++) {
+        bytes += BlockCompression::getLevelSize(entry.residentFormat, std::max(1u, entry.width >> level), std::max(1u, entry.height >> level));
+    }
+    return bytes;
+}
+
+
+VkDeviceSize TextureResidency::getCommittedBytes(const Entry& entry) const
+{
+    // Both textures exist for a while once a reload lands
+    return std::max(getBytes(entry, entry.residentMip), getBytes(entry, entry.loadingMip));
+}
+
+
+VkDeviceSize TextureResidency::getResidentBytes() const
+{
+    VkDeviceSize bytes = 0;
+    for (const Entry& entry : _entries) bytes += getBytes(entry, entry.residentMip);
+    return bytes;
+}
+
+
+bool TextureResidency::isLoading() const
+{
+    return std::any_of(_entries.begin(), _entries.end(), [](const Entry& entry) { return entry.residentMip == None; });
+}
+
+
+void TextureResidency::startLoad(Handle handle, uint32_t mip)
+{
+    Entry& entry = _entries[handle];
+    if (mip != None) {
+        entry.loadingMip = mip;
+        _loadsInFlight++;
+    }
+
+    // Same sources as the TextureLoader: the baked .ktx2 if there is one, else the image. Mapped from the asset
+    // pack when it has the file, read from disk otherwise.
+    AssetPack* pack = AssetPack::getInstance();
+    std::string bakedPath = std::filesystem::path(entry.path).replace_extension(".ktx2").string();
+    std::error_code error;
+
+    bool baked = true;
+    std::string readPath;
+    AssetView asset;
+    if (!(asset = pack->find(bakedPath))) {
+        if (std::filesystem::exists(bakedPath, error)) {
+            readPath = bakedPath;
+        } else if (!(asset = pack->find(entry.path))) {
+            readPath = entry.path;
+            baked = false;
+        } else {
+            baked = false;
+        }
+    }
+
+    std::shared_ptr<LoadState> state = _state;
+    const VkFormat format = entry.format;
+    auto decode = [state, handle, mip, format, baked, path = entry.path](const uint8_t* bytes, size_t size, bool packed) {
+        if (state->cancelled) return;
+        TRACE_SCOPE_CAT("Decode mips " + std::filesystem::path(path).filename().string(), "asset");
+        state->push(state->decode(handle, mip, format, bytes, size, baked, packed));
+    };
+
+    if (asset) {
+        ThreadPool::getInstance()->submit([decode, asset]() { decode(asset.data, asset.size, true); });
+    } else {
+        AsyncFileReader::getInstance()->read(readPath, [decode](FileReadResult& result) {
+            // A failed read decodes nothing, the load reports the failure
+            auto data = std::make_shared<std::vector<uint8_t>>(std::move(result.data));
+            ThreadPool::getInstance()->submit([decode, data]() { decode(data->data(), data->size(), false); });
+        });
+    }
+}
+
+
+bool TextureResidency::finishLoads(bool wait)
+{
+    LoadState::Result result;
+    {
+        std::unique_lock<std::mutex> lock(_state->mutex);
+        if (wait) {
+            _state->condition.wait(lock, [this]() { return !_state->finished.empty(); });
+        } else if (_state->finished.empty()) {
+            return false;
+        }
+        result = std::move(_state->finished.front());
+        _state->finished.erase(_state->finished.begin());
+    }
+
+    Entry& entry = _entries[result.handle];
+    if (!result.coarse) {
+        entry.loadingMip = None;
+        _loadsInFlight--;
+    }
+
+    if (!result.success && entry.residentMip != None) {
+        // Keep the levels it has
+        spdlog::error("Failed to reload texture mips! {}", entry.path);
+        entry.failed = true;
+        return true;
+    }
+
+    const VkDeviceSize retiredBytes = getBytes(entry, entry.residentMip);
+    std::shared_ptr<Texture2D> texture;
+    if (!result.success) {
+        // Keep the scene usable, the texture just shows up white and is never reloaded
+        spdlog::error("Failed to load texture image! {}", entry.path);
+        const uint8_t white[4] = { 255, 255, 255, 255 };
+        texture = std::make_shared<Texture2D>(_ctx, white, 1, 1, entry.format, 1);
+        entry.residentFormat = entry.format;
+        entry.width = 1;
+        entry.height = 1;
+        entry.levelCount = 1;
+        entry.coarseMip = 0;
+        entry.residentMip = 0;
+    } else {
+        TRACE_SCOPE_CAT("Upload mips " + std::filesystem::path(entry.path).filename().string(), "asset");
+        const HostTexture& host = result.texture;
+        if (result.generateMips) {
+            texture = std::make_shared<Texture2D>(_ctx, host.getLevelData(0), host.width, host.height, host.format);
+        } else {
+            texture = std::make_shared<Texture2D>(_ctx, host);
+        }
+        entry.residentFormat = host.format;
+        entry.width = result.width;
+        entry.height = result.height;
+        entry.levelCount = result.levelCount;
+        entry.coarseMip = result.coarseMip;
+        entry.residentMip = result.mip;
+    }
+    entry.lastUsed = _frameNumber;
+
+    // Frames in flight may still sample the old one, it counts against the budget until it is freed
+    std::shared_ptr<LoadState> state = _state;
+    std::shared_ptr<Texture2D> retired = std::move(entry.texture);
+    state->retiringBytes += retiredBytes;
+    _ctx->deletionQueue.push([state, retired, retiredBytes]() mutable {
+        retired.reset();
+        state->retiringBytes -= retiredBytes;
+    });
+
+    entry.texture = std::move(texture);
+    for (auto& callback : entry.callbacks) {
+        callback(entry.texture);
+    }
+    return true;
+}
+
+
+void TextureResidency::update()
+{
+    TRACE_SCOPE_CAT("TextureResidency::update", "asset");
+    _frameNumber++;
+
+    // One texture per frame, each one holds up the frame while its levels go through the staging ring.
+    // The frame recorded next already samples it, so the copy is submitted before it.
+    if (finishLoads(false)) _ctx->uploadManager->flush();
+
+    const VkDeviceSize budget = static_cast<VkDeviceSize>(_params.budgetMB) << 20;
+    VkDeviceSize committed = _state->retiringBytes;
+    VkDeviceSize releasing = 0; // Freed once the reloads of shrinking textures land
+    std::vector<Handle> growing;
+    std::vector<Handle> shrinkable;
+
+    for (Handle handle = 0; handle < _entries.size(); handle++) {
+        Entry& entry = _entries[handle];
+        if (entry.residentMip == None) continue;
+
+        committed += getCommittedBytes(entry);
+        if (entry.loadingMip != None && entry.loadingMip > entry.residentMip) {
+            releasing += getBytes(entry, entry.residentMip) - getBytes(entry, entry.loadingMip);
+        }
+
+        const uint32_t wanted = getWantedMip(entry);
+        if (wanted <= entry.residentMip) entry.lastUsed = _frameNumber;
+        if (entry.loadingMip != None || entry.failed) continue;
+
+        if (wanted < entry.residentMip) {
+            growing.push_back(handle);
+        } else if (wanted > entry.residentMip) {
+            shrinkable.push_back(handle);
+        }
+    }
+
+    // Biggest on screen first
+    std::sort(growing.begin(), growing.end(), [this](Handle a, Handle b) { return _entries[a].screenRadius > _entries[b].screenRadius; });
+
+    VkDeviceSize needed = committed;
+    for (Handle handle : growing) {
+        const Entry& entry = _entries[handle];
+        needed += getBytes(entry, getWantedMip(entry)) - getBytes(entry, entry.residentMip);
+    }
+
+    // Textures holding more levels than they need are reloaded smaller, least recently used first, until the
+    // growing ones fit
+    std::sort(shrinkable.begin(), shrinkable.end(), [this](Handle a, Handle b) { return _entries[a].lastUsed < _entries[b].lastUsed; });
+    for (Handle handle : shrinkable) {
+        if (needed <= budget + releasing || _loadsInFlight >= _params.maxLoadsInFlight) break;
+
+        const Entry& entry = _entries[handle];
+        const uint32_t wanted = getWantedMip(entry);
+        releasing += getBytes(entry, entry.residentMip) - getBytes(entry, wanted);
+        startLoad(handle, wanted);
+    }
+
+    for (Handle handle : growing) {
+        if (_loadsInFlight >= _params.maxLoadsInFlight) break;
+
+        // Coarser than wanted when it does not fit, unless memory is about to be freed
+        const Entry& entry = _entries[handle];
+        const VkDeviceSize residentBytes = getBytes(entry, entry.residentMip);
+        uint32_t mip = getWantedMip(entry);
+        if (releasing > 0 && committed + getBytes(entry, mip) - residentBytes > budget) continue;
+        while (mip < entry.residentMip && committed + getBytes(entry, mip) - residentBytes > budget) mip++;
+        if (mip == entry.residentMip) continue;
+
+        committed += getBytes(entry, mip) - residentBytes;
+        startLoad(handle, mip);
+    }
+
+    for (Entry& entry : _entries) entry.screenRadius = 0.0f;
+}
+
+
+void TextureResidency::finish()
+{
+    TRACE_SCOPE_CAT("TextureResidency::finish", "asset");
+    while (isLoading()) {
+        finishLoads(true);
+
+        // Start the copy now instead of after the last decode
+        _ctx->uploadManager->flush();
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "../stdafx.h"
+#include "../VulkanContext.h"
+#include "../Texture2D.h"
+
+
+struct TextureResidencyParams
+{
+    // GPU memory of all managed textures together. The coarse levels are kept even if they alone exceed it.
+    uint32_t budgetMB = 256;
+
+    // Levels up to this size are loaded first and never evicted
+    uint32_t minResidentSize = 256;
+
+    // Reloads in flight (read, decode and upload)
+    uint32_t maxLoadsInFlight = 2;
+
+    // Added to the estimated mip, positive values keep less detail
+    float lodBias = 0.0f;
+};
+
+
+// Keeps only the mip levels of the scene's textures that the screen can actually show, within a memory budget.
+// Every frame the scene tells how big each texture appears (setScreenRadius), the manager derives the finest mip
+// needed and reloads the texture with more levels once it grows on screen. A texture that shrank keeps its levels
+// until another one needs the memory, then the least recently used ones are reloaded smaller.
+//
+// A texture "at mip m" is a smaller texture made of level m and the levels below it. It is recreated from the
+// source (the baked .ktx2 or the image, from the asset pack or the disk) on the thread pool, and handed to the
+// onChanged() callbacks on the render thread, like TextureLoader does. Textures start out with a 1x1 placeholder
+// and get their coarse levels first.
+class TextureResidency
+{
+public:
+    using Handle = uint32_t;
+    using ChangedCallback = std::function<void(const std::shared_ptr<Texture2D>& texture)>;
+
+    explicit TextureResidency(std::shared_ptr<VulkanContext> ctx, TextureResidencyParams params = getDefaultParams());
+    ~TextureResidency();
+
+    TextureResidency(const TextureResidency&) = delete;
+    TextureResidency& operator=(const TextureResidency&) = delete;
+
+    // Declares a texture and starts loading its coarse levels. placeholderColor (RGBA) stands in until they are there.
+    Handle add(const std::string& path, VkFormat format, std::array<uint8_t, 4> placeholderColor = { 255, 255, 255, 255 });
+
+    // The current texture (or placeholder)
+    std::shared_ptr<Texture2D> get(Handle handle) const { return _entries[handle].texture; }
+
+    // Called every time the texture is replaced
+    void onChanged(Handle handle, ChangedCallback callback) { _entries[handle].callbacks.push_back(std::move(callback)); }
+
+    // Radius in pixels of the textured sphere this frame, 0 when it is not on screen. A texture on several models
+    // keeps the largest radius of the frame.
+    void setScreenRadius(Handle handle, float pixels);
+
+    // Swaps in finished loads, then picks the levels of every texture and starts the reloads.
+    // Call once per frame before recording, after the screen radii are set.
+    void update();
+
+    // Some texture still shows its placeholder
+    bool isLoading() const;
+
+    // Blocks until every texture has its coarse levels
+    void finish();
+
+    VkDeviceSize getResidentBytes() const;
+
+    // Params used by managers created without explicit ones (set from the command line)
+    static TextureResidencyParams getDefaultParams() { return defaultParams; }
+    static void setDefaultParams(const TextureResidencyParams& params) { defaultParams = params; }
+
+private:
+    std::shared_ptr<VulkanContext> _ctx;
+    TextureResidencyParams _params;
+
+    static constexpr uint32_t None = UINT32_MAX;
+
+    struct Entry {
+        std::string path;
+        VkFormat format;
+        std::shared_ptr<Texture2D> texture;
+        std::vector<ChangedCallback> callbacks;
+
+        // Known once the first load is done
+        VkFormat residentFormat = VK_FORMAT_UNDEFINED;  // Block compressed when baked
+        uint32_t width = 0;                             // Of level 0
+        uint32_t height = 0;
+        uint32_t levelCount = 0;
+        uint32_t coarseMip = 0;                         // Finest level that is never evicted
+
+        uint32_t residentMip = None;                    // None while the placeholder is shown
+        uint32_t loadingMip = None;
+        float screenRadius = 0.0f;
+        uint64_t lastUsed = 0;                          // Last frame whose screen size needed the resident levels
+        bool failed = false;                            // A reload failed, the levels stay as they are
+    };
+    std::vector<Entry> _entries;
+    uint64_t _frameNumber = 0;
+    uint32_t _loadsInFlight = 0;
+
+    // Shared with the read callbacks and decode tasks, so they can finish after the manager is gone
+    struct LoadState;
+    std::shared_ptr<LoadState> _state;
+
+    // Finest mip the screen radius calls for
+    uint32_t getWantedMip(const Entry& entry) const;
+    VkDeviceSize getBytes(const Entry& entry, uint32_t mip) const;
+    VkDeviceSize getCommittedBytes(const Entry& entry) const;
+
+    // mip None loads the coarse levels
+    void startLoad(Handle handle, uint32_t mip);
+    bool finishLoads(bool wait);
+
+    static TextureResidencyParams defaultParams;
+};
@@ -0,0 +1,159 @@
+#include "VirtualTextureFile.h"
+#include "AssetPack.h"
+
+
+namespace VirtualTextureFile {
+
+    namespace {
+
+        // Tile data is aligned to the largest texel block (BC7 / RGBA8 texel rows stay aligned too)
+        constexpr uint64_t TileAlignment = 16;
+
+        size_t getIndexSize(uint32_t mipCount, uint32_t tileCount)
+        {
+            return sizeof(Header) + mipCount * sizeof(Mip) + static_cast<size_t>(tileCount) * sizeof(Tile);
+        }
+
+    }
+
+
+    Index createIndex(VkFormat format, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t border)
+    {
+        Index index;
+        index.format = format;
+        index.width = width;
+        index.height = height;
+        index.tileSize = tileSize;
+        index.border = border;
+
+        uint32_t tileCount = 0;
+        for (uint32_t mip = 0; ; mip++) {
+            Mip level{};
+            level.width = std::max(1u, width >> mip);
+            level.height = std::max(1u, height >> mip);
+            level.tilesX = (level.width + tileSize - 1) / tileSize;
+            level.tilesY = (level.height + tileSize - 1) / tileSize;
+            level.firstTile = tileCount;
+            index.mips.push_back(level);
+            tileCount += level.tilesX * level.tilesY;
+
+            if (level.tilesX == 1 && level.tilesY == 1) break;
+        }
+
+        index.tiles.resize(tileCount);
+        return index;
+    }
+
+
+    bool readIndex(const uint8_t* data, size_t size, Index& index)
+    {
+        if (size < sizeof(Header)) return false;
+
+        Header header;
+        memcpy(&header, data, sizeof(Header));
+        if (header.magic != Magic || header.version != Version || header.tileSize == 0 || header.mipCount == 0) {
+            spdlog::error("Not a virtual texture (or an unsupported version)");
+            return false;
+        }
+        if (size < getIndexSize(header.mipCount, header.tileCount)) {
+            spdlog::error("Virtual texture index is truncated");
+            return false;
+        }
+
+        index.format = static_cast<VkFormat>(header.format);
+        index.width = header.width;
+        index.height = header.height;
+        index.tileSize = header.tileSize;
+        index.border = header.border;
+        index.mips.resize(header.mipCount);
+        index.tiles.resize(header.tileCount);
+        memcpy(index.mips.data(), data + sizeof(Header), header.mipCount * sizeof(Mip));
+        memcpy(index.tiles.data(), data + sizeof(Header) + header.mipCount * sizeof(Mip), header.tileCount * sizeof(Tile));
+
+        const Mip& last = index.mips.back();
+        if (last.firstTile + last.tilesX * last.tilesY != header.tileCount) {
+            spdlog::error("Virtual texture tile table does not match its levels");
+            return false;
+        }
+        return true;
+    }
+
+
+    bool loadIndex(const std::string& path, Index& index)
+    {
+        if (AssetView view = AssetPack::getInstance()->find(path)) {
+            return readIndex(view.data, view.size, index);
+        }
+
+        // Only the index, the tiles are read when they are needed
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            spdlog::error("Failed to open virtual texture: {}", path);
+            return false;
+        }
+
+        Header header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+        if (!file || header.magic != Magic) {
+            spdlog::error("Not a virtual texture: {}", path);
+            return false;
+        }
+
+        std::vector<uint8_t> data(getIndexSize(header.mipCount, header.tileCount));
+        memcpy(data.data(), &header, sizeof(Header));
+        file.read(reinterpret_cast<char*>(data.data() + sizeof(Header)), data.size() - sizeof(Header));
+        if (!file) {
+            spdlog::error("Failed to read virtual texture index: {}", path);
+            return false;
+        }
+        return readIndex(data.data(), data.size(), index);
+    }
+
+
+    bool save(const std::string& path, Index& index, const std::vector<std::vector<uint8_t>>& tiles)
+    {
+        if (tiles.size() != index.tiles.size()) {
+            spdlog::error("Virtual texture has {} tiles, {} given: {}", index.tiles.size(), tiles.size(), path);
+            return false;
+        }
+
+        const size_t indexSize = getIndexSize(static_cast<uint32_t>(index.mips.size()), static_cast<uint32_t>(index.tiles.size()));
+        uint64_t offset = indexSize;
+        for (size_t i = 0; i < tiles.size(); i++) {
+            offset = (offset + TileAlignment - 1) / TileAlignment * TileAlignment;
+            index.tiles[i] = { offset, static_cast<uint32_t>(tiles[i].size()), 0 };
+            offset += tiles[i].size();
+        }
+
+        Header header{};
+        header.magic = Magic;
+        header.version = Version;
+        header.format = static_cast<uint32_t>(index.format);
+        header.width = index.width;
+        header.height = index.height;
+        header.tileSize = index.tileSize;
+        header.border = index.border;
+        header.mipCount = static_cast<uint32_t>(index.mips.size());
+        header.tileCount = static_cast<uint32_t>(index.tiles.size());
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            spdlog::error("Failed to open virtual texture for writing: {}", path);
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(index.mips.data()), index.mips.size() * sizeof(Mip));
+        file.write(reinterpret_cast<const char*>(index.tiles.data()), index.tiles.size() * sizeof(Tile));
+
+        for (size_t i = 0; i < tiles.size(); i++) {
+            const std::streamoff padding = static_cast<std::streamoff>(index.tiles[i].offset) - file.tellp();
+            if (padding > 0) {
+                const char zeros[TileAlignment] = {};
+                file.write(zeros, padding);
+            }
+            file.write(reinterpret_cast<const char*>(tiles[i].data()), tiles[i].size());
+        }
+        return static_cast<bool>(file);
+    }
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "../stdafx.h"
+
+// Tiled texture for virtual texturing (.vtex, written by the TextureBaker with --virtual). Every mip level is cut
+// into tiles of tileSize x tileSize texels plus a border of border texels on each side (copied from the neighbors,
+// so bilinear filtering inside a tile never needs another tile), each tile compressed on its own. The mip chain
+// stops at the first level that fits into one tile.
+//
+//   Header | Mip[mipCount] | Tile[tileCount] | tile data
+//
+// Tiles of a level are stored row by row, levels largest first. Edge tiles are full size: past the image the
+// texels wrap around horizontally and repeat the last row vertically (planet maps are equirectangular).
+namespace VirtualTextureFile {
+
+    constexpr uint32_t Magic = 0x58455456; // "VTEX"
+    constexpr uint32_t Version = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t format;        // VkFormat of the tiles
+        uint32_t width;
+        uint32_t height;
+        uint32_t tileSize;
+        uint32_t border;
+        uint32_t mipCount;
+        uint32_t tileCount;
+        uint32_t reserved[3];
+    };
+    static_assert(sizeof(Header) == 48, "Virtual texture header must be tightly packed");
+
+    struct Mip {
+        uint32_t width;
+        uint32_t height;
+        uint32_t tilesX;
+        uint32_t tilesY;
+        uint32_t firstTile;     // Index of the level's first tile
+        uint32_t reserved[3];
+    };
+    static_assert(sizeof(Mip) == 32, "Virtual texture mip must be tightly packed");
+
+    struct Tile {
+        uint64_t offset;        // From the start of the file
+        uint32_t size;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(Tile) == 16, "Virtual texture tile must be tightly packed");
+
+    // Everything but the tile data
+    struct Index {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t tileSize = 0;
+        uint32_t border = 0;
+        std::vector<Mip> mips;
+        std::vector<Tile> tiles;
+
+        uint32_t getPaddedTileSize() const { return tileSize + 2 * border; }
+        uint32_t getTileIndex(uint32_t mip, uint32_t x, uint32_t y) const { return mips[mip].firstTile + y * mips[mip].tilesX + x; }
+    };
+
+    // Levels and tiles of a width x height image
+    Index createIndex(VkFormat format, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t border);
+
+    // From the start of the file (at least the header, the mips and the tile table)
+    bool readIndex(const uint8_t* data, size_t size, Index& index);
+
+    // Looks in the asset pack first
+    bool loadIndex(const std::string& path, Index& index);
+
+    // tiles[i] is tile i of the index, the offsets and sizes of the index are filled in
+    bool save(const std::string& path, Index& index, const std::vector<std::vector<uint8_t>>& tiles);
+
+}
@@ -1,19 +1,168 @@
 #include "stdafx.h"
 #include "Window.h"
+#include "Headless.h"
+#include "loader/AssetPack.h"
+#include "loader/TextureLoader.h"
+#include "loader/TextureResidency.h"
+#include "models/AsteroidBelt.h"
+#include "GpuCulling.h"
+#include "utilities/Tracer.h"
+
+
+namespace {
+
+    // Numeric option values, throw std::invalid_argument or std::out_of_range on malformed input
+    uint32_t parseUInt32(const std::string& value)
+    {
+        if (value.empty() || value[0] == '-') throw std::invalid_argument(value);
+        size_t end = 0;
+        const unsigned long long number = std::stoull(value, &end);
+        if (end != value.size()) throw std::invalid_argument(value);
+        if (number > UINT32_MAX) throw std::out_of_range(value);
+        return static_cast<uint32_t>(number);
+    }
+
+    // Window and headless sizes, 0 is no image and the window takes 16 bits
+    uint32_t parseExtent(const std::string& value)
+    {
+        const uint32_t number = parseUInt32(value);
+        if (number == 0) throw std::invalid_argument(value);
+        if (number > UINT16_MAX) throw std::out_of_range(value);
+        return number;
+    }
+
+    double parseDouble(const std::string& value)
+    {
+        size_t end = 0;
+        const double number = std::stod(value, &end);
+        if (end != value.size()) throw std::invalid_argument(value);
+        return number;
+    }
+
+}
+
 
 int main(int argc, char* argv[]) {
-    //Create a window
+    // Command line options
+    bool headless = false;
+    bool benchStartup = false;
+    uint32_t width = 1800;
+    uint32_t height = 900;
+    uint32_t frameCount = 1;
+    std::string outputDir;
+    std::string tracePath;
+    std::string packPath = "assets.pack";
+    std::string assetOrderPath;
+    SwapChainParams swapChainParams{};
+    FramePacerParams pacerParams{};
+
+    // Numbers are parsed in here, a malformed value ends the program with an error instead of an exception
+    int i = 1;
+    std::string arg;
+    try {
+        for (; i < argc; i++) {
+            arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--headless") {
+                headless = true;
+            } else if (arg == "--frames" && hasValue) {
+                frameCount = parseUInt32(argv[++i]);
+            } else if (arg == "--width" && hasValue) {
+                width = parseExtent(argv[++i]);
+            } else if (arg == "--height" && hasValue) {
+                height = parseExtent(argv[++i]);
+            } else if (arg == "--output" && hasValue) {
+                outputDir = argv[++i];
+            } else if (arg == "--trace" && hasValue) {
+                tracePath = argv[++i];
+            } else if (arg == "--pacing" && hasValue) {
+                std::string value = argv[++i];
+                auto mode = FramePacer::modeFromString(value);
+                if (mode.has_value()) pacerParams.mode = mode.value();
+                else spdlog::warn("Unknown pacing mode: {} (expected uncapped, target or vsync)", value);
+            } else if (arg == "--target-fps" && hasValue) {
+                pacerParams.targetFps = parseDouble(argv[++i]);
+                pacerParams.mode = PacingMode::TargetFps;
+            } else if (arg == "--present-mode" && hasValue) {
+                std::string value = argv[++i];
+                swapChainParams.presentMode = VulkanHelper::presentModeFromString(value);
+                if (!swapChainParams.presentMode.has_value()) spdlog::warn("Unknown present mode: {} (expected immediate, mailbox, fifo or fifo-relaxed)", value);
+            } else if (arg == "--frames-in-flight" && hasValue) {
+                swapChainParams.framesInFlight = parseUInt32(argv[++i]);
+            } else if (arg == "--decode-threads" && hasValue) {
+                TextureLoaderParams loaderParams = TextureLoader::getDefaultParams();
+                loaderParams.maxThreads = parseUInt32(argv[++i]);
+                TextureLoader::setDefaultParams(loaderParams);
+            } else if (arg == "--texture-budget" && hasValue) {
+                TextureResidencyParams residencyParams = TextureResidency::getDefaultParams();
+                residencyParams.budgetMB = parseUInt32(argv[++i]);
+                TextureResidency::setDefaultParams(residencyParams);
+            } else if (arg == "--asteroids" && hasValue) {
+                AsteroidBeltParams beltParams = AsteroidBelt::getDefaultParams();
+                beltParams.count = parseUInt32(argv[++i]);
+                AsteroidBelt::setDefaultParams(beltParams);
+            } else if (arg == "--gpu-culling") {
+                GpuCullingParams cullingParams = GpuCulling::getDefaultParams();
+                cullingParams.enabled = true;
+                GpuCulling::setDefaultParams(cullingParams);
+            } else if (arg == "--bench-startup") {
+                benchStartup = true;
+            } else if (arg == "--pack" && hasValue) {
+                packPath = argv[++i];
+            } else if (arg == "--no-pack") {
+                packPath.clear();
+            } else if (arg == "--record-asset-order" && hasValue) {
+                assetOrderPath = argv[++i];
+            } else {
+                spdlog::warn("Unknown argument: {}", arg);
+            }
+        }
+    } catch (const std::logic_error&) {
+        // std::invalid_argument and std::out_of_range, i is at the value
+        spdlog::error("Invalid value for {}: {}", arg, i < argc ? argv[i] : "");
+        return EXIT_FAILURE;
+    }
+
+    // Create the tracer on the main thread before anything else records into it
+    Tracer::getInstance();
+
+    // Assets come from the pack when there is one, loose files otherwise
+    if (!packPath.empty() && std::filesystem::exists(packPath)) {
+        AssetPack::getInstance()->open(packPath);
+    }
+    if (!assetOrderPath.empty()) AssetPack::getInstance()->startRecording();
+
+    int exitCode = EXIT_SUCCESS;
     try{
-        Window window;
-        if (!window.initialize("VulkanEngine", 1800, 900)) return EXIT_FAILURE;
+        if (benchStartup) {
+            // Scene load times for increasing decode thread counts, offscreen
+            swapChainParams.headlessExtent = { width, height };
+            Headless::benchmarkStartup(swapChainParams);
+        } else if (headless) {
+            // Render offscreen without a window
+            swapChainParams.headlessExtent = { width, height };
+            Headless app;
+            if (!app.initialize(swapChainParams)) return EXIT_FAILURE;
+            app.renderFrames(frameCount, outputDir);
+        } else {
+            //Create a window
+            Window window;
+            if (!window.initialize("VulkanEngine", static_cast<uint16_t>(width), static_cast<uint16_t>(height), swapChainParams, pacerParams)) return EXIT_FAILURE;
 
-        // Start the rendering loop
-        window.startRenderingLoop();
+            // Start the rendering loop
+            window.startRenderingLoop();
+        }
         
     } catch (const std::exception& e) {
         spdlog::error("{}", e.what());
-        return EXIT_FAILURE;
+        exitCode = EXIT_FAILURE;
     }
 
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    // Write the CPU timeline (includes startup and shutdown)
+    if (!tracePath.empty()) Tracer::getInstance()->dumpChromeTrace(tracePath);
+
+    // Input for the AssetPacker --order option
+    if (!assetOrderPath.empty()) AssetPack::getInstance()->saveRecordedOrder(assetOrderPath);
+
+    return exitCode;
+}
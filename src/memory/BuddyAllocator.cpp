@@ -0,0 +1,91 @@
+#include "BuddyAllocator.h"
+
+
+namespace {
+    bool isPowerOfTwo(uint64_t value)
+    {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+
+    uint64_t nextPowerOfTwo(uint64_t value)
+    {
+        uint64_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+}
+
+
+BuddyAllocator::BuddyAllocator(uint64_t capacity, uint64_t minBlockSize)
+    : _capacity(capacity), _minBlockSize(minBlockSize)
+{
+    if (!isPowerOfTwo(capacity) || !isPowerOfTwo(minBlockSize) || minBlockSize > capacity) {
+        throw std::runtime_error("Buddy allocator capacity and minimum block size must be powers of two!");
+    }
+
+    _levelCount = 1;
+    while ((capacity >> (_levelCount - 1)) > minBlockSize) _levelCount++;
+
+    _freeLists.resize(_levelCount);
+    _freeLists[0].insert(0);
+}
+
+
+std::optional<uint64_t> BuddyAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    uint64_t blockSize = std::max({ nextPowerOfTwo(std::max<uint64_t>(size, 1)), nextPowerOfTwo(std::max<uint64_t>(alignment, 1)), _minBlockSize });
+    if (blockSize > _capacity) return std::nullopt;
+
+    uint32_t level = 0;
+    while (getBlockSize(level) > blockSize) level++;
+
+    // Smallest free block that fits, then split it down to the requested level
+    int32_t found = static_cast<int32_t>(level);
+    while (found >= 0 && _freeLists[found].empty()) found--;
+    if (found < 0) return std::nullopt;
+
+    uint64_t offset = *_freeLists[found].begin();
+    _freeLists[found].erase(_freeLists[found].begin());
+    for (uint32_t l = static_cast<uint32_t>(found) + 1; l <= level; l++) {
+        _freeLists[l].insert(offset + getBlockSize(l)); // Upper half stays free
+    }
+
+    _allocated[offset] = level;
+    _usedBytes += blockSize;
+    return offset;
+}
+
+
+void BuddyAllocator::free(uint64_t offset)
+{
+    auto it = _allocated.find(offset);
+    if (it == _allocated.end()) {
+        spdlog::error("Buddy allocator: freeing unknown offset {}", offset);
+        return;
+    }
+
+    uint32_t level = it->second;
+    _allocated.erase(it);
+    _usedBytes -= getBlockSize(level);
+
+    // Merge upwards while the buddy is free too
+    while (level > 0) {
+        uint64_t buddy = offset ^ getBlockSize(level);
+        auto buddyIt = _freeLists[level].find(buddy);
+        if (buddyIt == _freeLists[level].end()) break;
+
+        _freeLists[level].erase(buddyIt);
+        offset = std::min(offset, buddy);
+        level--;
+    }
+    _freeLists[level].insert(offset);
+}
+
+
+uint64_t BuddyAllocator::getLargestFreeBlock() const
+{
+    for (uint32_t level = 0; level < _levelCount; level++) {
+        if (!_freeLists[level].empty()) return getBlockSize(level);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+#include "../stdafx.h"
+
+
+// Binary buddy allocator over the range [0, capacity). It only hands out offsets, the memory is owned by the caller.
+// Every block is a power of two and aligned to its own size, so any power of two alignment up to the
+// requested size comes for free. Freed blocks are merged with their buddy as soon as both are free.
+class BuddyAllocator
+{
+public:
+    // capacity and minBlockSize must be powers of two
+    BuddyAllocator(uint64_t capacity, uint64_t minBlockSize = 256);
+
+    // Returns the offset of a block of at least size bytes, or nothing if no block is large enough
+    std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment);
+    void free(uint64_t offset);
+
+    uint64_t getCapacity() const { return _capacity; }
+    uint64_t getUsedBytes() const { return _usedBytes; } // Including the rounding up to powers of two
+    uint64_t getFreeBytes() const { return _capacity - _usedBytes; }
+    uint64_t getLargestFreeBlock() const;
+    uint32_t getAllocationCount() const { return static_cast<uint32_t>(_allocated.size()); }
+    bool isEmpty() const { return _allocated.empty(); }
+
+private:
+    uint64_t _capacity;
+    uint64_t _minBlockSize;
+
+    // Level 0 is the whole range, blocks of level n are capacity >> n bytes
+    uint32_t _levelCount;
+    std::vector<std::set<uint64_t>> _freeLists; // Ordered, so the lowest offset is handed out first
+    std::unordered_map<uint64_t, uint32_t> _allocated; // Offset -> level
+    uint64_t _usedBytes = 0;
+
+    uint64_t getBlockSize(uint32_t level) const { return _capacity >> level; }
+};
@@ -0,0 +1,81 @@
+#include "FrameAllocator.h"
+#include "../VulkanHelper.h"
+
+
+FrameAllocator::FrameAllocator(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight, VkDeviceSize frameSize)
+    : _ctx(std::move(ctx)), _framesInFlight(framesInFlight)
+{
+    _alignment = getDeviceAlignment(_ctx);
+
+    // Keep every region aligned, so offsets within a region stay aligned in the buffer
+    _frameSize = (frameSize + _alignment - 1) / _alignment * _alignment;
+
+    VulkanHelper::createBuffer(_ctx,
+        _frameSize * _framesInFlight,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        _buffer, _allocation);
+
+    spdlog::info("Frame allocator created successfully ({} KB per frame, {} byte alignment)", _frameSize / 1024, _alignment);
+}
+
+
+FrameAllocator::~FrameAllocator()
+{
+    VulkanHelper::destroyBuffer(_ctx, _buffer, _allocation);
+}
+
+
+VkDeviceSize FrameAllocator::getDeviceAlignment(const std::shared_ptr<VulkanContext>& ctx)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(ctx->physicalDevice, &properties);
+    return std::max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
+}
+
+
+VkDeviceSize FrameAllocator::getFrameSize(const std::shared_ptr<VulkanContext>& ctx, std::initializer_list<VkDeviceSize> allocations)
+{
+    const VkDeviceSize alignment = getDeviceAlignment(ctx);
+    VkDeviceSize frameSize = 0;
+    for (VkDeviceSize size : allocations) {
+        frameSize += (std::max<VkDeviceSize>(size, 1) + alignment - 1) / alignment * alignment;
+    }
+    return frameSize;
+}
+
+
+void FrameAllocator::beginFrame(uint32_t frameIndex)
+{
+    _peakUsage = std::max<VkDeviceSize>(_peakUsage, _head);
+    _currentFrame = frameIndex;
+    _head = 0;
+}
+
+
+FrameAllocation FrameAllocator::allocate(VkDeviceSize size)
+{
+    VkDeviceSize alignedSize = (std::max<VkDeviceSize>(size, 1) + _alignment - 1) / _alignment * _alignment;
+    VkDeviceSize offset = _head.fetch_add(alignedSize);
+    if (offset + alignedSize > _frameSize) {
+        throw std::runtime_error("Frame allocator is out of memory, increase its frame size!");
+    }
+
+    VkDeviceSize bufferOffset = _currentFrame * _frameSize + offset;
+
+    FrameAllocation allocation;
+    allocation.data = static_cast<uint8_t*>(_allocation.mapped) + bufferOffset;
+    allocation.offset = static_cast<uint32_t>(bufferOffset);
+    allocation.size = size;
+    return allocation;
+}
+
+
+VkDescriptorBufferInfo FrameAllocator::getDescriptorInfo(VkDeviceSize range) const
+{
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = _buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = range;
+    return bufferInfo;
+}
\ No newline at end of file
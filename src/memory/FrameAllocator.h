@@ -0,0 +1,72 @@
+#pragma once
+#include "../stdafx.h"
+#include "../VulkanContext.h"
+#include <atomic>
+
+
+// A sub-range of the current frame's region, data is mapped and offset is usable as a dynamic offset
+struct FrameAllocation
+{
+    void* data = nullptr;
+    uint32_t offset = 0;
+    VkDeviceSize size = 0;
+};
+
+
+// Per-frame linear allocator for data that is rewritten every frame (uniforms, per-object constants).
+// One persistently mapped buffer is split into a region per frame in flight. Allocating is an atomic bump of
+// the region's head, and the region is reset when its frame slot comes around again (its fence has signaled).
+// Descriptors point at the whole buffer as UNIFORM_BUFFER_DYNAMIC (or STORAGE_BUFFER_DYNAMIC) and every
+// draw selects its data with a dynamic offset, so one descriptor set serves all frames and objects.
+class FrameAllocator
+{
+public:
+    FrameAllocator(std::shared_ptr<VulkanContext> ctx, uint32_t framesInFlight, VkDeviceSize frameSize = 1024 * 1024);
+    ~FrameAllocator();
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    // Frame size that fits the allocations, each aligned as allocate() aligns it
+    static VkDeviceSize getFrameSize(const std::shared_ptr<VulkanContext>& ctx, std::initializer_list<VkDeviceSize> allocations);
+
+    // Call once the fence of frameIndex has signaled, before anything is allocated for the frame
+    void beginFrame(uint32_t frameIndex);
+
+    // Thread safe. Offsets are aligned for uniform and storage buffers, throws if the frame's region is full.
+    FrameAllocation allocate(VkDeviceSize size);
+
+    // Copies data into the current frame and returns its dynamic offset
+    template<typename T>
+    uint32_t push(const T& data)
+    {
+        FrameAllocation allocation = allocate(sizeof(T));
+        memcpy(allocation.data, &data, sizeof(T));
+        return allocation.offset;
+    }
+
+    VkBuffer getBuffer() const { return _buffer; }
+
+    // For dynamic descriptors: the buffer from offset 0, range is the size of the struct the shader reads
+    VkDescriptorBufferInfo getDescriptorInfo(VkDeviceSize range) const;
+
+    VkDeviceSize getAlignment() const { return _alignment; }
+    VkDeviceSize getFrameSize() const { return _frameSize; }
+    VkDeviceSize getPeakUsage() const { return _peakUsage; } // Most bytes used by a single frame so far
+
+private:
+    static VkDeviceSize getDeviceAlignment(const std::shared_ptr<VulkanContext>& ctx);
+
+    std::shared_ptr<VulkanContext> _ctx;
+
+    uint32_t _framesInFlight;
+    VkDeviceSize _frameSize;
+    VkDeviceSize _alignment = 256;
+
+    VkBuffer _buffer = VK_NULL_HANDLE;
+    Allocation _allocation;
+
+    uint32_t _currentFrame = 0;
+    std::atomic<VkDeviceSize> _head = 0; // Bytes used in the current frame's region
+    VkDeviceSize _peakUsage = 0;
+};
@@ -0,0 +1,320 @@
+#include "MemoryAllocator.h"
+
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocatorParams params)
+    : _physicalDevice(physicalDevice), _device(device), _params(params)
+{
+    vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+    _maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+    // Two pools per memory type (linear and optimal resources), blocks stay well below the size of their heap
+    _pools.resize(_memoryProperties.memoryTypeCount * 2);
+    for (uint32_t type = 0; type < _memoryProperties.memoryTypeCount; type++) {
+        VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[type].heapIndex].size;
+        VkDeviceSize blockSize = _params.blockSize;
+        while (blockSize > heapSize / 8 && blockSize > 1024 * 1024) blockSize >>= 1;
+
+        for (uint32_t optimal = 0; optimal < 2; optimal++) {
+            Pool& pool = _pools[type * 2 + optimal];
+            pool.memoryType = type;
+            pool.optimal = optimal == 1;
+            pool.blockSize = blockSize;
+        }
+    }
+
+    spdlog::info("Memory allocator created successfully (block size {} MB, {} memory types)", _params.blockSize / (1024 * 1024), _memoryProperties.memoryTypeCount);
+}
+
+
+MemoryAllocator::~MemoryAllocator()
+{
+    uint32_t leaked = 0;
+    for (auto& pool : _pools) {
+        for (auto& block : pool.blocks) {
+            if (!block.allocator) continue;
+            leaked += block.allocator->getAllocationCount();
+            vkFreeMemory(_device, block.memory, nullptr);
+        }
+    }
+    for (auto& [memory, dedicated] : _dedicated) {
+        leaked++;
+        vkFreeMemory(_device, memory, nullptr);
+    }
+
+    if (leaked > 0) {
+        spdlog::warn("Memory allocator destroyed with {} live allocations", leaked);
+    }
+}
+
+
+Allocation MemoryAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, MemoryCategory category)
+{
+    VkMemoryDedicatedRequirements dedicatedRequirements{};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryRequirements2 requirements{};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    requirements.pNext = &dedicatedRequirements;
+
+    VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    requirementsInfo.buffer = buffer;
+    vkGetBufferMemoryRequirements2(_device, &requirementsInfo, &requirements);
+
+    bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+    Allocation allocation = allocateInternal(requirements.memoryRequirements, properties, category, false, dedicated, buffer, VK_NULL_HANDLE);
+    if (allocation.isValid()) {
+        vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset);
+    }
+    return allocation;
+}
+
+
+Allocation MemoryAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, MemoryCategory category)
+{
+    VkMemoryDedicatedRequirements dedicatedRequirements{};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryRequirements2 requirements{};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    requirements.pNext = &dedicatedRequirements;
+
+    VkImageMemoryRequirementsInfo2 requirementsInfo{};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    requirementsInfo.image = image;
+    vkGetImageMemoryRequirements2(_device, &requirementsInfo, &requirements);
+
+    bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+    Allocation allocation = allocateInternal(requirements.memoryRequirements, properties, category, true, dedicated, VK_NULL_HANDLE, image);
+    if (allocation.isValid()) {
+        vkBindImageMemory(_device, image, allocation.memory, allocation.offset);
+    }
+    return allocation;
+}
+
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category, bool optimal, bool dedicated)
+{
+    return allocateInternal(requirements, properties, category, optimal, dedicated, VK_NULL_HANDLE, VK_NULL_HANDLE);
+}
+
+
+Allocation MemoryAllocator::allocateInternal(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category, bool optimal,
+    bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::optional<uint32_t> memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    if (!memoryType.has_value()) {
+        spdlog::error("Failed to find suitable memory type!");
+        return {};
+    }
+
+    uint32_t poolIndex = memoryType.value() * 2 + (optimal ? 1 : 0);
+    Pool& pool = _pools[poolIndex];
+    VkDeviceSize dedicatedThreshold = _params.dedicatedThreshold > 0 ? _params.dedicatedThreshold : pool.blockSize / 2;
+
+    Allocation allocation{};
+    allocation.size = requirements.size;
+    allocation.category = category;
+    allocation.pool = poolIndex;
+
+    if (dedicated || requirements.size > dedicatedThreshold) {
+        void* mapped = nullptr;
+        VkDeviceMemory memory = allocateDeviceMemory(requirements.size, memoryType.value(), &mapped, dedicatedBuffer, dedicatedImage);
+        if (memory == VK_NULL_HANDLE) return {};
+
+        _dedicated[memory] = { requirements.size, category };
+        allocation.memory = memory;
+        allocation.mapped = mapped;
+    } else {
+        // First block with room, lower blocks fill up first
+        uint32_t blockIndex = UINT32_MAX;
+        std::optional<uint64_t> offset;
+        for (uint32_t b = 0; b < pool.blocks.size() && !offset.has_value(); b++) {
+            if (!pool.blocks[b].allocator) continue;
+            offset = pool.blocks[b].allocator->allocate(requirements.size, requirements.alignment);
+            if (offset.has_value()) blockIndex = b;
+        }
+
+        if (!offset.has_value()) {
+            Block block;
+            block.memory = allocateDeviceMemory(pool.blockSize, memoryType.value(), &block.mapped, VK_NULL_HANDLE, VK_NULL_HANDLE);
+            if (block.memory == VK_NULL_HANDLE) return {};
+            block.allocator = std::make_unique<BuddyAllocator>(pool.blockSize);
+            offset = block.allocator->allocate(requirements.size, requirements.alignment);
+
+            // Reuse the slot of a released block, so the indices of live allocations stay valid
+            auto freeSlot = std::find_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& b) { return !b.allocator; });
+            if (freeSlot != pool.blocks.end()) {
+                blockIndex = static_cast<uint32_t>(freeSlot - pool.blocks.begin());
+                *freeSlot = std::move(block);
+            } else {
+                blockIndex = static_cast<uint32_t>(pool.blocks.size());
+                pool.blocks.push_back(std::move(block));
+            }
+        }
+
+        const Block& block = pool.blocks[blockIndex];
+        allocation.memory = block.memory;
+        allocation.offset = offset.value();
+        allocation.block = blockIndex;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset.value() : nullptr;
+    }
+
+    _categoryBytes[static_cast<size_t>(category)] += requirements.size;
+    _categoryCounts[static_cast<size_t>(category)]++;
+    _requestedBytes += requirements.size;
+    return allocation;
+}
+
+
+void MemoryAllocator::free(Allocation& allocation)
+{
+    if (!allocation.isValid()) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (allocation.isDedicated()) {
+        // Freeing implicitly unmaps
+        vkFreeMemory(_device, allocation.memory, nullptr);
+        _dedicated.erase(allocation.memory);
+    } else {
+        Pool& pool = _pools[allocation.pool];
+        Block& block = pool.blocks[allocation.block];
+        block.allocator->free(allocation.offset);
+
+        // Keep one block per pool around, so a pool that is emptied and refilled does not reallocate
+        if (block.allocator->isEmpty()) {
+            uint32_t liveBlocks = 0;
+            for (const auto& b : pool.blocks) {
+                if (b.allocator) liveBlocks++;
+            }
+            if (liveBlocks > 1) {
+                vkFreeMemory(_device, block.memory, nullptr);
+                block = Block{};
+            }
+        }
+    }
+
+    _categoryBytes[static_cast<size_t>(allocation.category)] -= allocation.size;
+    _categoryCounts[static_cast<size_t>(allocation.category)]--;
+    _requestedBytes -= allocation.size;
+    allocation = Allocation{};
+}
+
+
+MemoryStats MemoryAllocator::getStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    MemoryStats stats{};
+    stats.maxDeviceMemoryCount = _maxAllocationCount;
+
+    VkDeviceSize freeBytes = 0;
+    VkDeviceSize largestFreeBytes = 0;
+    for (const auto& pool : _pools) {
+        for (const auto& block : pool.blocks) {
+            if (!block.allocator) continue;
+            stats.blockCount++;
+            stats.reservedBytes += block.allocator->getCapacity();
+            stats.usedBytes += block.allocator->getUsedBytes();
+            stats.allocationCount += block.allocator->getAllocationCount();
+            freeBytes += block.allocator->getFreeBytes();
+            largestFreeBytes += block.allocator->getLargestFreeBlock();
+        }
+    }
+
+    for (const auto& [memory, dedicated] : _dedicated) {
+        stats.dedicatedCount++;
+        stats.allocationCount++;
+        stats.reservedBytes += dedicated.size;
+        stats.usedBytes += dedicated.size;
+    }
+
+    stats.deviceMemoryCount = stats.blockCount + stats.dedicatedCount;
+    stats.requestedBytes = _requestedBytes;
+    stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(static_cast<double>(largestFreeBytes) / static_cast<double>(freeBytes)) : 0.0f;
+    stats.categoryBytes = _categoryBytes;
+    stats.categoryCounts = _categoryCounts;
+    return stats;
+}
+
+
+void MemoryAllocator::logStats() const
+{
+    MemoryStats stats = getStats();
+    auto toMB = [](VkDeviceSize bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+
+    spdlog::info("GPU memory: {} allocations in {} device memory objects ({} blocks, {} dedicated, limit {})",
+        stats.allocationCount, stats.deviceMemoryCount, stats.blockCount, stats.dedicatedCount, stats.maxDeviceMemoryCount);
+    spdlog::info("GPU memory: {:.1f} MB reserved, {:.1f} MB used, {:.1f} MB requested, fragmentation {:.1f}%",
+        toMB(stats.reservedBytes), toMB(stats.usedBytes), toMB(stats.requestedBytes), stats.fragmentation * 100.0f);
+    for (size_t i = 0; i < stats.categoryBytes.size(); i++) {
+        if (stats.categoryCounts[i] == 0) continue;
+        spdlog::info("  {:<14} {:>5} allocations {:>9.2f} MB", categoryToString(static_cast<MemoryCategory>(i)), stats.categoryCounts[i], toMB(stats.categoryBytes[i]));
+    }
+}
+
+
+const char* MemoryAllocator::categoryToString(MemoryCategory category)
+{
+    switch (category) {
+        case MemoryCategory::UniformBuffer: return "UniformBuffer";
+        case MemoryCategory::Geometry: return "Geometry";
+        case MemoryCategory::Staging: return "Staging";
+        case MemoryCategory::Readback: return "Readback";
+        case MemoryCategory::Texture: return "Texture";
+        case MemoryCategory::Attachment: return "Attachment";
+        case MemoryCategory::Other: return "Other";
+        default: return "Unknown";
+    }
+}
+
+
+std::optional<uint32_t> MemoryAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+    for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+
+bool MemoryAllocator::isHostVisible(uint32_t memoryType) const
+{
+    return (_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped, VkBuffer dedicatedBuffer, VkImage dedicatedImage)
+{
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = dedicatedBuffer;
+    dedicatedInfo.image = dedicatedImage;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = (dedicatedBuffer != VK_NULL_HANDLE || dedicatedImage != VK_NULL_HANDLE) ? &dedicatedInfo : nullptr;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        spdlog::error("Failed to allocate {} bytes of device memory (type {})!", size, memoryType);
+        return VK_NULL_HANDLE;
+    }
+
+    // Host visible memory is mapped once for its whole lifetime
+    *mapped = nullptr;
+    if (isHostVisible(memoryType)) {
+        vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+    }
+    return memory;
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+#include "../stdafx.h"
+#include "BuddyAllocator.h"
+#include <mutex>
+
+
+// What an allocation is used for (statistics only)
+enum class MemoryCategory
+{
+    UniformBuffer,
+    Geometry,       // Vertex, index and storage buffers
+    Staging,        // Host visible upload buffers
+    Readback,       // Host visible download buffers
+    Texture,
+    Attachment,     // Framebuffer and render graph images
+    Other,
+    Count
+};
+
+
+// A range of a VkDeviceMemory. Bind buffers and images at memory + offset.
+struct Allocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;             // Host visible memory stays mapped, this already points at offset
+    MemoryCategory category = MemoryCategory::Other;
+
+    uint32_t pool = UINT32_MAX;
+    uint32_t block = UINT32_MAX;        // UINT32_MAX for dedicated allocations
+
+    bool isValid() const { return memory != VK_NULL_HANDLE; }
+    bool isDedicated() const { return block == UINT32_MAX; }
+};
+
+
+struct MemoryStats
+{
+    uint32_t deviceMemoryCount = 0;         // vkAllocateMemory objects alive (blocks + dedicated)
+    uint32_t maxDeviceMemoryCount = 0;      // maxMemoryAllocationCount
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+
+    VkDeviceSize reservedBytes = 0;         // Size of all blocks and dedicated allocations
+    VkDeviceSize usedBytes = 0;             // Handed out (block sizes include the buddy rounding)
+    VkDeviceSize requestedBytes = 0;        // What was asked for
+
+    // 1 - largest free block / free bytes, over all blocks (0 when all free memory is in one piece per block)
+    float fragmentation = 0.0f;
+
+    std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)> categoryBytes{};
+    std::array<uint32_t, static_cast<size_t>(MemoryCategory::Count)> categoryCounts{};
+};
+
+
+struct MemoryAllocatorParams
+{
+    // Size of the blocks allocations are carved from (power of two, smaller on small heaps)
+    VkDeviceSize blockSize = 64ull * 1024 * 1024;
+
+    // Larger requests get their own VkDeviceMemory (0 means half a block)
+    VkDeviceSize dedicatedThreshold = 0;
+};
+
+
+// Sub-allocates device memory so the engine needs a handful of vkAllocateMemory calls instead of one per resource.
+// There is one pool of buddy-allocated blocks per memory type and resource kind: linear resources (buffers)
+// and optimal images never share a block, so bufferImageGranularity never has to be considered.
+// Large images, and resources the driver asks a dedicated allocation for, get their own VkDeviceMemory.
+class MemoryAllocator
+{
+public:
+    MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocatorParams params = {});
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    // Allocate memory for the resource and bind it. Returns an invalid allocation on failure.
+    Allocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, MemoryCategory category);
+    Allocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties, MemoryCategory category);
+
+    // Memory without a resource (e.g. shared by aliased images), optimal selects the pool of optimal tiling images
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category, bool optimal, bool dedicated = false);
+    void free(Allocation& allocation);
+
+    MemoryStats getStats() const;
+    void logStats() const;
+
+    static const char* categoryToString(MemoryCategory category);
+
+private:
+    VkPhysicalDevice _physicalDevice;
+    VkDevice _device;
+    MemoryAllocatorParams _params;
+    VkPhysicalDeviceMemoryProperties _memoryProperties;
+    uint32_t _maxAllocationCount = 0;
+
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        std::unique_ptr<BuddyAllocator> allocator;
+    };
+
+    struct Pool {
+        uint32_t memoryType = 0;
+        bool optimal = false;
+        VkDeviceSize blockSize = 0;
+        std::vector<Block> blocks; // Released blocks leave an empty slot, allocations keep their index
+    };
+    std::vector<Pool> _pools; // Indexed by memoryType * 2 + optimal
+
+    struct Dedicated {
+        VkDeviceSize size = 0;
+        MemoryCategory category = MemoryCategory::Other;
+    };
+    std::unordered_map<VkDeviceMemory, Dedicated> _dedicated;
+
+    // Per live allocation (not per block), for the statistics
+    std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)> _categoryBytes{};
+    std::array<uint32_t, static_cast<size_t>(MemoryCategory::Count)> _categoryCounts{};
+    VkDeviceSize _requestedBytes = 0;
+
+    mutable std::mutex _mutex;
+
+    std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+    bool isHostVisible(uint32_t memoryType) const;
+    VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped, VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+    Allocation allocateInternal(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category, bool optimal, bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+};
@@ -0,0 +1,78 @@
+#include "AsteroidBelt.h"
+#include "VirtualTextureSystem.h"
+#include "utilities/ThreadPool.h"
+
+
+AsteroidBeltParams AsteroidBelt::defaultParams{};
+
+
+AsteroidBelt::AsteroidBelt(std::weak_ptr<Model> parent, uint32_t baseColor, AsteroidBeltParams params)
+    : _parent(std::move(parent)), _baseColor(baseColor)
+{
+    std::mt19937 random(params.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    _asteroids.resize(params.count);
+    for (Asteroid& asteroid : _asteroids) {
+        // Denser towards the middle of the belt
+        const float r = 0.5f * (unit(random) + unit(random));
+        asteroid.orbitRadius = glm::mix(params.innerRadius, params.outerRadius, r);
+        asteroid.orbitAtT0 = unit(random) * 360.0f;
+        asteroid.orbitPerSec = params.orbitPerSec * std::pow(params.innerRadius / asteroid.orbitRadius, 1.5f);
+        asteroid.height = normal(random) * params.thickness * 0.5f;
+
+        asteroid.spinAtT0 = unit(random) * 360.0f;
+        asteroid.spinPerSec = (unit(random) - 0.5f) * 0.02f;
+        asteroid.spinAxis = glm::normalize(glm::vec3(normal(random), normal(random), normal(random)) + glm::vec3(0.0f, 1e-4f, 0.0f));
+
+        const float size = glm::mix(params.minSize, params.maxSize, unit(random) * unit(random)); // Mostly small ones
+        asteroid.scale = size * glm::vec3(0.7f + 0.5f * unit(random), 0.6f + 0.4f * unit(random), 0.7f + 0.5f * unit(random));
+
+        // Gray to brown, dull
+        const float brightness = 0.35f + 0.4f * unit(random);
+        const float warmth = unit(random) * 0.15f;
+        asteroid.shading = glm::vec4(brightness * (1.0f + warmth), brightness, brightness * (1.0f - warmth), 0.05f);
+    }
+
+    spdlog::info("Asteroid belt created successfully ({} asteroids)", _asteroids.size());
+}
+
+
+void AsteroidBelt::writeInstances(InstanceData* instances, float t) const
+{
+    glm::vec3 parentPosition = glm::vec3(0.0f);
+    if (auto parent = _parent.lock()) {
+        parentPosition = parent->getPosition();
+    }
+
+    // Chunks of asteroids on the thread pool, tens of thousands of matrices add up
+    constexpr uint32_t chunkSize = 2048;
+    const uint32_t count = getCount();
+    ThreadPool::getInstance()->parallelFor((count + chunkSize - 1) / chunkSize, [&](uint32_t chunk) {
+        const uint32_t end = std::min(count, (chunk + 1) * chunkSize);
+        for (uint32_t i = chunk * chunkSize; i < end; i++) {
+            const Asteroid& asteroid = _asteroids[i];
+
+            // Same orbit direction as Planet::calculateModelMatrix
+            const float orbitAngle = -glm::radians(asteroid.orbitAtT0 + asteroid.orbitPerSec * t);
+            const glm::vec3 position = parentPosition + glm::vec3(
+                asteroid.orbitRadius * std::cos(orbitAngle),
+                asteroid.height,
+                asteroid.orbitRadius * std::sin(orbitAngle));
+
+            const glm::mat3 spin = glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(asteroid.spinAtT0 + asteroid.spinPerSec * t), asteroid.spinAxis));
+
+            InstanceData& instance = instances[i];
+            instance.model = glm::mat4(
+                glm::vec4(spin[0] * asteroid.scale.x, 0.0f),
+                glm::vec4(spin[1] * asteroid.scale.y, 0.0f),
+                glm::vec4(spin[2] * asteroid.scale.z, 0.0f),
+                glm::vec4(position, 1.0f));
+            instance.virtualTextures = glm::uvec2(VirtualTextureSystem::None);
+            instance.baseColor = _baseColor;
+            instance.padding = 0;
+            instance.shading = asteroid.shading;
+        }
+    });
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "stdafx.h"
+#include "interface/Model.h"
+#include "models/InstancedBodies.h"
+
+
+struct AsteroidBeltParams
+{
+    uint32_t count = 20000;
+
+    // Orbit radii of the belt and how far the asteroids spread above and below the orbit plane
+    float innerRadius = 56.0f;
+    float outerRadius = 80.0f;
+    float thickness = 1.5f;
+
+    // Radius of a single asteroid (the mesh has radius 1)
+    float minSize = 0.02f;
+    float maxSize = 0.08f;
+
+    // Degrees per second at the inner radius, further out they are slower (Kepler, r^-1.5)
+    float orbitPerSec = 0.0003f;
+
+    uint32_t seed = 1;
+};
+
+
+// Many small bodies orbiting their parent, drawn through InstancedBodies. The asteroids are generated from the
+// params once, every frame only their orbit and spin angles advance.
+class AsteroidBelt
+{
+public:
+    AsteroidBelt(std::weak_ptr<Model> parent, uint32_t baseColor, AsteroidBeltParams params = getDefaultParams());
+
+    uint32_t getCount() const { return static_cast<uint32_t>(_asteroids.size()); }
+
+    // Writes getCount() instances at time t (as for Planet::calculateModelMatrix)
+    void writeInstances(InstanceData* instances, float t) const;
+
+    // Params used by belts created without explicit ones (set from the command line)
+    static AsteroidBeltParams getDefaultParams() { return defaultParams; }
+    static void setDefaultParams(const AsteroidBeltParams& params) { defaultParams = params; }
+
+private:
+    static AsteroidBeltParams defaultParams;
+
+    std::weak_ptr<Model> _parent;
+    uint32_t _baseColor;
+
+    struct Asteroid {
+        float orbitRadius;
+        float orbitAtT0;            // Degrees
+        float orbitPerSec;
+        float height;               // Above the orbit plane
+        float spinAtT0;             // Degrees
+        float spinPerSec;
+        glm::vec3 spinAxis;
+        glm::vec3 scale;            // Squashed a little, so they are not all spheres
+        glm::vec4 shading;
+    };
+    std::vector<Asteroid> _asteroids;
+};
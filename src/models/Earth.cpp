@@ -22,20 +22,38 @@ Earth::Earth(std::shared_ptr<VulkanContext> ctx,
       _specularTexture(std::move(specularTexture)),
       _overlayColorTexture(std::move(overlayColorTexture))
 {
-    std::vector<Descriptor> descriptors = {
-        Descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _baseColorTexture->getDescriptorInfo()), // Base color texture
-        Descriptor(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _unlitColorTexture->getDescriptorInfo()), // Unlit color texture
-        Descriptor(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _normalMapTexture->getDescriptorInfo()), // Normal map texture
-        Descriptor(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _specularTexture->getDescriptorInfo()), // Specular texture
-        Descriptor(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _overlayColorTexture->getDescriptorInfo()) // Overlay color texture
-    };
-    _descriptorSet = std::make_unique<DescriptorSet>(_ctx, descriptors);
+    BindlessTextures& bindless = *_ctx->bindlessTextures;
+    _unlitColorIndex = bindless.addTexture(_unlitColorTexture->getDescriptorInfo());
+    _normalMapIndex = bindless.addTexture(_normalMapTexture->getDescriptorInfo());
+    _specularIndex = bindless.addTexture(_specularTexture->getDescriptorInfo());
+    _overlayColorIndex = bindless.addTexture(_overlayColorTexture->getDescriptorInfo());
 }
 
 
 Earth::~Earth()
 {
-    // Cleanup resources if needed
+    BindlessTextures& bindless = *_ctx->bindlessTextures;
+    bindless.removeTexture(_unlitColorIndex);
+    bindless.removeTexture(_normalMapIndex);
+    bindless.removeTexture(_specularIndex);
+    bindless.removeTexture(_overlayColorIndex);
+}
+
+
+void Earth::setUnlitColorTexture(std::shared_ptr<Texture2D> texture) { swapTexture(_unlitColorTexture, _unlitColorIndex, std::move(texture)); }
+void Earth::setNormalMapTexture(std::shared_ptr<Texture2D> texture) { swapTexture(_normalMapTexture, _normalMapIndex, std::move(texture)); }
+void Earth::setSpecularTexture(std::shared_ptr<Texture2D> texture) { swapTexture(_specularTexture, _specularIndex, std::move(texture)); }
+void Earth::setOverlayColorTexture(std::shared_ptr<Texture2D> texture) { swapTexture(_overlayColorTexture, _overlayColorIndex, std::move(texture)); }
+
+
+Planet::PushConstants Earth::getPushConstants() const
+{
+    PushConstants constants = Planet::getPushConstants();
+    constants.unlitColor = _unlitColorIndex;
+    constants.normalMap = _normalMapIndex;
+    constants.specular = _specularIndex;
+    constants.overlayColor = _overlayColorIndex;
+    return constants;
 }
 
 
@@ -59,12 +77,12 @@ void Earth::draw(VkCommandBuffer commandBuffer, const Scene& scene)
 
     std::array<VkDescriptorSet, 2> descriptorSets = {
         ssScene->getSceneDescriptorSet()->getDescriptorSet(),        // Scene descriptor set
-        _descriptorSet->getDescriptorSet()                           // My descriptor set
+        _ctx->bindlessTextures->getDescriptorSet()                   // Bindless textures
     };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 0, nullptr);
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 1, &sceneInfoOffset);
 
-    // Push constants for model
-    vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4), &_modelMatrix);
+    pushConstants(commandBuffer, *ssScene, pipeline->getPipelineLayout());
 
     vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_mesh->getIndicesCount()), 1, 0, 0, 0);
 }
@@ -88,11 +106,9 @@ void Earth::drawSelection(VkCommandBuffer commandBuffer, const Scene& scene)
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
     vkCmdBindIndexBuffer(commandBuffer, _mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-    std::array<VkDescriptorSet, 2> descriptorSets = {
-        ssScene->getSceneDescriptorSet()->getDescriptorSet(),        // Scene descriptor set
-        _descriptorSet->getDescriptorSet()                        // My descriptor set
-    };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, selectionPipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 0, nullptr);
+    VkDescriptorSet sceneDescriptorSet = ssScene->getSceneDescriptorSet()->getDescriptorSet();
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, selectionPipeline->getPipelineLayout(), 0, 1, &sceneDescriptorSet, 1, &sceneInfoOffset);
 
     // Push constants for model
     vkCmdPushConstants(commandBuffer, selectionPipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4), &_modelMatrix);
@@ -34,7 +34,17 @@ public:
     void draw(VkCommandBuffer commandBuffer, const Scene& scene) override;
     void drawSelection(VkCommandBuffer commandBuffer, const Scene& scene) override;
 
-    const DescriptorSet* getDescriptorSet() const { return _descriptorSet.get(); }
+    // Swap a texture in (e.g. once it has loaded), safe while frames using the old one are in flight
+    void setUnlitColorTexture(std::shared_ptr<Texture2D> texture);
+    void setNormalMapTexture(std::shared_ptr<Texture2D> texture);
+    void setSpecularTexture(std::shared_ptr<Texture2D> texture);
+    void setOverlayColorTexture(std::shared_ptr<Texture2D> texture);
+
+    // Streams the day and night maps from the scene's VirtualTextureSystem (None keeps the texture)
+    void setVirtualTextures(uint32_t baseColor, uint32_t unlitColor) { _virtualTextures = { baseColor, unlitColor }; }
+
+protected:
+    PushConstants getPushConstants() const override;
 
 private:
     std::shared_ptr<Texture2D> _unlitColorTexture;
@@ -42,5 +52,9 @@ private:
     std::shared_ptr<Texture2D> _specularTexture;
     std::shared_ptr<Texture2D> _overlayColorTexture;
 
-    std::unique_ptr<DescriptorSet> _descriptorSet;
+    // Bindless texture indices
+    uint32_t _unlitColorIndex = BindlessTextures::None;
+    uint32_t _normalMapIndex = BindlessTextures::None;
+    uint32_t _specularIndex = BindlessTextures::None;
+    uint32_t _overlayColorIndex = BindlessTextures::None;
 };
\ No newline at end of file
@@ -12,17 +12,10 @@ GlowSphere::GlowSphere(std::shared_ptr<VulkanContext> ctx,
                          bool isLightSource)
     : Model(ctx, std::move(name), std::move(mesh)), _parent(std::move(parent)), _size(planetSize)
 {
-    _glowSphereInfo.color = color;
-    _glowSphereInfo.coeffScatter = coeffScatter;
-    _glowSphereInfo.powScatter = powScatter;
-    _glowSphereInfo.isLightSource = isLightSource ? 1 : 0;
-    _glowSphereUBO = std::make_unique<UniformBuffer<GlowSphereInfo>>(_ctx);
-    _glowSphereUBO->update(_glowSphereInfo);
-
-    std::vector<Descriptor> descriptors = {
-        Descriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _glowSphereUBO->getDescriptorInfo())
-    };
-    _descriptorSet = std::make_unique<DescriptorSet>(_ctx, descriptors);
+    _pushConstants.color = color;
+    _pushConstants.coeffScatter = coeffScatter;
+    _pushConstants.powScatter = powScatter;
+    _pushConstants.isLightSource = isLightSource ? 1 : 0;
 }
 
 
@@ -63,14 +56,14 @@ void GlowSphere::draw(VkCommandBuffer commandBuffer, const Scene& scene)
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
     vkCmdBindIndexBuffer(commandBuffer, _mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-    std::array<VkDescriptorSet, 2> descriptorSets = {
-        ssScene->getSceneDescriptorSet()->getDescriptorSet(),
-        _descriptorSet->getDescriptorSet()  // Per-model descriptor set
-    };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 0, nullptr);
+    VkDescriptorSet sceneDescriptorSet = ssScene->getSceneDescriptorSet()->getDescriptorSet();
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 1, &sceneDescriptorSet, 1, &sceneInfoOffset);
 
-    // Push constants for model
-    vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4), &_modelMatrix);
+    // Push constants for model and atmosphere
+    PushConstants constants = _pushConstants;
+    constants.model = _modelMatrix;
+    vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &constants);
 
     vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_mesh->getIndicesCount()), 1, 0, 0, 0);
 }
\ No newline at end of file
@@ -25,22 +25,21 @@ public:
 
     void draw(VkCommandBuffer commandBuffer, const Scene& scene) override;
 
-    const DescriptorSet* getDescriptorSet() const { return _descriptorSet.get(); }
-
     void calculateModelMatrix();
 
+    // Model matrix and atmosphere, no descriptor set of its own
+    struct PushConstants {
+        glm::mat4 model;
+        glm::vec4 color;
+        float coeffScatter = 3.0f;
+        float powScatter = 3.0f;
+        int isLightSource = 0;
+    };
+
 private:
 
     std::weak_ptr<Model> _parent;
     float _size = 1.0f;
 
-    struct GlowSphereInfo {
-        alignas(16) glm::vec4 color;
-        alignas(4) float coeffScatter = 3.0f;
-        alignas(4) float powScatter = 3.0f;
-        alignas(4) int isLightSource = 0;
-    } _glowSphereInfo;
-    std::unique_ptr<UniformBuffer<GlowSphereInfo>> _glowSphereUBO;
-
-    std::unique_ptr<DescriptorSet> _descriptorSet;
+    PushConstants _pushConstants;
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "InstancedBodies.h"
+#include "Planet.h"
+#include "AsteroidBelt.h"
+#include "SolarSystemScene.h"
+
+
+InstancedBodies::InstancedBodies(std::shared_ptr<VulkanContext> ctx,
+                                 std::string name,
+                                 std::shared_ptr<DeviceMesh> mesh,
+                                 const FrameAllocator& frameAllocator,
+                                 uint32_t capacity)
+    : Model(ctx, std::move(name), std::move(mesh)), _capacity(std::max(1u, capacity))
+{
+    _modelMatrix = glm::mat4(1.0f);
+
+    // The shaders read the instances from the dynamic offset on, the range covers a full batch (the culling
+    // shader reads it too)
+    _descriptorSet = std::make_unique<DescriptorSet>(_ctx, std::vector<Descriptor>{
+        Descriptor(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 1, frameAllocator.getDescriptorInfo(getFrameBytes(_capacity)))
+    });
+}
+
+
+InstancedBodies::~InstancedBodies()
+{
+}
+
+
+void InstancedBodies::add(std::shared_ptr<Planet> planet)
+{
+    reserve(1);
+    _planets.push_back(std::move(planet));
+}
+
+
+void InstancedBodies::add(std::shared_ptr<AsteroidBelt> belt)
+{
+    reserve(belt->getCount());
+    _belts.push_back(std::move(belt));
+}
+
+
+void InstancedBodies::reserve(uint32_t count)
+{
+    if (count > _capacity - _reserved) {
+        throw std::runtime_error("Instanced bodies " + _name + " are over capacity!");
+    }
+    _reserved += count;
+}
+
+
+void InstancedBodies::update(FrameAllocator& frameAllocator, float t)
+{
+    // The whole range of the descriptor, not only the bodies of this frame
+    FrameAllocation allocation = frameAllocator.allocate(getFrameBytes(_capacity));
+    InstanceData* instances = static_cast<InstanceData*>(allocation.data);
+    _instanceOffset = allocation.offset;
+
+    uint32_t count = 0;
+    for (const auto& planet : _planets) {
+        instances[count++] = planet->getInstanceData();
+    }
+    for (const auto& belt : _belts) {
+        belt->writeInstances(instances + count, t);
+        count += belt->getCount();
+    }
+    _instanceCount = count;
+}
+
+
+void InstancedBodies::addCullingBatch(GpuCulling& culling, float boundingRadius)
+{
+    _cullingBatch = culling.addBatch(_capacity, static_cast<uint32_t>(_mesh->getIndicesCount()), boundingRadius);
+}
+
+
+void InstancedBodies::recordCulling(VkCommandBuffer commandBuffer, GpuCulling& culling) const
+{
+    if (_cullingBatch == NoBatch) return;
+
+    culling.cull(commandBuffer, _cullingBatch, _descriptorSet->getDescriptorSet(), _instanceOffset, _instanceCount);
+}
+
+
+void InstancedBodies::draw(VkCommandBuffer commandBuffer, const Scene& scene)
+{
+    if (_instanceCount == 0) return;
+
+    const SolarSystemScene* ssScene = dynamic_cast<const SolarSystemScene*>(&scene);
+
+    // Culled on the GPU this frame, the culling wrote the draws
+    const GpuCulling* culling = _cullingBatch != NoBatch ? ssScene->getGpuCulling() : nullptr;
+
+    auto pipeline = culling ? _culledPipeline.lock() : _pipeline.lock();
+    if (!pipeline) {
+        spdlog::error("Pipeline is not set for InstancedBodies model.");
+        return;
+    }
+
+    pipeline->bind(commandBuffer);
+
+    VkBuffer vertexBuffers[] = {_mesh->getVertexBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, _mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+    std::array<VkDescriptorSet, 2> descriptorSets = {
+        ssScene->getSceneDescriptorSet()->getDescriptorSet(),        // Scene descriptor set
+        _ctx->bindlessTextures->getDescriptorSet()                   // Bindless textures
+    };
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 1, &sceneInfoOffset);
+
+    ssScene->getVirtualTextureSystem()->bind(commandBuffer, pipeline->getPipelineLayout(), 2);
+
+    VkDescriptorSet instanceDescriptorSet = _descriptorSet->getDescriptorSet();
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 3, 1, &instanceDescriptorSet, 1, &_instanceOffset);
+
+    if (culling) {
+        culling->drawIndirect(commandBuffer, pipeline->getPipelineLayout(), 4, _cullingBatch);
+    } else {
+        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_mesh->getIndicesCount()), _instanceCount, 0, 0, 0);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "stdafx.h"
+#include "VulkanContext.h"
+#include "geometry/DeviceMesh.h"
+#include "interface/Model.h"
+#include "DescriptorSet.h"
+#include "memory/FrameAllocator.h"
+#include "Scene.h"
+#include "Pipeline.h"
+#include "GpuCulling.h"
+
+class Planet;
+class AsteroidBelt;
+
+
+// Per-body data of the instanced planet shader (shaders/include/instances.glsl), std430
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::uvec2 virtualTextures;
+    uint32_t baseColor;             // Bindless texture index
+    uint32_t padding = 0;
+    glm::vec4 shading;              // Tint (rgb, multiplies the base color), specular strength
+};
+static_assert(sizeof(InstanceData) == 96, "InstanceData must match the std430 layout of the shader");
+
+
+// Bodies that share a mesh and the instanced planet pipeline, drawn with one instanced draw. Every frame update()
+// writes the data of all bodies to the frame allocator, the instance set (set 3) selects it with a dynamic offset
+// and the shader indexes it with gl_InstanceIndex.
+// With GPU culling the bodies are culled by a compute pass first and drawn with one indirect command of the
+// survivors, through the culled pipeline (setCulledPipeline).
+// Planets added here keep their textures, selection and feedback draws, only their main pass draw moves here.
+class InstancedBodies : public Model
+{
+public:
+    InstancedBodies(std::shared_ptr<VulkanContext> ctx,
+                    std::string name,
+                    std::shared_ptr<DeviceMesh> mesh,
+                    const FrameAllocator& frameAllocator,
+                    uint32_t capacity);
+
+    ~InstancedBodies();
+
+    // Throws if the bodies do not fit into the capacity
+    void add(std::shared_ptr<Planet> planet);
+    void add(std::shared_ptr<AsteroidBelt> belt);
+
+    // Writes this frame's instances (t as for Planet::calculateModelMatrix), after the planets' model matrices
+    void update(FrameAllocator& frameAllocator, float t);
+
+    void draw(VkCommandBuffer commandBuffer, const Scene& scene) override;
+
+    // Makes the bodies a batch of the culling (the mesh must fit into a sphere of boundingRadius), before its
+    // resources are created
+    void addCullingBatch(GpuCulling& culling, float boundingRadius);
+
+    // Draws the GPU culled bodies, reads the visible indices from the culling set at set 4
+    void setCulledPipeline(std::shared_ptr<Pipeline> pipeline) { _culledPipeline = std::move(pipeline); }
+
+    // Culls this frame's instances, between GpuCulling::beginCulling and endCulling
+    void recordCulling(VkCommandBuffer commandBuffer, GpuCulling& culling) const;
+
+    // Bytes update() allocates from the frame allocator every frame
+    static VkDeviceSize getFrameBytes(uint32_t capacity) { return std::max(1u, capacity) * sizeof(InstanceData); }
+
+    uint32_t getInstanceCount() const { return _instanceCount; }
+    uint32_t getCapacity() const { return _capacity; }
+
+    // Set 3 of the instanced pipelines (every batch has the same layout), bind it with getInstanceOffset()
+    const DescriptorSet* getDescriptorSet() const { return _descriptorSet.get(); }
+    uint32_t getInstanceOffset() const { return _instanceOffset; }
+
+private:
+    uint32_t _capacity;
+    uint32_t _reserved = 0;
+    std::vector<std::shared_ptr<Planet>> _planets;
+    std::vector<std::shared_ptr<AsteroidBelt>> _belts;
+
+    std::unique_ptr<DescriptorSet> _descriptorSet;
+    uint32_t _instanceOffset = 0;
+    uint32_t _instanceCount = 0;
+
+    static constexpr uint32_t NoBatch = UINT32_MAX;
+    uint32_t _cullingBatch = NoBatch;
+    std::weak_ptr<Pipeline> _culledPipeline;
+
+    void reserve(uint32_t count);
+};
@@ -24,16 +24,27 @@ Planet::Planet(std::shared_ptr<VulkanContext> ctx,
     _spinAtT0(spinAtT0),
     _spinPerSec(spinPerSec)
 {
-    std::vector<Descriptor> descriptors = {
-        Descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _baseColorTexture->getDescriptorInfo()), // Base color texture
-    };
-    _descriptorSet = std::make_unique<DescriptorSet>(_ctx, descriptors);
+    _baseColorIndex = _ctx->bindlessTextures->addTexture(_baseColorTexture->getDescriptorInfo());
 }
 
 
 Planet::~Planet()
 {
-    // Cleanup resources if needed
+    _ctx->bindlessTextures->removeTexture(_baseColorIndex);
+}
+
+
+void Planet::setBaseColorTexture(std::shared_ptr<Texture2D> texture)
+{
+    swapTexture(_baseColorTexture, _baseColorIndex, std::move(texture));
+}
+
+
+void Planet::swapTexture(std::shared_ptr<Texture2D>& slot, uint32_t& index, std::shared_ptr<Texture2D> texture)
+{
+    _ctx->deletionQueue.pushObject(std::move(slot));
+    slot = std::move(texture);
+    index = _ctx->bindlessTextures->replaceTexture(index, slot->getDescriptorInfo());
 }
 
 
@@ -81,12 +92,62 @@ void Planet::draw(VkCommandBuffer commandBuffer, const Scene& scene)
 
     std::array<VkDescriptorSet, 2> descriptorSets = {
         ssScene->getSceneDescriptorSet()->getDescriptorSet(),        // Scene descriptor set
-        _descriptorSet->getDescriptorSet()                        // My descriptor set
+        _ctx->bindlessTextures->getDescriptorSet()                   // Bindless textures
     };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 0, nullptr);
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 1, &sceneInfoOffset);
+
+    pushConstants(commandBuffer, *ssScene, pipeline->getPipelineLayout());
+
+    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_mesh->getIndicesCount()), 1, 0, 0, 0);
+}
+
+
+void Planet::pushConstants(VkCommandBuffer commandBuffer, const SolarSystemScene& scene, VkPipelineLayout pipelineLayout) const
+{
+    scene.getVirtualTextureSystem()->bind(commandBuffer, pipelineLayout, 2);
+
+    PushConstants constants = getPushConstants();
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &constants);
+}
+
+
+Planet::PushConstants Planet::getPushConstants() const
+{
+    PushConstants constants{ _modelMatrix, _virtualTextures };
+    constants.baseColor = _baseColorIndex;
+    return constants;
+}
+
+
+InstanceData Planet::getInstanceData() const
+{
+    InstanceData instance{};
+    instance.model = _modelMatrix;
+    instance.virtualTextures = _virtualTextures;
+    instance.baseColor = _baseColorIndex;
+    instance.shading = glm::vec4(1.0f, 1.0f, 1.0f, 0.2f); // As planet.vert passes for single draws
+    return instance;
+}
+
+
+void Planet::drawVirtualTextureFeedback(VkCommandBuffer commandBuffer, const Scene& scene, Pipeline& pipeline)
+{
+    const SolarSystemScene* ssScene = dynamic_cast<const SolarSystemScene*>(&scene);
+
+    pipeline.bind(commandBuffer);
+
+    VkBuffer vertexBuffers[] = {_mesh->getVertexBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, _mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+    // Set 1 (the bindless textures) is not used by the feedback shader
+    VkDescriptorSet sceneDescriptorSet = ssScene->getSceneDescriptorSet()->getDescriptorSet();
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.getPipelineLayout(), 0, 1, &sceneDescriptorSet, 1, &sceneInfoOffset);
 
-    // Push constants for model
-    vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4), &_modelMatrix);
+    pushConstants(commandBuffer, *ssScene, pipeline.getPipelineLayout());
 
     vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_mesh->getIndicesCount()), 1, 0, 0, 0);
 }
@@ -113,7 +174,8 @@ void Planet::drawSelection(VkCommandBuffer commandBuffer, const Scene& scene)
     std::array<VkDescriptorSet, 1> descriptorSets = {
         ssScene->getSceneDescriptorSet()->getDescriptorSet(),
     };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, selectionPipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 0, nullptr);
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, selectionPipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 1, &sceneInfoOffset);
 
     // Push constants for selection
     struct PushConstants {
@@ -7,6 +7,8 @@
 #include "Pipeline.h"
 #include "DescriptorSet.h"
 #include "Scene.h"
+#include "VirtualTextureSystem.h"
+#include "models/InstancedBodies.h"
 
 class Scene;
 class SolarSystemScene;
@@ -14,6 +16,17 @@ class SolarSystemScene;
 class Planet : public SelectableModel
 {
 public:
+    // Push constants of the planet, earth and virtual texture feedback shaders
+    struct PushConstants {
+        glm::mat4 model;
+        glm::uvec2 virtualTextures;
+        uint32_t baseColor = BindlessTextures::None;    // Bindless texture indices
+        uint32_t unlitColor = BindlessTextures::None;   // Earth only from here on
+        uint32_t normalMap = BindlessTextures::None;
+        uint32_t specular = BindlessTextures::None;
+        uint32_t overlayColor = BindlessTextures::None;
+    };
+
     Planet(std::shared_ptr<VulkanContext> ctx, 
            std::string name, 
            std::shared_ptr<DeviceMesh> mesh,
@@ -31,10 +44,21 @@ public:
     void draw(VkCommandBuffer commandBuffer, const Scene& scene) override;
     void drawSelection(VkCommandBuffer commandBuffer, const Scene& scene) override;
 
-    const DescriptorSet* getDescriptorSet() const { return _descriptorSet.get(); }
+    // Marks the virtual texture tiles the planet samples (in the scene's feedback pass)
+    void drawVirtualTextureFeedback(VkCommandBuffer commandBuffer, const Scene& scene, Pipeline& pipeline);
+
+    // Swaps the texture in (e.g. once it has loaded), safe while frames using the old one are in flight
+    void setBaseColorTexture(std::shared_ptr<Texture2D> texture);
+
+    // Streams the base color from the scene's VirtualTextureSystem instead of the texture
+    void setVirtualTexture(uint32_t baseColor) { _virtualTextures.x = baseColor; }
+    bool hasVirtualTexture() const { return _virtualTextures.x != VirtualTextureSystem::None || _virtualTextures.y != VirtualTextureSystem::None; }
 
     void calculateModelMatrix(float t);
 
+    // The planet's entry in an InstancedBodies batch (which then draws it in the main pass)
+    InstanceData getInstanceData() const;
+
 protected:
     std::weak_ptr<Model> _parent;             //Weak pointer to parent planet (if any)
 
@@ -46,6 +70,17 @@ protected:
     float _spinPerSec = 0.0f;
 
     std::shared_ptr<Texture2D> _baseColorTexture;
-    std::unique_ptr<DescriptorSet> _descriptorSet;
+    uint32_t _baseColorIndex = BindlessTextures::None;
+
+    glm::uvec2 _virtualTextures{ VirtualTextureSystem::None, VirtualTextureSystem::None };
+
+    // getPushConstants(), and the virtual texture set (set 2)
+    void pushConstants(VkCommandBuffer commandBuffer, const SolarSystemScene& scene, VkPipelineLayout pipelineLayout) const;
+
+    // Model matrix, virtual texture ids and bindless texture indices
+    virtual PushConstants getPushConstants() const;
+
+    // Swaps a texture and its bindless index, the old ones are released once the frames in flight are done
+    void swapTexture(std::shared_ptr<Texture2D>& slot, uint32_t& index, std::shared_ptr<Texture2D> texture);
 
 };
\ No newline at end of file
@@ -9,10 +9,7 @@ SkyBox::SkyBox(std::shared_ptr<VulkanContext> ctx,
     : Model(std::move(ctx), std::move(name), std::move(mesh)), 
       _cubemapTexture(std::move(cubemapTexture))
 {
-    std::vector<Descriptor> descriptors = {
-        Descriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, _cubemapTexture->getDescriptorInfo()), // Cubemap texture
-    };
-    _descriptorSet = std::make_unique<DescriptorSet>(_ctx, descriptors);
+    _cubemapIndex = _ctx->bindlessTextures->addCubemap(_cubemapTexture->getDescriptorInfo());
 
     _modelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(1500.0f)); // Scale the skybox to a large size
 }
@@ -20,7 +17,7 @@ SkyBox::SkyBox(std::shared_ptr<VulkanContext> ctx,
 
 SkyBox::~SkyBox()
 {
-    // Cleanup resources if needed
+    _ctx->bindlessTextures->removeCubemap(_cubemapIndex);
 }
 
 
@@ -44,12 +41,14 @@ void SkyBox::draw(VkCommandBuffer commandBuffer, const Scene& scene)
 
     std::array<VkDescriptorSet, 2> descriptorSets = {
         ssScene->getSceneDescriptorSet()->getDescriptorSet(),        // Scene descriptor set
-        _descriptorSet->getDescriptorSet()                           // My descriptor set
+        _ctx->bindlessTextures->getDescriptorSet()                   // Bindless textures
     };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 0, nullptr);
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 2, descriptorSets.data(), 1, &sceneInfoOffset);
 
     // Push constants for model
-    vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &_modelMatrix);
+    PushConstants constants{ _modelMatrix, _cubemapIndex };
+    vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &constants);
 
     vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_mesh->getIndicesCount()), 1, 0, 0, 0);
 }
\ No newline at end of file
@@ -20,10 +20,12 @@ public:
 
     void draw(VkCommandBuffer commandBuffer, const Scene& scene) override;
 
-    const DescriptorSet* getDescriptorSet() const { return _descriptorSet.get(); }
+    struct PushConstants {
+        glm::mat4 model;
+        uint32_t cubemap;   // Bindless cubemap index
+    };
 
 private:
     std::shared_ptr<TextureCubemap> _cubemapTexture;
-
-    std::unique_ptr<DescriptorSet> _descriptorSet;
+    uint32_t _cubemapIndex = BindlessTextures::None;
 };
\ No newline at end of file
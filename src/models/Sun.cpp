@@ -47,7 +47,8 @@ void Sun::draw(VkCommandBuffer commandBuffer, const Scene& scene)
     std::array<VkDescriptorSet, 1> descriptorSets = {
         ssScene->getSceneDescriptorSet()->getDescriptorSet() // Scene descriptor set
     };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 0, nullptr);
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 1, &sceneInfoOffset);
 
     // Push constants for model
     vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::mat4), &_modelMatrix);
@@ -77,7 +78,8 @@ void Sun::drawSelection(VkCommandBuffer commandBuffer, const Scene& scene)
     std::array<VkDescriptorSet, 1> descriptorSets = {
         ssScene->getSceneDescriptorSet()->getDescriptorSet(),
     };
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, selectionPipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 0, nullptr);
+    uint32_t sceneInfoOffset = ssScene->getSceneInfoOffset(); // Dynamic offset of the scene set
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, selectionPipeline->getPipelineLayout(), 0, 1, descriptorSets.data(), 1, &sceneInfoOffset);
 
     // Push constants for selection
     struct PushConstants {
@@ -0,0 +1,936 @@
+#include "RenderGraph.h"
+#include "../CommandRecorder.h"
+#include "../GpuProfiler.h"
+#include "../VulkanHelper.h"
+#include "../utilities/Tracer.h"
+
+
+namespace {
+    bool isDepthFormat(VkFormat format)
+    {
+        switch (format) {
+            case VK_FORMAT_D16_UNORM:
+            case VK_FORMAT_X8_D24_UNORM_PACK32:
+            case VK_FORMAT_D32_SFLOAT:
+            case VK_FORMAT_D16_UNORM_S8_UINT:
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    VkAttachmentLoadOp toLoadOp(RGLoad load)
+    {
+        switch (load) {
+            case RGLoad::Clear: return VK_ATTACHMENT_LOAD_OP_CLEAR;
+            case RGLoad::Load: return VK_ATTACHMENT_LOAD_OP_LOAD;
+            case RGLoad::DontCare: return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        }
+        return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    }
+
+    constexpr VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                              | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+                                              | VK_ACCESS_SHADER_WRITE_BIT
+                                              | VK_ACCESS_TRANSFER_WRITE_BIT;
+}
+
+
+RenderGraphPass& RenderGraphPass::addColorOutput(RGResource image, RGLoad load, VkClearColorValue clearColor)
+{
+    _colorOutputs.push_back({ image, RGResource{}, load, clearColor });
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::addResolveOutput(RGResource image)
+{
+    if (_colorOutputs.empty() || _colorOutputs.back().resolve.isValid()) {
+        throw std::runtime_error("Render graph pass " + _name + ": resolve output needs a color output to resolve!");
+    }
+    _colorOutputs.back().resolve = image;
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::setDepthOutput(RGResource image, RGLoad load, float clearDepth)
+{
+    _depthOutput = image;
+    _depthLoad = load;
+    _clearDepth = clearDepth;
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::addTextureInput(RGResource image)
+{
+    _textureInputs.push_back(image);
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::addStorageInput(RGResource image)
+{
+    _storageInputs.push_back(image);
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::addStorageOutput(RGResource image)
+{
+    _storageOutputs.push_back(image);
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::setRecord(RGRecordFunction record, std::function<uint32_t()> chunkCount)
+{
+    _record = std::move(record);
+    _chunkCount = std::move(chunkCount);
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::setProfileGroup(const std::string& group)
+{
+    _profileGroup = group;
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::setCondition(std::function<bool()> condition)
+{
+    _condition = std::move(condition);
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::setSideEffects()
+{
+    _sideEffects = true;
+    return *this;
+}
+
+
+RenderGraph::RenderGraph(std::shared_ptr<VulkanContext> ctx)
+    : _ctx(std::move(ctx))
+{
+}
+
+
+RenderGraph::~RenderGraph()
+{
+    destroyResources(false);
+}
+
+
+RGResource RenderGraph::createImage(const std::string& name, const RGImageDesc& desc)
+{
+    Image image;
+    image.name = name;
+    image.desc = desc;
+    if (isDepthFormat(desc.format)) {
+        image.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        if (VulkanHelper::hasStencilComponent(desc.format)) image.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    _images.push_back(std::move(image));
+    return RGResource{ static_cast<uint32_t>(_images.size() - 1) };
+}
+
+
+RGResource RenderGraph::importImage(const std::string& name, VkFormat format, const std::vector<VkImage>& images, const std::vector<VkImageView>& views, VkImageLayout finalLayout)
+{
+    Image image;
+    image.name = name;
+    image.desc.format = format;
+    image.imported = true;
+    image.importedImages = images;
+    image.importedViews = views;
+    image.finalLayout = finalLayout;
+    _images.push_back(std::move(image));
+    return RGResource{ static_cast<uint32_t>(_images.size() - 1) };
+}
+
+
+void RenderGraph::updateImportedImage(RGResource image, const std::vector<VkImage>& images, const std::vector<VkImageView>& views)
+{
+    if (!image.isValid() || !_images[image.index].imported) {
+        spdlog::error("Render graph: only imported images can be updated!");
+        return;
+    }
+    _images[image.index].importedImages = images;
+    _images[image.index].importedViews = views;
+}
+
+
+RenderGraphPass& RenderGraph::addGraphicsPass(const std::string& name)
+{
+    return addPass(name, RGPassType::Graphics);
+}
+
+
+RenderGraphPass& RenderGraph::addComputePass(const std::string& name)
+{
+    return addPass(name, RGPassType::Compute);
+}
+
+
+RenderGraphPass& RenderGraph::addPass(const std::string& name, RGPassType type)
+{
+    if (findPass(name)) {
+        throw std::runtime_error("Render graph already has a pass named " + name + "!");
+    }
+    PassData data;
+    data.pass.reset(new RenderGraphPass(name, type));
+    _passes.push_back(std::move(data));
+    return *_passes.back().pass;
+}
+
+
+const RenderGraph::PassData* RenderGraph::findPass(const std::string& name) const
+{
+    for (const auto& data : _passes) {
+        if (data.pass->_name == name) return &data;
+    }
+    return nullptr;
+}
+
+
+void RenderGraph::compile(VkExtent2D extent)
+{
+    TRACE_SCOPE("RenderGraph::compile");
+
+    destroyResources(true);
+    _extent = extent;
+
+    for (auto& image : _images) {
+        if (image.imported) {
+            image.extent = extent;
+        } else {
+            image.extent.width = std::max(1u, static_cast<uint32_t>(extent.width * image.desc.scale));
+            image.extent.height = std::max(1u, static_cast<uint32_t>(extent.height * image.desc.scale));
+        }
+    }
+
+    cullPasses();
+    computeLifetimes();
+    createRenderPasses();
+    createTransientImages();
+    createFramebuffers();
+    computeBarriers();
+
+    uint32_t culledCount = 0;
+    for (const auto& data : _passes) {
+        if (data.culled) {
+            culledCount++;
+            spdlog::info("Render graph: culled pass {} ({})", data.pass->_name, data.disabled ? "disabled" : "nothing consumes its outputs");
+        }
+    }
+
+    VkDeviceSize aliasedBytes = 0;
+    VkDeviceSize unaliasedBytes = 0;
+    uint32_t transientCount = 0;
+    for (const auto& block : _memoryBlocks) {
+        aliasedBytes += block.size;
+        transientCount += static_cast<uint32_t>(block.images.size());
+    }
+    for (const auto& image : _images) {
+        if (image.image == VK_NULL_HANDLE) continue;
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(_ctx->device, image.image, &memRequirements);
+        unaliasedBytes += memRequirements.size;
+    }
+
+    spdlog::info("Render graph compiled successfully: {} passes ({} culled), {} transient images in {} memory blocks, {:.1f} MB ({:.1f} MB without aliasing)",
+        _passes.size(), culledCount, transientCount, _memoryBlocks.size(),
+        aliasedBytes / (1024.0 * 1024.0), unaliasedBytes / (1024.0 * 1024.0));
+}
+
+
+std::vector<std::pair<RGResource, RenderGraph::Access>> RenderGraph::getAccesses(const RenderGraphPass& pass) const
+{
+    std::vector<std::pair<RGResource, Access>> accesses;
+
+    auto add = [&](RGResource image, Access access) {
+        if (!image.isValid()) return;
+        for (auto& [existing, existingAccess] : accesses) {
+            if (existing.index != image.index) continue;
+            if (existingAccess.layout != access.layout) {
+                throw std::runtime_error("Render graph pass " + pass._name + " uses image " + _images[image.index].name + " in two layouts!");
+            }
+            existingAccess.stages |= access.stages;
+            existingAccess.access |= access.access;
+            existingAccess.write |= access.write;
+            return;
+        }
+        accesses.emplace_back(image, access);
+    };
+
+    const VkPipelineStageFlags shaderStage = pass._type == RGPassType::Compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+    for (const auto& output : pass._colorOutputs) {
+        VkAccessFlags access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        if (output.load == RGLoad::Load) access |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+        add(output.image, { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, access, true });
+        add(output.resolve, { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true });
+    }
+    add(pass._depthOutput, { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true });
+    for (RGResource input : pass._textureInputs) {
+        add(input, { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shaderStage, VK_ACCESS_SHADER_READ_BIT, false });
+    }
+    for (RGResource input : pass._storageInputs) {
+        add(input, { VK_IMAGE_LAYOUT_GENERAL, shaderStage, VK_ACCESS_SHADER_READ_BIT, false });
+    }
+    for (RGResource output : pass._storageOutputs) {
+        add(output, { VK_IMAGE_LAYOUT_GENERAL, shaderStage, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, true });
+    }
+
+    return accesses;
+}
+
+
+void RenderGraph::cullPasses()
+{
+    // Walk backwards: a pass survives if it writes an imported image or something a surviving pass reads
+    std::vector<bool> needed(_images.size(), false);
+
+    for (auto it = _passes.rbegin(); it != _passes.rend(); ++it) {
+        const RenderGraphPass& pass = *it->pass;
+
+        // Disabled passes neither survive nor keep their inputs alive (another pass may write the same images)
+        it->disabled = pass._condition && !pass._condition();
+        if (it->disabled) {
+            it->culled = true;
+            continue;
+        }
+
+        bool alive = pass._sideEffects;
+        auto checkWrite = [&](RGResource image) {
+            if (image.isValid() && (_images[image.index].imported || needed[image.index])) alive = true;
+        };
+        for (const auto& output : pass._colorOutputs) {
+            checkWrite(output.image);
+            checkWrite(output.resolve);
+        }
+        checkWrite(pass._depthOutput);
+        for (RGResource output : pass._storageOutputs) checkWrite(output);
+
+        it->culled = !alive;
+        if (!alive) continue;
+
+        for (RGResource input : pass._textureInputs) needed[input.index] = true;
+        for (RGResource input : pass._storageInputs) needed[input.index] = true;
+        for (const auto& output : pass._colorOutputs) {
+            if (output.load == RGLoad::Load) needed[output.image.index] = true;
+        }
+        if (pass._depthOutput.isValid() && pass._depthLoad == RGLoad::Load) needed[pass._depthOutput.index] = true;
+    }
+}
+
+
+void RenderGraph::computeLifetimes()
+{
+    for (uint32_t passIndex = 0; passIndex < _passes.size(); passIndex++) {
+        if (_passes[passIndex].culled) continue;
+        const RenderGraphPass& pass = *_passes[passIndex].pass;
+
+        for (const auto& [resource, access] : getAccesses(pass)) {
+            Image& image = _images[resource.index];
+            image.firstPass = std::min(image.firstPass, passIndex);
+            image.lastPass = std::max(image.lastPass, passIndex);
+
+            switch (access.layout) {
+                case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: image.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+                case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: image.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+                case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: image.usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+                case VK_IMAGE_LAYOUT_GENERAL: image.usage |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+                default: break;
+            }
+        }
+    }
+
+    // Attachments that live and die inside one pass never need to reach memory (MSAA color, depth)
+    for (auto& image : _images) {
+        if (image.imported || image.firstPass == UINT32_MAX) continue;
+        const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if (image.firstPass == image.lastPass && (image.usage & ~attachmentUsage) == 0) {
+            image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+    }
+}
+
+
+void RenderGraph::createRenderPasses()
+{
+    for (uint32_t passIndex = 0; passIndex < _passes.size(); passIndex++) {
+        PassData& data = _passes[passIndex];
+        const RenderGraphPass& pass = *data.pass;
+        if (pass._type != RGPassType::Graphics) continue;
+
+        // Contents only need to be written out if a later pass or the outside world looks at them
+        auto storeOp = [&](RGResource resource) {
+            const Image& image = _images[resource.index];
+            bool readLater = image.imported || (image.firstPass != UINT32_MAX && image.lastPass > passIndex);
+            return readLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        };
+
+        std::vector<VkAttachmentDescription> attachments;
+        std::vector<VkAttachmentReference> colorRefs;
+        std::vector<VkAttachmentReference> resolveRefs;
+        bool hasResolve = false;
+        data.clearValues.clear();
+
+        // Layouts are handled by the graph's barriers, so every attachment enters and leaves in its attachment layout
+        for (const auto& output : pass._colorOutputs) {
+            const Image& image = _images[output.image.index];
+
+            VkAttachmentDescription attachment{};
+            attachment.format = image.desc.format;
+            attachment.samples = image.desc.samples;
+            attachment.loadOp = toLoadOp(output.load);
+            attachment.storeOp = output.resolve.isValid() ? VK_ATTACHMENT_STORE_OP_DONT_CARE : storeOp(output.image);
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+            colorRefs.push_back({ static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+            attachments.push_back(attachment);
+
+            VkClearValue clearValue{};
+            clearValue.color = output.clearColor;
+            data.clearValues.push_back(clearValue);
+
+            if (data.extent.width == 0) {
+                data.extent = image.extent;
+                data.samples = image.desc.samples;
+            } else if (image.extent.width != data.extent.width || image.extent.height != data.extent.height || image.desc.samples != data.samples) {
+                throw std::runtime_error("Render graph pass " + pass._name + ": attachments differ in size or sample count!");
+            }
+        }
+
+        for (const auto& output : pass._colorOutputs) {
+            if (!output.resolve.isValid()) {
+                resolveRefs.push_back({ VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+                continue;
+            }
+            hasResolve = true;
+            const Image& image = _images[output.resolve.index];
+
+            VkAttachmentDescription attachment{};
+            attachment.format = image.desc.format;
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.storeOp = storeOp(output.resolve);
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+            resolveRefs.push_back({ static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+            attachments.push_back(attachment);
+            data.clearValues.push_back(VkClearValue{});
+        }
+
+        VkAttachmentReference depthRef{};
+        if (pass._depthOutput.isValid()) {
+            const Image& image = _images[pass._depthOutput.index];
+
+            VkAttachmentDescription attachment{};
+            attachment.format = image.desc.format;
+            attachment.samples = image.desc.samples;
+            attachment.loadOp = toLoadOp(pass._depthLoad);
+            attachment.storeOp = storeOp(pass._depthOutput);
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+            depthRef = { static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+            attachments.push_back(attachment);
+
+            VkClearValue clearValue{};
+            clearValue.depthStencil = { pass._clearDepth, 0 };
+            data.clearValues.push_back(clearValue);
+
+            if (data.extent.width == 0) {
+                data.extent = image.extent;
+                data.samples = image.desc.samples;
+            }
+        }
+
+        if (attachments.empty()) {
+            throw std::runtime_error("Render graph pass " + pass._name + " has no attachments!");
+        }
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+        subpass.pColorAttachments = colorRefs.data();
+        subpass.pResolveAttachments = hasResolve ? resolveRefs.data() : nullptr;
+        subpass.pDepthStencilAttachment = pass._depthOutput.isValid() ? &depthRef : nullptr;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+
+        if (vkCreateRenderPass(_ctx->device, &renderPassInfo, nullptr, &data.renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render pass for render graph pass " + pass._name + "!");
+        }
+    }
+}
+
+
+void RenderGraph::createTransientImages()
+{
+    struct Candidate {
+        uint32_t image;
+        VkMemoryRequirements requirements;
+    };
+    std::vector<Candidate> candidates;
+
+    for (uint32_t i = 0; i < _images.size(); i++) {
+        Image& image = _images[i];
+        if (image.imported || image.firstPass == UINT32_MAX) continue; // Only used by culled passes
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { image.extent.width, image.extent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = image.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = image.usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.samples = image.desc.samples;
+
+        if (vkCreateImage(_ctx->device, &imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render graph image " + image.name + "!");
+        }
+
+        Candidate candidate{ i, {} };
+        vkGetImageMemoryRequirements(_ctx->device, image.image, &candidate.requirements);
+        candidates.push_back(candidate);
+    }
+
+    // Biggest first, each image goes into the first block whose current users are all dead before it starts (or start after it ends)
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.requirements.size > b.requirements.size;
+    });
+
+    for (const auto& candidate : candidates) {
+        Image& image = _images[candidate.image];
+
+        uint32_t blockIndex = UINT32_MAX;
+        for (uint32_t b = 0; b < _memoryBlocks.size() && blockIndex == UINT32_MAX; b++) {
+            const MemoryBlock& block = _memoryBlocks[b];
+            if ((block.memoryTypeBits & candidate.requirements.memoryTypeBits) == 0) continue;
+
+            bool overlaps = false;
+            for (uint32_t other : block.images) {
+                const Image& otherImage = _images[other];
+                if (image.firstPass <= otherImage.lastPass && otherImage.firstPass <= image.lastPass) {
+                    overlaps = true;
+                    break;
+                }
+            }
+            if (!overlaps) blockIndex = b;
+        }
+
+        if (blockIndex == UINT32_MAX) {
+            _memoryBlocks.emplace_back();
+            blockIndex = static_cast<uint32_t>(_memoryBlocks.size() - 1);
+        }
+
+        MemoryBlock& block = _memoryBlocks[blockIndex];
+        block.memoryTypeBits &= candidate.requirements.memoryTypeBits;
+        block.size = std::max(block.size, candidate.requirements.size);
+        block.alignment = std::max(block.alignment, candidate.requirements.alignment);
+        block.images.push_back(candidate.image);
+        image.memoryBlock = blockIndex;
+    }
+
+    for (auto& block : _memoryBlocks) {
+        VkMemoryRequirements requirements{ block.size, block.alignment, block.memoryTypeBits };
+        block.allocation = _ctx->memoryAllocator->allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Attachment, true);
+        if (!block.allocation.isValid()) {
+            throw std::runtime_error("Failed to allocate render graph memory!");
+        }
+
+        // Every image of a block starts at the block's offset, their lifetimes never overlap
+        for (uint32_t index : block.images) {
+            Image& image = _images[index];
+            vkBindImageMemory(_ctx->device, image.image, block.allocation.memory, block.allocation.offset);
+            image.view = VulkanHelper::createImageView(_ctx, image.image, image.desc.format, 1, 1, image.aspect);
+        }
+    }
+}
+
+
+void RenderGraph::createFramebuffers()
+{
+    for (auto& data : _passes) {
+        const RenderGraphPass& pass = *data.pass;
+        if (data.culled || pass._type != RGPassType::Graphics) continue;
+
+        // Attachment order matches createRenderPasses: colors, resolves, depth
+        std::vector<RGResource> attachments;
+        for (const auto& output : pass._colorOutputs) attachments.push_back(output.image);
+        for (const auto& output : pass._colorOutputs) {
+            if (output.resolve.isValid()) attachments.push_back(output.resolve);
+        }
+        if (pass._depthOutput.isValid()) attachments.push_back(pass._depthOutput);
+
+        uint32_t framebufferCount = 1;
+        for (RGResource attachment : attachments) {
+            const Image& image = _images[attachment.index];
+            if (image.imported) framebufferCount = std::max(framebufferCount, static_cast<uint32_t>(image.importedViews.size()));
+        }
+
+        for (uint32_t i = 0; i < framebufferCount; i++) {
+            std::vector<VkImageView> views;
+            for (RGResource attachment : attachments) views.push_back(getVkImageView(attachment, i));
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = data.renderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+            framebufferInfo.pAttachments = views.data();
+            framebufferInfo.width = data.extent.width;
+            framebufferInfo.height = data.extent.height;
+            framebufferInfo.layers = 1;
+
+            VkFramebuffer framebuffer;
+            if (vkCreateFramebuffer(_ctx->device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create framebuffer for render graph pass " + pass._name + "!");
+            }
+            data.framebuffers.push_back(framebuffer);
+        }
+    }
+}
+
+
+void RenderGraph::computeBarriers()
+{
+    auto needsBarrier = [](const Access& from, const Access& to) {
+        return from.layout != to.layout || from.write || to.write;
+    };
+
+    // State of every image at the end of the frame
+    for (uint32_t passIndex = 0; passIndex < _passes.size(); passIndex++) {
+        if (_passes[passIndex].culled) continue;
+        for (const auto& [resource, access] : getAccesses(*_passes[passIndex].pass)) {
+            Image& image = _images[resource.index];
+            if (passIndex == image.firstPass || needsBarrier(image.finalState, access)) {
+                image.finalState = access;
+            } else {
+                image.finalState.stages |= access.stages;
+                image.finalState.access |= access.access;
+            }
+        }
+    }
+
+    // Contents never survive into the next frame, so every image starts out UNDEFINED. The first barrier still has to wait
+    // for the previous user of the memory: the image sharing the block before it, or itself in the previous frame.
+    for (auto& image : _images) {
+        if (image.firstPass == UINT32_MAX) continue;
+        image.initialState = {};
+        if (image.imported) {
+            // Matches the stage the image acquire semaphore is waited on
+            image.initialState.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        }
+    }
+    for (const auto& block : _memoryBlocks) {
+        std::vector<uint32_t> users = block.images;
+        std::sort(users.begin(), users.end(), [this](uint32_t a, uint32_t b) {
+            return _images[a].firstPass < _images[b].firstPass;
+        });
+        for (size_t i = 0; i < users.size(); i++) {
+            const Image& previous = _images[users[(i + users.size() - 1) % users.size()]];
+            Access& initial = _images[users[i]].initialState;
+            initial.stages = previous.finalState.stages;
+            initial.access = previous.finalState.access & WRITE_ACCESS_MASK;
+        }
+    }
+
+    std::vector<Access> states(_images.size());
+    std::vector<bool> touched(_images.size(), false);
+    for (size_t i = 0; i < _images.size(); i++) states[i] = _images[i].initialState;
+
+    for (auto& data : _passes) {
+        data.barriers.clear();
+        if (data.culled) continue;
+
+        for (const auto& [resource, access] : getAccesses(*data.pass)) {
+            Access& state = states[resource.index];
+            if (!touched[resource.index] || needsBarrier(state, access)) {
+                Access from = state;
+                from.access &= WRITE_ACCESS_MASK; // Reads never need to be made available
+                data.barriers.push_back({ resource, from, access });
+                state = access;
+                touched[resource.index] = true;
+            } else {
+                state.stages |= access.stages;
+                state.access |= access.access;
+            }
+        }
+    }
+
+    _finalBarriers.clear();
+    for (size_t i = 0; i < _images.size(); i++) {
+        const Image& image = _images[i];
+        if (!image.imported || !touched[i] || states[i].layout == image.finalLayout) continue;
+
+        Access from = states[i];
+        from.access &= WRITE_ACCESS_MASK;
+        Access to{ image.finalLayout, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, false };
+        _finalBarriers.push_back({ RGResource{ static_cast<uint32_t>(i) }, from, to });
+    }
+}
+
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t importIndex, CommandRecorder& recorder, GpuProfiler& profiler)
+{
+    TRACE_SCOPE("RenderGraph::execute");
+
+    auto recordBarriers = [&](const std::vector<Barrier>& barriers) {
+        if (barriers.empty()) return;
+
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        imageBarriers.reserve(barriers.size());
+
+        for (const auto& barrier : barriers) {
+            const Image& image = _images[barrier.image.index];
+
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.oldLayout = barrier.from.layout;
+            imageBarrier.newLayout = barrier.to.layout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = getVkImage(barrier.image, importIndex);
+            imageBarrier.subresourceRange = { image.aspect, 0, 1, 0, 1 };
+            imageBarrier.srcAccessMask = barrier.from.access;
+            imageBarrier.dstAccessMask = barrier.to.access;
+            imageBarriers.push_back(imageBarrier);
+
+            srcStages |= barrier.from.stages;
+            dstStages |= barrier.to.stages;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer,
+            srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            dstStages,
+            0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    };
+
+    // Record the secondaries of every graphics pass in one go, so the thread pool sees all of the frame's work
+    std::vector<SecondaryRecording> recordings;
+    std::vector<std::pair<size_t, size_t>> passRecordings(_passes.size(), { 0, 0 });
+    for (size_t i = 0; i < _passes.size(); i++) {
+        const PassData& data = _passes[i];
+        const RenderGraphPass& pass = *data.pass;
+        if (data.culled || pass._type != RGPassType::Graphics || !pass._record) continue;
+
+        uint32_t chunkCount = pass._chunkCount ? std::max(1u, pass._chunkCount()) : 1;
+        VkFramebuffer framebuffer = data.framebuffers[data.framebuffers.size() > 1 ? importIndex : 0];
+
+        passRecordings[i] = { recordings.size(), chunkCount };
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            SecondaryRecording recording;
+            recording.name = pass._name.c_str();
+            recording.renderPass = data.renderPass;
+            recording.framebuffer = framebuffer;
+            recording.extent = data.extent;
+            recording.record = [&pass, chunk, chunkCount](VkCommandBuffer cmd) { pass._record(cmd, chunk, chunkCount); };
+            recordings.push_back(std::move(recording));
+        }
+    }
+    {
+        TRACE_SCOPE("RecordSecondaries");
+        recorder.record(recordings);
+    }
+
+    const std::string* openGroup = nullptr;
+    for (size_t i = 0; i < _passes.size(); i++) {
+        const PassData& data = _passes[i];
+        const RenderGraphPass& pass = *data.pass;
+        if (data.culled) continue;
+
+        // Barriers are recorded inside the group, so the group time covers everything between its passes
+        if (!openGroup || *openGroup != pass._profileGroup) {
+            if (openGroup) profiler.endPass(commandBuffer);
+            openGroup = pass._profileGroup.empty() ? nullptr : &pass._profileGroup;
+            if (openGroup) profiler.beginPass(commandBuffer, *openGroup);
+        }
+
+        recordBarriers(data.barriers);
+        profiler.beginPass(commandBuffer, pass._name);
+
+        if (pass._type == RGPassType::Graphics) {
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = data.renderPass;
+            renderPassInfo.framebuffer = data.framebuffers[data.framebuffers.size() > 1 ? importIndex : 0];
+            renderPassInfo.renderArea.offset = { 0, 0 };
+            renderPassInfo.renderArea.extent = data.extent;
+            renderPassInfo.clearValueCount = static_cast<uint32_t>(data.clearValues.size());
+            renderPassInfo.pClearValues = data.clearValues.data();
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+            auto [first, count] = passRecordings[i];
+            if (count > 0) {
+                std::vector<VkCommandBuffer> secondaries;
+                secondaries.reserve(count);
+                for (size_t r = first; r < first + count; r++) secondaries.push_back(recordings[r].commandBuffer);
+                vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+            }
+
+            vkCmdEndRenderPass(commandBuffer);
+        } else if (pass._record) {
+            pass._record(commandBuffer, 0, 1);
+        }
+
+        profiler.endPass(commandBuffer);
+    }
+    if (openGroup) profiler.endPass(commandBuffer);
+
+    recordBarriers(_finalBarriers);
+}
+
+
+VkRenderPass RenderGraph::getRenderPass(const std::string& passName) const
+{
+    const PassData* data = findPass(passName);
+    if (!data || data->renderPass == VK_NULL_HANDLE) {
+        throw std::runtime_error("Render graph has no graphics pass named " + passName + "!");
+    }
+    return data->renderPass;
+}
+
+
+VkSampleCountFlagBits RenderGraph::getPassSamples(const std::string& passName) const
+{
+    const PassData* data = findPass(passName);
+    return data ? data->samples : VK_SAMPLE_COUNT_1_BIT;
+}
+
+
+bool RenderGraph::isPassCulled(const std::string& passName) const
+{
+    const PassData* data = findPass(passName);
+    return !data || data->culled;
+}
+
+
+uint32_t RenderGraph::getProfiledPassCount() const
+{
+    // Same grouping as execute(): a group is timed every time a run of its passes starts
+    uint32_t count = 0;
+    const std::string* openGroup = nullptr;
+    for (const auto& data : _passes) {
+        if (data.culled) continue;
+        if (!openGroup || *openGroup != data.pass->_profileGroup) {
+            openGroup = data.pass->_profileGroup.empty() ? nullptr : &data.pass->_profileGroup;
+            if (openGroup) count++;
+        }
+        count++;
+    }
+    return count;
+}
+
+
+VkImageView RenderGraph::getImageView(RGResource image) const
+{
+    return getVkImageView(image, 0);
+}
+
+
+VkExtent2D RenderGraph::getImageExtent(RGResource image) const
+{
+    return _images[image.index].extent;
+}
+
+
+VkImage RenderGraph::getVkImage(RGResource resource, uint32_t importIndex) const
+{
+    const Image& image = _images[resource.index];
+    if (image.imported) return image.importedImages[std::min<size_t>(importIndex, image.importedImages.size() - 1)];
+    return image.image;
+}
+
+
+VkImageView RenderGraph::getVkImageView(RGResource resource, uint32_t importIndex) const
+{
+    const Image& image = _images[resource.index];
+    if (image.imported) return image.importedViews[std::min<size_t>(importIndex, image.importedViews.size() - 1)];
+    return image.view;
+}
+
+
+void RenderGraph::destroyResources(bool deferred)
+{
+    // Handles are collected first, so a recompile can hand them to the deletion queue while frames still use them
+    std::vector<VkFramebuffer> framebuffers;
+    std::vector<VkRenderPass> renderPasses;
+    std::vector<VkImageView> views;
+    std::vector<VkImage> images;
+    std::vector<Allocation> allocations;
+
+    for (auto& data : _passes) {
+        framebuffers.insert(framebuffers.end(), data.framebuffers.begin(), data.framebuffers.end());
+        data.framebuffers.clear();
+        if (data.renderPass != VK_NULL_HANDLE) {
+            renderPasses.push_back(data.renderPass);
+            data.renderPass = VK_NULL_HANDLE;
+        }
+        data.extent = { 0, 0 };
+        data.barriers.clear();
+    }
+
+    for (auto& image : _images) {
+        if (image.view != VK_NULL_HANDLE) views.push_back(image.view);
+        if (image.image != VK_NULL_HANDLE) images.push_back(image.image);
+        image.view = VK_NULL_HANDLE;
+        image.image = VK_NULL_HANDLE;
+        image.memoryBlock = UINT32_MAX;
+        image.usage = 0;
+        image.firstPass = UINT32_MAX;
+        image.lastPass = 0;
+        image.initialState = {};
+        image.finalState = {};
+    }
+
+    for (auto& block : _memoryBlocks) {
+        allocations.push_back(block.allocation);
+    }
+    _memoryBlocks.clear();
+    _finalBarriers.clear();
+
+    auto destroy = [device = _ctx->device, allocator = _ctx->memoryAllocator.get(), framebuffers, renderPasses, views, images, allocations]() mutable {
+        for (VkFramebuffer framebuffer : framebuffers) vkDestroyFramebuffer(device, framebuffer, nullptr);
+        for (VkRenderPass renderPass : renderPasses) vkDestroyRenderPass(device, renderPass, nullptr);
+        for (VkImageView view : views) vkDestroyImageView(device, view, nullptr);
+        for (VkImage image : images) vkDestroyImage(device, image, nullptr);
+        for (Allocation& allocation : allocations) allocator->free(allocation);
+    };
+
+    if (deferred && !(framebuffers.empty() && renderPasses.empty() && images.empty())) {
+        _ctx->deletionQueue.push(std::move(destroy));
+    } else {
+        destroy();
+    }
+}
@@ -0,0 +1,230 @@
+#pragma once
+#include "../stdafx.h"
+#include "../VulkanContext.h"
+
+class CommandRecorder;
+class GpuProfiler;
+
+
+// Handle to an image owned (transient) or tracked (imported) by a RenderGraph
+struct RGResource
+{
+    static constexpr uint32_t INVALID = UINT32_MAX;
+    uint32_t index = INVALID;
+
+    bool isValid() const { return index != INVALID; }
+};
+
+
+// Size is relative to the extent the graph is compiled with, so a resize only needs a recompile
+struct RGImageDesc
+{
+    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    float scale = 1.0f;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+
+// Records one chunk of a pass: record(commandBuffer, chunk, chunkCount)
+using RGRecordFunction = std::function<void(VkCommandBuffer, uint32_t, uint32_t)>;
+
+
+// What a pass does with an attachment's previous contents
+enum class RGLoad
+{
+    Clear,
+    Load,
+    DontCare
+};
+
+
+enum class RGPassType
+{
+    Graphics,
+    Compute
+};
+
+
+// A pass declares what it reads and writes, the graph works out everything else.
+// Graphics passes are recorded into secondary command buffers (split into chunks on the thread pool),
+// compute passes are recorded straight into the frame's primary command buffer.
+class RenderGraphPass
+{
+    friend class RenderGraph;
+
+public:
+    // Attachments. A resolve output resolves the color output added right before it.
+    RenderGraphPass& addColorOutput(RGResource image, RGLoad load = RGLoad::Clear, VkClearColorValue clearColor = {{ 0.0f, 0.0f, 0.0f, 1.0f }});
+    RenderGraphPass& addResolveOutput(RGResource image);
+    RenderGraphPass& setDepthOutput(RGResource image, RGLoad load = RGLoad::Clear, float clearDepth = 1.0f);
+
+    // Shader access
+    RenderGraphPass& addTextureInput(RGResource image);
+    RenderGraphPass& addStorageInput(RGResource image);
+    RenderGraphPass& addStorageOutput(RGResource image);
+
+    // record is called once per chunk (possibly from worker threads), chunkCount is queried every frame
+    RenderGraphPass& setRecord(RGRecordFunction record, std::function<uint32_t()> chunkCount = nullptr);
+
+    // Consecutive passes of the same group are also timed together under the group name
+    RenderGraphPass& setProfileGroup(const std::string& group);
+
+    // Passes whose condition returns false are culled. It is evaluated by compile, so recompile after it changes.
+    RenderGraphPass& setCondition(std::function<bool()> condition);
+
+    // Keeps the pass even though no pass reads its outputs (it writes buffers the graph does not track)
+    RenderGraphPass& setSideEffects();
+
+    const std::string& getName() const { return _name; }
+    RGPassType getType() const { return _type; }
+
+private:
+    RenderGraphPass(std::string name, RGPassType type) : _name(std::move(name)), _type(type) {}
+
+    std::string _name;
+    RGPassType _type;
+
+    struct ColorOutput {
+        RGResource image;
+        RGResource resolve;
+        RGLoad load;
+        VkClearColorValue clearColor;
+    };
+    std::vector<ColorOutput> _colorOutputs;
+    RGResource _depthOutput;
+    RGLoad _depthLoad = RGLoad::Clear;
+    float _clearDepth = 1.0f;
+
+    std::vector<RGResource> _textureInputs;
+    std::vector<RGResource> _storageInputs;
+    std::vector<RGResource> _storageOutputs;
+
+    RGRecordFunction _record;
+    std::function<uint32_t()> _chunkCount;
+    std::string _profileGroup;
+    std::function<bool()> _condition;
+    bool _sideEffects = false;
+};
+
+
+// Frame graph for the scene's passes. Passes run in declaration order; compile() then
+//  - culls passes whose outputs nobody consumes (imported images and passes with side effects are the roots),
+//  - creates a render pass and framebuffer per graphics pass with load/store ops derived from usage,
+//  - derives the layout transitions and barriers between passes,
+//  - creates transient images and lets images with disjoint lifetimes share memory.
+class RenderGraph
+{
+public:
+    RenderGraph(std::shared_ptr<VulkanContext> ctx);
+    ~RenderGraph();
+
+    RGResource createImage(const std::string& name, const RGImageDesc& desc);
+
+    // External images (e.g. the swapchain), one view per index passed to execute. They are left in finalLayout.
+    RGResource importImage(const std::string& name, VkFormat format, const std::vector<VkImage>& images, const std::vector<VkImageView>& views, VkImageLayout finalLayout);
+
+    // Points an imported image at new images (e.g. a recreated swapchain), takes effect on the next compile
+    void updateImportedImage(RGResource image, const std::vector<VkImage>& images, const std::vector<VkImageView>& views);
+
+    RenderGraphPass& addGraphicsPass(const std::string& name);
+    RenderGraphPass& addComputePass(const std::string& name);
+
+    // Builds all Vulkan objects. Can be called again (e.g. after a resize) to rebuild them,
+    // the previous objects are then released through the deletion queue once in-flight frames are done.
+    void compile(VkExtent2D extent);
+
+    // Records the whole graph into commandBuffer. importIndex selects the view of imported images.
+    void execute(VkCommandBuffer commandBuffer, uint32_t importIndex, CommandRecorder& recorder, GpuProfiler& profiler);
+
+    // Valid after compile. Render passes exist for culled passes too, so their pipelines can still be built.
+    VkRenderPass getRenderPass(const std::string& passName) const;
+    VkSampleCountFlagBits getPassSamples(const std::string& passName) const;
+    bool isPassCulled(const std::string& passName) const;
+
+    // Passes and profile groups execute() times per frame, valid after compile (see GpuProfiler::reserve)
+    uint32_t getProfiledPassCount() const;
+    VkImageView getImageView(RGResource image) const;
+    VkExtent2D getImageExtent(RGResource image) const;
+
+private:
+    std::shared_ptr<VulkanContext> _ctx;
+    VkExtent2D _extent = { 0, 0 };
+
+    // How a pass touches an image
+    struct Access {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+        bool write = false;
+    };
+
+    struct Image {
+        std::string name;
+        RGImageDesc desc;
+        VkExtent2D extent = { 0, 0 };
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+
+        // Imported
+        bool imported = false;
+        std::vector<VkImage> importedImages;
+        std::vector<VkImageView> importedViews;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Transient
+        VkImageUsageFlags usage = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t memoryBlock = UINT32_MAX;
+
+        // Lifetime over the live passes, and the state its memory is left in by whoever used it last
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+        Access initialState;
+        Access finalState;
+    };
+    std::vector<Image> _images;
+
+    struct Barrier {
+        RGResource image;
+        Access from;
+        Access to;
+    };
+
+    struct PassData {
+        std::unique_ptr<RenderGraphPass> pass;
+        bool culled = false;
+        bool disabled = false; // Culled because of its condition
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        std::vector<VkFramebuffer> framebuffers; // One per import index if the pass writes an imported image
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        VkExtent2D extent = { 0, 0 };
+        std::vector<VkClearValue> clearValues;
+        std::vector<Barrier> barriers; // Recorded before the pass
+    };
+    std::vector<PassData> _passes;
+    std::vector<Barrier> _finalBarriers; // Imported images to their final layout
+
+    struct MemoryBlock {
+        Allocation allocation;
+        VkDeviceSize size = 0;
+        VkDeviceSize alignment = 1;
+        uint32_t memoryTypeBits = ~0u;
+        std::vector<uint32_t> images;
+    };
+    std::vector<MemoryBlock> _memoryBlocks;
+
+    RenderGraphPass& addPass(const std::string& name, RGPassType type);
+    const PassData* findPass(const std::string& name) const;
+    void destroyResources(bool deferred);
+
+    void cullPasses();
+    void computeLifetimes();
+    void createRenderPasses();
+    void createTransientImages();
+    void createFramebuffers();
+    void computeBarriers();
+
+    std::vector<std::pair<RGResource, Access>> getAccesses(const RenderGraphPass& pass) const;
+    VkImage getVkImage(RGResource image, uint32_t importIndex) const;
+    VkImageView getVkImageView(RGResource image, uint32_t importIndex) const;
+};
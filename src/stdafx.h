@@ -1,8 +1,12 @@
 #pragma once
 
+// The offline tools (VENGINE_TOOL) are built without SDL and ImGui, they only use the Vulkan types
+
 // [SDL]
+#ifndef VENGINE_TOOL
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_vulkan.h>
+#endif
 
 // [Vulkan]
 #include <vulkan/vulkan.h>
@@ -20,9 +24,11 @@
 #include <glm/gtx/hash.hpp>
 
 // [ImGui]
+#ifndef VENGINE_TOOL
 #include "imgui.h"
 #include "imgui-impl/imgui_impl_sdl3.h"
 #include "imgui-impl/imgui_impl_vulkan.h"
+#endif
 
 // [Standard libraries: basic]
 #include <algorithm>
@@ -54,4 +60,5 @@
 #include <vector>
 
 // [Global constants]
-const int MAX_FRAMES_IN_FLIGHT = 2;
\ No newline at end of file
+const int MAX_FRAMES_IN_FLIGHT = 3; // Upper bound for per-frame arrays, the count in use is SwapChain::getFramesInFlight()
+const int DEFAULT_FRAMES_IN_FLIGHT = 2;
\ No newline at end of file
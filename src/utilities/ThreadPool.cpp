@@ -0,0 +1,123 @@
+#include "ThreadPool.h"
+#include "Tracer.h"
+
+
+namespace {
+    thread_local uint32_t tlsThreadIndex = 0;
+}
+
+
+ThreadPool::ThreadPool()
+{
+    // Leave one core for the main thread, which also takes part in parallelFor
+    uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t workerCount = std::max(1u, hardwareThreads - 1);
+
+    _workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        _workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+
+    spdlog::info("Thread pool created with {} workers", workerCount);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+
+    for (auto& worker : _workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+
+uint32_t ThreadPool::getThreadIndex()
+{
+    return tlsThreadIndex;
+}
+
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push(std::move(task));
+    }
+    _condition.notify_one();
+}
+
+
+void ThreadPool::workerLoop(uint32_t threadIndex)
+{
+    tlsThreadIndex = threadIndex;
+    Tracer::getInstance()->setThreadName("Worker " + std::to_string(threadIndex));
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+            if (_stopping && _tasks.empty()) return;
+            task = std::move(_tasks.front());
+            _tasks.pop();
+        }
+        task();
+    }
+}
+
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& fn)
+{
+    if (count == 0) return;
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+
+    // Indices are handed out through an atomic counter, so whoever is free takes the next one
+    struct SharedState {
+        std::atomic<uint32_t> nextIndex{0};
+        std::atomic<uint32_t> remaining{0};
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+        std::exception_ptr exception;
+        std::mutex exceptionMutex;
+    };
+    auto state = std::make_shared<SharedState>();
+    state->remaining = count;
+
+    auto drain = [state, count, &fn]() {
+        uint32_t index;
+        while ((index = state->nextIndex.fetch_add(1)) < count) {
+            try {
+                fn(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->exceptionMutex);
+                if (!state->exception) state->exception = std::current_exception();
+            }
+            if (state->remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(state->doneMutex);
+                state->doneCondition.notify_all();
+            }
+        }
+    };
+
+    // Helpers that start after every index is taken return immediately (fn is never touched after the wait below)
+    uint32_t helperCount = std::min(count - 1, getWorkerCount());
+    for (uint32_t i = 0; i < helperCount; i++) {
+        enqueue(drain);
+    }
+    drain();
+
+    {
+        std::unique_lock<std::mutex> lock(state->doneMutex);
+        state->doneCondition.wait(lock, [&state]() { return state->remaining.load() == 0; });
+    }
+
+    if (state->exception) std::rethrow_exception(state->exception);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../stdafx.h"
+#include "Singleton.h"
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <queue>
+
+
+/**
+*	@brief Fixed set of worker threads shared by the engine (command recording, asset loading).
+*	Threads are numbered so per-thread resources can be indexed: 0 is any non-worker thread (the main thread), workers are 1..getWorkerCount().
+*	Index 0 is shared by all non-worker threads (loader, reader, completion threads), so resources indexed by it must
+*	only be used by one of them (CommandRecorder checks that it is the thread that created it).
+*/
+class ThreadPool : public Singleton<ThreadPool>
+{
+    friend class Singleton<ThreadPool>;
+
+public:
+    ~ThreadPool();
+
+    uint32_t getWorkerCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+    // Worker count + the calling thread
+    uint32_t getThreadCount() const { return getWorkerCount() + 1; }
+
+    // Index of the calling thread (0 outside of the pool)
+    static uint32_t getThreadIndex();
+
+    // Run a task on a worker, the future holds the result (or the exception)
+    template<typename F>
+    auto submit(F&& task) -> std::future<decltype(task())>;
+
+    // Run fn(i) for i in [0, count). The calling thread takes part and returns once every index is done.
+    // Safe to call from a worker (the caller drains the indices itself if the pool is busy).
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& fn);
+
+private:
+    ThreadPool();
+
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stopping = false;
+
+    void enqueue(std::function<void()> task);
+    void workerLoop(uint32_t threadIndex);
+};
+
+
+template<typename F>
+auto ThreadPool::submit(F&& task) -> std::future<decltype(task())>
+{
+    using Result = decltype(task());
+
+    // std::function needs a copyable callable, so the packaged task lives behind a shared_ptr
+    auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packagedTask->get_future();
+    enqueue([packagedTask]() { (*packagedTask)(); });
+    return future;
+}
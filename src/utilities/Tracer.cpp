@@ -0,0 +1,202 @@
+#include "Tracer.h"
+#include <cstring>
+#include <iomanip>
+
+
+namespace {
+    // Each thread caches its own buffer, registration happens once per thread
+    thread_local void* tlsThreadBuffer = nullptr;
+
+    void copyName(char* dst, const char* src)
+    {
+        strncpy(dst, src, TraceEvent::MaxNameLength - 1);
+        dst[TraceEvent::MaxNameLength - 1] = '\0';
+    }
+
+    void writeJsonString(std::ostream& out, const char* str)
+    {
+        out << '"';
+        for (const char* c = str; *c; c++) {
+            switch (*c) {
+                case '"':  out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\t': out << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20) out << ' ';
+                    else out << *c;
+            }
+        }
+        out << '"';
+    }
+}
+
+
+Tracer::Tracer()
+    : _epoch(std::chrono::steady_clock::now())
+{
+    setThreadName("Main");
+}
+
+
+Tracer::~Tracer()
+{
+}
+
+
+uint64_t Tracer::now() const
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count());
+}
+
+
+Tracer::ThreadBuffer* Tracer::getThreadBuffer()
+{
+    if (tlsThreadBuffer) return static_cast<ThreadBuffer*>(tlsThreadBuffer);
+
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->events.resize(EventsPerThread);
+
+    std::lock_guard<std::mutex> lock(_buffersMutex);
+    buffer->threadId = static_cast<uint32_t>(_buffers.size() + 1);
+    buffer->threadName = "Thread " + std::to_string(buffer->threadId);
+    tlsThreadBuffer = buffer.get();
+    _buffers.push_back(std::move(buffer));
+    return _buffers.back().get();
+}
+
+
+void Tracer::record(const char* name, const char* category, uint64_t startNs, uint64_t endNs)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+
+    // Announce the write before checking for a dump, the dump sets _paused before it checks writing (both seq_cst),
+    // so either this event is dropped or the dump waits for it
+    buffer->writing.store(true);
+    if (_paused.load()) {
+        buffer->writing.store(false, std::memory_order_release);
+        return;
+    }
+
+    // Only this thread writes, so a relaxed load of our own index is enough
+    uint64_t index = buffer->writeIndex.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer->events[index % EventsPerThread];
+    copyName(event.name, name);
+    event.category = category;
+    event.startNs = startNs;
+    event.durationNs = endNs - startNs;
+
+    // Publish the event to the reader
+    buffer->writeIndex.store(index + 1, std::memory_order_release);
+    buffer->writing.store(false, std::memory_order_release);
+}
+
+
+void Tracer::setThreadName(const std::string& name)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(_buffersMutex);
+    buffer->threadName = name;
+}
+
+
+bool Tracer::dumpChromeTrace(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        spdlog::error("Failed to open trace file {}", path);
+        return false;
+    }
+
+    struct ThreadSnapshot {
+        uint32_t threadId;
+        std::string threadName;
+        std::vector<TraceEvent> events;
+    };
+    std::vector<ThreadSnapshot> snapshots;
+    {
+        std::lock_guard<std::mutex> lock(_buffersMutex);
+
+        // Stop the writers and wait for the events being written, then every slot below writeIndex is complete
+        _paused.store(true);
+        for (const auto& buffer : _buffers) {
+            while (buffer->writing.load(std::memory_order_acquire)) std::this_thread::yield();
+        }
+
+        snapshots.reserve(_buffers.size());
+        for (const auto& buffer : _buffers) {
+            uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+            uint64_t begin = end > EventsPerThread ? end - EventsPerThread : 0;
+            ThreadSnapshot& snapshot = snapshots.emplace_back(ThreadSnapshot{ buffer->threadId, buffer->threadName, {} });
+            snapshot.events.reserve(static_cast<size_t>(end - begin));
+            for (uint64_t i = begin; i < end; i++) {
+                snapshot.events.push_back(buffer->events[i % EventsPerThread]);
+            }
+        }
+
+        _paused.store(false);
+    }
+
+    size_t eventCount = 0;
+    bool first = true;
+    out << "{\"traceEvents\":[\n";
+
+    for (const ThreadSnapshot& snapshot : snapshots) {
+        // Thread name metadata
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << snapshot.threadId << ",\"args\":{\"name\":";
+        writeJsonString(out, snapshot.threadName.c_str());
+        out << "}}";
+
+        for (const TraceEvent& event : snapshot.events) {
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":";
+            writeJsonString(out, event.category ? event.category : "engine");
+            out << ",\"ph\":\"X\",\"ts\":" << std::fixed << std::setprecision(3) << event.startNs / 1000.0
+                << ",\"dur\":" << event.durationNs / 1000.0
+                << ",\"pid\":1,\"tid\":" << snapshot.threadId << "}";
+            eventCount++;
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    out.close();
+
+    spdlog::info("Wrote {} trace events to {}", eventCount, path);
+    return true;
+}
+
+
+TraceScope::TraceScope(const char* name, const char* category)
+{
+    begin(name, category);
+}
+
+
+TraceScope::TraceScope(const std::string& name, const char* category)
+    : TraceScope(name.c_str(), category)
+{
+}
+
+
+void TraceScope::begin(const char* name, const char* category)
+{
+    Tracer* tracer = Tracer::getInstance();
+    if (_active || !tracer->isEnabled()) return;
+
+    copyName(_name, name);
+    _category = category;
+    _active = true;
+    _startNs = tracer->now();
+}
+
+
+TraceScope::~TraceScope()
+{
+    if (!_active) return;
+
+    Tracer* tracer = Tracer::getInstance();
+    tracer->record(_name, _category, _startNs, tracer->now());
+}
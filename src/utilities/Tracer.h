@@ -0,0 +1,106 @@
+#pragma once
+
+#include "../stdafx.h"
+#include "Singleton.h"
+#include <atomic>
+#include <mutex>
+
+
+// One completed CPU scope. Names are copied so temporaries (e.g. texture paths) can be traced.
+struct TraceEvent
+{
+    static constexpr size_t MaxNameLength = 48;
+
+    char name[MaxNameLength];
+    const char* category; // Must be a string literal
+    uint64_t startNs;
+    uint64_t durationNs;
+};
+
+
+/**
+*	@brief CPU timeline tracer. Every thread writes into its own ring buffer (single producer, no locks on the hot path),
+*	the buffers are merged and written as Chrome trace JSON (chrome://tracing, Perfetto) on demand.
+*	Recording pauses while the buffers are copied for a dump, events ending in that window are dropped.
+*	Call getInstance() once from the main thread before any other thread starts tracing.
+*/
+class Tracer : public Singleton<Tracer>
+{
+    friend class Singleton<Tracer>;
+
+public:
+    ~Tracer();
+
+    void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since the tracer was created
+    uint64_t now() const;
+
+    void record(const char* name, const char* category, uint64_t startNs, uint64_t endNs);
+
+    // Name shown for the calling thread in the trace viewer
+    void setThreadName(const std::string& name);
+
+    bool dumpChromeTrace(const std::string& path) const;
+
+private:
+    Tracer();
+
+    static constexpr size_t EventsPerThread = 16384;
+
+    struct ThreadBuffer {
+        uint32_t threadId = 0;
+        std::string threadName;
+        std::vector<TraceEvent> events;
+        std::atomic<uint64_t> writeIndex{0}; // Total number of events ever written, the slot is writeIndex % EventsPerThread
+        std::atomic<bool> writing{false};    // The owner is writing a slot, the dump waits for it
+    };
+    ThreadBuffer* getThreadBuffer();
+
+    std::chrono::steady_clock::time_point _epoch;
+    std::atomic<bool> _enabled{true};
+    mutable std::atomic<bool> _paused{false};   // Set by the dump while it copies the buffers
+
+    mutable std::mutex _buffersMutex; // Only guards registration of new threads and dumping
+    std::vector<std::unique_ptr<ThreadBuffer>> _buffers;
+};
+
+
+// RAII scope, records an event from construction (or begin) to destruction
+class TraceScope
+{
+public:
+    TraceScope() = default;
+    TraceScope(const char* name, const char* category = "engine");
+    TraceScope(const std::string& name, const char* category = "engine");
+    ~TraceScope();
+
+    // Starts an inactive scope, if tracing is enabled
+    void begin(const char* name, const char* category = "engine");
+    void begin(const std::string& name, const char* category = "engine") { begin(name.c_str(), category); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    char _name[TraceEvent::MaxNameLength];
+    const char* _category = nullptr;
+    uint64_t _startNs = 0;
+    bool _active = false;
+};
+
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef VULKANENGINE_DISABLE_TRACING
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_CAT(name, category)
+#else
+// The name is only evaluated when tracing is enabled, so names built from strings cost nothing otherwise
+#define TRACE_SCOPE(name) TRACE_SCOPE_CAT(name, "engine")
+#define TRACE_SCOPE_CAT(name, category) \
+    TraceScope TRACE_CONCAT(_traceScope, __LINE__); \
+    if (Tracer::getInstance()->isEnabled()) TRACE_CONCAT(_traceScope, __LINE__).begin(name, category)
+#endif
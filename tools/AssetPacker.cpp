@@ -0,0 +1,174 @@
+// Packs the loose asset files into the single file the engine maps at startup (see AssetPack).
+//
+//   AssetPacker [--out <file>] [--order <file>] [<file or directory>...]   (default: assets.pack, textures spv)
+//
+// Run it from the directory the engine runs in, the paths are stored relative to it ("textures/sun.jpg").
+// --order takes the list written by the engine with --record-asset-order: those assets come first, in the order
+// the engine first asked for them, so a cold start reads the pack front to back. The rest follows sorted by path.
+
+#include "stdafx.h"
+#include "loader/AssetPack.h"
+
+
+namespace {
+
+    struct PackedFile {
+        std::string path;       // Normalized, the key in the pack
+        uint64_t size = 0;
+        uint64_t offset = 0;
+    };
+
+
+    std::vector<std::string> readOrderFile(const std::string& path)
+    {
+        std::vector<std::string> order;
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            spdlog::warn("No asset order file found, packing by path only: {}", path);
+            return order;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) order.push_back(AssetPack::normalizePath(line));
+        }
+        return order;
+    }
+
+
+    uint64_t alignUp(uint64_t value)
+    {
+        return (value + AssetPack::Alignment - 1) / AssetPack::Alignment * AssetPack::Alignment;
+    }
+
+}
+
+
+int main(int argc, char* argv[])
+{
+    std::string outputPath = "assets.pack";
+    std::string orderPath;
+    std::vector<std::filesystem::path> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) {
+            outputPath = argv[++i];
+        } else if (arg == "--order" && hasValue) {
+            orderPath = argv[++i];
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) inputs = { "textures", "spv" };
+
+    // Collect the files
+    std::map<std::string, PackedFile> files;
+    for (const auto& input : inputs) {
+        std::error_code error;
+        if (std::filesystem::is_directory(input, error)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error)) {
+                if (!entry.is_regular_file()) continue;
+                std::string path = AssetPack::normalizePath(entry.path().string());
+                files[path] = { path, static_cast<uint64_t>(entry.file_size()), 0 };
+            }
+        } else if (std::filesystem::is_regular_file(input, error)) {
+            std::string path = AssetPack::normalizePath(input.string());
+            files[path] = { path, static_cast<uint64_t>(std::filesystem::file_size(input)), 0 };
+        } else {
+            spdlog::warn("Skipping {}: not a file or a directory", input.string());
+        }
+    }
+    if (files.empty()) {
+        spdlog::error("No assets to pack");
+        return EXIT_FAILURE;
+    }
+
+    // Payload order: first use, then the rest by path (the map is sorted already)
+    std::vector<PackedFile*> payloadOrder;
+    std::unordered_set<std::string> placed;
+    uint32_t orderedCount = 0;
+    if (!orderPath.empty()) {
+        for (const auto& path : readOrderFile(orderPath)) {
+            auto it = files.find(path);
+            if (it != files.end() && placed.insert(path).second) {
+                payloadOrder.push_back(&it->second);
+                orderedCount++;
+            }
+        }
+    }
+    for (auto& [path, file] : files) {
+        if (placed.insert(path).second) payloadOrder.push_back(&file);
+    }
+
+    // Index sorted by hash, the runtime looks paths up by binary search
+    std::vector<AssetPack::Entry> entries;
+    std::string strings;
+    for (const auto& [path, file] : files) {
+        AssetPack::Entry entry{};
+        entry.pathHash = AssetPack::hashPath(path);
+        entry.size = file.size;
+        entry.pathOffset = static_cast<uint32_t>(strings.size());
+        entry.pathLength = static_cast<uint32_t>(path.size());
+        strings += path;
+        entries.push_back(entry);
+    }
+
+    AssetPack::Header header{};
+    header.magic = AssetPack::Magic;
+    header.version = AssetPack::Version;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.stringsOffset = sizeof(AssetPack::Header) + entries.size() * sizeof(AssetPack::Entry);
+    header.stringsSize = strings.size();
+
+    uint64_t offset = header.stringsOffset + header.stringsSize;
+    for (PackedFile* file : payloadOrder) {
+        offset = alignUp(offset);
+        file->offset = offset;
+        offset += file->size;
+    }
+
+    // entries was built in path order, the same order as files
+    size_t index = 0;
+    for (const auto& [path, file] : files) {
+        entries[index++].offset = file.offset;
+    }
+    std::sort(entries.begin(), entries.end(), [](const AssetPack::Entry& a, const AssetPack::Entry& b) { return a.pathHash < b.pathHash; });
+
+    // Write
+    std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        spdlog::error("Failed to open asset pack for writing: {}", outputPath);
+        return EXIT_FAILURE;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetPack::Entry));
+    out.write(strings.data(), strings.size());
+
+    std::vector<char> buffer;
+    for (const PackedFile* file : payloadOrder) {
+        const std::streamoff padding = static_cast<std::streamoff>(file->offset) - out.tellp();
+        if (padding > 0) {
+            const char zeros[AssetPack::Alignment] = {};
+            out.write(zeros, padding);
+        }
+
+        std::ifstream in(file->path, std::ios::binary);
+        buffer.resize(static_cast<size_t>(file->size));
+        in.read(buffer.data(), buffer.size());
+        if (!in) {
+            spdlog::error("Failed to read {}", file->path);
+            return EXIT_FAILURE;
+        }
+        out.write(buffer.data(), buffer.size());
+    }
+
+    if (!out) {
+        spdlog::error("Failed to write asset pack: {}", outputPath);
+        return EXIT_FAILURE;
+    }
+
+    spdlog::info("Packed {} assets into {} ({:.1f} MB, {} in first use order)", files.size(), outputPath, offset / (1024.0 * 1024.0), orderedCount);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,323 @@
+// Offline texture baker: turns the jpg / png textures into .ktx2 files with every mip level precomputed and block
+// compressed, which the TextureLoader picks up instead of the source images.
+//
+//   TextureBaker [--out <dir>] [--bc1] [--virtual] [--force] [<file or directory>...]   (default: textures)
+//
+// The format follows the file name:
+//   *normal*    BC5 UNORM, xy of the tangent space normal (the shader rebuilds z), mips renormalized
+//   *specular*  BC4 UNORM, the red channel
+//   otherwise   BC7 sRGB, or BC1 sRGB with --bc1 when the image is opaque
+// Color mips are averaged in linear space, not on the sRGB encoded values.
+//
+// --virtual writes .vtex files for the VirtualTextureSystem instead: every mip level cut into BC7 sRGB tiles with
+// a border. Only color images are baked that way.
+
+#include "stdafx.h"
+#include "loader/BlockCompression.h"
+#include "loader/HostTexture.h"
+#include "loader/Ktx2.h"
+#include "loader/VirtualTextureFile.h"
+#include "utilities/ThreadPool.h"
+#include "utilities/Tracer.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+
+namespace {
+
+    enum class Kind { Color, Normal, Mask };
+
+    struct BakerOptions {
+        std::filesystem::path outputDir;    // Empty writes next to the source
+        bool allowBC1 = false;
+        bool virtualTexture = false;
+        bool force = false;
+    };
+
+    // Virtual texture tiles, the VirtualTextureSystem expects these
+    constexpr uint32_t VirtualTileSize = 128;
+    constexpr uint32_t VirtualTileBorder = 4;
+
+
+    float srgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+
+    uint8_t linearToSrgb8(float value)
+    {
+        value = std::clamp(value, 0.f, 1.f);
+        float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::lround(encoded * 255.f));
+    }
+
+
+    // Halves an RGBA8 image with a 2x2 box filter (odd edges repeat their last texel)
+    std::vector<uint8_t> downsample(const std::vector<uint8_t>& src, uint32_t width, uint32_t height, Kind kind)
+    {
+        static const std::array<float, 256> srgbTable = []() {
+            std::array<float, 256> table{};
+            for (int i = 0; i < 256; i++) table[i] = srgbToLinear(i / 255.f);
+            return table;
+        }();
+
+        const uint32_t dstWidth = std::max(1u, width / 2);
+        const uint32_t dstHeight = std::max(1u, height / 2);
+        std::vector<uint8_t> dst(static_cast<size_t>(dstWidth) * dstHeight * 4);
+
+        ThreadPool::getInstance()->parallelFor(dstHeight, [&](uint32_t y) {
+            const uint32_t y0 = std::min(y * 2, height - 1);
+            const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < dstWidth; x++) {
+                const uint32_t x0 = std::min(x * 2, width - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                const uint8_t* texels[4] = {
+                    &src[(static_cast<size_t>(y0) * width + x0) * 4], &src[(static_cast<size_t>(y0) * width + x1) * 4],
+                    &src[(static_cast<size_t>(y1) * width + x0) * 4], &src[(static_cast<size_t>(y1) * width + x1) * 4] };
+                uint8_t* out = &dst[(static_cast<size_t>(y) * dstWidth + x) * 4];
+
+                float sum[4] = {};
+                for (const uint8_t* texel : texels) {
+                    for (int c = 0; c < 4; c++) {
+                        // Alpha is linear in every kind
+                        bool srgb = kind == Kind::Color && c < 3;
+                        sum[c] += srgb ? srgbTable[texel[c]] : (kind == Kind::Normal && c < 3 ? texel[c] / 127.5f - 1.f : texel[c] / 255.f);
+                    }
+                }
+                for (float& value : sum) value /= 4.f;
+
+                if (kind == Kind::Normal) {
+                    // The average of unit vectors is shorter, sampling expects unit length again
+                    glm::vec3 normal(sum[0], sum[1], sum[2]);
+                    float length = glm::length(normal);
+                    normal = length > 1e-6f ? normal / length : glm::vec3(0.f, 0.f, 1.f);
+                    for (int c = 0; c < 3; c++) out[c] = static_cast<uint8_t>(std::lround((normal[c] * 0.5f + 0.5f) * 255.f));
+                } else {
+                    for (int c = 0; c < 3; c++) {
+                        out[c] = kind == Kind::Color ? linearToSrgb8(sum[c]) : static_cast<uint8_t>(std::lround(sum[c] * 255.f));
+                    }
+                }
+                out[3] = static_cast<uint8_t>(std::lround(sum[3] * 255.f));
+            }
+        });
+
+        return dst;
+    }
+
+
+    bool isOpaque(const std::vector<uint8_t>& rgba)
+    {
+        for (size_t i = 3; i < rgba.size(); i += 4) {
+            if (rgba[i] != 255) return false;
+        }
+        return true;
+    }
+
+
+    Kind getKind(const std::filesystem::path& source)
+    {
+        std::string name = source.filename().string();
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        if (name.find("normal") != std::string::npos) return Kind::Normal;
+        if (name.find("specular") != std::string::npos) return Kind::Mask;
+        return Kind::Color;
+    }
+
+
+    bool bake(const std::filesystem::path& source, const std::filesystem::path& destination, const BakerOptions& options)
+    {
+        TRACE_SCOPE_CAT("Bake " + source.filename().string(), "asset");
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(source.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            spdlog::error("Failed to load texture image! {}", source.string());
+            return false;
+        }
+        std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        const Kind kind = getKind(source);
+        HostTexture texture;
+        if (kind == Kind::Normal) {
+            texture.format = VK_FORMAT_BC5_UNORM_BLOCK;
+        } else if (kind == Kind::Mask) {
+            texture.format = VK_FORMAT_BC4_UNORM_BLOCK;
+        } else {
+            texture.format = options.allowBC1 && isOpaque(level) ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+        }
+        texture.width = static_cast<uint32_t>(width);
+        texture.height = static_cast<uint32_t>(height);
+
+        // Full chain down to 1x1, every level filtered from the previous one
+        const uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+        for (uint32_t mip = 0; mip < mipLevels; mip++) {
+            uint32_t levelWidth = texture.getLevelWidth(mip);
+            uint32_t levelHeight = texture.getLevelHeight(mip);
+            if (mip > 0) level = downsample(level, texture.getLevelWidth(mip - 1), texture.getLevelHeight(mip - 1), kind);
+
+            std::vector<uint8_t> blocks = BlockCompression::compress(texture.format, level.data(), levelWidth, levelHeight);
+            texture.levels.push_back({ texture.data.size(), blocks.size() });
+            texture.data.insert(texture.data.end(), blocks.begin(), blocks.end());
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(destination.parent_path(), error);
+        if (!Ktx2::save(destination.string(), texture)) {
+            spdlog::error("Failed to write {}", destination.string());
+            return false;
+        }
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        const char* formatName = texture.format == VK_FORMAT_BC5_UNORM_BLOCK ? "BC5" : texture.format == VK_FORMAT_BC4_UNORM_BLOCK ? "BC4" :
+                                 texture.format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ? "BC1" : "BC7";
+        spdlog::info("Baked {} ({}x{}, {} mips, {}): {:.1f} MB -> {:.1f} MB in {:.0f} ms", source.string(), width, height, mipLevels, formatName,
+            static_cast<double>(width) * height * 4 / (1024 * 1024), texture.data.size() / (1024.0 * 1024.0),
+            std::chrono::duration<double, std::milli>(endTime - startTime).count());
+        return true;
+    }
+
+
+    bool bakeVirtual(const std::filesystem::path& source, const std::filesystem::path& destination)
+    {
+        TRACE_SCOPE_CAT("Bake " + source.filename().string(), "asset");
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(source.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            spdlog::error("Failed to load texture image! {}", source.string());
+            return false;
+        }
+        std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        VirtualTextureFile::Index index = VirtualTextureFile::createIndex(VK_FORMAT_BC7_SRGB_BLOCK, static_cast<uint32_t>(width),
+            static_cast<uint32_t>(height), VirtualTileSize, VirtualTileBorder);
+        const uint32_t paddedSize = index.getPaddedTileSize();
+        std::vector<std::vector<uint8_t>> tiles(index.tiles.size());
+
+        for (uint32_t mip = 0; mip < index.mips.size(); mip++) {
+            const VirtualTextureFile::Mip& info = index.mips[mip];
+            if (mip > 0) level = downsample(level, index.mips[mip - 1].width, index.mips[mip - 1].height, Kind::Color);
+
+            // Past the image the texels wrap around horizontally and repeat the edge row vertically, like the sampler
+            // of a whole equirectangular map would
+            ThreadPool::getInstance()->parallelFor(info.tilesX * info.tilesY, [&](uint32_t tile) {
+                const int32_t originX = static_cast<int32_t>((tile % info.tilesX) * index.tileSize) - static_cast<int32_t>(index.border);
+                const int32_t originY = static_cast<int32_t>((tile / info.tilesX) * index.tileSize) - static_cast<int32_t>(index.border);
+                const int32_t levelWidth = static_cast<int32_t>(info.width);
+                const int32_t levelHeight = static_cast<int32_t>(info.height);
+
+                std::vector<uint8_t> texels(static_cast<size_t>(paddedSize) * paddedSize * 4);
+                for (uint32_t y = 0; y < paddedSize; y++) {
+                    const int32_t sourceY = std::clamp(originY + static_cast<int32_t>(y), 0, levelHeight - 1);
+                    for (uint32_t x = 0; x < paddedSize; x++) {
+                        const int32_t sourceX = ((originX + static_cast<int32_t>(x)) % levelWidth + levelWidth) % levelWidth;
+                        memcpy(&texels[(static_cast<size_t>(y) * paddedSize + x) * 4], &level[(static_cast<size_t>(sourceY) * levelWidth + sourceX) * 4], 4);
+                    }
+                }
+                tiles[info.firstTile + tile] = BlockCompression::compress(index.format, texels.data(), paddedSize, paddedSize);
+            });
+        }
+        size_t totalSize = 0;
+        for (const auto& tile : tiles) totalSize += tile.size();
+
+        std::error_code error;
+        std::filesystem::create_directories(destination.parent_path(), error);
+        if (!VirtualTextureFile::save(destination.string(), index, tiles)) {
+            spdlog::error("Failed to write {}", destination.string());
+            return false;
+        }
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        spdlog::info("Baked {} ({}x{}, {} mips, {} tiles of {}+{}, BC7): {:.1f} MB -> {:.1f} MB in {:.0f} ms", source.string(), width, height,
+            index.mips.size(), tiles.size(), index.tileSize, 2 * index.border, static_cast<double>(width) * height * 4 / (1024 * 1024),
+            totalSize / (1024.0 * 1024.0), std::chrono::duration<double, std::milli>(endTime - startTime).count());
+        return true;
+    }
+
+
+    bool isSourceImage(const std::filesystem::path& path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".jpg" || extension == ".jpeg" || extension == ".png";
+    }
+
+}
+
+
+int main(int argc, char* argv[])
+{
+    BakerOptions options;
+    std::vector<std::filesystem::path> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--bc1") {
+            options.allowBC1 = true;
+        } else if (arg == "--virtual") {
+            options.virtualTexture = true;
+        } else if (arg == "--force") {
+            options.force = true;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) inputs.push_back("textures");
+
+    // Source images with the root their relative output path is taken from
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> sources;
+    for (const auto& input : inputs) {
+        std::error_code error;
+        if (std::filesystem::is_directory(input, error)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error)) {
+                if (entry.is_regular_file() && isSourceImage(entry.path())) sources.push_back({ entry.path(), input });
+            }
+        } else if (std::filesystem::is_regular_file(input, error) && isSourceImage(input)) {
+            sources.push_back({ input, input.parent_path() });
+        } else {
+            spdlog::warn("Skipping {}: not an image or a directory", input.string());
+        }
+    }
+
+    Tracer::getInstance();
+
+    uint32_t baked = 0;
+    uint32_t failed = 0;
+    uint32_t skipped = 0;
+    for (const auto& [source, root] : sources) {
+        if (options.virtualTexture && getKind(source) != Kind::Color) {
+            skipped++;
+            continue;
+        }
+
+        std::filesystem::path destination = options.outputDir.empty() ? source : options.outputDir / std::filesystem::relative(source, root);
+        destination.replace_extension(options.virtualTexture ? ".vtex" : ".ktx2");
+
+        // Up to date already
+        std::error_code error;
+        if (!options.force && std::filesystem::exists(destination, error) &&
+            std::filesystem::last_write_time(destination, error) >= std::filesystem::last_write_time(source, error)) {
+            continue;
+        }
+
+        if (options.virtualTexture ? bakeVirtual(source, destination) : bake(source, destination, options)) {
+            baked++;
+        } else {
+            failed++;
+        }
+    }
+
+    spdlog::info("Baked {} textures ({} up to date, {} not color, {} failed) on {} threads", baked, sources.size() - baked - failed - skipped,
+        skipped, failed, ThreadPool::getInstance()->getThreadCount());
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}